@@ -0,0 +1,499 @@
+/* Benchmark harness for the hot cml_math_* functions.
+ *
+ * Every benchmark runs in one of two modes:
+ *   latency     each operation consumes the result of the previous one,
+ *               so the time per op is the length of the dependency chain.
+ *   throughput  independent operations over arrays that stay in L1, so the
+ *               time per op is bounded by the execution ports.
+ * Results are printed as JSON with ns/op, millions of ops per second and
+ * ops/cycle. Cycles come from the time-stamp counter on x86, or from
+ * CML_BENCH_GHZ when it is set (useful where the core clock differs from the
+ * TSC rate). An op of bvh4_build is a whole build over BENCH_BVH_TRIS
+ * triangles, so its ns/op is the build time; an op of the traversal
+ * benchmarks is one ray, so their mops_per_s is Mrays/s.
+ *
+ * Usage: cml_bench [--quick] [--filter substring] */
+
+#include "cml.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+    #define CML_BENCH_TSC 1
+#endif
+
+/* Elements per array in throughput mode, small enough to stay in L1. */
+#define BENCH_N 256
+
+/* Triangles in the BVH benchmark scene. */
+#define BENCH_BVH_TRIS 65536
+
+/* Spheres in the culling benchmarks, enough to stream from memory. */
+#define BENCH_CULL_N (1u << 20)
+
+/*============================================================================*/
+/* Timing                                                                     */
+/*============================================================================*/
+
+static f64
+bench_now_ns(void) {
+    struct timespec t;
+#if defined(CLOCK_MONOTONIC)
+    clock_gettime(CLOCK_MONOTONIC, &t);
+#else
+    timespec_get(&t, TIME_UTC);
+#endif
+    return (f64)t.tv_sec * 1e9 + (f64)t.tv_nsec;
+}
+
+/* Returns the clock in GHz used for ops/cycle, or 0 when unknown. */
+static f64
+bench_ghz(void) {
+    const char* env = getenv("CML_BENCH_GHZ");
+    if (env) {
+        return atof(env);
+    }
+#if defined(CML_BENCH_TSC)
+    const f64 t0 = bench_now_ns();
+    const u64 c0 = __rdtsc();
+    while (bench_now_ns() - t0 < 50e6) {
+    }
+    const u64 c1 = __rdtsc();
+    return (f64)(c1 - c0) / (bench_now_ns() - t0);
+#else
+    return 0.0;
+#endif
+}
+
+/* Keeps the compiler from discarding results written to p. */
+static inline void
+bench_escape(void* p) {
+#if defined(__GNUC__) || defined(__clang__)
+    __asm__ volatile("" : : "g"(p) : "memory");
+#else
+    static void* volatile sink;
+    sink = p;
+#endif
+}
+
+/*============================================================================*/
+/* Data                                                                       */
+/*============================================================================*/
+
+static cml_align(64) vec2 g_v2a[BENCH_N], g_v2b[BENCH_N], g_v2o[BENCH_N];
+static cml_align(64) vec4 g_v4a[BENCH_N], g_v4b[BENCH_N], g_v4o[BENCH_N];
+static cml_align(64) mat4 g_m4a[BENCH_N], g_m4b[BENCH_N], g_m4o[BENCH_N];
+static cml_align(64) quat g_qa[BENCH_N], g_qb[BENCH_N], g_qo[BENCH_N];
+static cml_align(64) f64  g_fa[BENCH_N], g_ft[BENCH_N], g_fo[BENCH_N];
+static cml_align(64) u64  g_uo[BENCH_N];
+static rngx8 g_rng;
+
+/* Random small triangles in the unit cube, their BVH, and rays through the
+ * cube from the z = -1 plane. */
+static vec4* g_tri;
+static bvh4  g_bvh;
+static cml_align(64) vec4 g_ro[BENCH_N], g_rd[BENCH_N];
+
+/* Spheres scattered around the view frustum of g_frustum, in f64 and f32. */
+static vec4_soa  g_cull;
+static vec4f_soa g_cullf;
+static u64*      g_cull_mask;
+static frustum   g_frustum;
+
+/* Escapes every output array, so no stores into them are dead. */
+static inline void
+bench_escape_outputs(void) {
+    bench_escape(g_v2o);
+    bench_escape(g_v4o);
+    bench_escape(g_m4o);
+    bench_escape(g_qo);
+    bench_escape(g_fo);
+    bench_escape(g_uo);
+}
+
+static void
+bench_init(void) {
+    rng r;
+    cml_math_rng_seed(&r, 12345);
+    for (size_t i = 0; i < BENCH_N; i++) {
+        f64 x[8];
+        for (size_t j = 0; j < 8; j++) {
+            x[j] = cml_math_rng_next_f64(&r) * 2.0 - 1.0;
+        }
+        g_v2a[i] = cml_math_vec2_set(x[0], x[1]);
+        g_v2b[i] = cml_math_vec2_set(x[2], x[3]);
+        g_v4a[i] = cml_math_vec4_set(x[0], x[1], x[2], 1.0);
+        g_v4b[i] = cml_math_vec4_set(x[4], x[5], x[6], 0.0);
+        g_m4a[i] = cml_math_mat4_mul(
+                   cml_math_mat4_rotation(0.0, 0.0, 1.0, x[3]),
+                   cml_math_mat4_translation(x[4], x[5], x[6]));
+        g_m4b[i] = cml_math_mat4_rotation(1.0, 0.0, 0.0, x[7]);
+        g_qa[i]  = cml_math_quat_from_axis_angle(
+                   cml_math_vec4_set(0.0, 0.0, 1.0, 0.0), x[3]);
+        g_qb[i]  = cml_math_quat_from_axis_angle(
+                   cml_math_vec4_set(1.0, 0.0, 0.0, 0.0), x[7]);
+        g_fa[i]  = x[0] + 1.5;
+        g_ft[i]  = x[1] * 0.5 + 0.5;
+    }
+    cml_math_rngx8_seed(&g_rng, 6789);
+    g_tri = (vec4*)cml_aligned_alloc(64, 3 * BENCH_BVH_TRIS * sizeof(vec4));
+    if (!g_tri) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < BENCH_BVH_TRIS; i++) {
+        f64 c[3];
+        for (size_t k = 0; k < 3; k++) {
+            c[k] = cml_math_rng_next_f64(&r);
+        }
+        for (size_t k = 0; k < 3; k++) {
+            g_tri[3 * i + k] = cml_math_vec4_set(
+                               c[0] + 0.02 * cml_math_rng_next_f64(&r),
+                               c[1] + 0.02 * cml_math_rng_next_f64(&r),
+                               c[2] + 0.02 * cml_math_rng_next_f64(&r), 0.0);
+        }
+    }
+    g_bvh = cml_math_bvh4_build_triangles(g_tri, BENCH_BVH_TRIS);
+    g_cull      = cml_math_vec4_soa_alloc(BENCH_CULL_N);
+    g_cullf     = cml_math_vec4f_soa_alloc(BENCH_CULL_N);
+    g_cull_mask = (u64*)malloc(BENCH_CULL_N / 64 * sizeof(u64));
+    if (!g_cull.x || !g_cullf.x || !g_cull_mask) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < BENCH_CULL_N; i++) {
+        g_cull.x[i]  = (cml_math_rng_next_f64(&r) - 0.5) * 200.0;
+        g_cull.y[i]  = (cml_math_rng_next_f64(&r) - 0.5) * 200.0;
+        g_cull.z[i]  = -cml_math_rng_next_f64(&r) * 150.0;
+        g_cull.w[i]  = cml_math_rng_next_f64(&r);
+        g_cullf.x[i] = (f32)g_cull.x[i];
+        g_cullf.y[i] = (f32)g_cull.y[i];
+        g_cullf.z[i] = (f32)g_cull.z[i];
+        g_cullf.w[i] = (f32)g_cull.w[i];
+    }
+    g_frustum = cml_math_frustum_from_mat4(
+                cml_math_mat4_perspective(1.0, 1.5, 0.1, 100.0));
+    for (size_t i = 0; i < BENCH_N; i++) {
+        const f64 x = cml_math_rng_next_f64(&r);
+        const f64 y = cml_math_rng_next_f64(&r);
+        g_ro[i] = cml_math_vec4_set(x, y, -1.0, 0.0);
+        g_rd[i] = cml_math_vec4_set(cml_math_rng_next_f64(&r) - x,
+                                    cml_math_rng_next_f64(&r) - y,
+                                    1.0 + cml_math_rng_next_f64(&r), 0.0);
+    }
+}
+
+/*============================================================================*/
+/* Benchmarks                                                                 */
+/*============================================================================*/
+
+/* Each function runs reps repetitions and returns the number of ops. */
+typedef size_t (*bench_fn)(size_t reps);
+
+/* Defines a throughput benchmark: body runs once per array element i. */
+#define BENCH_THROUGHPUT(name, body)                                           \
+    static size_t                                                              \
+    bench_##name(const size_t reps) {                                          \
+        for (size_t r = 0; r < reps; r++) {                                    \
+            for (size_t i = 0; i < BENCH_N; i++) {                             \
+                body;                                                          \
+            }                                                                  \
+            bench_escape_outputs();                                            \
+        }                                                                      \
+        return reps * BENCH_N;                                                 \
+    }
+
+/* Defines a latency benchmark: body updates the state x in place. */
+#define BENCH_LATENCY(name, type, init, body)                                  \
+    static size_t                                                              \
+    bench_##name(const size_t reps) {                                          \
+        type x = init;                                                         \
+        for (size_t r = 0; r < reps; r++) {                                    \
+            body;                                                              \
+        }                                                                      \
+        bench_escape(&x);                                                      \
+        return reps;                                                           \
+    }
+
+BENCH_THROUGHPUT(vec2_add, g_v2o[i] = cml_math_vec2_add(g_v2a[i], g_v2b[i]))
+BENCH_THROUGHPUT(vec2_dot,
+                 g_fo[i] = cml_math_vec2_dot_product(g_v2a[i], g_v2b[i]))
+BENCH_THROUGHPUT(vec2_normalize, g_v2o[i] = cml_math_vec2_normalize(g_v2a[i]))
+BENCH_LATENCY(vec2_add_lat, vec2, g_v2a[0],
+              x = cml_math_vec2_add(x, g_v2b[0]))
+
+BENCH_THROUGHPUT(vec4_add, g_v4o[i] = cml_math_vec4_add(g_v4a[i], g_v4b[i]))
+BENCH_THROUGHPUT(vec4_dot,
+                 g_fo[i] = cml_math_vec4_dot_product(g_v4a[i], g_v4b[i]))
+BENCH_THROUGHPUT(vec4_normalize, g_v4o[i] = cml_math_vec4_normalize(g_v4a[i]))
+BENCH_LATENCY(vec4_normalize_lat, vec4, g_v4a[0],
+              x = cml_math_vec4_normalize(x))
+
+BENCH_THROUGHPUT(mat4_mul, g_m4o[i] = cml_math_mat4_mul(g_m4a[i], g_m4b[i]))
+BENCH_THROUGHPUT(mat4_inverse, g_m4o[i] = cml_math_mat4_inverse(g_m4a[i]))
+BENCH_THROUGHPUT(mat4_mul_vec4,
+                 g_v4o[i] = cml_math_mat4_mul_vec4(g_m4a[i], g_v4a[i]))
+BENCH_THROUGHPUT(mat4_transform_points,
+                 cml_math_mat4_transform_points(&g_m4a[0], &g_v4a[i],
+                                                &g_v4o[i], 1))
+BENCH_LATENCY(mat4_mul_lat, mat4, g_m4a[0],
+              x = cml_math_mat4_mul(x, g_m4b[0]))
+
+BENCH_THROUGHPUT(quat_mul, g_qo[i] = cml_math_quat_mul(g_qa[i], g_qb[i]))
+BENCH_THROUGHPUT(quat_slerp,
+                 g_qo[i] = cml_math_quat_slerp(g_qa[i], g_qb[i], 0.3))
+BENCH_THROUGHPUT(quat_rotate,
+                 g_v4o[i] = cml_math_quat_rotate(g_qa[i], g_v4a[i]))
+
+static size_t
+bench_quat_slerp_array(const size_t reps) {
+    for (size_t r = 0; r < reps; r++) {
+        cml_math_quat_slerp_array(g_qa, g_qb, g_ft, g_qo, BENCH_N);
+        bench_escape(g_qo);
+    }
+    return reps * BENCH_N;
+}
+
+static size_t
+bench_quat_nlerp_array(const size_t reps) {
+    for (size_t r = 0; r < reps; r++) {
+        cml_math_quat_nlerp_array(g_qa, g_qb, g_ft, g_qo, BENCH_N);
+        bench_escape(g_qo);
+    }
+    return reps * BENCH_N;
+}
+
+BENCH_LATENCY(quat_mul_lat, quat, g_qa[0], x = cml_math_quat_mul(x, g_qb[0]))
+
+BENCH_LATENCY(rng_next_lat, u64, 0,
+              x ^= cml_math_rng_next(cml_math_rng_thread()))
+
+static size_t
+bench_rand_fill_u64(const size_t reps) {
+    for (size_t r = 0; r < reps; r++) {
+        cml_math_rand_fill_u64(&g_rng, g_uo, BENCH_N);
+        bench_escape(g_uo);
+    }
+    return reps * BENCH_N;
+}
+
+static size_t
+bench_rand_fill_f64(const size_t reps) {
+    for (size_t r = 0; r < reps; r++) {
+        cml_math_rand_fill_f64(&g_rng, g_fo, BENCH_N);
+        bench_escape(g_fo);
+    }
+    return reps * BENCH_N;
+}
+
+/* Defines a throughput benchmark of cml_math_<name>_array. */
+#define BENCH_ARRAY(name)                                                      \
+    static size_t                                                              \
+    bench_##name##_array(const size_t reps) {                                  \
+        for (size_t r = 0; r < reps; r++) {                                    \
+            cml_math_##name##_array(g_fa, g_fo, BENCH_N);                      \
+            bench_escape(g_fo);                                                \
+        }                                                                      \
+        return reps * BENCH_N;                                                 \
+    }
+
+BENCH_ARRAY(sin)
+BENCH_ARRAY(exp)
+BENCH_ARRAY(log)
+BENCH_ARRAY(sqrt)
+BENCH_LATENCY(f64x4_sin_lat, f64x4, simde_mm256_set1_pd(0.5),
+              x = cml_math_sin(simde_mm256_add_pd(x,
+                               simde_mm256_set1_pd(1.0))))
+
+static size_t
+bench_array_sum(const size_t reps) {
+    for (size_t r = 0; r < reps; r++) {
+        g_fo[0] = cml_math_array_sum(g_fa, BENCH_N, CML_REDUCE_FAST);
+        bench_escape(g_fo);
+    }
+    return reps * BENCH_N;
+}
+
+static size_t
+bench_bvh4_build(const size_t reps) {
+    for (size_t r = 0; r < reps; r++) {
+        bvh4 b = cml_math_bvh4_build_triangles(g_tri, BENCH_BVH_TRIS);
+        bench_escape(b.nodes);
+        cml_math_bvh4_free(&b);
+    }
+    return reps;
+}
+
+static size_t
+bench_bvh4_intersect(const size_t reps) {
+    for (size_t r = 0; r < reps; r++) {
+        for (size_t i = 0; i < BENCH_N; i++) {
+            bvh4_hit h;
+            g_uo[i] = cml_math_bvh4_intersect_triangles(&g_bvh, g_tri,
+                                                        g_ro[i], g_rd[i], 0.0,
+                                                        INFINITY, &h);
+        }
+        bench_escape(g_uo);
+    }
+    return reps * BENCH_N;
+}
+
+static size_t
+bench_bvh4_occluded(const size_t reps) {
+    for (size_t r = 0; r < reps; r++) {
+        for (size_t i = 0; i < BENCH_N; i++) {
+            g_uo[i] = cml_math_bvh4_occluded_triangles(&g_bvh, g_tri,
+                                                       g_ro[i], g_rd[i], 0.0,
+                                                       INFINITY);
+        }
+        bench_escape(g_uo);
+    }
+    return reps * BENCH_N;
+}
+
+static size_t
+bench_frustum_cull_spheres(const size_t reps) {
+    for (size_t r = 0; r < reps; r++) {
+        g_uo[0] = cml_math_frustum_cull_spheres(&g_frustum, &g_cull,
+                                                g_cull_mask);
+        bench_escape(g_cull_mask);
+    }
+    return reps * BENCH_CULL_N;
+}
+
+static size_t
+bench_frustum_cull_spheres_f32(const size_t reps) {
+    for (size_t r = 0; r < reps; r++) {
+        g_uo[0] = cml_math_frustum_cull_spheres_f32(&g_frustum, &g_cullf,
+                                                    g_cull_mask);
+        bench_escape(g_cull_mask);
+    }
+    return reps * BENCH_CULL_N;
+}
+
+typedef struct bench {
+    const char* name;
+    const char* mode;
+    bench_fn    fn;
+} bench;
+
+static const bench g_benches[] = {
+    {"vec2_add",              "throughput", bench_vec2_add},
+    {"vec2_add",              "latency",    bench_vec2_add_lat},
+    {"vec2_dot",              "throughput", bench_vec2_dot},
+    {"vec2_normalize",        "throughput", bench_vec2_normalize},
+    {"vec4_add",              "throughput", bench_vec4_add},
+    {"vec4_dot",              "throughput", bench_vec4_dot},
+    {"vec4_normalize",        "throughput", bench_vec4_normalize},
+    {"vec4_normalize",        "latency",    bench_vec4_normalize_lat},
+    {"mat4_mul",              "throughput", bench_mat4_mul},
+    {"mat4_mul",              "latency",    bench_mat4_mul_lat},
+    {"mat4_inverse",          "throughput", bench_mat4_inverse},
+    {"mat4_mul_vec4",         "throughput", bench_mat4_mul_vec4},
+    {"mat4_transform_points", "throughput", bench_mat4_transform_points},
+    {"quat_mul",              "throughput", bench_quat_mul},
+    {"quat_mul",              "latency",    bench_quat_mul_lat},
+    {"quat_slerp",            "throughput", bench_quat_slerp},
+    {"quat_slerp_array",      "throughput", bench_quat_slerp_array},
+    {"quat_nlerp_array",      "throughput", bench_quat_nlerp_array},
+    {"quat_rotate",           "throughput", bench_quat_rotate},
+    {"rng_next",              "latency",    bench_rng_next_lat},
+    {"rand_fill_u64",         "throughput", bench_rand_fill_u64},
+    {"rand_fill_f64",         "throughput", bench_rand_fill_f64},
+    {"sin_array",             "throughput", bench_sin_array},
+    {"exp_array",             "throughput", bench_exp_array},
+    {"log_array",             "throughput", bench_log_array},
+    {"sqrt_array",            "throughput", bench_sqrt_array},
+    {"f64x4_sin",             "latency",    bench_f64x4_sin_lat},
+    {"array_sum",             "throughput", bench_array_sum},
+    {"bvh4_build",            "throughput", bench_bvh4_build},
+    {"bvh4_intersect",        "throughput", bench_bvh4_intersect},
+    {"bvh4_occluded",         "throughput", bench_bvh4_occluded},
+    {"cull_spheres",          "throughput", bench_frustum_cull_spheres},
+    {"cull_spheres_f32",      "throughput", bench_frustum_cull_spheres_f32},
+};
+
+/* Returns the best ns/op of five runs of about target_ns each. */
+static f64
+bench_run(const bench_fn fn, const f64 target_ns) {
+    size_t reps = 1;
+    for (;;) {
+        const f64 t0 = bench_now_ns();
+        fn(reps);
+        if (bench_now_ns() - t0 >= target_ns / 4 || reps >> 40) {
+            break;
+        }
+        reps *= 2;
+    }
+    f64 best = HUGE_VAL;
+    for (i32 k = 0; k < 5; k++) {
+        const f64 t0  = bench_now_ns();
+        const size_t ops = fn(reps);
+        const f64 ns  = (bench_now_ns() - t0) / (f64)ops;
+        best = ns < best ? ns : best;
+    }
+    return best;
+}
+
+static const char*
+bench_backend(void) {
+#if defined(SIMDE_NO_NATIVE)
+    return "scalar";
+#elif defined(SIMDE_X86_AVX512F_NATIVE)
+    return "avx512";
+#elif defined(SIMDE_X86_AVX2_NATIVE)
+    return "avx2";
+#elif defined(SIMDE_X86_SSE2_NATIVE)
+    return "sse2";
+#else
+    return "other";
+#endif
+}
+
+int
+main(int argc, char** argv) {
+    f64 target_ns = 100e6;
+    const char* filter = NULL;
+    for (i32 i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            target_ns = 1e6;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--filter substring]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    bench_init();
+    const f64 ghz = bench_ghz();
+    printf("{\n  \"backend\": \"%s\",\n  \"ghz\": %.3f,\n  \"results\": [",
+           bench_backend(), ghz);
+    const char* sep = "\n";
+    const size_t count = sizeof(g_benches) / sizeof(g_benches[0]);
+    for (size_t i = 0; i < count; i++) {
+        const bench* b = &g_benches[i];
+        if (filter && !strstr(b->name, filter)) {
+            continue;
+        }
+        const f64 ns = bench_run(b->fn, target_ns);
+        printf("%s    {\"name\": \"%s\", \"mode\": \"%s\", "
+               "\"ns_per_op\": %.4f, \"mops_per_s\": %.4f, ", sep, b->name,
+               b->mode, ns, 1e3 / ns);
+        if (ghz > 0.0) {
+            printf("\"ops_per_cycle\": %.4f}", 1.0 / (ns * ghz));
+        } else {
+            printf("\"ops_per_cycle\": null}");
+        }
+        sep = ",\n";
+        fflush(stdout);
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
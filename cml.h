@@ -15,6 +15,15 @@
 #include <float.h>
 #include <math.h>
 #include <string.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+#if defined(_OPENMP)
+    #include <omp.h>
+#endif
 
 /*===========================================================================*/
 /* Compiler Helpers                                                          */
@@ -47,6 +56,88 @@
     #error "Unsupported compiler"
 #endif
 
+/* GCC and clang on x86 expose cpuid through __builtin_cpu_supports, which
+ * runtime dispatch uses to detect the instruction set; elsewhere it falls
+ * back to the build's baseline. */
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+    #define CML_DISPATCH_X86
+#endif
+
+/* Compiler-specific storage class for thread-local variables. */
+#if defined(__GNUC__) || defined(__clang__)
+    #define cml_thread_local _Thread_local
+#elif defined(_MSC_VER)
+    #define cml_thread_local __declspec(thread)
+#else
+    #error "Unsupported compiler"
+#endif
+
+/* Compiler-specific storage class for a global defined in every translation
+ * unit that includes this header, which the linker merges into one. */
+#if defined(__GNUC__) || defined(__clang__)
+    #define cml_shared __attribute__((weak))
+#elif defined(_MSC_VER)
+    #define cml_shared __declspec(selectany)
+#else
+    #error "Unsupported compiler"
+#endif
+
+/* Compiler-specific relaxed atomic fetch-and-add on a u64. */
+#if defined(__GNUC__) || defined(__clang__)
+    #define cml_atomic_fetch_add(p, v)                                         \
+        __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+#elif defined(_MSC_VER)
+    #define cml_atomic_fetch_add(p, v)                                         \
+        ((u64)_InterlockedExchangeAdd64((volatile long long*)(p),              \
+                                        (long long)(v)))
+#else
+    #error "Unsupported compiler"
+#endif
+
+/* Compiler-specific acquire load, release store and compare-and-swap on an
+ * i32. cml_atomic_cas replaces *p with v if it equals e and returns whether
+ * it did. */
+#if defined(__GNUC__) || defined(__clang__)
+    #define cml_atomic_load_acquire(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define cml_atomic_store_release(p, v)                                     \
+        __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define cml_atomic_cas(p, e, v)                                            \
+        __sync_bool_compare_and_swap((p), (e), (v))
+#elif defined(_MSC_VER)
+    #define cml_atomic_load_acquire(p)                                         \
+        ((i32)_InterlockedCompareExchange((volatile long*)(p), 0, 0))
+    #define cml_atomic_store_release(p, v)                                     \
+        ((void)_InterlockedExchange((volatile long*)(p), (long)(v)))
+    #define cml_atomic_cas(p, e, v)                                            \
+        (_InterlockedCompareExchange((volatile long*)(p), (long)(v),           \
+                                     (long)(e)) == (long)(e))
+#else
+    #error "Unsupported compiler"
+#endif
+
+/* Compiler-specific population count and trailing zero count of a u64. The
+ * trailing zero count is undefined for zero. */
+#if defined(__GNUC__) || defined(__clang__)
+    #define cml_popcount64(x) ((u32)__builtin_popcountll(x))
+    #define cml_ctz64(x)      ((u32)__builtin_ctzll(x))
+#elif defined(_MSC_VER)
+    #define cml_popcount64(x) ((u32)__popcnt64(x))
+    #define cml_ctz64(x)      ((u32)_tzcnt_u64(x))
+#else
+    #error "Unsupported compiler"
+#endif
+
+/* Compiler-specific aligned allocation. The size passed to cml_aligned_alloc
+ * must be a multiple of the alignment. */
+#if defined(_MSC_VER)
+    #define cml_aligned_alloc(a, s) _aligned_malloc((s), (a))
+    #define cml_aligned_free(p)     _aligned_free(p)
+#else
+    #define cml_aligned_alloc(a, s) aligned_alloc((a), (s))
+    #define cml_aligned_free(p)     free(p)
+#endif
+
 /*===========================================================================*/
 /* Signed Integer Types                                                      */
 /*===========================================================================*/
@@ -100,6 +191,107 @@ typedef simde__m256d f64x4;
 /* 512-Bit Vector of 64-Bit Floating-Point Numbers */
 typedef simde__m512d f64x8;
 
+/*===========================================================================*/
+/* Native-Width Vector Types                                                 */
+/*===========================================================================*/
+
+/* f64xn is the widest f64 vector the target executes natively. Array kernels
+ * are written against these helpers so they process 8 lanes per instruction
+ * on AVX-512 and 4 lanes everywhere else, where SIMDE maps f64x4 onto the
+ * best available instructions. */
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+    #define CML_F64XN_LANES 8
+    typedef f64x8 f64xn;
+    #define cml_f64xn_loadu(p)        simde_mm512_loadu_pd(p)
+    #define cml_f64xn_storeu(p, a)    simde_mm512_storeu_pd(p, a)
+    #define cml_f64xn_store(p, a)     simde_mm512_store_pd(p, a)
+    #define cml_f64xn_set1(s)         simde_mm512_set1_pd(s)
+    #define cml_f64xn_add(a, b)       simde_mm512_add_pd(a, b)
+    #define cml_f64xn_sub(a, b)       simde_mm512_sub_pd(a, b)
+    #define cml_f64xn_mul(a, b)       simde_mm512_mul_pd(a, b)
+    #define cml_f64xn_div(a, b)       simde_mm512_div_pd(a, b)
+    #define cml_f64xn_sqrt(a)         simde_mm512_sqrt_pd(a)
+    #define cml_f64xn_min(a, b)       simde_mm512_min_pd(a, b)
+    #define cml_f64xn_max(a, b)       simde_mm512_max_pd(a, b)
+    #define cml_f64xn_fmadd(a, b, c)  simde_mm512_fmadd_pd(a, b, c)
+    #define cml_f64xn_fmsub(a, b, c)  simde_mm512_fmsub_pd(a, b, c)
+    #define cml_f64xn_fnmadd(a, b, c) simde_mm512_fnmadd_pd(a, b, c)
+    #define cml_f64xn_abs(a)          simde_mm512_abs_pd(a)
+    #define cml_f64xn_cmpge_mask(a, b)                                         \
+        ((u32)simde_mm512_cmp_pd_mask(a, b, SIMDE_CMP_GE_OQ))
+    #define cml_f64xn_cmpgt_mask(a, b)                                         \
+        ((u32)simde_mm512_cmp_pd_mask(a, b, SIMDE_CMP_GT_OQ))
+    #define cml_f64xn_cmpnlt_mask(a, b)                                        \
+        ((u32)simde_mm512_cmp_pd_mask(a, b, SIMDE_CMP_NLT_UQ))
+#else
+    #define CML_F64XN_LANES 4
+    typedef f64x4 f64xn;
+    #define cml_f64xn_loadu(p)        simde_mm256_loadu_pd(p)
+    #define cml_f64xn_storeu(p, a)    simde_mm256_storeu_pd(p, a)
+    #define cml_f64xn_store(p, a)     simde_mm256_store_pd(p, a)
+    #define cml_f64xn_set1(s)         simde_mm256_set1_pd(s)
+    #define cml_f64xn_add(a, b)       simde_mm256_add_pd(a, b)
+    #define cml_f64xn_sub(a, b)       simde_mm256_sub_pd(a, b)
+    #define cml_f64xn_mul(a, b)       simde_mm256_mul_pd(a, b)
+    #define cml_f64xn_div(a, b)       simde_mm256_div_pd(a, b)
+    #define cml_f64xn_sqrt(a)         simde_mm256_sqrt_pd(a)
+    #define cml_f64xn_min(a, b)       simde_mm256_min_pd(a, b)
+    #define cml_f64xn_max(a, b)       simde_mm256_max_pd(a, b)
+    #define cml_f64xn_fmadd(a, b, c)  simde_mm256_fmadd_pd(a, b, c)
+    #define cml_f64xn_fmsub(a, b, c)  simde_mm256_fmsub_pd(a, b, c)
+    #define cml_f64xn_fnmadd(a, b, c) simde_mm256_fnmadd_pd(a, b, c)
+    #define cml_f64xn_abs(a)                                                   \
+        simde_mm256_andnot_pd(simde_mm256_set1_pd(-0.0), a)
+    #define cml_f64xn_cmpge_mask(a, b)                                         \
+        ((u32)simde_mm256_movemask_pd(                                         \
+            simde_mm256_cmp_pd(a, b, SIMDE_CMP_GE_OQ)))
+    #define cml_f64xn_cmpgt_mask(a, b)                                         \
+        ((u32)simde_mm256_movemask_pd(                                         \
+            simde_mm256_cmp_pd(a, b, SIMDE_CMP_GT_OQ)))
+    #define cml_f64xn_cmpnlt_mask(a, b)                                        \
+        ((u32)simde_mm256_movemask_pd(                                         \
+            simde_mm256_cmp_pd(a, b, SIMDE_CMP_NLT_UQ)))
+#endif
+
+/* f32xn is the f32 counterpart of f64xn, with twice the lanes. Only the
+ * operations the single-precision stream kernels need are defined. */
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+    #define CML_F32XN_LANES 16
+    typedef f32x16 f32xn;
+    #define cml_f32xn_loadu(p)        simde_mm512_loadu_ps(p)
+    #define cml_f32xn_set1(s)         simde_mm512_set1_ps(s)
+    #define cml_f32xn_add(a, b)       simde_mm512_add_ps(a, b)
+    #define cml_f32xn_min(a, b)       simde_mm512_min_ps(a, b)
+    #define cml_f32xn_fmadd(a, b, c)  simde_mm512_fmadd_ps(a, b, c)
+    #define cml_f32xn_cmpnlt_mask(a, b)                                        \
+        ((u32)simde_mm512_cmp_ps_mask(a, b, SIMDE_CMP_NLT_UQ))
+#else
+    #define CML_F32XN_LANES 8
+    typedef f32x8 f32xn;
+    #define cml_f32xn_loadu(p)        simde_mm256_loadu_ps(p)
+    #define cml_f32xn_set1(s)         simde_mm256_set1_ps(s)
+    #define cml_f32xn_add(a, b)       simde_mm256_add_ps(a, b)
+    #define cml_f32xn_min(a, b)       simde_mm256_min_ps(a, b)
+    #define cml_f32xn_fmadd(a, b, c)  simde_mm256_fmadd_ps(a, b, c)
+    #define cml_f32xn_cmpnlt_mask(a, b)                                        \
+        ((u32)simde_mm256_movemask_ps(                                         \
+            simde_mm256_cmp_ps(a, b, SIMDE_CMP_NLT_UQ)))
+#endif
+
+/* Transposes four f64x4 rows in place. Used to move data between
+ * array-of-structures and structure-of-arrays layouts. */
+cml_inline void
+cml_math_f64x4_transpose(f64x4 r[4]) {
+    const f64x4 t0 = simde_mm256_unpacklo_pd(r[0], r[1]);
+    const f64x4 t1 = simde_mm256_unpackhi_pd(r[0], r[1]);
+    const f64x4 t2 = simde_mm256_unpacklo_pd(r[2], r[3]);
+    const f64x4 t3 = simde_mm256_unpackhi_pd(r[2], r[3]);
+    r[0] = simde_mm256_permute2f128_pd(t0, t2, 0x20);
+    r[1] = simde_mm256_permute2f128_pd(t1, t3, 0x20);
+    r[2] = simde_mm256_permute2f128_pd(t0, t2, 0x31);
+    r[3] = simde_mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
 /*============================================================================*/
 /* Mathematical Constants                                                     */
 /*============================================================================*/
@@ -131,6 +323,15 @@ typedef simde__m512d f64x8;
 /* 1 / (4 * Pi) */
 #define CML_1_DIV_4_MUL_PI   0.079577471545947667884441881686257181
 
+/* 2 / Pi */
+#define CML_2_DIV_PI         0.636619772367581343075535053490057448
+
+/* Natural logarithm of 2 */
+#define CML_LN_2             0.693147180559945309417232121458176568
+
+/* Base-2 logarithm of e */
+#define CML_LOG2_E           1.442695040888963407359924681001892137
+
 /* Square root of 2 */
 #define CML_SQRT_2           1.414213562373095048801688724209698079
 
@@ -219,6 +420,53 @@ typedef simde__m512d f64x8;
 /* Elementary Functions                                                       */
 /*============================================================================*/
 
+/* The f64x4 and f64x8 entries of sin, cos, exp, log and atan2. Without a
+ * vector libm behind SIMDE (native SVML, or SLEEF), they use the built-in
+ * polynomial kernels further down instead of per-lane libm calls. Those
+ * are within 1 ulp; defining CML_FAST_MATH selects their 4 ulp tier for
+ * sin, cos, exp and log, which also drops the special-value handling.
+ * sincos always uses the built-in kernels. */
+#if defined(SIMDE_X86_SVML_NATIVE) || defined(SIMDE_MATH_SLEEF_ENABLE)
+    #define cml_f64x4_sin   simde_mm256_sin_pd
+    #define cml_f64x8_sin   simde_mm512_sin_pd
+    #define cml_f64x4_cos   simde_mm256_cos_pd
+    #define cml_f64x8_cos   simde_mm512_cos_pd
+    #define cml_f64x4_exp   simde_mm256_exp_pd
+    #define cml_f64x8_exp   simde_mm512_exp_pd
+    #define cml_f64x4_log   simde_mm256_log_pd
+    #define cml_f64x8_log   simde_mm512_log_pd
+    #define cml_f64x4_atan2 simde_mm256_atan2_pd
+    #define cml_f64x8_atan2 simde_mm512_atan2_pd
+    #define cml_f64x4_sincos cml_math_sincos_u1_f64x4
+    #define cml_f64x8_sincos cml_math_sincos_u1_f64x8
+#elif defined(CML_FAST_MATH)
+    #define cml_f64x4_sin   cml_math_sin_u4_f64x4
+    #define cml_f64x8_sin   cml_math_sin_u4_f64x8
+    #define cml_f64x4_cos   cml_math_cos_u4_f64x4
+    #define cml_f64x8_cos   cml_math_cos_u4_f64x8
+    #define cml_f64x4_exp   cml_math_exp_u4_f64x4
+    #define cml_f64x8_exp   cml_math_exp_u4_f64x8
+    #define cml_f64x4_log   cml_math_log_u4_f64x4
+    #define cml_f64x8_log   cml_math_log_u4_f64x8
+    #define cml_f64x4_atan2 cml_math_atan2_u1_f64x4
+    #define cml_f64x8_atan2 cml_math_atan2_u1_f64x8
+    #define cml_f64x4_sincos cml_math_sincos_u4_f64x4
+    #define cml_f64x8_sincos cml_math_sincos_u4_f64x8
+#else
+    #define cml_f64x4_sin   cml_math_sin_u1_f64x4
+    #define cml_f64x8_sin   cml_math_sin_u1_f64x8
+    #define cml_f64x4_cos   cml_math_cos_u1_f64x4
+    #define cml_f64x8_cos   cml_math_cos_u1_f64x8
+    #define cml_f64x4_exp   cml_math_exp_u1_f64x4
+    #define cml_f64x8_exp   cml_math_exp_u1_f64x8
+    #define cml_f64x4_log   cml_math_log_u1_f64x4
+    #define cml_f64x8_log   cml_math_log_u1_f64x8
+    #define cml_f64x4_atan2 cml_math_atan2_u1_f64x4
+    #define cml_f64x8_atan2 cml_math_atan2_u1_f64x8
+    #define cml_f64x4_sincos cml_math_sincos_u1_f64x4
+    #define cml_f64x8_sincos cml_math_sincos_u1_f64x8
+#endif
+
 /*---------------*/
 /* Trigonometric */
 /*---------------*/
@@ -229,9 +477,9 @@ typedef simde__m512d f64x8;
     f32x4:  simde_mm_sin_ps,                                                   \
     f64x2:  simde_mm_sin_pd,                                                   \
     f32x8:  simde_mm256_sin_ps,                                                \
-    f64x4:  simde_mm256_sin_pd,                                                \
+    f64x4:  cml_f64x4_sin,                                                     \
     f32x16: simde_mm512_sin_ps,                                                \
-    f64x8:  simde_mm512_sin_pd                                                 \
+    f64x8:  cml_f64x8_sin                                                      \
 )(x)
 
 #define cml_math_cos(x) _Generic((x),                                          \
@@ -240,9 +488,9 @@ typedef simde__m512d f64x8;
     f32x4:  simde_mm_cos_ps,                                                   \
     f64x2:  simde_mm_cos_pd,                                                   \
     f32x8:  simde_mm256_cos_ps,                                                \
-    f64x4:  simde_mm256_cos_pd,                                                \
+    f64x4:  cml_f64x4_cos,                                                     \
     f32x16: simde_mm512_cos_ps,                                                \
-    f64x8:  simde_mm512_cos_pd                                                 \
+    f64x8:  cml_f64x8_cos                                                      \
 )(x)
 
 #define cml_math_tan(x) _Generic((x),                                          \
@@ -289,17 +537,24 @@ typedef simde__m512d f64x8;
     f64x8:  simde_mm512_atan_pd                                                \
 )(x)
 
-#define cml_math_atan2(y, x) _Generic((y, x),                                  \
+#define cml_math_atan2(y, x) _Generic((x),                                     \
     f32:    atan2f,                                                            \
     f64:    atan2,                                                             \
     f32x4:  simde_mm_atan2_ps,                                                 \
     f64x2:  simde_mm_atan2_pd,                                                 \
     f32x8:  simde_mm256_atan2_ps,                                              \
-    f64x4:  simde_mm256_atan2_pd,                                              \
+    f64x4:  cml_f64x4_atan2,                                                   \
     f32x16: simde_mm512_atan2_ps,                                              \
-    f64x8:  simde_mm512_atan2_pd                                               \
+    f64x8:  cml_f64x8_atan2                                                    \
 )(y, x)
 
+/* Computes *s = sin(x) and *c = cos(x) with one argument reduction. */
+#define cml_math_sincos(x, s, c) _Generic((x),                                 \
+    f64:    cml_math_sincos_f64,                                               \
+    f64x4:  cml_f64x4_sincos,                                                  \
+    f64x8:  cml_f64x8_sincos                                                   \
+)(x, s, c)
+
 /*------------*/
 /* Hyperbolic */
 /*------------*/
@@ -380,9 +635,9 @@ typedef simde__m512d f64x8;
     f32x4:  simde_mm_exp_ps,                                                   \
     f64x2:  simde_mm_exp_pd,                                                   \
     f32x8:  simde_mm256_exp_ps,                                                \
-    f64x4:  simde_mm256_exp_pd,                                                \
+    f64x4:  cml_f64x4_exp,                                                     \
     f32x16: simde_mm512_exp_ps,                                                \
-    f64x8:  simde_mm512_exp_pd                                                 \
+    f64x8:  cml_f64x8_exp                                                      \
 )(x)
 
 #define cml_math_exp2(x) _Generic((x),                                         \
@@ -428,9 +683,9 @@ typedef simde__m512d f64x8;
     f32x4:  simde_mm_log_ps,                                                   \
     f64x2:  simde_mm_log_pd,                                                   \
     f32x8:  simde_mm256_log_ps,                                                \
-    f64x4:  simde_mm256_log_pd,                                                \
+    f64x4:  cml_f64x4_log,                                                     \
     f32x16: simde_mm512_log_ps,                                                \
-    f64x8:  simde_mm512_log_pd                                                 \
+    f64x8:  cml_f64x8_log                                                      \
 )(x)
 
 #define cml_math_log2(x) _Generic((x),                                         \
@@ -540,15 +795,72 @@ typedef simde__m512d f64x8;
     f64x8:  simde_mm512_floor_pd                                               \
 )(x)
 
+/* Vector round, halfway cases away from zero like the C round. Adding the
+ * largest value below 0.5 with the sign of x and truncating is exact: the
+ * sum only reaches the next integer when x is at or past the halfway
+ * point. The SIMDE round intrinsics take a rounding-mode immediate, so they
+ * cannot sit in the one-argument _Generic table directly. */
+cml_inline f32x4
+cml_math_round_f32x4(const f32x4 x) {
+    const f32x4 h = simde_mm_or_ps(simde_mm_set1_ps(0x1.fffffep-2f),
+                    simde_mm_and_ps(x, simde_mm_set1_ps(-0.0f)));
+    return simde_mm_round_ps(simde_mm_add_ps(x, h),
+                             SIMDE_MM_FROUND_TO_ZERO | SIMDE_MM_FROUND_NO_EXC);
+}
+
+cml_inline f64x2
+cml_math_round_f64x2(const f64x2 x) {
+    const f64x2 h = simde_mm_or_pd(simde_mm_set1_pd(0x1.fffffffffffffp-2),
+                    simde_mm_and_pd(x, simde_mm_set1_pd(-0.0)));
+    return simde_mm_round_pd(simde_mm_add_pd(x, h),
+                             SIMDE_MM_FROUND_TO_ZERO | SIMDE_MM_FROUND_NO_EXC);
+}
+
+cml_inline f32x8
+cml_math_round_f32x8(const f32x8 x) {
+    const f32x8 h = simde_mm256_or_ps(simde_mm256_set1_ps(0x1.fffffep-2f),
+                    simde_mm256_and_ps(x, simde_mm256_set1_ps(-0.0f)));
+    return simde_mm256_round_ps(simde_mm256_add_ps(x, h),
+                                SIMDE_MM_FROUND_TO_ZERO |
+                                SIMDE_MM_FROUND_NO_EXC);
+}
+
+cml_inline f64x4
+cml_math_round_f64x4(const f64x4 x) {
+    const f64x4 h = simde_mm256_or_pd(simde_mm256_set1_pd(0x1.fffffffffffffp-2),
+                    simde_mm256_and_pd(x, simde_mm256_set1_pd(-0.0)));
+    return simde_mm256_round_pd(simde_mm256_add_pd(x, h),
+                                SIMDE_MM_FROUND_TO_ZERO |
+                                SIMDE_MM_FROUND_NO_EXC);
+}
+
+cml_inline f32x16
+cml_math_round_f32x16(const f32x16 x) {
+    const f32x16 h = simde_mm512_or_ps(simde_mm512_set1_ps(0x1.fffffep-2f),
+                     simde_mm512_and_ps(x, simde_mm512_set1_ps(-0.0f)));
+    return simde_mm512_roundscale_ps(simde_mm512_add_ps(x, h),
+                                     SIMDE_MM_FROUND_TO_ZERO |
+                                     SIMDE_MM_FROUND_NO_EXC);
+}
+
+cml_inline f64x8
+cml_math_round_f64x8(const f64x8 x) {
+    const f64x8 h = simde_mm512_or_pd(simde_mm512_set1_pd(0x1.fffffffffffffp-2),
+                    simde_mm512_and_pd(x, simde_mm512_set1_pd(-0.0)));
+    return simde_mm512_roundscale_pd(simde_mm512_add_pd(x, h),
+                                     SIMDE_MM_FROUND_TO_ZERO |
+                                     SIMDE_MM_FROUND_NO_EXC);
+}
+
 #define cml_math_round(x) _Generic((x),                                        \
     f32:    roundf,                                                            \
     f64:    round,                                                             \
-    f32x4:  simde_mm_round_ps,                                                 \
-    f64x2:  simde_mm_round_pd,                                                 \
-    f32x8:  simde_mm256_round_ps,                                              \
-    f64x4:  simde_mm256_round_pd,                                              \
-    f32x16: simde_mm512_round_ps,                                              \
-    f64x8:  simde_mm512_round_pd                                               \
+    f32x4:  cml_math_round_f32x4,                                              \
+    f64x2:  cml_math_round_f64x2,                                              \
+    f32x8:  cml_math_round_f32x8,                                              \
+    f64x4:  cml_math_round_f64x4,                                              \
+    f32x16: cml_math_round_f32x16,                                             \
+    f64x8:  cml_math_round_f64x8                                               \
 )(x)
 
 #define cml_math_trunc(x) _Generic((x),                                        \
@@ -714,12 +1026,11 @@ typedef simde__m512d f64x8;
 
 /* Calculates the factorial of a given value. */
 #define cml_math_factorial(x)                                                  \
-    ((x) == 0 ? 1 : (x) * cml_math_factorial((x) - 1))
+    cml_math_factorial_f64((u32)(x))
 
 /* Calculates the binomial coefficient of a given value. */
 #define cml_math_binomial(n, k)                                                \
-    (cml_math_factorial(n) / (cml_math_factorial(k) *                          \
-                              cml_math_factorial(n - k)))
+    cml_math_binomial_f64((u32)(n), (u32)(k))
 
 /* Calculates the greatest common divisor of two given values. */
 #define cml_math_gcd(a, b)                                                     \
@@ -743,14 +1054,13 @@ typedef simde__m512d f64x8;
 #define cml_math_quadratic(a, b, c, x)                                         \
     (((b) * (b)) - (4 * (a) * (c))) / (2 * (a) * (x))
 
-/* Calculates the sum of a given array of n values. */
+/* Calculates the sum of a given array of n f64 values. */
 #define cml_math_horizontal_sum(a, n)                                          \
-    ((n) == 1 ? (a)[0] : (a)[0] + cml_math_horizontal_sum((a) + 1, (n) - 1))
+    cml_math_array_sum((a), (n), CML_REDUCE_FAST)
 
-/* Calculates the product of a given array of n values. */
+/* Calculates the product of a given array of n f64 values. */
 #define cml_math_horizontal_product(a, n)                                      \
-    ((n) == 1 ? (a)[0] : (a)[0] *                                              \
-     cml_math_horizontal_product((a) + 1, (n) - 1))
+    cml_math_array_product((a), (n))
 
 /* Linear interpolation. */
 #define cml_math_lerp(a, b, t)                                                 \
@@ -771,22 +1081,33 @@ typedef simde__m512d f64x8;
     (cml_math_lerp(cml_math_lerp((a), (b), (t)),                               \
                    (c), (u)))
 
-/* Catmull-Rom interpolation. */
+/* Catmull-Rom interpolation between b and c, with a and d as the outer
+ * control points. */
 #define cml_math_catmullrom(a, b, c, d, t)                                     \
-    (cml_math_lerp(cml_math_barycentric((a), (b), (c), (t), 0.5),              \
-                   cml_math_barycentric((b), (c), (d), (t), 0.5), (t)))
+    (0.5 * ((2.0 * (b)) + (t) * (((c) - (a)) + (t) *                           \
+     ((2.0 * (a) - 5.0 * (b) + 4.0 * (c) - (d)) + (t) *                        \
+     (3.0 * ((b) - (c)) + (d) - (a))))))
 
-/* Hermite interpolation. */
+/* Hermite-style blend of the control points a, b, c and d, kept with its
+ * original arguments and results. For the cubic Hermite curve through points
+ * and tangents use cml_math_cubic_hermite. */
 #define cml_math_hermite(a, b, c, d, t)                                        \
     (cml_math_lerp(cml_math_barycentric((a), (b), (c), (t), 0.5),              \
                    cml_math_barycentric((b), (c), (d), (t), 0.5),              \
                    cml_math_square((t))))
 
-/* Bezier interpolation. */
+/* Cubic Hermite interpolation from point p0 with tangent m0 to point p1 with
+ * tangent m1, the basis of CML_SPLINE_HERMITE tracks. */
+#define cml_math_cubic_hermite(p0, m0, p1, m1, t)                              \
+    ((p0) + (t) * ((m0) + (t) * ((3.0 * ((p1) - (p0)) - 2.0 * (m0) - (m1)) +   \
+     (t) * (2.0 * ((p0) - (p1)) + (m0) + (m1)))))
+
+/* Cubic Bezier interpolation from a to d, with b and c as the inner control
+ * points. */
 #define cml_math_bezier(a, b, c, d, t)                                         \
-    (cml_math_lerp(cml_math_barycentric((a), (b), (c), (t), 0.5),              \
-                   cml_math_barycentric((b), (c), (d), (t), 0.5),              \
-                   cml_math_cube((t))))
+    ((1.0 - (t)) * (1.0 - (t)) * (1.0 - (t)) * (a) +                           \
+     3.0 * (1.0 - (t)) * (1.0 - (t)) * (t) * (b) +                             \
+     3.0 * (1.0 - (t)) * (t) * (t) * (c) + (t) * (t) * (t) * (d))
 
 /* Calculates the size of an array in bytes. */
 #define cml_math_array_size(x)                                                 \
@@ -899,783 +1220,2199 @@ cml_math_reinterpret_m512i_as_m512d(simde__m512i i) {
 }
 
 /*============================================================================*/
-/* Random Number Generation                                                   */
+/* Vectorized Elementary Function Kernels                                     */
 /*============================================================================*/
 
-/*----------------*/
-/* Scalar Version */
-/*----------------*/
+/* Polynomial kernels that run entirely in vector registers, independent of
+ * whether SIMDE or SLEEF provide a vector libm. The coefficients are the
+ * fdlibm ones, accurate to within 1 ulp on their reduced ranges. */
+
+/* log((1 + s) / (1 - s)) = 2s + s * R(s^2), R(z) = z * (Lg1 + z * Lg2...). */
+static const f64 cml_log_coeffs[7] = {
+    6.666666666666735130e-01, 3.999999999940941908e-01,
+    2.857142874366239149e-01, 2.222219843214978396e-01,
+    1.818357216161805012e-01, 1.531383769920937332e-01,
+    1.479819860511658591e-01
+};
+
+/* sin(x) = x + x^3 * (S1 + x^2 * (S2 + ...)) on [-pi/4, pi/4]. */
+static const f64 cml_sin_coeffs[6] = {
+    -1.66666666666666324348e-01,  8.33333333332248946124e-03,
+    -1.98412698298579493134e-04,  2.75573137070700676789e-06,
+    -2.50507602534068634195e-08,  1.58969099521155010221e-10
+};
+
+/* cos(x) = 1 - x^2 / 2 + x^4 * (C1 + x^2 * (C2 + ...)) on [-pi/4, pi/4]. */
+static const f64 cml_cos_coeffs[6] = {
+     4.16666666666666019037e-02, -1.38888888888741095749e-03,
+     2.48015872894767294178e-05, -2.75573143513906633035e-07,
+     2.08757232129817482790e-09, -1.13596475577881948265e-11
+};
+
+/* Natural logarithm of 2, split so that e * CML_LN2_HI is exact. */
+#define CML_LN2_HI 6.93147180369123816490e-01
+#define CML_LN2_LO 1.90821492927058770002e-10
+
+/* Evaluates c[0] + x * (c[1] + x * (... + x * c[n - 1])) by Horner's rule. */
+cml_inline f64x4
+cml_math_horner_f64x4(const f64x4 x, const f64* c, const i32 n) {
+    f64x4 p = simde_mm256_set1_pd(c[n - 1]);
+    for (i32 i = n - 2; i >= 0; i--) {
+        p = simde_mm256_fmadd_pd(x, p, simde_mm256_set1_pd(c[i]));
+    }
+    return p;
+}
+
+/* Natural logarithm of four positive, finite, normal doubles. The argument is
+ * split as x = 2^e * m with m in [sqrt(2)/2, sqrt(2)), and
+ * log(m) = 2 * atanh(f / (2 + f)) with f = m - 1. */
+cml_inline f64x4
+cml_math_log_f64x4(const f64x4 x) {
+    const simde__m256i bits  = simde_mm256_castpd_si256(x);
+    const simde__m256i mmask = simde_mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL);
+    const simde__m256i one   = simde_mm256_set1_epi64x(0x3FF0000000000000LL);
+    const simde__m256i two52 = simde_mm256_set1_epi64x(0x4330000000000000LL);
+    /* Reading the biased exponent as the low bits of 2^52 converts it to a
+     * double without an integer conversion instruction. */
+    f64x4 e = simde_mm256_sub_pd(
+              simde_mm256_castsi256_pd(
+              simde_mm256_or_si256(simde_mm256_srli_epi64(bits, 52), two52)),
+              simde_mm256_set1_pd(4503599627370496.0 + 1023.0));
+    f64x4 m = simde_mm256_castsi256_pd(
+              simde_mm256_or_si256(simde_mm256_and_si256(bits, mmask), one));
+    const f64x4 big = simde_mm256_cmp_pd(m, simde_mm256_set1_pd(CML_SQRT_2),
+                                         SIMDE_CMP_GT_OQ);
+    m = simde_mm256_blendv_pd(m, 
+        simde_mm256_mul_pd(m, simde_mm256_set1_pd(0.5)), big);
+    e = simde_mm256_add_pd(e, 
+        simde_mm256_and_pd(big, simde_mm256_set1_pd(1.0)));
+    const f64x4 f    = simde_mm256_sub_pd(m, simde_mm256_set1_pd(1.0));
+    const f64x4 s    = simde_mm256_div_pd(f, 
+                       simde_mm256_add_pd(f, simde_mm256_set1_pd(2.0)));
+    const f64x4 z    = simde_mm256_mul_pd(s, s);
+    const f64x4 hfsq = simde_mm256_mul_pd(simde_mm256_set1_pd(0.5),
+                       simde_mm256_mul_pd(f, f));
+    const f64x4 r    = simde_mm256_mul_pd(z, 
+                       cml_math_horner_f64x4(z, cml_log_coeffs, 7));
+    /* log(m) = f - (hfsq - s * (hfsq + R)), with e * ln(2) added in two
+     * parts so the large term stays exact. */
+    f64x4 y;
+    y = simde_mm256_fmsub_pd(e, simde_mm256_set1_pd(CML_LN2_LO), hfsq);
+    y = simde_mm256_fmadd_pd(s, simde_mm256_add_pd(hfsq, r), y);
+    y = simde_mm256_add_pd(f, y);
+    return simde_mm256_fmadd_pd(e, simde_mm256_set1_pd(CML_LN2_HI), y);
+}
+
+/* sin(x) for |x| <= pi/4. */
+cml_inline f64x4
+cml_math_sin_kernel_f64x4(const f64x4 x) {
+    const f64x4 z = simde_mm256_mul_pd(x, x);
+    return simde_mm256_fmadd_pd(simde_mm256_mul_pd(z, x),
+           cml_math_horner_f64x4(z, cml_sin_coeffs, 6), x);
+}
+
+/* cos(x) for |x| <= pi/4. */
+cml_inline f64x4
+cml_math_cos_kernel_f64x4(const f64x4 x) {
+    const f64x4 z  = simde_mm256_mul_pd(x, x);
+    const f64x4 hz = simde_mm256_mul_pd(z, simde_mm256_set1_pd(0.5));
+    const f64x4 w  = simde_mm256_sub_pd(simde_mm256_set1_pd(1.0), hz);
+    /* w + (((1 - w) - hz) + z^2 * p) recovers the rounding error of
+     * 1 - hz. */
+    return simde_mm256_add_pd(w, 
+           simde_mm256_fmadd_pd(simde_mm256_mul_pd(z, z),
+           cml_math_horner_f64x4(z, cml_cos_coeffs, 6),
+           simde_mm256_sub_pd(
+           simde_mm256_sub_pd(simde_mm256_set1_pd(1.0), w), hz)));
+}
+
+/* Rotates kernel results sk = sin(r), ck = cos(r) by q quarter turns, where q
+ * holds the quadrant in the low two bits of each 64-bit lane. */
+cml_inline void
+cml_math_sincos_quadrant_f64x4(const f64x4 sk, const f64x4 ck,
+                               const simde__m256i q, f64x4* s, f64x4* c) {
+    const simde__m256i one = simde_mm256_set1_epi64x(1);
+    const simde__m256i two = simde_mm256_set1_epi64x(2);
+    const f64x4 swap     = simde_mm256_castsi256_pd(
+                           simde_mm256_cmpeq_epi64(
+                           simde_mm256_and_si256(q, one), one));
+    const f64x4 sin_sign = simde_mm256_castsi256_pd(
+                           simde_mm256_slli_epi64(
+                           simde_mm256_and_si256(q, two), 62));
+    const f64x4 cos_sign = simde_mm256_castsi256_pd(
+                           simde_mm256_slli_epi64(
+                           simde_mm256_and_si256(
+                           simde_mm256_add_epi64(q, one), two), 62));
+    *s = simde_mm256_xor_pd(simde_mm256_blendv_pd(sk, ck, swap), sin_sign);
+    *c = simde_mm256_xor_pd(simde_mm256_blendv_pd(ck, sk, swap), cos_sign);
+}
+
+/* Computes sin(2 * pi * t) and cos(2 * pi * t) for |t| < 2^50, within 2 ulp.
+ * Reducing in turns rather than radians is exact, which makes this the
+ * natural kernel for random angles drawn as uniform fractions of a
+ * circle. */
+cml_inline void
+cml_math_sincos_turns_f64x4(const f64x4 t, f64x4* s, f64x4* c) {
+    /* Adding 1.5 * 2^52 rounds 4t to the nearest integer k and leaves k in
+     * the low mantissa bits. */
+    const f64x4 magic = simde_mm256_set1_pd(6755399441055744.0);
+    const f64x4 kbits = simde_mm256_add_pd(
+                        simde_mm256_mul_pd(t, simde_mm256_set1_pd(4.0)), 
+                        magic);
+    const f64x4 k     = simde_mm256_sub_pd(kbits, magic);
+    const f64x4 f     = simde_mm256_fnmadd_pd(k, simde_mm256_set1_pd(0.25), t);
+    const f64x4 r     = simde_mm256_mul_pd(f, 
+                        simde_mm256_set1_pd(CML_2_MUL_PI));
+    cml_math_sincos_quadrant_f64x4(cml_math_sin_kernel_f64x4(r),
+                                   cml_math_cos_kernel_f64x4(r),
+                                   simde_mm256_castpd_si256(kbits), s, c);
+}
+
+/* asin(x) = x + x * R(x^2) on [-0.5, 0.5], with R a rational function. */
+static const f64 cml_asin_p_coeffs[6] = {
+     1.66666666666666657415e-01, -3.25565818622400915405e-01,
+     2.01212532134862925881e-01, -4.00555345006794114027e-02,
+     7.91534994289814532176e-04,  3.47933107596021167570e-05
+};
+
+static const f64 cml_asin_q_coeffs[5] = {
+     1.00000000000000000000e+00, -2.40339491173441421878e+00,
+     2.02094576023350569471e+00, -6.88283971605453293030e-01,
+     7.70381505559019352791e-02
+};
+
+/* Pi / 2, split so that the high part is exact. */
+#define CML_PI_DIV_2_HI 1.57079632679489655800e+00
+#define CML_PI_DIV_2_LO 6.12323399573676603587e-17
+
+/* Arc cosine of four doubles in [-1, 1], within 2 ulp. Arguments with
+ * |x| > 0.5 go through acos(x) = 2 * asin(sqrt((1 - |x|) / 2)), mirrored
+ * about pi / 2 for negative x, so the whole domain shares one rational
+ * kernel. */
+cml_inline f64x4
+cml_math_acos_f64x4(const f64x4 x) {
+    const f64x4 half = simde_mm256_set1_pd(0.5);
+    const f64x4 ax   = simde_mm256_andnot_pd(simde_mm256_set1_pd(-0.0), x);
+    const f64x4 big  = simde_mm256_cmp_pd(ax, half, SIMDE_CMP_GT_OQ);
+    const f64x4 zb   = simde_mm256_mul_pd(half,
+                       simde_mm256_sub_pd(simde_mm256_set1_pd(1.0), ax));
+    const f64x4 z    = simde_mm256_blendv_pd(simde_mm256_mul_pd(x, x), zb, big);
+    const f64x4 r    = simde_mm256_div_pd(
+                       simde_mm256_mul_pd(z,
+                       cml_math_horner_f64x4(z, cml_asin_p_coeffs, 6)),
+                       cml_math_horner_f64x4(z, cml_asin_q_coeffs, 5));
+    /* |x| <= 0.5: pi / 2 - (x + x * r). */
+    const f64x4 small = simde_mm256_sub_pd(simde_mm256_set1_pd(CML_PI_DIV_2_HI),
+                        simde_mm256_sub_pd(x,
+                        simde_mm256_fnmadd_pd(x, r,
+                        simde_mm256_set1_pd(CML_PI_DIV_2_LO))));
+    /* |x| > 0.5: 2 * (s + s * r) with s = sqrt(z), or pi minus that. */
+    const f64x4 s     = simde_mm256_sqrt_pd(z);
+    const f64x4 v     = simde_mm256_mul_pd(simde_mm256_set1_pd(2.0),
+                        simde_mm256_fmadd_pd(s, r, s));
+    const f64x4 neg   = simde_mm256_cmp_pd(x, simde_mm256_setzero_pd(),
+                                           SIMDE_CMP_LT_OQ);
+    const f64x4 large = simde_mm256_blendv_pd(v,
+                        simde_mm256_sub_pd(simde_mm256_set1_pd(CML_PI), v),
+                        neg);
+    return simde_mm256_blendv_pd(small, large, big);
+}
+
+/* sin(x) for x in [0, pi / 2]. Above pi / 4 it evaluates cos(pi / 2 - x)
+ * instead, so only the polynomial kernels are needed. */
+cml_inline f64x4
+cml_math_sin_half_pi_f64x4(const f64x4 x) {
+    const f64x4 upper = simde_mm256_cmp_pd(x, simde_mm256_set1_pd(CML_PI_DIV_4),
+                                           SIMDE_CMP_GT_OQ);
+    const f64x4 y     = simde_mm256_add_pd(
+                        simde_mm256_sub_pd(
+                        simde_mm256_set1_pd(CML_PI_DIV_2_HI), x),
+                        simde_mm256_set1_pd(CML_PI_DIV_2_LO));
+    return simde_mm256_blendv_pd(cml_math_sin_kernel_f64x4(x),
+                                 cml_math_cos_kernel_f64x4(y), upper);
+}
+
+/*-------------------*/
+/* Full-Domain Tiers */
+/*-------------------*/
+
+/* Complete sin, cos, sincos, exp, log and atan2 over f64x4 and f64x8, built
+ * on the kernels above so that vector code needs no libm. Each function
+ * comes in two tiers, named after their error bound as in SLEEF:
+ *
+ * _u1 is within 1 ulp and follows C99 Annex F for every input: signed
+ *     zeros, infinities, NaN and subnormals. Trigonometric arguments above
+ *     CML_TRIG_REDUCE_MAX go to scalar libm, one lane at a time.
+ * _u4 is within 4 ulp for finite, normal arguments (sin and cos up to
+ *     CML_TRIG_REDUCE_MAX, exp in [-708, 709]) and skips the special-value
+ *     handling. Outside that domain the result is unspecified.
+ *
+ * atan2 has only the _u1 tier, as its cost is the division and reductions
+ * that a faster tier would still need. */
+
+/* pi / 2 split into 33-bit parts, so that k * CML_PIO2_1 and k * CML_PIO2_2
+ * are exact for k < 2^20 (fdlibm). */
+#define CML_PIO2_1 1.57079632673412561417e+00
+#define CML_PIO2_2 6.07710050630396597660e-11
+#define CML_PIO2_3 2.02226624871116645580e-21
+
+/* pi / 2 split into two doubles, for reduction with fused multiply-adds. */
+#define CML_PIO2_FMA_HI 1.57079632679489655800e+00
+#define CML_PIO2_FMA_LO 6.12323399573676603587e-17
+
+/* Largest |x| the vector trigonometric kernels reduce themselves. */
+#define CML_TRIG_REDUCE_MAX 1048576.0
+
+/* exp(r) = 1 + r + r^2 * (1 / 2! + r * (1 / 3! + ...)) for |r| <= ln(2) / 2.
+ * Thirteen terms leave a truncation error below 2^-58; the _u4 tier drops
+ * the last one. */
+static const f64 cml_exp_coeffs[12] = {
+    1.0 / 2.0,                 1.0 / 6.0,
+    1.0 / 24.0,                1.0 / 120.0,
+    1.0 / 720.0,               1.0 / 5040.0,
+    1.0 / 40320.0,             1.0 / 362880.0,
+    1.0 / 3628800.0,           1.0 / 39916800.0,
+    1.0 / 479001600.0,         1.0 / 6227020800.0
+};
+
+/* atan(t) = t - t * z * P(z), z = t^2, for |t| <= 7 / 16 (fdlibm). */
+static const f64 cml_atan_coeffs[11] = {
+     3.33333333333329318027e-01, -1.99999999998764832476e-01,
+     1.42857142725034663711e-01, -1.11111104054623557880e-01,
+     9.09088713343650656196e-02, -7.69187620504482999495e-02,
+     6.66107313738753120669e-02, -5.83357013379057348645e-02,
+     4.97687799461593236017e-02, -3.65315727442169155270e-02,
+     1.62858201153657823623e-02
+};
+
+/* Pi / 4, split so that the high part is exact. */
+#define CML_PI_DIV_4_HI 7.85398163397448278999e-01
+#define CML_PI_DIV_4_LO 3.06161699786838301793e-17
+
+/* tan(pi / 8), the reduced range of the atan polynomial. */
+#define CML_TAN_PI_DIV_8 4.14213562373095034e-01
+
+/* Low and high halves of an f64x8, and the reverse. */
+cml_inline f64x4
+cml_math_f64x8_lo(const f64x8 x) {
+    return simde_mm512_castpd512_pd256(x);
+}
+
+cml_inline f64x4
+cml_math_f64x8_hi(const f64x8 x) {
+    return simde_mm512_extractf64x4_pd(x, 1);
+}
+
+cml_inline f64x8
+cml_math_f64x8_join(const f64x4 lo, const f64x4 hi) {
+    return simde_mm512_insertf64x4(simde_mm512_castpd256_pd512(lo), hi, 1);
+}
+
+/* Applies a scalar function to every lane of x. */
+cml_inline f64x4
+cml_math_f64x4_map_scalar(const f64x4 x, f64 (*f)(f64)) {
+    f64 v[4];
+    simde_mm256_storeu_pd(v, x);
+    for (i32 i = 0; i < 4; i++) {
+        v[i] = f(v[i]);
+    }
+    return simde_mm256_loadu_pd(v);
+}
+
+/* sin(x + y) for |x| <= pi / 4 and a tail |y| << ulp(x) (fdlibm). */
+cml_inline f64x4
+cml_math_sin_kernel_tail_f64x4(const f64x4 x, const f64x4 y) {
+    const f64x4 z = simde_mm256_mul_pd(x, x);
+    const f64x4 v = simde_mm256_mul_pd(z, x);
+    const f64x4 p = cml_math_horner_f64x4(z, cml_sin_coeffs + 1, 5);
+    /* x - ((z * (y / 2 - v * p) - y) - v * S1) */
+    const f64x4 u = simde_mm256_fmsub_pd(z,
+                    simde_mm256_fnmadd_pd(v, p,
+                    simde_mm256_mul_pd(y, simde_mm256_set1_pd(0.5))), y);
+    return simde_mm256_sub_pd(x, simde_mm256_fnmadd_pd(v,
+           simde_mm256_set1_pd(cml_sin_coeffs[0]), u));
+}
+
+/* cos(x + y) for |x| <= pi / 4 and a tail |y| << ulp(x) (fdlibm). */
+cml_inline f64x4
+cml_math_cos_kernel_tail_f64x4(const f64x4 x, const f64x4 y) {
+    const f64x4 z  = simde_mm256_mul_pd(x, x);
+    const f64x4 hz = simde_mm256_mul_pd(z, simde_mm256_set1_pd(0.5));
+    const f64x4 w  = simde_mm256_sub_pd(simde_mm256_set1_pd(1.0), hz);
+    /* w + (((1 - w) - hz) + (z^2 * p - x * y)) */
+    return simde_mm256_add_pd(w,
+           simde_mm256_add_pd(
+           simde_mm256_sub_pd(
+           simde_mm256_sub_pd(simde_mm256_set1_pd(1.0), w), hz),
+           simde_mm256_fmsub_pd(simde_mm256_mul_pd(z, z),
+           cml_math_horner_f64x4(z, cml_cos_coeffs, 6),
+           simde_mm256_mul_pd(x, y))));
+}
+
+/* sin and cos of |x| = k * pi / 2 + r, with the quadrant k in the low bits
+ * of the lanes of kbits. The _u1 reduction keeps r as a sum hi + lo of
+ * exact products; the _u4 one rounds r to a double with two fused
+ * multiply-adds. */
+cml_inline void
+cml_math_sincos_reduce_f64x4(const f64x4 ax, const bool fast, f64x4* s,
+                             f64x4* c) {
+    const f64x4 magic = simde_mm256_set1_pd(6755399441055744.0);
+    const f64x4 kbits = simde_mm256_add_pd(
+                        simde_mm256_mul_pd(ax,
+                        simde_mm256_set1_pd(CML_2_DIV_PI)), magic);
+    const f64x4 k     = simde_mm256_sub_pd(kbits, magic);
+    const simde__m256i q = simde_mm256_castpd_si256(kbits);
+    if (fast) {
+        f64x4 r;
+        r = simde_mm256_fnmadd_pd(k, simde_mm256_set1_pd(CML_PIO2_FMA_HI), ax);
+        r = simde_mm256_fnmadd_pd(k, simde_mm256_set1_pd(CML_PIO2_FMA_LO), r);
+        cml_math_sincos_quadrant_f64x4(cml_math_sin_kernel_f64x4(r),
+                                       cml_math_cos_kernel_f64x4(r), q, s, c);
+    } else {
+        /* ax - k * pio2_1 is exact, by Sterbenz's lemma, and the error of
+         * subtracting k * pio2_2 is recovered by TwoSum. k * pio2_3 can
+         * exceed ulp(r), so hi + lo is renormalized at the end. */
+        const f64x4 a  = simde_mm256_fnmadd_pd(k,
+                         simde_mm256_set1_pd(CML_PIO2_1), ax);
+        const f64x4 b  = simde_mm256_mul_pd(k,
+                         simde_mm256_set1_pd(CML_PIO2_2));
+        const f64x4 h  = simde_mm256_sub_pd(a, b);
+        const f64x4 av = simde_mm256_add_pd(h, b);
+        const f64x4 e  = simde_mm256_add_pd(simde_mm256_sub_pd(a, av),
+                         simde_mm256_sub_pd(simde_mm256_sub_pd(av, h), b));
+        const f64x4 l  = simde_mm256_fnmadd_pd(k,
+                         simde_mm256_set1_pd(CML_PIO2_3), e);
+        const f64x4 hi = simde_mm256_add_pd(h, l);
+        const f64x4 lo = simde_mm256_add_pd(simde_mm256_sub_pd(h, hi), l);
+        cml_math_sincos_quadrant_f64x4(cml_math_sin_kernel_tail_f64x4(hi, lo),
+                                       cml_math_cos_kernel_tail_f64x4(hi, lo),
+                                       q, s, c);
+    }
+}
+
+/* Computes sin(x) and cos(x) together, within 1 ulp. */
+cml_inline void
+cml_math_sincos_u1_f64x4(const f64x4 x, f64x4* s, f64x4* c) {
+    const f64x4 sign = simde_mm256_set1_pd(-0.0);
+    const f64x4 ax   = simde_mm256_andnot_pd(sign, x);
+    cml_math_sincos_reduce_f64x4(ax, false, s, c);
+    *s = simde_mm256_xor_pd(*s, simde_mm256_and_pd(sign, x));
+    /* NaN, infinities and arguments too large to reduce. */
+    const f64x4 ok = simde_mm256_cmp_pd(ax,
+                     simde_mm256_set1_pd(CML_TRIG_REDUCE_MAX),
+                     SIMDE_CMP_LE_OQ);
+    if (simde_mm256_movemask_pd(ok) != 0xF) {
+        *s = simde_mm256_blendv_pd(cml_math_f64x4_map_scalar(x, sin), *s, ok);
+        *c = simde_mm256_blendv_pd(cml_math_f64x4_map_scalar(x, cos), *c, ok);
+    }
+}
 
-/*----------------------------------------------------*/
-/* RNG - xoshiro256+ - Drop-in replacement for rand() */
-/*----------------------------------------------------*/
+/* Computes sin(x) and cos(x) together, within 4 ulp. */
+cml_inline void
+cml_math_sincos_u4_f64x4(const f64x4 x, f64x4* s, f64x4* c) {
+    const f64x4 sign = simde_mm256_set1_pd(-0.0);
+    cml_math_sincos_reduce_f64x4(simde_mm256_andnot_pd(sign, x), true, s, c);
+    *s = simde_mm256_xor_pd(*s, simde_mm256_and_pd(sign, x));
+}
+
+/* Sine, within 1 ulp. */
+cml_inline f64x4
+cml_math_sin_u1_f64x4(const f64x4 x) {
+    f64x4 s, c;
+    cml_math_sincos_u1_f64x4(x, &s, &c);
+    return s;
+}
+
+/* Cosine, within 1 ulp. */
+cml_inline f64x4
+cml_math_cos_u1_f64x4(const f64x4 x) {
+    f64x4 s, c;
+    cml_math_sincos_u1_f64x4(x, &s, &c);
+    return c;
+}
+
+/* Sine, within 4 ulp. */
+cml_inline f64x4
+cml_math_sin_u4_f64x4(const f64x4 x) {
+    f64x4 s, c;
+    cml_math_sincos_u4_f64x4(x, &s, &c);
+    return s;
+}
+
+/* Cosine, within 4 ulp. */
+cml_inline f64x4
+cml_math_cos_u4_f64x4(const f64x4 x) {
+    f64x4 s, c;
+    cml_math_sincos_u4_f64x4(x, &s, &c);
+    return c;
+}
+
+/* 2^k for integral k in [-1022, 1023], built in the exponent field. */
+cml_inline f64x4
+cml_math_pow2i_f64x4(const f64x4 k) {
+    const f64x4 bias = simde_mm256_set1_pd(6755399441055744.0 + 1023.0);
+    const simde__m256i bits = simde_mm256_castpd_si256(
+                              simde_mm256_add_pd(k, bias));
+    return simde_mm256_castsi256_pd(simde_mm256_slli_epi64(bits, 52));
+}
+
+/* exp(r) - 1 for |r| <= ln(2) / 2, from the first n Taylor terms past r. */
+cml_inline f64x4
+cml_math_expm1_kernel_f64x4(const f64x4 r, const i32 n) {
+    return simde_mm256_fmadd_pd(simde_mm256_mul_pd(r, r),
+           cml_math_horner_f64x4(r, cml_exp_coeffs, n), r);
+}
+
+/* Splits x = k * ln(2) + r + rl with |r| <= ln(2) / 2 and rl the rounding
+ * error of r. */
+cml_inline f64x4
+cml_math_exp_reduce_f64x4(const f64x4 x, f64x4* r, f64x4* rl) {
+    const f64x4 magic = simde_mm256_set1_pd(6755399441055744.0);
+    const f64x4 k     = simde_mm256_sub_pd(
+                        simde_mm256_fmadd_pd(x,
+                        simde_mm256_set1_pd(CML_LOG2_E), magic), magic);
+    /* x - k * ln2_hi is exact. */
+    const f64x4 a     = simde_mm256_fnmadd_pd(k,
+                        simde_mm256_set1_pd(CML_LN2_HI), x);
+    *r  = simde_mm256_fnmadd_pd(k, simde_mm256_set1_pd(CML_LN2_LO), a);
+    *rl = simde_mm256_fnmadd_pd(k, simde_mm256_set1_pd(CML_LN2_LO),
+                                simde_mm256_sub_pd(a, *r));
+    return k;
+}
+
+/* Exponential, within 1 ulp. Overflows to infinity above 709.78 and goes
+ * through the subnormals to zero below -708.4. */
+cml_inline f64x4
+cml_math_exp_u1_f64x4(const f64x4 x) {
+    /* Clamping first keeps k in range; NaN passes through max and min. */
+    const f64x4 xc = simde_mm256_min_pd(simde_mm256_set1_pd(710.0),
+                     simde_mm256_max_pd(simde_mm256_set1_pd(-746.0), x));
+    f64x4 r, rl;
+    const f64x4 k  = cml_math_exp_reduce_f64x4(xc, &r, &rl);
+    /* exp(r + rl) = exp(r) * (1 + rl), to first order. */
+    const f64x4 p  = cml_math_expm1_kernel_f64x4(r, 12);
+    const f64x4 e  = simde_mm256_add_pd(simde_mm256_set1_pd(1.0),
+                     simde_mm256_fmadd_pd(p, rl, simde_mm256_add_pd(p, rl)));
+    /* 2^k in two factors, so that results near the ends of the range
+     * neither overflow early nor lose the subnormals. */
+    const f64x4 magic = simde_mm256_set1_pd(6755399441055744.0);
+    const f64x4 k1 = simde_mm256_sub_pd(
+                     simde_mm256_fmadd_pd(k, simde_mm256_set1_pd(0.5), magic),
+                     magic);
+    const f64x4 k2 = simde_mm256_sub_pd(k, k1);
+    return simde_mm256_mul_pd(
+           simde_mm256_mul_pd(e, cml_math_pow2i_f64x4(k1)),
+           cml_math_pow2i_f64x4(k2));
+}
+
+/* Exponential of x in [-708, 709], within 4 ulp. */
+cml_inline f64x4
+cml_math_exp_u4_f64x4(const f64x4 x) {
+    f64x4 r, rl;
+    const f64x4 k = cml_math_exp_reduce_f64x4(x, &r, &rl);
+    return simde_mm256_mul_pd(
+           simde_mm256_add_pd(simde_mm256_set1_pd(1.0),
+                              cml_math_expm1_kernel_f64x4(r, 11)),
+           cml_math_pow2i_f64x4(k));
+}
+
+/* Natural logarithm, within 1 ulp. Subnormals are scaled into the normal
+ * range first; zero gives -inf, negative numbers NaN. */
+cml_inline f64x4
+cml_math_log_u1_f64x4(const f64x4 x) {
+    const f64x4 normal = simde_mm256_and_pd(
+                         simde_mm256_cmp_pd(x, simde_mm256_set1_pd(DBL_MIN),
+                                            SIMDE_CMP_GE_OQ),
+                         simde_mm256_cmp_pd(x, simde_mm256_set1_pd(HUGE_VAL),
+                                            SIMDE_CMP_LT_OQ));
+    if (simde_mm256_movemask_pd(normal) == 0xF) {
+        return cml_math_log_f64x4(x);
+    }
+    const f64x4 sub = simde_mm256_and_pd(
+                      simde_mm256_cmp_pd(x, simde_mm256_set1_pd(DBL_MIN),
+                                         SIMDE_CMP_LT_OQ),
+                      simde_mm256_cmp_pd(x, simde_mm256_setzero_pd(),
+                                         SIMDE_CMP_GT_OQ));
+    const f64x4 xs  = simde_mm256_blendv_pd(x,
+                      simde_mm256_mul_pd(x, simde_mm256_set1_pd(0x1p54)), sub);
+    f64x4 y = cml_math_log_f64x4(xs);
+    y = simde_mm256_sub_pd(y, simde_mm256_and_pd(sub,
+        simde_mm256_set1_pd(54.0 * CML_LN_2)));
+    y = simde_mm256_blendv_pd(y, simde_mm256_set1_pd(-HUGE_VAL),
+        simde_mm256_cmp_pd(x, simde_mm256_setzero_pd(), SIMDE_CMP_EQ_OQ));
+    y = simde_mm256_blendv_pd(y, simde_mm256_set1_pd(NAN),
+        simde_mm256_cmp_pd(x, simde_mm256_setzero_pd(), SIMDE_CMP_LT_OQ));
+    /* +inf and NaN map to themselves. */
+    return simde_mm256_blendv_pd(y, x,
+           simde_mm256_cmp_pd(x, simde_mm256_set1_pd(HUGE_VAL),
+                              SIMDE_CMP_NLT_UQ));
+}
+
+/* Natural logarithm of positive, finite, normal x, within 4 ulp. */
+cml_inline f64x4
+cml_math_log_u4_f64x4(const f64x4 x) {
+    return cml_math_log_f64x4(x);
+}
+
+/* Arc tangent of y / x in the quadrant of (x, y), within 1 ulp, with the
+ * C99 special cases. The result is q * pi / 4 + atan(t) for an integer q,
+ * with |t| <= tan(pi / 8): |y / x| is reduced through
+ * atan(t) = pi / 2 - atan(1 / t) to [0, 1] and then through
+ * atan(t) = pi / 4 + atan((t - 1) / (t + 1)). Both steps work on the
+ * numerator and the denominator, whose rounding errors are carried into a
+ * correction of the one division. */
+cml_inline f64x4
+cml_math_atan2_u1_f64x4(const f64x4 y, const f64x4 x) {
+    const f64x4 sign = simde_mm256_set1_pd(-0.0);
+    const f64x4 one  = simde_mm256_set1_pd(1.0);
+    const f64x4 inf  = simde_mm256_set1_pd(HUGE_VAL);
+    f64x4 ax = simde_mm256_andnot_pd(sign, x);
+    f64x4 ay = simde_mm256_andnot_pd(sign, y);
+    /* atan2(+-inf, +-inf) is an odd multiple of pi / 4, as for |y| = |x|. */
+    const f64x4 infs = simde_mm256_and_pd(
+                       simde_mm256_cmp_pd(ax, inf, SIMDE_CMP_EQ_OQ),
+                       simde_mm256_cmp_pd(ay, inf, SIMDE_CMP_EQ_OQ));
+    ax = simde_mm256_blendv_pd(ax, one, infs);
+    ay = simde_mm256_blendv_pd(ay, one, infs);
+    /* t = n / d in [-1, 1]; q = 2 if |y| > |x|. */
+    const f64x4 swap = simde_mm256_cmp_pd(ay, ax, SIMDE_CMP_GT_OQ);
+    f64x4 n = simde_mm256_blendv_pd(ay, simde_mm256_xor_pd(ax, sign), swap);
+    f64x4 d = simde_mm256_blendv_pd(ax, ay, swap);
+    f64x4 q = simde_mm256_and_pd(swap, simde_mm256_set1_pd(2.0));
+    /* For |t| > tan(pi / 8), t' = -s * (d - |n|) / (d + |n|) and q += s,
+     * with s the sign of t. Since d >= |n| both sums are Fast2Sums. */
+    const f64x4 an  = simde_mm256_andnot_pd(sign, n);
+    const f64x4 sn  = simde_mm256_and_pd(sign, n);
+    const f64x4 big = simde_mm256_cmp_pd(an,
+                      simde_mm256_mul_pd(d,
+                      simde_mm256_set1_pd(CML_TAN_PI_DIV_8)),
+                      SIMDE_CMP_GT_OQ);
+    const f64x4 m   = simde_mm256_sub_pd(d, an);
+    const f64x4 em  = simde_mm256_sub_pd(simde_mm256_sub_pd(d, m), an);
+    const f64x4 p   = simde_mm256_add_pd(d, an);
+    const f64x4 ep  = simde_mm256_sub_pd(an, simde_mm256_sub_pd(p, d));
+    const f64x4 en  = simde_mm256_and_pd(big,
+                      simde_mm256_xor_pd(em, simde_mm256_xor_pd(sn, sign)));
+    const f64x4 ed  = simde_mm256_and_pd(big, ep);
+    n = simde_mm256_blendv_pd(n,
+        simde_mm256_xor_pd(m, simde_mm256_xor_pd(sn, sign)), big);
+    d = simde_mm256_blendv_pd(d, p, big);
+    q = simde_mm256_add_pd(q,
+        simde_mm256_and_pd(big, simde_mm256_or_pd(one, sn)));
+    /* t = n / d, with t = n for d = 0 so that atan2(+-0, +-0) has no
+     * 0 / 0, plus the correction dt for the rounding of t, n and d. */
+    const f64x4 t  = simde_mm256_blendv_pd(simde_mm256_div_pd(n, d), n,
+                     simde_mm256_cmp_pd(d, simde_mm256_setzero_pd(),
+                                        SIMDE_CMP_EQ_OQ));
+    const f64x4 re = simde_mm256_fnmadd_pd(t, ed,
+                     simde_mm256_add_pd(simde_mm256_fnmadd_pd(t, d, n), en));
+    const f64x4 z  = simde_mm256_mul_pd(t, t);
+    f64x4 dt = simde_mm256_div_pd(re, simde_mm256_fmadd_pd(d, z, d));
+    /* d = 0 and d = inf leave t exact but dt undefined. */
+    dt = simde_mm256_and_pd(dt, simde_mm256_cmp_pd(dt, dt, SIMDE_CMP_ORD_Q));
+    /* atan(t + dt) = t + c, with c small next to t. */
+    f64x4 tt = t;
+    f64x4 cc = simde_mm256_fnmadd_pd(simde_mm256_mul_pd(t, z),
+               cml_math_horner_f64x4(z, cml_atan_coeffs, 11), dt);
+    /* The left half-plane, including x = -0, takes pi - a: q = 4 - q and
+     * the arc tangent changes sign. */
+    const f64x4 left = simde_mm256_castsi256_pd(
+                       simde_mm256_cmpgt_epi64(simde_mm256_setzero_si256(),
+                       simde_mm256_castpd_si256(x)));
+    q  = simde_mm256_blendv_pd(q,
+         simde_mm256_sub_pd(simde_mm256_set1_pd(4.0), q), left);
+    tt = simde_mm256_xor_pd(tt, simde_mm256_and_pd(left, sign));
+    cc = simde_mm256_xor_pd(cc, simde_mm256_and_pd(left, sign));
+    /* q * pi / 4 = ch + cl, then ch + t by Fast2Sum since |ch| >= |t| or
+     * ch = 0, so that only the final addition rounds. */
+    const f64x4 ch = simde_mm256_mul_pd(q,
+                     simde_mm256_set1_pd(CML_PI_DIV_4_HI));
+    const f64x4 cl = simde_mm256_fmadd_pd(q,
+                     simde_mm256_set1_pd(CML_PI_DIV_4_LO),
+                     simde_mm256_fmsub_pd(q,
+                     simde_mm256_set1_pd(CML_PI_DIV_4_HI), ch));
+    const f64x4 sh = simde_mm256_add_pd(ch, tt);
+    const f64x4 sl = simde_mm256_add_pd(simde_mm256_sub_pd(ch, sh), tt);
+    const f64x4 a  = simde_mm256_add_pd(sh,
+                     simde_mm256_add_pd(simde_mm256_add_pd(sl, cl), cc));
+    return simde_mm256_xor_pd(a, simde_mm256_and_pd(sign, y));
+}
+
+/* Defines cml_math_<name>_f64x8 from the f64x4 kernel of the same name. */
+#define CML_F64X8_FROM_F64X4(name)                                             \
+    cml_inline f64x8                                                           \
+    cml_math_##name##_f64x8(const f64x8 x) {                                   \
+        return cml_math_f64x8_join(                                            \
+               cml_math_##name##_f64x4(cml_math_f64x8_lo(x)),                  \
+               cml_math_##name##_f64x4(cml_math_f64x8_hi(x)));                 \
+    }
 
-/* The seed must be initialized with non-zero values. */
-static u64 seed[4] = {1, 2, 3, 4};
+CML_F64X8_FROM_F64X4(sin_u1)
+CML_F64X8_FROM_F64X4(cos_u1)
+CML_F64X8_FROM_F64X4(sin_u4)
+CML_F64X8_FROM_F64X4(cos_u4)
+CML_F64X8_FROM_F64X4(exp_u1)
+CML_F64X8_FROM_F64X4(exp_u4)
+CML_F64X8_FROM_F64X4(log_u1)
+CML_F64X8_FROM_F64X4(log_u4)
 
-static inline u64 
-rotl(const u64 x, i32 k) {
-    return (x << k) | (x >> (64 - k));
+cml_inline void
+cml_math_sincos_u1_f64x8(const f64x8 x, f64x8* s, f64x8* c) {
+    f64x4 s0, c0, s1, c1;
+    cml_math_sincos_u1_f64x4(cml_math_f64x8_lo(x), &s0, &c0);
+    cml_math_sincos_u1_f64x4(cml_math_f64x8_hi(x), &s1, &c1);
+    *s = cml_math_f64x8_join(s0, s1);
+    *c = cml_math_f64x8_join(c0, c1);
 }
 
-/* Returns a random number in the range [0, 2^64). */
-cml_inline u64 
-cml_math_rand(void) {
-    const u64 result = rotl(seed[1] * 5, 7) * 9;
-    const u64 t = seed[1] << 17;
-    seed[2] ^= seed[0];
-    seed[3] ^= seed[1];
-    seed[1] ^= seed[2];
-    seed[0] ^= seed[3];
-    seed[2] ^= t;
-    seed[3] = rotl(seed[3], 45);
-    return result;
+cml_inline void
+cml_math_sincos_u4_f64x8(const f64x8 x, f64x8* s, f64x8* c) {
+    f64x4 s0, c0, s1, c1;
+    cml_math_sincos_u4_f64x4(cml_math_f64x8_lo(x), &s0, &c0);
+    cml_math_sincos_u4_f64x4(cml_math_f64x8_hi(x), &s1, &c1);
+    *s = cml_math_f64x8_join(s0, s1);
+    *c = cml_math_f64x8_join(c0, c1);
 }
 
-/* Returns a random number in the range [0, 2^32). */
-cml_inline f64 
-cml_math_rand_f64(void) {
-    const u64 result = rotl(seed[1] * 5, 7) * 9;
-    const u64 t = seed[1] << 17;
-    seed[2] ^= seed[0];
-    seed[3] ^= seed[1];
-    seed[1] ^= seed[2];
-    seed[0] ^= seed[3];
-    seed[2] ^= t;
-    seed[3] = rotl(seed[3], 45);
-    /* Convert the 64-bit unsigned integer to a f64 in the range [0, 1). */
-    return (f64)result / (f64)UINT64_MAX;
+cml_inline f64x8
+cml_math_atan2_u1_f64x8(const f64x8 y, const f64x8 x) {
+    return cml_math_f64x8_join(
+           cml_math_atan2_u1_f64x4(cml_math_f64x8_lo(y), cml_math_f64x8_lo(x)),
+           cml_math_atan2_u1_f64x4(cml_math_f64x8_hi(y), cml_math_f64x8_hi(x)));
 }
 
-/*----------------*/
-/* Vector Version */
-/*----------------*/
+/* Scalar sincos. Compilers merge the two calls into one libm sincos where
+ * the C library has it. */
+cml_inline void
+cml_math_sincos_f64(const f64 x, f64* s, f64* c) {
+    *s = sin(x);
+    *c = cos(x);
+}
 
-/*------------------------------*/
-/* Generates two random numbers */
-/*------------------------------*/
+/*============================================================================*/
+/* Array Elementary Functions                                                 */
+/*============================================================================*/
 
-/* The seed must be initialized with non-zero values. */
-static simde__m128i seedx2[2] = {{1,2}, {3,4}};
-                               
+/* Every elementary function of the _Generic family above, applied
+ * elementwise over an f64 buffer with the widest vectors of the target.
+ * The output may alias the input exactly. The head is peeled until the
+ * output is vector aligned, and the head and tail run through a padded
+ * register so that every element goes through the same vector kernel.
+ *
+ * When compiled with OpenMP, arrays of at least CML_ARRAY_PARALLEL_MIN
+ * elements are split across threads in blocks of whole cache lines.
+ * Without OpenMP, callers with their own thread pool can split the work
+ * the same way with cml_math_array_range. */
+
+/* Smallest array split across OpenMP threads. */
+#ifndef CML_ARRAY_PARALLEL_MIN
+    #define CML_ARRAY_PARALLEL_MIN 65536
+#endif
 
-cml_inline simde__m128i 
-rotlx2(const simde__m128i x, const i32 k) {
-    const simde__m128i k_mask   = simde_mm_set_epi64x(k, k);
-    const simde__m128i rot_mask = simde_mm_set_epi64x(64 - k, 64 - k);
-    return simde_mm_or_si128(
-           simde_mm_sll_epi64(x, k_mask), 
-           simde_mm_srl_epi64(x, rot_mask));
-}
+/* Elements of an f64 array in one cache line. */
+#define CML_ARRAY_BLOCK 8
 
-/* Returns 2 random numbers in the range [0, 2^64) in the form of __m128i. */
-cml_inline simde__m128i 
-cml_math_randx2(void) {
-    const simde__m128i result = simde_mm_mul_epu32(seedx2[1], 
-                                simde_mm_set_epi64x(5, 9));
-    const simde__m128i t      = simde_mm_slli_epi64(seedx2[1], 17);
-    seedx2[0]                  = simde_mm_xor_si128(seedx2[0], seedx2[1]);
-    seedx2[1]                  = simde_mm_xor_si128(seedx2[1], seedx2[0]);
-    seedx2[0]                  = simde_mm_xor_si128(seedx2[0], seedx2[1]);
-    seedx2[1]                  = simde_mm_xor_si128(seedx2[1], seedx2[0]);
-    seedx2[0]                  = simde_mm_xor_si128(seedx2[0], t);
-    seedx2[1]                  = rotlx2(seedx2[1], 45);
-    return result;
+/* Unary and binary kernels over native-width vectors. */
+typedef f64xn (*cml_f64xn_fn1)(f64xn);
+typedef f64xn (*cml_f64xn_fn2)(f64xn, f64xn);
+
+/* Computes the range [begin, end) of part `part` when n elements are split
+ * into `parts` parts. Boundaries fall on whole cache lines, so threads
+ * writing neighbouring parts never share a line. */
+cml_inline void
+cml_math_array_range(const size_t n, const size_t parts, const size_t part,
+                     size_t* begin, size_t* end) {
+    const size_t blocks = (n + CML_ARRAY_BLOCK - 1) / CML_ARRAY_BLOCK;
+    const size_t b0 = blocks * part / parts * CML_ARRAY_BLOCK;
+    const size_t b1 = blocks * (part + 1) / parts * CML_ARRAY_BLOCK;
+    *begin = b0 < n ? b0 : n;
+    *end   = b1 < n ? b1 : n;
+}
+
+/* Applies f to the m < CML_F64XN_LANES elements at a (and b) through a
+ * padded vector. The padding repeats the last element, so the padded lanes
+ * raise no floating-point exception the real lanes do not already raise,
+ * whatever the domain of the function. Does nothing for m == 0, which has no
+ * last element to repeat. */
+cml_inline void
+cml_math_array_partial(const cml_f64xn_fn1 f1, const cml_f64xn_fn2 f2,
+                       const f64* a, const f64* b, f64* out,
+                       const size_t m) {
+    if (m == 0) {
+        return;
+    }
+    f64 x[CML_F64XN_LANES], y[CML_F64XN_LANES];
+    for (size_t j = 0; j < m; j++) {
+        x[j] = a[j];
+        y[j] = b ? b[j] : 0.0;
+    }
+    for (size_t j = m; j < CML_F64XN_LANES; j++) {
+        x[j] = x[m - 1];
+        y[j] = y[m - 1];
+    }
+    const f64xn r = f1 ? f1(cml_f64xn_loadu(x))
+                       : f2(cml_f64xn_loadu(x), cml_f64xn_loadu(y));
+    cml_f64xn_storeu(x, r);
+    for (size_t j = 0; j < m; j++) {
+        out[j] = x[j];
+    }
 }
 
-/* Returns 2 random doubles in the range [0, 2^32) in the form
- * of simde__m128d. */
-cml_inline simde__m128d 
-cml_math_randx2_f64(void) {
-    const simde__m128i result = simde_mm_mul_epu32(seedx2[1], 
-                                simde_mm_set_epi64x(5, 9));
-    const simde__m128i t      = simde_mm_slli_epi64(seedx2[1], 17);
-    seedx2[0]                  = simde_mm_xor_si128(seedx2[0], seedx2[1]);
-    seedx2[1]                  = simde_mm_xor_si128(seedx2[1], seedx2[0]);
-    seedx2[0]                  = simde_mm_xor_si128(seedx2[0], seedx2[1]);
-    seedx2[1]                  = simde_mm_xor_si128(seedx2[1], seedx2[0]);
-    seedx2[0]                  = simde_mm_xor_si128(seedx2[0], t);
-    seedx2[1]                  = rotlx2(seedx2[1], 45);
-    /* Convert the __m128i to __m128d in the range [0, 1). */
-    return simde_mm_cvtepi32_pd(simde_mm_srli_epi64(result, 32));
+/* Applies f1 to a, or f2 to a and b, on one thread. */
+cml_inline void
+cml_math_array_map_serial(const cml_f64xn_fn1 f1, const cml_f64xn_fn2 f2,
+                          const f64* a, const f64* b, f64* out,
+                          const size_t n) {
+    const size_t vbytes = CML_F64XN_LANES * sizeof(f64);
+    const uintptr_t addr = (uintptr_t)out;
+    size_t head = 0;
+    if (addr % sizeof(f64) == 0) {
+        head = (vbytes - addr % vbytes) % vbytes / sizeof(f64);
+        head = head < n ? head : n;
+    }
+    if (head > 0) {
+        cml_math_array_partial(f1, f2, a, b, out, head);
+    }
+    size_t i = head;
+    for (; i + CML_F64XN_LANES <= n; i += CML_F64XN_LANES) {
+        const f64xn x = cml_f64xn_loadu(a + i);
+        cml_f64xn_store(out + i, f1 ? f1(x)
+                                    : f2(x, cml_f64xn_loadu(b + i)));
+    }
+    if (i < n) {
+        cml_math_array_partial(f1, f2, a + i, b ? b + i : NULL, out + i,
+                               n - i);
+    }
 }
 
-/*-------------------------------*/
-/* Generates four random numbers */
-/*-------------------------------*/
+/* Applies f1 to a, or f2 to a and b, splitting large arrays across OpenMP
+ * threads when available. */
+cml_inline void
+cml_math_array_map(const cml_f64xn_fn1 f1, const cml_f64xn_fn2 f2,
+                   const f64* a, const f64* b, f64* out, const size_t n) {
+#if defined(_OPENMP)
+    if (n >= CML_ARRAY_PARALLEL_MIN) {
+        const i64 parts = (i64)omp_get_max_threads();
+        #pragma omp parallel for schedule(static)
+        for (i64 p = 0; p < parts; p++) {
+            size_t begin, end;
+            cml_math_array_range(n, (size_t)parts, (size_t)p, &begin, &end);
+            cml_math_array_map_serial(f1, f2, a + begin,
+                                      b ? b + begin : NULL, out + begin,
+                                      end - begin);
+        }
+        return;
+    }
+#endif
+    cml_math_array_map_serial(f1, f2, a, b, out, n);
+}
+
+/* Defines cml_math_<name>_array(in, out, n), computing
+ * out[i] = cml_math_<name>(in[i]) for i < n. */
+#define CML_ARRAY_UNARY(name)                                                  \
+    cml_inline f64xn                                                           \
+    cml_math_##name##_f64xn(const f64xn x) {                                   \
+        return cml_math_##name(x);                                             \
+    }                                                                          \
+    static inline void                                                         \
+    cml_math_##name##_array(const f64* in, f64* out, const size_t n) {         \
+        cml_math_array_map(cml_math_##name##_f64xn, NULL, in, NULL, out, n);   \
+    }
 
-cml_inline simde__m256i 
-rotlx4(const simde__m256i x, i32 k) {
-    #if defined(_MSC_VER)
-        return simde_mm256_or_si256(
-               simde_mm256_slli_epi64(x, k), 
-               simde_mm256_srli_epi64(x, 64 - k));
-    #elif defined(__clang__) || defined(__GNUC__) 
-        simde__m256i result;
-        for (i32 i = 0; i < 4; i++) {
-            result[i] = (x[i] << k) | (x[i] >> (64 - k));
+/* Defines cml_math_<name>_array(a, b, out, n), computing
+ * out[i] = cml_math_<name>(a[i], b[i]) for i < n. */
+#define CML_ARRAY_BINARY(name)                                                 \
+    cml_inline f64xn                                                           \
+    cml_math_##name##_f64xn(const f64xn a, const f64xn b) {                    \
+        return cml_math_##name(a, b);                                          \
+    }                                                                          \
+    static inline void                                                         \
+    cml_math_##name##_array(const f64* a, const f64* b, f64* out,              \
+                            const size_t n) {                                  \
+        cml_math_array_map(NULL, cml_math_##name##_f64xn, a, b, out, n);       \
+    }
+
+/*---------------*/
+/* Trigonometric */
+/*---------------*/
+
+CML_ARRAY_UNARY(sin)
+CML_ARRAY_UNARY(cos)
+CML_ARRAY_UNARY(tan)
+CML_ARRAY_UNARY(asin)
+CML_ARRAY_UNARY(acos)
+CML_ARRAY_UNARY(atan)
+CML_ARRAY_BINARY(atan2)
+
+/* Computes s[i] = sin(in[i]) and c[i] = cos(in[i]) for i < n, with one
+ * argument reduction per element. */
+static inline void
+cml_math_sincos_array(const f64* in, f64* s, f64* c, const size_t n) {
+    size_t i = 0;
+    for (; i + CML_F64XN_LANES <= n; i += CML_F64XN_LANES) {
+        f64xn vs, vc;
+        cml_math_sincos(cml_f64xn_loadu(in + i), &vs, &vc);
+        cml_f64xn_storeu(s + i, vs);
+        cml_f64xn_storeu(c + i, vc);
+    }
+    if (i < n) {
+        f64 x[CML_F64XN_LANES], y[CML_F64XN_LANES];
+        for (size_t j = 0; j < CML_F64XN_LANES; j++) {
+            x[j] = i + j < n ? in[i + j] : 0.0;
         }
-        return result;       
-    #endif
+        f64xn vs, vc;
+        cml_math_sincos(cml_f64xn_loadu(x), &vs, &vc);
+        cml_f64xn_storeu(x, vs);
+        cml_f64xn_storeu(y, vc);
+        for (size_t j = 0; i + j < n; j++) {
+            s[i + j] = x[j];
+            c[i + j] = y[j];
+        }
+    }
 }
 
-/* The seed must be initialized with non-zero values. */
-static simde__m256i seedx4[4] = {{1, 2, 3, 4}, 
-                                 {5, 6, 7, 8}, 
-                                 {9, 10,11,12}, 
-                                 {13,14,15,16}};
+/*------------*/
+/* Hyperbolic */
+/*------------*/
 
-/* Returns 4 random numbers in the range [0, 2^64) in the form
- * of simde__m256i. */
-cml_inline simde__m256i 
-cml_math_randx4(void) {
-    const simde__m256i result = simde_mm256_add_epi64(seedx4[0], seedx4[3]);
-    const simde__m256i t      = simde_mm256_xor_si256(seedx4[1], seedx4[0]);
-    seedx4[2]                 = simde_mm256_xor_si256(seedx4[2], seedx4[0]);
-    seedx4[3]                 = simde_mm256_xor_si256(seedx4[3], seedx4[1]);
-    seedx4[1]                 = simde_mm256_xor_si256(seedx4[1], seedx4[2]);
-    seedx4[0]                 = simde_mm256_xor_si256(t, seedx4[3]);
-    seedx4[2]                 = rotlx4(seedx4[2], 45);
-    return result;
-}
+CML_ARRAY_UNARY(sinh)
+CML_ARRAY_UNARY(cosh)
+CML_ARRAY_UNARY(tanh)
+CML_ARRAY_UNARY(asinh)
+CML_ARRAY_UNARY(acosh)
+CML_ARRAY_UNARY(atanh)
 
-/* SIMDE apparently doesn't implement this function, so here's what the
- * intrinsics logic should look like. */
-cml_inline simde__m256d 
-simde_mm256_cvtepi64_pd(simde__m256i a) {
-    simde__m256d result;
-    result[0] = (f64)a[0];
-    result[1] = (f64)a[1];
-    result[2] = (f64)a[2];
-    result[3] = (f64)a[3];
-    return result;
-}
+/*-------------*/
+/* Exponential */
+/*-------------*/
 
-/* Returns 4 random doubles in the range [0, 2^64) in the form
- * of simde__m256d. */
-cml_inline simde__m256d 
-cml_math_randx4_f64(void) {
-    const simde__m256i result = simde_mm256_add_epi64(seedx4[0], seedx4[3]);
-    const simde__m256i t      = simde_mm256_xor_si256(seedx4[1], seedx4[0]);
-    seedx4[2]                 = simde_mm256_xor_si256(seedx4[2], seedx4[0]);
-    seedx4[3]                 = simde_mm256_xor_si256(seedx4[3], seedx4[1]);
-    seedx4[1]                 = simde_mm256_xor_si256(seedx4[1], seedx4[2]);
-    seedx4[0]                 = simde_mm256_xor_si256(t, seedx4[3]);
-    seedx4[2]                 = rotlx4(seedx4[2], 45);
-    const simde__m256d random = simde_mm256_cvtepi64_pd(result);
-    const simde__m256d scale  = simde_mm256_set1_pd(0x1.0p-53);
-    return                      simde_mm256_mul_pd(random, scale);
-}
+CML_ARRAY_UNARY(exp)
+CML_ARRAY_UNARY(exp2)
+CML_ARRAY_UNARY(exp10)
+CML_ARRAY_UNARY(expm1)
 
-/*============================================================================*/
-/* Mathematical Types Forward Declarations                                    */
-/*============================================================================*/
+/*-------------*/
+/* Logarithmic */
+/*-------------*/
 
-typedef struct vec2 vec2;
-typedef struct vec4 vec4;
-typedef struct mat4 mat4;
-typedef struct quat quat;
+CML_ARRAY_UNARY(log)
+CML_ARRAY_UNARY(log2)
+CML_ARRAY_UNARY(log10)
+CML_ARRAY_UNARY(log1p)
+
+/*-----------------*/
+/* Power Functions */
+/*-----------------*/
+
+CML_ARRAY_BINARY(pow)
+CML_ARRAY_UNARY(sqrt)
+CML_ARRAY_UNARY(cbrt)
+CML_ARRAY_BINARY(hypot)
+
+/*--------------------*/
+/* Rounding Functions */
+/*--------------------*/
+
+CML_ARRAY_UNARY(ceil)
+CML_ARRAY_UNARY(floor)
+CML_ARRAY_UNARY(round)
+CML_ARRAY_UNARY(trunc)
+CML_ARRAY_UNARY(rint)
+CML_ARRAY_UNARY(nearbyint)
 
 /*============================================================================*/
-/* 2D Vector                                                                  */
+/* Array Reductions                                                           */
 /*============================================================================*/
 
-/* 2D vector. */
-typedef struct vec2 {
-    simde__m128d v;
-} vec2;
-
-/*--------------------------*/
-/* Initialization Functions */
-/*--------------------------*/
+/* Sum, product, minimum, maximum, mean, variance and dot product of f64
+ * arrays. Every kernel keeps four independent vector accumulators, so the
+ * loop runs at the load or add throughput instead of the add latency.
+ *
+ * The additive reductions take a cml_reduce_mode:
+ *   CML_REDUCE_FAST         plain sums in the four accumulators, error
+ *                           growing with n / (4 * CML_F64XN_LANES).
+ *   CML_REDUCE_PAIRWISE     fast sums over blocks of CML_REDUCE_BLOCK
+ *                           elements, added pairwise, error growing with
+ *                           log2(n). Runs at the speed of the fast mode.
+ *   CML_REDUCE_COMPENSATED  Kahan-Babuska summation with the exact error of
+ *                           every addition (and of every product of the
+ *                           dot) carried per lane, about as accurate as a
+ *                           sum in twice the working precision.
+ *
+ * When compiled with OpenMP, arrays of at least CML_REDUCE_PARALLEL_MIN
+ * elements are split across threads with cml_math_array_range and the
+ * partial results combined in part order, so a fixed thread count always
+ * gives the same result. */
+
+/* Smallest array reduced across OpenMP threads, 4 MiB of f64. */
+#ifndef CML_REDUCE_PARALLEL_MIN
+    #define CML_REDUCE_PARALLEL_MIN 524288
+#endif
 
-/* Set vector elements individually. */
-cml_inline vec2
-cml_math_vec2_set(const f64 x, const f64 y) {
-    vec2 v;
-    v.v = simde_mm_set_pd(y, x);
-    return v;
+/* Elements summed directly before the pairwise mode starts splitting. */
+#define CML_REDUCE_BLOCK 256
+
+/* Most partial results of a threaded reduction. */
+#define CML_REDUCE_PARTS 64
+
+typedef enum cml_reduce_mode {
+    CML_REDUCE_FAST,
+    CML_REDUCE_PAIRWISE,
+    CML_REDUCE_COMPENSATED
+} cml_reduce_mode;
+
+/* Reductions of the kernels below. CML_REDUCE_SQDEV sums (a[i] - c)^2. */
+typedef enum cml_reduce_op {
+    CML_REDUCE_SUM,
+    CML_REDUCE_DOT,
+    CML_REDUCE_SQDEV,
+    CML_REDUCE_PRODUCT,
+    CML_REDUCE_MIN,
+    CML_REDUCE_MAX
+} cml_reduce_op;
+
+/* Adds the lanes of a native-width vector. */
+cml_inline f64
+cml_math_f64xn_hsum(const f64xn a) {
+    f64 x[CML_F64XN_LANES];
+    cml_f64xn_storeu(x, a);
+    for (size_t w = CML_F64XN_LANES / 2; w > 0; w /= 2) {
+        for (size_t j = 0; j < w; j++) {
+            x[j] += x[j + w];
+        }
+    }
+    return x[0];
 }
 
-/* Set vector elements from an array. */
-cml_inline vec2
-cml_math_vec2_set_from_array(const f64* a) {
-    vec2 v;
-    v.v = simde_mm_loadu_pd(a);
-    return v;
+/* Loads the factors x and y of vector i of an additive reduction, whose
+ * terms are x * y. */
+cml_inline void
+cml_math_reduce_load(const cml_reduce_op op, const f64* a, const f64* b,
+                     const f64 c, const size_t i, f64xn* x, f64xn* y) {
+    switch (op) {
+    case CML_REDUCE_DOT:
+        *x = cml_f64xn_loadu(a + i);
+        *y = cml_f64xn_loadu(b + i);
+        break;
+    case CML_REDUCE_SQDEV:
+        *x = cml_f64xn_sub(cml_f64xn_loadu(a + i), cml_f64xn_set1(c));
+        *y = *x;
+        break;
+    default:
+        *x = cml_f64xn_loadu(a + i);
+        *y = cml_f64xn_set1(1.0);
+        break;
+    }
 }
 
-/* Set vector elements from a scalar. */
-cml_inline vec2
-cml_math_vec2_set_from_scalar(const f64 s) {
-    vec2 v;
-    v.v = simde_mm_set1_pd(s);
-    return v;
+/* Returns the term of element i of an additive reduction. */
+cml_inline f64
+cml_math_reduce_term(const cml_reduce_op op, const f64* a, const f64* b,
+                     const f64 c, const size_t i) {
+    switch (op) {
+    case CML_REDUCE_DOT:
+        return a[i] * b[i];
+    case CML_REDUCE_SQDEV:
+        return (a[i] - c) * (a[i] - c);
+    default:
+        return a[i];
+    }
 }
 
-/* Set vector elements from a 2D vector. */
-cml_inline vec2
-cml_math_vec2_set_from_vec2(const vec2 v) {
-    vec2 r;
-    r.v = v.v;
-    return r;
+/* Adds the terms of an additive reduction in four vector accumulators. */
+cml_inline f64
+cml_math_reduce_fast(const cml_reduce_op op, const f64* a, const f64* b,
+                     const f64 c, const size_t n) {
+    const size_t l = CML_F64XN_LANES;
+    f64xn s0 = cml_f64xn_set1(0.0), s1 = s0, s2 = s0, s3 = s0;
+    f64xn x, y;
+    size_t i = 0;
+    for (; i + 4 * l <= n; i += 4 * l) {
+        cml_math_reduce_load(op, a, b, c, i, &x, &y);
+        s0 = cml_f64xn_fmadd(x, y, s0);
+        cml_math_reduce_load(op, a, b, c, i + l, &x, &y);
+        s1 = cml_f64xn_fmadd(x, y, s1);
+        cml_math_reduce_load(op, a, b, c, i + 2 * l, &x, &y);
+        s2 = cml_f64xn_fmadd(x, y, s2);
+        cml_math_reduce_load(op, a, b, c, i + 3 * l, &x, &y);
+        s3 = cml_f64xn_fmadd(x, y, s3);
+    }
+    for (; i + l <= n; i += l) {
+        cml_math_reduce_load(op, a, b, c, i, &x, &y);
+        s0 = cml_f64xn_fmadd(x, y, s0);
+    }
+    f64 s = cml_math_f64xn_hsum(cml_f64xn_add(cml_f64xn_add(s0, s1),
+                                              cml_f64xn_add(s2, s3)));
+    for (; i < n; i++) {
+        s += cml_math_reduce_term(op, a, b, c, i);
+    }
+    return s;
 }
 
-/* Set vector elements to zero. */
-cml_inline vec2
-cml_math_vec2_zero(void) {
-    vec2 v;
-    v.v = simde_mm_setzero_pd();
-    return v;
+/* Adds the terms of an additive reduction pairwise over blocks of
+ * CML_REDUCE_BLOCK elements. */
+static inline f64
+cml_math_reduce_pairwise(const cml_reduce_op op, const f64* a, const f64* b,
+                         const f64 c, const size_t n) {
+    if (n <= CML_REDUCE_BLOCK) {
+        return cml_math_reduce_fast(op, a, b, c, n);
+    }
+    const size_t blocks = (n + CML_REDUCE_BLOCK - 1) / CML_REDUCE_BLOCK;
+    const size_t h = blocks / 2 * CML_REDUCE_BLOCK;
+    return cml_math_reduce_pairwise(op, a, b, c, h) +
+           cml_math_reduce_pairwise(op, a + h, b ? b + h : NULL, c, n - h);
 }
 
-/* Set vector elements to one. */
-cml_inline vec2
-cml_math_vec2_one(void) {
-    vec2 v;
-    v.v = simde_mm_set1_pd(1.0);
-    return v;
+/* One compensated step: adds x * y to s and the exact rounding errors of
+ * the product and of the addition (Knuth's TwoSum) to e. */
+cml_inline void
+cml_math_reduce_twosum(const f64xn x, const f64xn y, f64xn* s, f64xn* e) {
+    const f64xn p  = cml_f64xn_mul(x, y);
+    const f64xn ep = cml_f64xn_fmsub(x, y, p);
+    const f64xn t  = cml_f64xn_add(*s, p);
+    const f64xn z  = cml_f64xn_sub(t, *s);
+    const f64xn es = cml_f64xn_add(cml_f64xn_sub(*s, cml_f64xn_sub(t, z)),
+                                   cml_f64xn_sub(p, z));
+    *e = cml_f64xn_add(*e, cml_f64xn_add(es, ep));
+    *s = t;
+}
+
+/* Scalar version of cml_math_reduce_twosum. */
+cml_inline void
+cml_math_reduce_twosum_f64(const f64 x, const f64 y, f64* s, f64* e) {
+    const f64 p = x * y;
+    const f64 t = *s + p;
+    const f64 z = t - *s;
+    *e += (*s - (t - z)) + (p - z) + fma(x, y, -p);
+    *s = t;
+}
+
+/* Adds the terms of an additive reduction with compensated summation. */
+static inline f64
+cml_math_reduce_compensated(const cml_reduce_op op, const f64* a,
+                            const f64* b, const f64 c, const size_t n) {
+    const size_t l = CML_F64XN_LANES;
+    f64xn s0 = cml_f64xn_set1(0.0), s1 = s0, s2 = s0, s3 = s0;
+    f64xn e0 = s0, e1 = s0, e2 = s0, e3 = s0;
+    f64xn x, y;
+    size_t i = 0;
+    for (; i + 4 * l <= n; i += 4 * l) {
+        cml_math_reduce_load(op, a, b, c, i, &x, &y);
+        cml_math_reduce_twosum(x, y, &s0, &e0);
+        cml_math_reduce_load(op, a, b, c, i + l, &x, &y);
+        cml_math_reduce_twosum(x, y, &s1, &e1);
+        cml_math_reduce_load(op, a, b, c, i + 2 * l, &x, &y);
+        cml_math_reduce_twosum(x, y, &s2, &e2);
+        cml_math_reduce_load(op, a, b, c, i + 3 * l, &x, &y);
+        cml_math_reduce_twosum(x, y, &s3, &e3);
+    }
+    for (; i + l <= n; i += l) {
+        cml_math_reduce_load(op, a, b, c, i, &x, &y);
+        cml_math_reduce_twosum(x, y, &s0, &e0);
+    }
+    /* Fold the accumulators into one, still compensated. */
+    const f64xn one = cml_f64xn_set1(1.0);
+    cml_math_reduce_twosum(s1, one, &s0, &e0);
+    cml_math_reduce_twosum(s3, one, &s2, &e2);
+    cml_math_reduce_twosum(s2, one, &s0, &e0);
+    e0 = cml_f64xn_add(cml_f64xn_add(e0, e1), cml_f64xn_add(e2, e3));
+    f64 sl[CML_F64XN_LANES], el[CML_F64XN_LANES];
+    cml_f64xn_storeu(sl, s0);
+    cml_f64xn_storeu(el, e0);
+    f64 s = 0.0, e = 0.0;
+    for (size_t j = 0; j < l; j++) {
+        cml_math_reduce_twosum_f64(sl[j], 1.0, &s, &e);
+        e += el[j];
+    }
+    for (; i < n; i++) {
+        switch (op) {
+        case CML_REDUCE_DOT:
+            cml_math_reduce_twosum_f64(a[i], b[i], &s, &e);
+            break;
+        case CML_REDUCE_SQDEV:
+            cml_math_reduce_twosum_f64(a[i] - c, a[i] - c, &s, &e);
+            break;
+        default:
+            cml_math_reduce_twosum_f64(a[i], 1.0, &s, &e);
+            break;
+        }
+    }
+    return s + e;
+}
+
+/* Folds x into the product, minimum or maximum r. The minimum and maximum
+ * return r when x is NaN. */
+cml_inline f64xn
+cml_math_reduce_step(const cml_reduce_op op, const f64xn r, const f64xn x) {
+    switch (op) {
+    case CML_REDUCE_MIN:
+        return cml_f64xn_min(x, r);
+    case CML_REDUCE_MAX:
+        return cml_f64xn_max(x, r);
+    default:
+        return cml_f64xn_mul(x, r);
+    }
 }
 
-/* Set vector elements to infinity. */
-cml_inline vec2
-cml_math_vec2_infinity(void) {
-    vec2 v;
-    v.v = simde_mm_set1_pd(HUGE_VAL);
-    return v;
+/* Scalar version of cml_math_reduce_step. */
+cml_inline f64
+cml_math_reduce_step_f64(const cml_reduce_op op, const f64 r, const f64 x) {
+    switch (op) {
+    case CML_REDUCE_MIN:
+        return x < r ? x : r;
+    case CML_REDUCE_MAX:
+        return x > r ? x : r;
+    default:
+        return x * r;
+    }
 }
 
-/*----------------------*/
-/* Arithmetic Functions */
-/*----------------------*/
-
-/* Add two vectors. */
-cml_inline vec2
-cml_math_vec2_add(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_add_pd(a.v, b.v);
-    return v;
+/* Product, minimum or maximum of n elements in four vector accumulators. */
+cml_inline f64
+cml_math_reduce_fold(const cml_reduce_op op, const f64* a, const size_t n) {
+    const size_t l = CML_F64XN_LANES;
+    const f64 id = op == CML_REDUCE_MIN ? HUGE_VAL
+                 : op == CML_REDUCE_MAX ? -HUGE_VAL : 1.0;
+    f64xn r0 = cml_f64xn_set1(id), r1 = r0, r2 = r0, r3 = r0;
+    size_t i = 0;
+    for (; i + 4 * l <= n; i += 4 * l) {
+        r0 = cml_math_reduce_step(op, r0, cml_f64xn_loadu(a + i));
+        r1 = cml_math_reduce_step(op, r1, cml_f64xn_loadu(a + i + l));
+        r2 = cml_math_reduce_step(op, r2, cml_f64xn_loadu(a + i + 2 * l));
+        r3 = cml_math_reduce_step(op, r3, cml_f64xn_loadu(a + i + 3 * l));
+    }
+    for (; i + l <= n; i += l) {
+        r0 = cml_math_reduce_step(op, r0, cml_f64xn_loadu(a + i));
+    }
+    r0 = cml_math_reduce_step(op, cml_math_reduce_step(op, r0, r1),
+                              cml_math_reduce_step(op, r2, r3));
+    f64 x[CML_F64XN_LANES];
+    cml_f64xn_storeu(x, r0);
+    f64 r = id;
+    for (size_t j = 0; j < l; j++) {
+        r = cml_math_reduce_step_f64(op, r, x[j]);
+    }
+    for (; i < n; i++) {
+        r = cml_math_reduce_step_f64(op, r, a[i]);
+    }
+    return r;
 }
 
-/* Add a vector and a scalar. */
-cml_inline vec2
-cml_math_vec2_add_scalar(const vec2 a, const f64 b) {
-    vec2 v;
-    v.v = simde_mm_add_pd(a.v, simde_mm_set1_pd(b));
-    return v;
+/* Reduces n elements of a (and b) on one thread. */
+cml_inline f64
+cml_math_reduce_serial(const cml_reduce_op op, const cml_reduce_mode mode,
+                       const f64* a, const f64* b, const f64 c,
+                       const size_t n) {
+    if (op == CML_REDUCE_PRODUCT || op == CML_REDUCE_MIN ||
+        op == CML_REDUCE_MAX) {
+        return cml_math_reduce_fold(op, a, n);
+    }
+    switch (mode) {
+    case CML_REDUCE_PAIRWISE:
+        return cml_math_reduce_pairwise(op, a, b, c, n);
+    case CML_REDUCE_COMPENSATED:
+        return cml_math_reduce_compensated(op, a, b, c, n);
+    default:
+        return cml_math_reduce_fast(op, a, b, c, n);
+    }
 }
 
-/* Subtract two vectors. */
-cml_inline vec2
-cml_math_vec2_sub(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_sub_pd(a.v, b.v);
-    return v;
+/* Reduces n elements of a (and b), splitting large arrays across OpenMP
+ * threads when available. */
+cml_inline f64
+cml_math_reduce(const cml_reduce_op op, const cml_reduce_mode mode,
+                const f64* a, const f64* b, const f64 c, const size_t n) {
+#if defined(_OPENMP)
+    if (n >= CML_REDUCE_PARALLEL_MIN && omp_get_max_threads() > 1) {
+        const i64 threads = (i64)omp_get_max_threads();
+        const i64 parts = threads < CML_REDUCE_PARTS ? threads
+                                                     : CML_REDUCE_PARTS;
+        f64 partial[CML_REDUCE_PARTS];
+        #pragma omp parallel for schedule(static)
+        for (i64 p = 0; p < parts; p++) {
+            size_t begin, end;
+            cml_math_array_range(n, (size_t)parts, (size_t)p, &begin, &end);
+            partial[p] = cml_math_reduce_serial(op, mode, a + begin,
+                                                b ? b + begin : NULL, c,
+                                                end - begin);
+        }
+        const cml_reduce_op combine =
+            op == CML_REDUCE_DOT || op == CML_REDUCE_SQDEV ? CML_REDUCE_SUM
+                                                           : op;
+        return cml_math_reduce_serial(combine, mode, partial, NULL, 0.0,
+                                      (size_t)parts);
+    }
+#endif
+    return cml_math_reduce_serial(op, mode, a, b, c, n);
 }
 
-/* Negate a vector. */
-cml_inline vec2
-cml_math_vec2_neg(const vec2 a) {
-    vec2 v;
-    v.v = simde_mm_sub_pd(simde_mm_setzero_pd(), a.v);
-    return v;
+/* Returns the sum of n elements, 0 for an empty array. */
+static inline f64
+cml_math_array_sum(const f64* a, const size_t n, const cml_reduce_mode mode) {
+    return cml_math_reduce(CML_REDUCE_SUM, mode, a, NULL, 0.0, n);
 }
 
-/* Subtract a vector and a scalar. */
-cml_inline vec2
-cml_math_vec2_sub_scalar(const vec2 a, const f64 b) {
-    vec2 v;
-    v.v = simde_mm_sub_pd(a.v, simde_mm_set1_pd(b));
-    return v;
+/* Returns the product of n elements, 1 for an empty array. */
+static inline f64
+cml_math_array_product(const f64* a, const size_t n) {
+    return cml_math_reduce(CML_REDUCE_PRODUCT, CML_REDUCE_FAST, a, NULL, 0.0,
+                           n);
 }
 
-/* Multiply two vectors. */
-cml_inline vec2
-cml_math_vec2_mul(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_mul_pd(a.v, b.v);
-    return v;
+/* Returns the smallest of n elements, ignoring NaNs. Returns +inf for an
+ * empty array. */
+static inline f64
+cml_math_array_min(const f64* a, const size_t n) {
+    return cml_math_reduce(CML_REDUCE_MIN, CML_REDUCE_FAST, a, NULL, 0.0, n);
 }
 
-/* Multiply a vector and a scalar. */
-cml_inline vec2
-cml_math_vec2_mul_scalar(const vec2 a, const f64 b) {
-    vec2 v;
-    v.v = simde_mm_mul_pd(a.v, simde_mm_set1_pd(b));
-    return v;
+/* Returns the largest of n elements, ignoring NaNs. Returns -inf for an
+ * empty array. */
+static inline f64
+cml_math_array_max(const f64* a, const size_t n) {
+    return cml_math_reduce(CML_REDUCE_MAX, CML_REDUCE_FAST, a, NULL, 0.0, n);
 }
 
-/* Divide two vectors. */
-cml_inline vec2
-cml_math_vec2_div(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_div_pd(a.v, b.v);
-    return v;
+/* Returns the mean of n elements, NaN for an empty array. */
+static inline f64
+cml_math_array_mean(const f64* a, const size_t n,
+                    const cml_reduce_mode mode) {
+    return cml_math_array_sum(a, n, mode) / (f64)n;
 }
 
-/* Divide a vector and a scalar. */
-cml_inline vec2
-cml_math_vec2_div_scalar(const vec2 a, const f64 b) {
-    vec2 v;
-    v.v = simde_mm_div_pd(a.v, simde_mm_set1_pd(b));
-    return v;
+/* Returns the population variance of n elements, NaN for an empty array.
+ * Two passes: the mean, then the sum of squared deviations from it, which
+ * does not cancel the way the sum of squares minus the squared sum does.
+ * Multiply by n / (n - 1) for the sample variance. */
+static inline f64
+cml_math_array_variance(const f64* a, const size_t n,
+                        const cml_reduce_mode mode) {
+    const f64 mean = cml_math_array_mean(a, n, mode);
+    return cml_math_reduce(CML_REDUCE_SQDEV, mode, a, NULL, mean, n) /
+           (f64)n;
 }
 
-/* Compute the component-wise minimum of two vectors. */
-cml_inline vec2
-cml_math_vec2_min(const vec2 a, const vec2 b) {
-    vec2 r;
-    r.v = simde_mm_min_pd(a.v, b.v);
-    return r;
+/* Returns the dot product of n elements of a and b, 0 for empty arrays. */
+static inline f64
+cml_math_array_dot(const f64* a, const f64* b, const size_t n,
+                   const cml_reduce_mode mode) {
+    return cml_math_reduce(CML_REDUCE_DOT, mode, a, b, 0.0, n);
 }
 
-/* Compute the component-wise maximum of two vectors. */
-cml_inline vec2
-cml_math_vec2_max(const vec2 a, const vec2 b) {
-    vec2 r;
-    r.v = simde_mm_max_pd(a.v, b.v);
-    return r;
+/*============================================================================*/
+/* Random Number Generation                                                   */
+/*============================================================================*/
+
+/* All generators are members of the xoshiro256 family. Each generator keeps
+ * its state in an explicit object, so threads never share state unless they
+ * share an object. The argument-less functions (cml_math_rand() and friends)
+ * draw from a default generator that is private to the calling thread. */
+
+/* The state must never be all zero; the seeding functions guarantee this. */
+typedef struct rng {
+    u64 s[4];
+} rng;
+
+/* Two independent xoshiro256 streams, one per 64-bit lane. */
+typedef struct rngx2 {
+    simde__m128i s[4];
+} rngx2;
+
+/* Four independent xoshiro256 streams, one per 64-bit lane. */
+typedef struct rngx4 {
+    simde__m256i s[4];
+} rngx4;
+
+/* Polynomial that advances a xoshiro256 state by 2^128 steps. */
+static const u64 cml_rng_jump_poly[4] = {
+    0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+};
+
+/* Polynomial that advances a xoshiro256 state by 2^192 steps. */
+static const u64 cml_rng_long_jump_poly[4] = {
+    0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+    0x77710069854ee241ULL, 0x39109bb02acbe635ULL
+};
+
+/* Number of default generators handed out so far. Each thread's default
+ * generator is seeded from its position in this count. The counter is one
+ * object for the whole program, not one per translation unit, so threads that
+ * first draw from different source files still get distinct streams. */
+cml_shared u64 cml_rng_default_count = 0;
+
+/*----------------*/
+/* Scalar Version */
+/*----------------*/
+
+/*-----------------------------------------------------*/
+/* RNG - xoshiro256** - Drop-in replacement for rand() */
+/*-----------------------------------------------------*/
+
+static inline u64 
+rotl(const u64 x, i32 k) {
+    return (x << k) | (x >> (64 - k));
 }
 
-/* Compute the component-wise absolute value of a vector. */
-cml_inline vec2
-cml_math_vec2_abs(const vec2 a) {
-    vec2 r;
-    r.v = simde_mm_andnot_pd(simde_mm_set1_pd(-0.0), a.v);
-    return r;
+/* splitmix64, used to expand a single 64-bit seed into a full state. */
+cml_inline u64
+cml_math_splitmix64(u64* x) {
+    u64 z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
 }
 
-/* Compute the component-wise square root of a vector. */
-cml_inline vec2
-cml_math_vec2_sqrt(const vec2 a) {
-    vec2 r;
-    r.v = simde_mm_sqrt_pd(a.v);
-    return r;
+/* Seed a generator from a single 64-bit value. */
+cml_inline void
+cml_math_rng_seed(rng* r, u64 seed) {
+    r->s[0] = cml_math_splitmix64(&seed);
+    r->s[1] = cml_math_splitmix64(&seed);
+    r->s[2] = cml_math_splitmix64(&seed);
+    r->s[3] = cml_math_splitmix64(&seed);
 }
 
-/* Compute the component-wise reciprocal square root of a vector. */
-cml_inline vec2
-cml_math_vec2_rsqrt(const vec2 a) {
-    vec2 r;
-    r.v = simde_mm_div_pd(
-          simde_mm_set1_pd(1.0), 
-          simde_mm_sqrt_pd(a.v));
-    return r;
+/* Returns a random number in the range [0, 2^64) and advances the
+ * generator. */
+cml_inline u64 
+cml_math_rng_next(rng* r) {
+    u64* s = r->s;
+    const u64 result = rotl(s[1] * 5, 7) * 9;
+    const u64 t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
 }
 
-/* Compute the component-wise reciprocal of a vector. */
-cml_inline vec2
-cml_math_vec2_rcp(const vec2 a) {
-    vec2 r;
-    r.v = simde_mm_div_pd(
-          simde_mm_set1_pd(1.0), 
-          a.v);
+/* Returns a random number in the range [0, 1) and advances the generator. */
+cml_inline f64 
+cml_math_rng_next_f64(rng* r) {
+    /* The top 53 bits fill the mantissa exactly. */
+    return (f64)(cml_math_rng_next(r) >> 11) * 0x1.0p-53;
+}
+
+/* Advances a generator by the number of steps encoded in a jump
+ * polynomial. */
+static inline void
+cml_math_rng_jump_by(rng* r, const u64 poly[4]) {
+    u64 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for (i32 i = 0; i < 4; i++) {
+        for (i32 b = 0; b < 64; b++) {
+            if (poly[i] & ((u64)1 << b)) {
+                s0 ^= r->s[0];
+                s1 ^= r->s[1];
+                s2 ^= r->s[2];
+                s3 ^= r->s[3];
+            }
+            cml_math_rng_next(r);
+        }
+    }
+    r->s[0] = s0;
+    r->s[1] = s1;
+    r->s[2] = s2;
+    r->s[3] = s3;
+}
+
+/* Advances a generator by 2^128 steps. Calling this on copies of one
+ * generator yields 2^128 non-overlapping streams, e.g. one per thread. */
+static inline void
+cml_math_rng_jump(rng* r) {
+    cml_math_rng_jump_by(r, cml_rng_jump_poly);
+}
+
+/* Advances a generator by 2^192 steps. Use this to split off 2^64 starting
+ * points, each of which can then be split further with
+ * cml_math_rng_jump. */
+static inline void
+cml_math_rng_long_jump(rng* r) {
+    cml_math_rng_jump_by(r, cml_rng_long_jump_poly);
+}
+
+/* Returns the state used for the next thread-default generator. The first
+ * one starts from {1, 2, 3, 4}, the historical fixed seed of cml_math_rand.
+ * Each later one is seeded through splitmix64 from its position in the count,
+ * so the nth default costs the same as the first. Unlike jumped copies these
+ * streams are not provably disjoint, but with a 2^256 period an overlap is
+ * vanishingly unlikely; use cml_math_rng_jump where it must be ruled out. */
+static inline rng
+cml_math_rng_default_base(void) {
+    rng r = {{1, 2, 3, 4}};
+    u64 n = cml_atomic_fetch_add(&cml_rng_default_count, 1);
+    if (n > 0) {
+        cml_math_rng_seed(&r, cml_math_splitmix64(&n));
+    }
     return r;
 }
 
-/* Compute the component-wise square of a vector. */
-cml_inline vec2
-cml_math_vec2_square(const vec2 a) {
-    vec2 r;
-    r.v = simde_mm_mul_pd(a.v, a.v);
-    return r;
+/* Each thread's default generator, likewise shared by every translation
+ * unit. */
+cml_shared cml_thread_local rng  cml_rng_thread_state = {{0, 0, 0, 0}};
+cml_shared cml_thread_local bool cml_rng_thread_ready = false;
+
+/* Returns the calling thread's default generator, creating it on first
+ * use. */
+cml_inline rng*
+cml_math_rng_thread(void) {
+    if (!cml_rng_thread_ready) {
+        cml_rng_thread_state = cml_math_rng_default_base();
+        cml_rng_thread_ready = true;
+    }
+    return &cml_rng_thread_state;
 }
 
-/* Compute the component-wise cube of a vector. */
-cml_inline vec2
-cml_math_vec2_cube(const vec2 a) {
-    vec2 r;
-    r.v = simde_mm_mul_pd(a.v, simde_mm_mul_pd(a.v, a.v));
-    return r;
+/* Returns a random number in the range [0, 2^64) from the calling thread's
+ * default generator. */
+cml_inline u64 
+cml_math_rand(void) {
+    return cml_math_rng_next(cml_math_rng_thread());
 }
 
-/* Compute the component-wise exponent of a vector. */
-cml_inline vec2
-cml_math_vec2_exp(const vec2 a) {
-    vec2 r;
-    r.v = simde_mm_exp_pd(a.v);
-    return r;
+/* Returns a random number in the range [0, 1) from the calling thread's
+ * default generator. */
+cml_inline f64 
+cml_math_rand_f64(void) {
+    return cml_math_rng_next_f64(cml_math_rng_thread());
 }
 
-/*----------------------*/
-/* Comparison Functions */
-/*----------------------*/
+/*----------------*/
+/* Vector Version */
+/*----------------*/
 
-/* Compare two vectors for equality. */
-cml_inline vec2
-cml_math_vec2_is_equal(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_cmpeq_pd(a.v, b.v);
-    return v;
+/* The vector generators use the xoshiro256+ output function, which needs no
+ * 64-bit multiply but has weak low bits; cml_math_rngx8_next_starstar gives
+ * the xoshiro256** output of the same state for full-width integers. Lane i
+ * of a vector generator is seeded i jumps (2^128 steps each) away from lane
+ * 0, so lanes never overlap. */
+
+/*------------------------------*/
+/* Generates two random numbers */
+/*------------------------------*/
+
+cml_inline simde__m128i 
+rotlx2(const simde__m128i x, const i32 k) {
+    const simde__m128i k_mask   = simde_mm_set_epi64x(k, k);
+    const simde__m128i rot_mask = simde_mm_set_epi64x(64 - k, 64 - k);
+    return simde_mm_or_si128(
+           simde_mm_sll_epi64(x, k_mask), 
+           simde_mm_srl_epi64(x, rot_mask));
 }
 
-/* Compare two vectors for inequality. */
-cml_inline vec2
-cml_math_vec2_is_not_equal(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_cmpneq_pd(a.v, b.v);
-    return v;
+/* Load lane j of every state word of a two-lane generator into a scalar
+ * generator, or store it back. */
+cml_inline void
+cml_math_rngx2_lane(rngx2* r, const i32 j, rng* lane, const bool store) {
+    u64 w[4][2];
+    for (i32 i = 0; i < 4; i++) {
+        simde_mm_storeu_si128((simde__m128i*)w[i], r->s[i]);
+        if (store) {
+            w[i][j] = lane->s[i];
+            r->s[i] = simde_mm_loadu_si128((const simde__m128i*)w[i]);
+        } else {
+            lane->s[i] = w[i][j];
+        }
+    }
 }
 
-/* Compare two vectors for less than. */
-cml_inline vec2
-cml_math_vec2_is_less(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_cmplt_pd(a.v, b.v);
-    return v;
+/* Seed both lanes from a scalar generator: lane 0 copies it and lane 1 is
+ * one jump ahead. */
+cml_inline void
+cml_math_rngx2_seed_from_rng(rngx2* r, const rng* base) {
+    rng lane = *base;
+    for (i32 i = 0; i < 4; i++) {
+        r->s[i] = simde_mm_setzero_si128();
+    }
+    for (i32 j = 0; j < 2; j++) {
+        cml_math_rngx2_lane(r, j, &lane, true);
+        cml_math_rng_jump(&lane);
+    }
 }
 
-/* Compare two vectors for greater than. */
-cml_inline vec2
-cml_math_vec2_is_greater(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_cmpgt_pd(a.v, b.v);
-    return v;
+/* Seed both lanes from a single 64-bit value. */
+cml_inline void
+cml_math_rngx2_seed(rngx2* r, const u64 seed) {
+    rng base;
+    cml_math_rng_seed(&base, seed);
+    cml_math_rngx2_seed_from_rng(r, &base);
+}
+
+/* Advances every lane by 2^128 steps per lane, so a jumped copy never
+ * overlaps the original. */
+static inline void
+cml_math_rngx2_jump(rngx2* r) {
+    for (i32 j = 0; j < 2; j++) {
+        rng lane;
+        cml_math_rngx2_lane(r, j, &lane, false);
+        cml_math_rng_jump(&lane);
+        cml_math_rng_jump(&lane);
+        cml_math_rngx2_lane(r, j, &lane, true);
+    }
 }
 
-/*---------------------------*/
-/* Common Graphics Functions */
-/*---------------------------*/
+/* Advances every lane by 2^192 steps. */
+static inline void
+cml_math_rngx2_long_jump(rngx2* r) {
+    for (i32 j = 0; j < 2; j++) {
+        rng lane;
+        cml_math_rngx2_lane(r, j, &lane, false);
+        cml_math_rng_long_jump(&lane);
+        cml_math_rngx2_lane(r, j, &lane, true);
+    }
+}
 
-/* Compute the length of a vector. */
-cml_inline f64
-cml_math_vec2_length(const vec2 v) {
-    vec2 r;
-    r.v = simde_mm_mul_pd(v.v, v.v);
-    r.v = simde_mm_hadd_pd(r.v, r.v);
-    return sqrt(simde_mm_cvtsd_f64(r.v));
+/* Returns 2 random numbers in the range [0, 2^64) in the form of __m128i
+ * and advances the generator. */
+cml_inline simde__m128i 
+cml_math_rngx2_next(rngx2* r) {
+    simde__m128i* s = r->s;
+    const simde__m128i result = simde_mm_add_epi64(s[0], s[3]);
+    const simde__m128i t      = simde_mm_slli_epi64(s[1], 17);
+    s[2]                      = simde_mm_xor_si128(s[2], s[0]);
+    s[3]                      = simde_mm_xor_si128(s[3], s[1]);
+    s[1]                      = simde_mm_xor_si128(s[1], s[2]);
+    s[0]                      = simde_mm_xor_si128(s[0], s[3]);
+    s[2]                      = simde_mm_xor_si128(s[2], t);
+    s[3]                      = rotlx2(s[3], 45);
+    return result;
 }
 
-/* Compute the squared length of a vector. */
-cml_inline f64
-cml_math_vec2_length_squared(const vec2 v) {
-    vec2 r;
-    r.v = simde_mm_mul_pd(v.v, v.v);
-    r.v = simde_mm_hadd_pd(r.v, r.v);
-    return simde_mm_cvtsd_f64(r.v);
+/* Maps 2 random 64-bit integers to doubles in the range [0, 1), giving
+ * exactly (x >> 11) * 0x1.0p-53 per lane. The top 52 bits go in the mantissa
+ * of a number in [1, 2) and one is subtracted; the 53rd bit then adds
+ * 0x1.0p-53, which is exact, so no integer-to-double conversion is needed. */
+cml_inline simde__m128d
+cml_math_rng_bits_to_f64x2(const simde__m128i bits) {
+    const simde__m128i one = simde_mm_set1_epi64x(0x3FF0000000000000LL);
+    const simde__m128i low = simde_mm_set1_epi64x(0x800);
+    const simde__m128d hi  = simde_mm_sub_pd(
+                             simde_mm_castsi128_pd(simde_mm_or_si128(
+                             simde_mm_srli_epi64(bits, 12), one)),
+                             simde_mm_set1_pd(1.0));
+    const simde__m128i set = simde_mm_cmpeq_epi64(
+                             simde_mm_and_si128(bits, low), low);
+    return simde_mm_add_pd(hi, simde_mm_and_pd(simde_mm_castsi128_pd(set),
+                               simde_mm_set1_pd(0x1.0p-53)));
+}
+
+/* Returns 2 random doubles in the range [0, 1) in the form of simde__m128d
+ * and advances the generator. */
+cml_inline simde__m128d 
+cml_math_rngx2_next_f64(rngx2* r) {
+    return cml_math_rng_bits_to_f64x2(cml_math_rngx2_next(r));
+}
+
+/* Each thread's default two-lane generator, shared by every translation
+ * unit like the scalar one. */
+cml_shared cml_thread_local rngx2 cml_rngx2_thread_state = {{{0}}};
+cml_shared cml_thread_local bool  cml_rngx2_thread_ready = false;
+
+/* Returns the calling thread's default two-lane generator, creating it on
+ * first use. */
+cml_inline rngx2*
+cml_math_rngx2_thread(void) {
+    if (!cml_rngx2_thread_ready) {
+        const rng base = cml_math_rng_default_base();
+        cml_math_rngx2_seed_from_rng(&cml_rngx2_thread_state, &base);
+        cml_rngx2_thread_ready = true;
+    }
+    return &cml_rngx2_thread_state;
 }
 
-/* Compute the distance between two vectors. */
-cml_inline f64
-cml_math_vec2_distance(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_sub_pd(a.v, b.v);
-    v.v = simde_mm_mul_pd(v.v, v.v);
-    v.v = simde_mm_hadd_pd(v.v, v.v);
-    return sqrt(simde_mm_cvtsd_f64(v.v));
+/* Returns 2 random numbers in the range [0, 2^64) in the form of __m128i. */
+cml_inline simde__m128i 
+cml_math_randx2(void) {
+    return cml_math_rngx2_next(cml_math_rngx2_thread());
 }
 
-/* Compute the squared distance between two vectors. */
-cml_inline f64
-cml_math_vec2_distance_squared(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_sub_pd(a.v, b.v);
-    v.v = simde_mm_mul_pd(v.v, v.v);
-    v.v = simde_mm_hadd_pd(v.v, v.v);
-    return simde_mm_cvtsd_f64(v.v);
+/* Returns 2 random doubles in the range [0, 1) in the form
+ * of simde__m128d. */
+cml_inline simde__m128d 
+cml_math_randx2_f64(void) {
+    return cml_math_rngx2_next_f64(cml_math_rngx2_thread());
 }
 
-/* Normalize a vector. */
-cml_inline vec2
-cml_math_vec2_normalize(const vec2 v) {
-    vec2 r;
-    r.v = simde_mm_mul_pd(v.v, v.v);
-    r.v = simde_mm_hadd_pd(r.v, r.v);
-    r.v = simde_mm_div_pd(v.v, simde_mm_sqrt_pd(r.v));
-    return r;
+/*-------------------------------*/
+/* Generates four random numbers */
+/*-------------------------------*/
+
+cml_inline simde__m256i 
+rotlx4(const simde__m256i x, i32 k) {
+    const simde__m128i k_mask   = simde_mm_set_epi64x(0, k);
+    const simde__m128i rot_mask = simde_mm_set_epi64x(0, 64 - k);
+    return simde_mm256_or_si256(
+           simde_mm256_sll_epi64(x, k_mask), 
+           simde_mm256_srl_epi64(x, rot_mask));
 }
 
-/* Compute the dot product of two vectors. */
-cml_inline f64
-cml_math_vec2_dot_product(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_mul_pd(a.v, b.v);
-    v.v = simde_mm_hadd_pd(v.v, v.v);
-    return simde_mm_cvtsd_f64(v.v);
+/* Load lane j of every state word of a four-lane generator into a scalar
+ * generator, or store it back. */
+cml_inline void
+cml_math_rngx4_lane(rngx4* r, const i32 j, rng* lane, const bool store) {
+    u64 w[4][4];
+    for (i32 i = 0; i < 4; i++) {
+        simde_mm256_storeu_si256((simde__m256i*)w[i], r->s[i]);
+        if (store) {
+            w[i][j] = lane->s[i];
+            r->s[i] = simde_mm256_loadu_si256((const simde__m256i*)w[i]);
+        } else {
+            lane->s[i] = w[i][j];
+        }
+    }
 }
 
-/* Compute the cross product of two vectors. */
-cml_inline f64
-cml_math_vec2_cross_product(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_shuffle_pd(a.v, a.v, 1);
-    v.v = simde_mm_mul_pd(v.v, b.v);
-    v.v = simde_mm_shuffle_pd(v.v, v.v, 1);
-    v.v = simde_mm_sub_pd(a.v, v.v);
-    return simde_mm_cvtsd_f64(v.v);
+/* Seed all four lanes from a scalar generator: lane j is j jumps ahead of
+ * it. */
+cml_inline void
+cml_math_rngx4_seed_from_rng(rngx4* r, const rng* base) {
+    rng lane = *base;
+    for (i32 i = 0; i < 4; i++) {
+        r->s[i] = simde_mm256_setzero_si256();
+    }
+    for (i32 j = 0; j < 4; j++) {
+        cml_math_rngx4_lane(r, j, &lane, true);
+        cml_math_rng_jump(&lane);
+    }
 }
 
-/* Compute the angle between two vectors. */
-cml_inline f64
-cml_math_vec2_angle(const vec2 a, const vec2 b) {
-    vec2 v;
-    v.v = simde_mm_mul_pd(a.v, b.v);
-    v.v = simde_mm_hadd_pd(v.v, v.v);
-    v.v = simde_mm_div_pd(v.v, 
-          simde_mm_mul_pd(
-          simde_mm_sqrt_pd(
-          simde_mm_mul_pd(a.v, a.v)), 
-          simde_mm_sqrt_pd(
-          simde_mm_mul_pd(b.v, b.v))));
-    return acos(simde_mm_cvtsd_f64(v.v));
+/* Seed all four lanes from a single 64-bit value. */
+cml_inline void
+cml_math_rngx4_seed(rngx4* r, const u64 seed) {
+    rng base;
+    cml_math_rng_seed(&base, seed);
+    cml_math_rngx4_seed_from_rng(r, &base);
+}
+
+/* Advances every lane by 2^128 steps per lane, so a jumped copy never
+ * overlaps the original. */
+static inline void
+cml_math_rngx4_jump(rngx4* r) {
+    for (i32 j = 0; j < 4; j++) {
+        rng lane;
+        cml_math_rngx4_lane(r, j, &lane, false);
+        for (i32 i = 0; i < 4; i++) {
+            cml_math_rng_jump(&lane);
+        }
+        cml_math_rngx4_lane(r, j, &lane, true);
+    }
 }
 
-/* Reflect a vector about a normal. */
-cml_inline vec2
-cml_math_vec2_reflect(const vec2 v, const vec2 n) {
-    vec2 r;
-    r.v = simde_mm_mul_pd(n.v, n.v);
-    r.v = simde_mm_hadd_pd(r.v, r.v);
-    r.v = simde_mm_mul_pd(v.v, r.v);
-    r.v = simde_mm_mul_pd(r.v, simde_mm_set1_pd(2.0));
-    r.v = simde_mm_sub_pd(v.v, r.v);
-    return r;
+/* Advances every lane by 2^192 steps. */
+static inline void
+cml_math_rngx4_long_jump(rngx4* r) {
+    for (i32 j = 0; j < 4; j++) {
+        rng lane;
+        cml_math_rngx4_lane(r, j, &lane, false);
+        cml_math_rng_long_jump(&lane);
+        cml_math_rngx4_lane(r, j, &lane, true);
+    }
 }
 
-/* Compute the projection of a vector onto another vector. */
-cml_inline vec2
-cml_math_vec2_project(const vec2 v, const vec2 n) {
-    vec2 r;
-    r.v = simde_mm_mul_pd(n.v, n.v);
-    r.v = simde_mm_hadd_pd(r.v, r.v);
-    r.v = simde_mm_mul_pd(v.v, r.v);
-    r.v = simde_mm_mul_pd(r.v, simde_mm_set1_pd(2.0));
-    r.v = simde_mm_sub_pd(v.v, r.v);
-    return r;
+/* Returns 4 random numbers in the range [0, 2^64) in the form
+ * of simde__m256i and advances the generator. */
+cml_inline simde__m256i 
+cml_math_rngx4_next(rngx4* r) {
+    simde__m256i* s = r->s;
+    const simde__m256i result = simde_mm256_add_epi64(s[0], s[3]);
+    const simde__m256i t      = simde_mm256_slli_epi64(s[1], 17);
+    s[2]                      = simde_mm256_xor_si256(s[2], s[0]);
+    s[3]                      = simde_mm256_xor_si256(s[3], s[1]);
+    s[1]                      = simde_mm256_xor_si256(s[1], s[2]);
+    s[0]                      = simde_mm256_xor_si256(s[0], s[3]);
+    s[2]                      = simde_mm256_xor_si256(s[2], t);
+    s[3]                      = rotlx4(s[3], 45);
+    return result;
 }
 
-/* Compute the component-wise lerp of two vectors. */
-cml_inline vec2
-cml_math_vec2_lerp(const vec2 a, const vec2 b, const f64 t) {
-    vec2 r;
-    r.v = simde_mm_sub_pd(b.v, a.v);
-    r.v = simde_mm_mul_pd(r.v, simde_mm_set1_pd(t));
-    r.v = simde_mm_add_pd(r.v, a.v);
-    return r;
+/* SIMDE apparently doesn't implement this function, so here's what the
+ * intrinsics logic should look like. */
+cml_inline simde__m256d 
+simde_mm256_cvtepi64_pd(simde__m256i a) {
+    simde__m256d result;
+    result[0] = (f64)a[0];
+    result[1] = (f64)a[1];
+    result[2] = (f64)a[2];
+    result[3] = (f64)a[3];
+    return result;
 }
 
-/* Compute the component-wise smoothstep of two vectors. */
-cml_inline vec2
-cml_math_vec2_smoothstep(const vec2 a, const vec2 b, const f64 t) {
-    vec2 r;
-    r.v = simde_mm_sub_pd(b.v, a.v);
-    r.v = simde_mm_mul_pd(r.v, simde_mm_set1_pd(t));
-    r.v = simde_mm_mul_pd(r.v, r.v);
-    r.v = simde_mm_mul_pd(r.v, simde_mm_set1_pd(3.0));
-    r.v = simde_mm_sub_pd(r.v, simde_mm_set1_pd(2.0));
-    r.v = simde_mm_mul_pd(r.v, simde_mm_mul_pd(r.v, r.v));
-    r.v = simde_mm_add_pd(r.v, simde_mm_set1_pd(1.0));
-    r.v = simde_mm_mul_pd(r.v, simde_mm_sub_pd(b.v, a.v));
-    r.v = simde_mm_add_pd(r.v, a.v);
-    return r;
+/* Maps 4 random 64-bit integers to doubles in the range [0, 1), as
+ * cml_math_rng_bits_to_f64x2 does. */
+cml_inline simde__m256d
+cml_math_rng_bits_to_f64x4(const simde__m256i bits) {
+    const simde__m256i one = simde_mm256_set1_epi64x(0x3FF0000000000000LL);
+    const simde__m256i low = simde_mm256_set1_epi64x(0x800);
+    const simde__m256d hi  = simde_mm256_sub_pd(
+                             simde_mm256_castsi256_pd(simde_mm256_or_si256(
+                             simde_mm256_srli_epi64(bits, 12), one)),
+                             simde_mm256_set1_pd(1.0));
+    const simde__m256i set = simde_mm256_cmpeq_epi64(
+                             simde_mm256_and_si256(bits, low), low);
+    return simde_mm256_add_pd(hi, simde_mm256_and_pd(
+                                  simde_mm256_castsi256_pd(set),
+                                  simde_mm256_set1_pd(0x1.0p-53)));
+}
+
+/* Returns 4 random doubles in the range [0, 1) in the form of simde__m256d
+ * and advances the generator. */
+cml_inline simde__m256d 
+cml_math_rngx4_next_f64(rngx4* r) {
+    return cml_math_rng_bits_to_f64x4(cml_math_rngx4_next(r));
+}
+
+/* Each thread's default four-lane generator, shared by every translation
+ * unit like the scalar one. */
+cml_shared cml_thread_local rngx4 cml_rngx4_thread_state = {{{0}}};
+cml_shared cml_thread_local bool  cml_rngx4_thread_ready = false;
+
+/* Returns the calling thread's default four-lane generator, creating it on
+ * first use. */
+cml_inline rngx4*
+cml_math_rngx4_thread(void) {
+    if (!cml_rngx4_thread_ready) {
+        const rng base = cml_math_rng_default_base();
+        cml_math_rngx4_seed_from_rng(&cml_rngx4_thread_state, &base);
+        cml_rngx4_thread_ready = true;
+    }
+    return &cml_rngx4_thread_state;
 }
 
-/* Compute the component-wise clamp of a vector. */
-cml_inline vec2
-cml_math_vec2_clamp(const vec2 v, const vec2 min, const vec2 max) {
-    vec2 r;
-    r.v = simde_mm_min_pd(v.v, max.v);
-    r.v = simde_mm_max_pd(r.v, min.v);
-    return r;
+/* Returns 4 random numbers in the range [0, 2^64) in the form
+ * of simde__m256i. */
+cml_inline simde__m256i 
+cml_math_randx4(void) {
+    return cml_math_rngx4_next(cml_math_rngx4_thread());
 }
 
-/* Print a vector to stdout. */
-cml_inline void
-cml_math_vec2_print(const vec2 v) {
-    f64 a[2];
-    simde_mm_storeu_pd(a, v.v);
-    printf("%f %f ", a[0], a[1]);
+/* Returns 4 random doubles in the range [0, 1) in the form
+ * of simde__m256d. */
+cml_inline simde__m256d 
+cml_math_randx4_f64(void) {
+    return cml_math_rngx4_next_f64(cml_math_rngx4_thread());
 }
 
-/*============================================================================*/
-/* 4D Vector                                                                  */
-/*============================================================================*/
+/*--------------------------------*/
+/* Generates eight random numbers */
+/*--------------------------------*/
 
-typedef struct vec4 {
-    simde__m256d v;
-} vec4;
+/* Eight independent xoshiro256 streams, one per 64-bit lane. On AVX-512 each
+ * state word is one register; elsewhere SIMDE splits it into two halves that
+ * advance in parallel. */
+typedef struct rngx8 {
+    simde__m512i s[4];
+} rngx8;
 
-/* Set vector elements individually. */
-cml_inline vec4
-cml_math_vec4_set(const f64 x, const f64 y, const f64 z, const f64 w) {
-    vec4 r;
-    r.v = simde_mm256_set_pd(w, z, y, x);
-    return r;
+/* Load lane j of every state word of an eight-lane generator into a scalar
+ * generator, or store it back. */
+cml_inline void
+cml_math_rngx8_lane(rngx8* r, const i32 j, rng* lane, const bool store) {
+    u64 w[4][8];
+    for (i32 i = 0; i < 4; i++) {
+        simde_mm512_storeu_si512(w[i], r->s[i]);
+        if (store) {
+            w[i][j] = lane->s[i];
+            r->s[i] = simde_mm512_loadu_si512(w[i]);
+        } else {
+            lane->s[i] = w[i][j];
+        }
+    }
 }
 
-/* Set vector elements from an array. */
-cml_inline vec4
-cml_math_vec4_set_array(const f64 *a) {
-    vec4 r;
-    r.v = simde_mm256_loadu_pd(a);
-    return r;
+/* Seed all eight lanes from a scalar generator: lane j is j jumps ahead of
+ * it. */
+cml_inline void
+cml_math_rngx8_seed_from_rng(rngx8* r, const rng* base) {
+    rng lane = *base;
+    for (i32 i = 0; i < 4; i++) {
+        r->s[i] = simde_mm512_setzero_si512();
+    }
+    for (i32 j = 0; j < 8; j++) {
+        cml_math_rngx8_lane(r, j, &lane, true);
+        cml_math_rng_jump(&lane);
+    }
 }
 
-/* Set vector elements from a scalar. */
-cml_inline vec4
-cml_math_vec4_set_scalar(const f64 s) {
-    vec4 r;
-    r.v = simde_mm256_set1_pd(s);
-    return r;
+/* Seed all eight lanes from a single 64-bit value. */
+cml_inline void
+cml_math_rngx8_seed(rngx8* r, const u64 seed) {
+    rng base;
+    cml_math_rng_seed(&base, seed);
+    cml_math_rngx8_seed_from_rng(r, &base);
+}
+
+/* Advances every lane by 2^128 steps per lane, so a jumped copy never
+ * overlaps the original. */
+static inline void
+cml_math_rngx8_jump(rngx8* r) {
+    for (i32 j = 0; j < 8; j++) {
+        rng lane;
+        cml_math_rngx8_lane(r, j, &lane, false);
+        for (i32 i = 0; i < 8; i++) {
+            cml_math_rng_jump(&lane);
+        }
+        cml_math_rngx8_lane(r, j, &lane, true);
+    }
 }
 
-/* Set vector elements from two 2D vectors. */
-cml_inline vec4
-cml_math_vec4_set_vec2(const vec2 v1, const vec2 v2) {
-    vec4 r;
-    r.v = simde_mm256_set_pd(v2.v[1], v2.v[0], v1.v[1], v1.v[0]);
-    return r;
+/* Advances every lane by 2^192 steps. */
+static inline void
+cml_math_rngx8_long_jump(rngx8* r) {
+    for (i32 j = 0; j < 8; j++) {
+        rng lane;
+        cml_math_rngx8_lane(r, j, &lane, false);
+        cml_math_rng_long_jump(&lane);
+        cml_math_rngx8_lane(r, j, &lane, true);
+    }
 }
 
-/* Set vector elements to zero. */
-cml_inline vec4
-cml_math_vec4_zero(void) {
-    vec4 r;
-    r.v = simde_mm256_setzero_pd();
-    return r;
+/* Returns 8 random numbers in the range [0, 2^64) in the form
+ * of simde__m512i and advances the generator. */
+cml_inline simde__m512i
+cml_math_rngx8_next(rngx8* r) {
+    simde__m512i* s = r->s;
+    const simde__m512i result = simde_mm512_add_epi64(s[0], s[3]);
+    const simde__m512i t      = simde_mm512_slli_epi64(s[1], 17);
+    s[2]                      = simde_mm512_xor_si512(s[2], s[0]);
+    s[3]                      = simde_mm512_xor_si512(s[3], s[1]);
+    s[1]                      = simde_mm512_xor_si512(s[1], s[2]);
+    s[0]                      = simde_mm512_xor_si512(s[0], s[3]);
+    s[2]                      = simde_mm512_xor_si512(s[2], t);
+    s[3]                      = simde_mm512_rol_epi64(s[3], 45);
+    return result;
 }
 
-/* Set vector elements to one. */
-cml_inline vec4
-cml_math_vec4_one(void) {
-    vec4 r;
-    r.v = simde_mm256_set1_pd(1.0);
-    return r;
+/* Returns 8 random numbers in the range [0, 2^64) through the xoshiro256**
+ * output function and advances the generator. All 64 bits are of full
+ * quality, and lane j gives what cml_math_rng_next gives for a scalar
+ * generator holding that lane's state. The multiplies by 5 and 9 are done
+ * as shifts and adds. */
+cml_inline simde__m512i
+cml_math_rngx8_next_starstar(rngx8* r) {
+    const simde__m512i s1 = r->s[1];
+    const simde__m512i x  = simde_mm512_rol_epi64(simde_mm512_add_epi64(
+                            simde_mm512_slli_epi64(s1, 2), s1), 7);
+    cml_math_rngx8_next(r);
+    return simde_mm512_add_epi64(simde_mm512_slli_epi64(x, 3), x);
 }
 
-/* Set vector elements to infinity. */
-cml_inline vec4
-cml_math_vec4_inf(void) {
-    vec4 r;
-    r.v = simde_mm256_set1_pd(HUGE_VAL);
-    return r;
+/* Maps 8 random 64-bit integers to doubles in the range [0, 1), as
+ * cml_math_rng_bits_to_f64x2 does. */
+cml_inline simde__m512d
+cml_math_rng_bits_to_f64x8(const simde__m512i bits) {
+    const simde__m512i one = simde_mm512_set1_epi64(0x3FF0000000000000LL);
+    const simde__m512d hi  = simde_mm512_sub_pd(
+                             simde_mm512_castsi512_pd(simde_mm512_or_si512(
+                             simde_mm512_srli_epi64(bits, 12), one)),
+                             simde_mm512_set1_pd(1.0));
+    const simde__mmask8 set = simde_mm512_test_epi64_mask(
+                              bits, simde_mm512_set1_epi64(0x800));
+    return simde_mm512_mask_add_pd(hi, set, hi,
+                                   simde_mm512_set1_pd(0x1.0p-53));
+}
+
+/* Returns 8 random doubles in the range [0, 1) in the form of simde__m512d
+ * and advances the generator. */
+cml_inline simde__m512d
+cml_math_rngx8_next_f64(rngx8* r) {
+    return cml_math_rng_bits_to_f64x8(cml_math_rngx8_next(r));
+}
+
+/* Each thread's default eight-lane generator, shared by every translation
+ * unit like the scalar one. */
+cml_shared cml_thread_local rngx8 cml_rngx8_thread_state = {{{0}}};
+cml_shared cml_thread_local bool  cml_rngx8_thread_ready = false;
+
+/* Returns the calling thread's default eight-lane generator, creating it on
+ * first use. */
+cml_inline rngx8*
+cml_math_rngx8_thread(void) {
+    if (!cml_rngx8_thread_ready) {
+        const rng base = cml_math_rng_default_base();
+        cml_math_rngx8_seed_from_rng(&cml_rngx8_thread_state, &base);
+        cml_rngx8_thread_ready = true;
+    }
+    return &cml_rngx8_thread_state;
 }
 
-/*----------------------*/
-/* Arithmetic Functions */
-/*----------------------*/
+/*-----------------*/
+/* Bulk Generation */
+/*-----------------*/
 
-/* Add two vectors. */
-cml_inline vec4
-cml_math_vec4_add(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_add_pd(a.v, b.v);
-    return r;
+/* Fill out with n random numbers in the range [0, 2^64), eight per step,
+ * from the xoshiro256** output so the low bits are as good as the high ones.
+ * If n is not a multiple of eight the unused values of the last step are
+ * discarded. */
+static inline void
+cml_math_rand_fill_u64(rngx8* r, u64* out, const size_t n) {
+    /* Work on a local copy so the state stays in registers instead of being
+     * reloaded after every store to out. */
+    rngx8 g = *r;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        simde_mm512_storeu_si512(out + i, cml_math_rngx8_next_starstar(&g));
+    }
+    if (i < n) {
+        u64 tail[8];
+        simde_mm512_storeu_si512(tail, cml_math_rngx8_next_starstar(&g));
+        memcpy(out + i, tail, (n - i) * sizeof(u64));
+    }
+    *r = g;
+}
+
+/* Fill out with n random doubles in the range [0, 1), each carrying 53
+ * random bits as cml_math_rng_bits_to_f64x8 builds them. If n is not a
+ * multiple of eight the unused values of the last step are discarded. */
+static inline void
+cml_math_rand_fill_f64(rngx8* r, f64* out, const size_t n) {
+    /* Work on a local copy so the state stays in registers instead of being
+     * reloaded after every store to out. */
+    rngx8 g = *r;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        simde_mm512_storeu_pd(out + i, cml_math_rngx8_next_f64(&g));
+    }
+    if (i < n) {
+        f64 tail[8];
+        simde_mm512_storeu_pd(tail, cml_math_rngx8_next_f64(&g));
+        memcpy(out + i, tail, (n - i) * sizeof(f64));
+    }
+    *r = g;
 }
 
-/* Add a vector and a scalar. */
-cml_inline vec4
-cml_math_vec4_add_scalar(const vec4 v, const f64 s) {
-    vec4 r;
-    r.v = simde_mm256_add_pd(v.v, simde_mm256_set1_pd(s));
-    return r;
-}
+/*============================================================================*/
+/* Mathematical Types Forward Declarations                                    */
+/*============================================================================*/
 
-/* Subtract two vectors. */
-cml_inline vec4
-cml_math_vec4_sub(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_sub_pd(a.v, b.v);
-    return r;
-}
+typedef struct vec2 vec2;
+typedef struct vec4 vec4;
+typedef struct mat4 mat4;
+typedef struct quat quat;
+typedef struct dquat dquat;
+typedef struct vec2f vec2f;
+typedef struct vec4f vec4f;
+typedef struct mat4f mat4f;
+typedef struct quatf quatf;
 
-/* Subtract a scalar from a vector. */
-cml_inline vec4
-cml_math_vec4_sub_scalar(const vec4 v, const f64 s) {
-    vec4 r;
-    r.v = simde_mm256_sub_pd(v.v, simde_mm256_set1_pd(s));
-    return r;
-}
+/*============================================================================*/
+/* 2D Vector                                                                  */
+/*============================================================================*/
 
-/* Negate a vector. */
-cml_inline vec4
-cml_math_vec4_neg(const vec4 v) {
-    vec4 r;
-    r.v = simde_mm256_sub_pd(simde_mm256_setzero_pd(), v.v);
+/* 2D vector. */
+typedef struct vec2 {
+    simde__m128d v;
+} vec2;
+
+/*--------------------------*/
+/* Initialization Functions */
+/*--------------------------*/
+
+/* Set vector elements individually. */
+cml_inline vec2
+cml_math_vec2_set(const f64 x, const f64 y) {
+    vec2 v;
+    v.v = simde_mm_set_pd(y, x);
+    return v;
+}
+
+/* Set vector elements from an array. */
+cml_inline vec2
+cml_math_vec2_set_from_array(const f64* a) {
+    vec2 v;
+    v.v = simde_mm_loadu_pd(a);
+    return v;
+}
+
+/* Set vector elements from a scalar. */
+cml_inline vec2
+cml_math_vec2_set_from_scalar(const f64 s) {
+    vec2 v;
+    v.v = simde_mm_set1_pd(s);
+    return v;
+}
+
+/* Set vector elements from a 2D vector. */
+cml_inline vec2
+cml_math_vec2_set_from_vec2(const vec2 v) {
+    vec2 r;
+    r.v = v.v;
     return r;
 }
 
+/* Set vector elements to zero. */
+cml_inline vec2
+cml_math_vec2_zero(void) {
+    vec2 v;
+    v.v = simde_mm_setzero_pd();
+    return v;
+}
+
+/* Set vector elements to one. */
+cml_inline vec2
+cml_math_vec2_one(void) {
+    vec2 v;
+    v.v = simde_mm_set1_pd(1.0);
+    return v;
+}
+
+/* Set vector elements to infinity. */
+cml_inline vec2
+cml_math_vec2_infinity(void) {
+    vec2 v;
+    v.v = simde_mm_set1_pd(HUGE_VAL);
+    return v;
+}
+
+/*----------------------*/
+/* Arithmetic Functions */
+/*----------------------*/
+
+/* Add two vectors. */
+cml_inline vec2
+cml_math_vec2_add(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_add_pd(a.v, b.v);
+    return v;
+}
+
+/* Add a vector and a scalar. */
+cml_inline vec2
+cml_math_vec2_add_scalar(const vec2 a, const f64 b) {
+    vec2 v;
+    v.v = simde_mm_add_pd(a.v, simde_mm_set1_pd(b));
+    return v;
+}
+
+/* Subtract two vectors. */
+cml_inline vec2
+cml_math_vec2_sub(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_sub_pd(a.v, b.v);
+    return v;
+}
+
+/* Negate a vector. */
+cml_inline vec2
+cml_math_vec2_neg(const vec2 a) {
+    vec2 v;
+    v.v = simde_mm_sub_pd(simde_mm_setzero_pd(), a.v);
+    return v;
+}
+
+/* Subtract a vector and a scalar. */
+cml_inline vec2
+cml_math_vec2_sub_scalar(const vec2 a, const f64 b) {
+    vec2 v;
+    v.v = simde_mm_sub_pd(a.v, simde_mm_set1_pd(b));
+    return v;
+}
+
 /* Multiply two vectors. */
-cml_inline vec4
-cml_math_vec4_mul(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_mul_pd(a.v, b.v);
-    return r;
+cml_inline vec2
+cml_math_vec2_mul(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_mul_pd(a.v, b.v);
+    return v;
 }
 
 /* Multiply a vector and a scalar. */
-cml_inline vec4
-cml_math_vec4_mul_scalar(const vec4 v, const f64 s) {
-    vec4 r;
-    r.v = simde_mm256_mul_pd(v.v, simde_mm256_set1_pd(s));
-    return r;
+cml_inline vec2
+cml_math_vec2_mul_scalar(const vec2 a, const f64 b) {
+    vec2 v;
+    v.v = simde_mm_mul_pd(a.v, simde_mm_set1_pd(b));
+    return v;
 }
 
 /* Divide two vectors. */
-cml_inline vec4
-cml_math_vec4_div(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_div_pd(a.v, b.v);
+cml_inline vec2
+cml_math_vec2_div(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_div_pd(a.v, b.v);
+    return v;
+}
+
+/* Divide a vector and a scalar. */
+cml_inline vec2
+cml_math_vec2_div_scalar(const vec2 a, const f64 b) {
+    vec2 v;
+    v.v = simde_mm_div_pd(a.v, simde_mm_set1_pd(b));
+    return v;
+}
+
+/* Compute the component-wise minimum of two vectors. */
+cml_inline vec2
+cml_math_vec2_min(const vec2 a, const vec2 b) {
+    vec2 r;
+    r.v = simde_mm_min_pd(a.v, b.v);
     return r;
 }
 
-/* Divide a vector by a scalar. */
-cml_inline vec4
-cml_math_vec4_div_scalar(const vec4 v, const f64 s) {
-    vec4 r;
-    r.v = simde_mm256_div_pd(v.v, simde_mm256_set1_pd(s));
+/* Compute the component-wise maximum of two vectors. */
+cml_inline vec2
+cml_math_vec2_max(const vec2 a, const vec2 b) {
+    vec2 r;
+    r.v = simde_mm_max_pd(a.v, b.v);
     return r;
 }
 
-/* Compute the reciprocal of a vector. */
-cml_inline vec4
-cml_math_vec4_rcp(const vec4 v) {
-    vec4 r;
-    r.v = simde_mm256_div_pd(simde_mm256_set1_pd(1.0), v.v);
+/* Compute the component-wise absolute value of a vector. */
+cml_inline vec2
+cml_math_vec2_abs(const vec2 a) {
+    vec2 r;
+    r.v = simde_mm_andnot_pd(simde_mm_set1_pd(-0.0), a.v);
     return r;
 }
 
-/* Compute the square root of a vector. */
-cml_inline vec4
-cml_math_vec4_sqrt(const vec4 v) {
-    vec4 r;
-    r.v = simde_mm256_sqrt_pd(v.v);
+/* Compute the component-wise square root of a vector. */
+cml_inline vec2
+cml_math_vec2_sqrt(const vec2 a) {
+    vec2 r;
+    r.v = simde_mm_sqrt_pd(a.v);
     return r;
 }
 
-/* Compute the reciprocal square root of a vector. */
-cml_inline vec4
-cml_math_vec4_rsqrt(const vec4 v) {
-    vec4 r;
-    r.v = simde_mm256_div_pd(
-          simde_mm256_set1_pd(1.0), 
-          simde_mm256_sqrt_pd(v.v));
+/* Compute the component-wise reciprocal square root of a vector. */
+cml_inline vec2
+cml_math_vec2_rsqrt(const vec2 a) {
+    vec2 r;
+    r.v = simde_mm_div_pd(
+          simde_mm_set1_pd(1.0), 
+          simde_mm_sqrt_pd(a.v));
     return r;
 }
 
-/* Compute the absolute value of a vector. */
-cml_inline vec4
-cml_math_vec4_abs(const vec4 v) {
-    vec4 r;
-    r.v = simde_mm256_andnot_pd(
-          simde_mm256_set1_pd(-0.0), 
-          v.v);
+/* Compute the component-wise reciprocal of a vector. */
+cml_inline vec2
+cml_math_vec2_rcp(const vec2 a) {
+    vec2 r;
+    r.v = simde_mm_div_pd(
+          simde_mm_set1_pd(1.0), 
+          a.v);
     return r;
 }
 
-/* Compute the minimum of two vectors. */
-cml_inline vec4
-cml_math_vec4_min(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_min_pd(a.v, b.v);
+/* Compute the component-wise square of a vector. */
+cml_inline vec2
+cml_math_vec2_square(const vec2 a) {
+    vec2 r;
+    r.v = simde_mm_mul_pd(a.v, a.v);
     return r;
 }
 
-/* Compute the maximum of two vectors. */
-cml_inline vec4
-cml_math_vec4_max(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_max_pd(a.v, b.v);
+/* Compute the component-wise cube of a vector. */
+cml_inline vec2
+cml_math_vec2_cube(const vec2 a) {
+    vec2 r;
+    r.v = simde_mm_mul_pd(a.v, simde_mm_mul_pd(a.v, a.v));
+    return r;
+}
+
+/* Compute the component-wise exponent of a vector. */
+cml_inline vec2
+cml_math_vec2_exp(const vec2 a) {
+    vec2 r;
+    r.v = simde_mm_exp_pd(a.v);
     return r;
 }
 
@@ -1684,778 +3421,7210 @@ cml_math_vec4_max(const vec4 a, const vec4 b) {
 /*----------------------*/
 
 /* Compare two vectors for equality. */
-cml_inline vec4
-cml_math_vec4_is_equal(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_cmp_pd(a.v, b.v, SIMDE_CMP_EQ_OQ);
-    return r;
+cml_inline vec2
+cml_math_vec2_is_equal(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_cmpeq_pd(a.v, b.v);
+    return v;
 }
 
 /* Compare two vectors for inequality. */
-cml_inline vec4
-cml_math_vec4_is_not_equal(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_cmp_pd(a.v, b.v, SIMDE_CMP_NEQ_UQ);
-    return r;
-}
-
-/* Compare two vectors for less than. */
-cml_inline vec4
-cml_math_vec4_is_less(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_cmp_pd(a.v, b.v, SIMDE_CMP_LT_OQ);
-    return r;
+cml_inline vec2
+cml_math_vec2_is_not_equal(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_cmpneq_pd(a.v, b.v);
+    return v;
+}
+
+/* Compare two vectors for less than. */
+cml_inline vec2
+cml_math_vec2_is_less(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_cmplt_pd(a.v, b.v);
+    return v;
 }
 
 /* Compare two vectors for greater than. */
-cml_inline vec4
-cml_math_vec4_is_greater(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_cmp_pd(a.v, b.v, SIMDE_CMP_GT_OQ);
-    return r;
+cml_inline vec2
+cml_math_vec2_is_greater(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_cmpgt_pd(a.v, b.v);
+    return v;
 }
 
 /*---------------------------*/
 /* Common Graphics Functions */
 /*---------------------------*/
 
-/* Compute the dot product of two vectors. */
+/* Compute the length of a vector. */
 cml_inline f64
-cml_math_vec4_dot_product(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_mul_pd(a.v, b.v);
-    r.v = simde_mm256_hadd_pd(r.v, r.v);
-    r.v = simde_mm256_hadd_pd(r.v, r.v);
-    return r.v[0];
+cml_math_vec2_length(const vec2 v) {
+    vec2 r;
+    r.v = simde_mm_mul_pd(v.v, v.v);
+    r.v = simde_mm_hadd_pd(r.v, r.v);
+    return sqrt(simde_mm_cvtsd_f64(r.v));
 }
 
-/* Returns the cross product of a 4D vector. */
-cml_inline vec4 
-cml_math_vec4_cross_product(const vec4 a, const vec4 b) {
-    vec4 result, permute_b, permute_a, sub_result;
-    permute_b.v  = simde_mm256_permute4x64_pd(b.v, 
-                   SIMDE_MM_SHUFFLE(3, 0, 2, 1));
-    permute_a.v  = simde_mm256_permute4x64_pd(a.v, 
-                   SIMDE_MM_SHUFFLE(3, 0, 2, 1));
-    sub_result.v = simde_mm256_sub_pd(
-                   simde_mm256_mul_pd(a.v, permute_b.v), 
-                   simde_mm256_mul_pd(b.v, permute_a.v));
-    result.v     = simde_mm256_permute4x64_pd(sub_result.v, 
-                   SIMDE_MM_SHUFFLE(3, 0, 2, 1));
-    return result;
+/* Compute the squared length of a vector. */
+cml_inline f64
+cml_math_vec2_length_squared(const vec2 v) {
+    vec2 r;
+    r.v = simde_mm_mul_pd(v.v, v.v);
+    r.v = simde_mm_hadd_pd(r.v, r.v);
+    return simde_mm_cvtsd_f64(r.v);
 }
 
-/* Compute the length of a vector. */
+/* Compute the distance between two vectors. */
 cml_inline f64
-cml_math_vec4_length(const vec4 v) {
-    vec4 r;
-    r.v = simde_mm256_mul_pd(v.v, v.v);
-    r.v = simde_mm256_hadd_pd(r.v, r.v);
-    r.v = simde_mm256_hadd_pd(r.v, r.v);
-    return sqrt(r.v[0]);
+cml_math_vec2_distance(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_sub_pd(a.v, b.v);
+    v.v = simde_mm_mul_pd(v.v, v.v);
+    v.v = simde_mm_hadd_pd(v.v, v.v);
+    return sqrt(simde_mm_cvtsd_f64(v.v));
 }
 
-/* Compute the squared length of a vector. */
+/* Compute the squared distance between two vectors. */
 cml_inline f64
-cml_math_vec4_length_squared(const vec4 v) {
-    vec4 r;
-    r.v = simde_mm256_mul_pd(v.v, v.v);
-    r.v = simde_mm256_hadd_pd(r.v, r.v);
-    r.v = simde_mm256_hadd_pd(r.v, r.v);
-    return r.v[0];
+cml_math_vec2_distance_squared(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_sub_pd(a.v, b.v);
+    v.v = simde_mm_mul_pd(v.v, v.v);
+    v.v = simde_mm_hadd_pd(v.v, v.v);
+    return simde_mm_cvtsd_f64(v.v);
 }
 
 /* Normalize a vector. */
-cml_inline vec4
-cml_math_vec4_normalize(const vec4 v) {
-    vec4 r;
-    r.v = simde_mm256_div_pd(v.v, 
-          simde_mm256_sqrt_pd(
-          simde_mm256_mul_pd(v.v, v.v)));
+cml_inline vec2
+cml_math_vec2_normalize(const vec2 v) {
+    vec2 r;
+    r.v = simde_mm_mul_pd(v.v, v.v);
+    r.v = simde_mm_hadd_pd(r.v, r.v);
+    r.v = simde_mm_div_pd(v.v, simde_mm_sqrt_pd(r.v));
     return r;
 }
 
-/* Compute the distance between two vectors. */
+/* Compute the dot product of two vectors. */
 cml_inline f64
-cml_math_vec4_distance(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_sub_pd(a.v, b.v);
-    r.v = simde_mm256_mul_pd(r.v, r.v);
-    r.v = simde_mm256_hadd_pd(r.v, r.v);
-    r.v = simde_mm256_hadd_pd(r.v, r.v);
-    return sqrt(r.v[0]);
+cml_math_vec2_dot_product(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_mul_pd(a.v, b.v);
+    v.v = simde_mm_hadd_pd(v.v, v.v);
+    return simde_mm_cvtsd_f64(v.v);
 }
 
-/* Compute the squared distance between two vectors. */
+/* Compute the cross product of two vectors. */
 cml_inline f64
-cml_math_vec4_distance_squared(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_sub_pd(a.v, b.v);
-    r.v = simde_mm256_mul_pd(r.v, r.v);
-    r.v = simde_mm256_hadd_pd(r.v, r.v);
-    r.v = simde_mm256_hadd_pd(r.v, r.v);
-    return r.v[0];
+cml_math_vec2_cross_product(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_shuffle_pd(a.v, a.v, 1);
+    v.v = simde_mm_mul_pd(v.v, b.v);
+    v.v = simde_mm_shuffle_pd(v.v, v.v, 1);
+    v.v = simde_mm_sub_pd(a.v, v.v);
+    return simde_mm_cvtsd_f64(v.v);
 }
 
-/* Compute the linear interpolation between two vectors. */
-cml_inline vec4
-cml_math_vec4_lerp(const vec4 a, const vec4 b, const f64 t) {
-    vec4 r;
-    r.v = simde_mm256_add_pd(a.v, 
-          simde_mm256_mul_pd(
-          simde_mm256_sub_pd(b.v, a.v), 
-          simde_mm256_set1_pd(t)));
+/* Compute the angle between two vectors. */
+cml_inline f64
+cml_math_vec2_angle(const vec2 a, const vec2 b) {
+    vec2 v;
+    v.v = simde_mm_mul_pd(a.v, b.v);
+    v.v = simde_mm_hadd_pd(v.v, v.v);
+    v.v = simde_mm_div_pd(v.v, 
+          simde_mm_mul_pd(
+          simde_mm_sqrt_pd(
+          simde_mm_mul_pd(a.v, a.v)), 
+          simde_mm_sqrt_pd(
+          simde_mm_mul_pd(b.v, b.v))));
+    return acos(simde_mm_cvtsd_f64(v.v));
+}
+
+/* Reflect a vector about a normal. */
+cml_inline vec2
+cml_math_vec2_reflect(const vec2 v, const vec2 n) {
+    vec2 r;
+    r.v = simde_mm_mul_pd(n.v, n.v);
+    r.v = simde_mm_hadd_pd(r.v, r.v);
+    r.v = simde_mm_mul_pd(v.v, r.v);
+    r.v = simde_mm_mul_pd(r.v, simde_mm_set1_pd(2.0));
+    r.v = simde_mm_sub_pd(v.v, r.v);
     return r;
 }
 
-/* Compute the reflection of a vector. */
-cml_inline vec4
-cml_math_vec4_reflect(const vec4 v, const vec4 n) {
-    vec4 r;
-    r.v = simde_mm256_sub_pd(v.v, 
-          simde_mm256_mul_pd(
-          simde_mm256_mul_pd(
-          simde_mm256_mul_pd(
-          simde_mm256_mul_pd(v.v, n.v), n.v), 
-          simde_mm256_set1_pd(2.0)), 
-          simde_mm256_set1_pd(1.0)));
+/* Compute the projection of a vector onto another vector. */
+cml_inline vec2
+cml_math_vec2_project(const vec2 v, const vec2 n) {
+    vec2 r;
+    r.v = simde_mm_mul_pd(n.v, n.v);
+    r.v = simde_mm_hadd_pd(r.v, r.v);
+    r.v = simde_mm_mul_pd(v.v, r.v);
+    r.v = simde_mm_mul_pd(r.v, simde_mm_set1_pd(2.0));
+    r.v = simde_mm_sub_pd(v.v, r.v);
     return r;
 }
 
-/* Compute the refraction of a vector. */
-cml_inline vec4
-cml_math_vec4_refract(const vec4 v, const vec4 n, const f64 eta) {
-    vec4 r;
-    f64 k = 1.0 - eta * eta * (1.0 - cml_math_vec4_dot_product(v, n) * 
-                                     cml_math_vec4_dot_product(v, n));
-    if (k < 0.0) {
-        r.v = simde_mm256_set1_pd(0.0);
-    } else {
-        r.v = simde_mm256_add_pd(
-              simde_mm256_mul_pd(
-              simde_mm256_set1_pd(eta), v.v), 
-              simde_mm256_mul_pd(
-              simde_mm256_set1_pd(eta * 
-              cml_math_vec4_dot_product(v, n) - sqrt(k)), n.v));
-    }
+/* Compute the component-wise lerp of two vectors. */
+cml_inline vec2
+cml_math_vec2_lerp(const vec2 a, const vec2 b, const f64 t) {
+    vec2 r;
+    r.v = simde_mm_sub_pd(b.v, a.v);
+    r.v = simde_mm_mul_pd(r.v, simde_mm_set1_pd(t));
+    r.v = simde_mm_add_pd(r.v, a.v);
     return r;
 }
 
-/* Angle between two vectors. */
-cml_inline f64
-cml_math_vec4_angle(const vec4 a, const vec4 b) {
-    vec4 r;
-    r.v = simde_mm256_mul_pd(a.v, b.v);
-    r.v = simde_mm256_hadd_pd(r.v, r.v);
-    r.v = simde_mm256_hadd_pd(r.v, r.v);
-    return acos(r.v[0] / (cml_math_vec4_length(a) * 
-                          cml_math_vec4_length(b)));
+/* Compute the component-wise smoothstep of two vectors. */
+cml_inline vec2
+cml_math_vec2_smoothstep(const vec2 a, const vec2 b, const f64 t) {
+    vec2 r;
+    r.v = simde_mm_sub_pd(b.v, a.v);
+    r.v = simde_mm_mul_pd(r.v, simde_mm_set1_pd(t));
+    r.v = simde_mm_mul_pd(r.v, r.v);
+    r.v = simde_mm_mul_pd(r.v, simde_mm_set1_pd(3.0));
+    r.v = simde_mm_sub_pd(r.v, simde_mm_set1_pd(2.0));
+    r.v = simde_mm_mul_pd(r.v, simde_mm_mul_pd(r.v, r.v));
+    r.v = simde_mm_add_pd(r.v, simde_mm_set1_pd(1.0));
+    r.v = simde_mm_mul_pd(r.v, simde_mm_sub_pd(b.v, a.v));
+    r.v = simde_mm_add_pd(r.v, a.v);
+    return r;
 }
 
-/* Print a vector. */
+/* Compute the component-wise clamp of a vector. */
+cml_inline vec2
+cml_math_vec2_clamp(const vec2 v, const vec2 min, const vec2 max) {
+    vec2 r;
+    r.v = simde_mm_min_pd(v.v, max.v);
+    r.v = simde_mm_max_pd(r.v, min.v);
+    return r;
+}
+
+/* Print a vector to stdout. */
 cml_inline void
-cml_math_vec4_print(const vec4 v) {
-    printf("%f %f %f %f ", v.v[0], v.v[1], v.v[2], v.v[3]);
+cml_math_vec2_print(const vec2 v) {
+    f64 a[2];
+    simde_mm_storeu_pd(a, v.v);
+    printf("%f %f ", a[0], a[1]);
 }
 
 /*============================================================================*/
-/* 4x4 Matrix                                                                 */
+/* 4D Vector                                                                  */
 /*============================================================================*/
 
-typedef struct mat4 {
-    simde__m256d m[4];
-} mat4;
+typedef struct vec4 {
+    simde__m256d v;
+} vec4;
 
-/*------------------*/
-/* Matrix Functions */
-/*------------------*/
-
-/* Create a 4x4 matrix. */
-cml_inline mat4
-cml_math_mat4(const f64 m00, const f64 m01, const f64 m02, const f64 m03,
-              const f64 m10, const f64 m11, const f64 m12, const f64 m13,
-              const f64 m20, const f64 m21, const f64 m22, const f64 m23,
-              const f64 m30, const f64 m31, const f64 m32, const f64 m33) {
-    mat4 r;
-    r.m[0] = simde_mm256_set_pd(m00, m01, m02, m03);
-    r.m[1] = simde_mm256_set_pd(m10, m11, m12, m13);
-    r.m[2] = simde_mm256_set_pd(m20, m21, m22, m23);
-    r.m[3] = simde_mm256_set_pd(m30, m31, m32, m33);
+/* Set vector elements individually. */
+cml_inline vec4
+cml_math_vec4_set(const f64 x, const f64 y, const f64 z, const f64 w) {
+    vec4 r;
+    r.v = simde_mm256_set_pd(w, z, y, x);
     return r;
 }
 
-/* Add two matrices. */
-cml_inline mat4
-cml_math_mat4_add(const mat4 a, const mat4 b) {
-    mat4 r;
-    r.m[0] = simde_mm256_add_pd(a.m[0], b.m[0]);
-    r.m[1] = simde_mm256_add_pd(a.m[1], b.m[1]);
-    r.m[2] = simde_mm256_add_pd(a.m[2], b.m[2]);
-    r.m[3] = simde_mm256_add_pd(a.m[3], b.m[3]);
+/* Set vector elements from an array. */
+cml_inline vec4
+cml_math_vec4_set_array(const f64 *a) {
+    vec4 r;
+    r.v = simde_mm256_loadu_pd(a);
     return r;
 }
 
-/* Subtract two matrices. */
-cml_inline mat4
-cml_math_mat4_sub(const mat4 a, const mat4 b) {
-    mat4 r;
-    r.m[0] = simde_mm256_sub_pd(a.m[0], b.m[0]);
-    r.m[1] = simde_mm256_sub_pd(a.m[1], b.m[1]);
-    r.m[2] = simde_mm256_sub_pd(a.m[2], b.m[2]);
-    r.m[3] = simde_mm256_sub_pd(a.m[3], b.m[3]);
+/* Set vector elements from a scalar. */
+cml_inline vec4
+cml_math_vec4_set_scalar(const f64 s) {
+    vec4 r;
+    r.v = simde_mm256_set1_pd(s);
     return r;
 }
 
-/* Multiply two matrices. */
-cml_inline mat4
-cml_math_mat4_mul(const mat4 a, const mat4 b) {
-    mat4 r;
-    r.m[0] = simde_mm256_set1_pd(0.0);
-    r.m[1] = simde_mm256_set1_pd(0.0);
-    r.m[2] = simde_mm256_set1_pd(0.0);
-    r.m[3] = simde_mm256_set1_pd(0.0);
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < 4; j++) {
-            r.m[i] = simde_mm256_add_pd(r.m[i], 
-                     simde_mm256_mul_pd(
-                     simde_mm256_set1_pd(a.m[i][j]), b.m[j]));
-        }
-    }
+/* Set vector elements from two 2D vectors. */
+cml_inline vec4
+cml_math_vec4_set_vec2(const vec2 v1, const vec2 v2) {
+    vec4 r;
+    r.v = simde_mm256_set_pd(v2.v[1], v2.v[0], v1.v[1], v1.v[0]);
     return r;
 }
 
-/* Multiply a matrix by a scalar. */
-cml_inline mat4
-cml_math_mat4_mul_scalar(const mat4 a, const f64 s) {
-    mat4 r;
-    r.m[0] = simde_mm256_mul_pd(a.m[0], simde_mm256_set1_pd(s));
-    r.m[1] = simde_mm256_mul_pd(a.m[1], simde_mm256_set1_pd(s));
-    r.m[2] = simde_mm256_mul_pd(a.m[2], simde_mm256_set1_pd(s));
-    r.m[3] = simde_mm256_mul_pd(a.m[3], simde_mm256_set1_pd(s));
+/* Set vector elements to zero. */
+cml_inline vec4
+cml_math_vec4_zero(void) {
+    vec4 r;
+    r.v = simde_mm256_setzero_pd();
     return r;
 }
 
-/* Create a 4x4 identity matrix. */
-cml_inline mat4
-cml_math_mat4_identity(void) {
-    mat4 r;
-    r.m[0] = simde_mm256_set_pd(1.0, 0.0, 0.0, 0.0);
-    r.m[1] = simde_mm256_set_pd(0.0, 1.0, 0.0, 0.0);
-    r.m[2] = simde_mm256_set_pd(0.0, 0.0, 1.0, 0.0);
-    r.m[3] = simde_mm256_set_pd(0.0, 0.0, 0.0, 1.0);
+/* Set vector elements to one. */
+cml_inline vec4
+cml_math_vec4_one(void) {
+    vec4 r;
+    r.v = simde_mm256_set1_pd(1.0);
     return r;
 }
 
-/* Create a 4x4 translation matrix. */
-cml_inline mat4
-cml_math_mat4_translation(const f64 x, const f64 y, const f64 z) {
-    mat4 r;
-    r.m[0] = simde_mm256_set_pd(1.0, 0.0, 0.0, 0.0);
-    r.m[1] = simde_mm256_set_pd(0.0, 1.0, 0.0, 0.0);
-    r.m[2] = simde_mm256_set_pd(0.0, 0.0, 1.0, 0.0);
-    r.m[3] = simde_mm256_set_pd(x, y, z, 1.0);
+/* Set vector elements to infinity. */
+cml_inline vec4
+cml_math_vec4_inf(void) {
+    vec4 r;
+    r.v = simde_mm256_set1_pd(HUGE_VAL);
     return r;
 }
 
-/* Create a 4x4 scaling matrix. */
-cml_inline mat4
-cml_math_mat4_scaling(const f64 x, const f64 y, const f64 z) {
-    mat4 r;
-    r.m[0] = simde_mm256_set_pd(x, 0.0, 0.0, 0.0);
-    r.m[1] = simde_mm256_set_pd(0.0, y, 0.0, 0.0);
-    r.m[2] = simde_mm256_set_pd(0.0, 0.0, z, 0.0);
-    r.m[3] = simde_mm256_set_pd(0.0, 0.0, 0.0, 1.0);
+/*----------------------*/
+/* Arithmetic Functions */
+/*----------------------*/
+
+/* Add two vectors. */
+cml_inline vec4
+cml_math_vec4_add(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_add_pd(a.v, b.v);
     return r;
 }
 
-/* Transpose of a 4x4 matrix. */
-cml_inline mat4
-cml_math_mat4_transpose(const mat4 a) {
-    mat4 r;
-    r.m[0][0] = a.m[0][0];
-    r.m[0][1] = a.m[1][0];
-    r.m[0][2] = a.m[2][0];
-    r.m[0][3] = a.m[3][0];
-    r.m[1][0] = a.m[0][1];
-    r.m[1][1] = a.m[1][1];
-    r.m[1][2] = a.m[2][1];
-    r.m[1][3] = a.m[3][1];
-    r.m[2][0] = a.m[0][2];
-    r.m[2][1] = a.m[1][2];
-    r.m[2][2] = a.m[2][2];
-    r.m[2][3] = a.m[3][2];
-    r.m[3][0] = a.m[0][3];
-    r.m[3][1] = a.m[1][3];
-    r.m[3][2] = a.m[2][3];
-    r.m[3][3] = a.m[3][3];
-    return r;
-}
-
-/* Create a 4x4 rotation matrix. */
-cml_inline mat4
-cml_math_mat4_rotation(const f64 x, const f64 y, const f64 z, const f64 angle) {
-    mat4 r;
-    f64 c = cos(angle);
-    f64 s = sin(angle);
-    f64 t = 1.0 - c;
-    r.m[0] = simde_mm256_set_pd(c + x * x * t, 
-                                    x * y * t - z * s, 
-                                    x * z * t + y * s, 0.0);
-    r.m[1] = simde_mm256_set_pd(x * y * t + z * s, 
-                                c + y * y * t, 
-                                y * z * t - x * s, 0.0);
-    r.m[2] = simde_mm256_set_pd(x * z * t - y * s, 
-                                y * z * t + x * s, 
-                                c + z * z * t, 0.0);
-    r.m[3] = simde_mm256_set_pd(0.0, 0.0, 0.0, 1.0);
+/* Add a vector and a scalar. */
+cml_inline vec4
+cml_math_vec4_add_scalar(const vec4 v, const f64 s) {
+    vec4 r;
+    r.v = simde_mm256_add_pd(v.v, simde_mm256_set1_pd(s));
     return r;
 }
 
-/* Determinant of matrix. */
-cml_inline f64
-cml_math_mat4_determinant(const mat4 mat) {
-    f64 t[6];
-    f64 a = mat.m[0][0], b = mat.m[0][1], c = mat.m[0][2], d = mat.m[0][3],
-      e = mat.m[1][0], f = mat.m[1][1], g = mat.m[1][2], h = mat.m[1][3],
-      i = mat.m[2][0], j = mat.m[2][1], k = mat.m[2][2], l = mat.m[2][3],
-      m = mat.m[3][0], n = mat.m[3][1], o = mat.m[3][2], p = mat.m[3][3];
-    t[0] = k * p - o * l; 
-    t[1] = j * p - n * l; 
-    t[2] = j * o - n * k;
-    t[3] = i * p - m * l; 
-    t[4] = i * o - m * k; 
-    t[5] = i * n - m * j;
-    return a * (f * t[0] - g * t[1] + h * t[2]) -
-           b * (e * t[0] - g * t[3] + h * t[4]) +
-           c * (e * t[1] - f * t[3] + h * t[5]) -
-           d * (e * t[2] - f * t[4] + g * t[5]);
+/* Subtract two vectors. */
+cml_inline vec4
+cml_math_vec4_sub(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_sub_pd(a.v, b.v);
+    return r;
 }
 
-/* Matrix multiplication by scalar. */
-cml_inline mat4
-mat4_mul_scalar(const mat4 a, const f64 scalar) {
-    mat4 result;
-    result.m[0][0] = a.m[0][0] * scalar; result.m[0][1] = a.m[0][1] * scalar;
-    result.m[0][2] = a.m[0][2] * scalar; result.m[0][3] = a.m[0][3] * scalar;
-    result.m[1][0] = a.m[1][0] * scalar; result.m[1][1] = a.m[1][1] * scalar;
-    result.m[1][2] = a.m[1][2] * scalar; result.m[1][3] = a.m[1][3] * scalar;
-    result.m[2][0] = a.m[2][0] * scalar; result.m[2][1] = a.m[2][1] * scalar;
-    result.m[2][2] = a.m[2][2] * scalar; result.m[2][3] = a.m[2][3] * scalar;
-    result.m[3][0] = a.m[3][0] * scalar; result.m[3][1] = a.m[3][1] * scalar;
-    result.m[3][2] = a.m[3][2] * scalar; result.m[3][3] = a.m[3][3] * scalar;
-    return result;
-}   
-
-/* Inverse of matrix. */
-cml_inline mat4
-cml_math_mat4_inverse(const mat4 mat) {
-    mat4 dest;
-    f64 t[6];
-    f64 det;
-    f64 a = mat.m[0][0], b = mat.m[0][1], c = mat.m[0][2], d = mat.m[0][3],
-        e = mat.m[1][0], f = mat.m[1][1], g = mat.m[1][2], h = mat.m[1][3],
-        i = mat.m[2][0], j = mat.m[2][1], k = mat.m[2][2], l = mat.m[2][3],
-        m = mat.m[3][0], n = mat.m[3][1], o = mat.m[3][2], p = mat.m[3][3];
-    t[0] = k * p - o * l; 
-    t[1] = j * p - n * l; 
-    t[2] = j * o - n * k;
-    t[3] = i * p - m * l; 
-    t[4] = i * o - m * k; 
-    t[5] = i * n - m * j;
-    dest.m[0][0] =  f * t[0] - g * t[1] + h * t[2];
-    dest.m[1][0] =-(e * t[0] - g * t[3] + h * t[4]);
-    dest.m[2][0] =  e * t[1] - f * t[3] + h * t[5];
-    dest.m[3][0] =-(e * t[2] - f * t[4] + g * t[5]);
-    dest.m[0][1] =-(b * t[0] - c * t[1] + d * t[2]);
-    dest.m[1][1] =  a * t[0] - c * t[3] + d * t[4];
-    dest.m[2][1] =-(a * t[1] - b * t[3] + d * t[5]);
-    dest.m[3][1] =  a * t[2] - b * t[4] + c * t[5];
-    t[0] = g * p - o * h; 
-    t[1] = f * p - n * h; 
-    t[2] = f * o - n * g;
-    t[3] = e * p - m * h; 
-    t[4] = e * o - m * g; 
-    t[5] = e * n - m * f;
-    dest.m[0][2] =  b * t[0] - c * t[1] + d * t[2];
-    dest.m[1][2] =-(a * t[0] - c * t[3] + d * t[4]);
-    dest.m[2][2] =  a * t[1] - b * t[3] + d * t[5];
-    dest.m[3][2] =-(a * t[2] - b * t[4] + c * t[5]);
-    t[0] = g * l - k * h; 
-    t[1] = f * l - j * h; 
-    t[2] = f * k - j * g;
-    t[3] = e * l - i * h; 
-    t[4] = e * k - i * g; 
-    t[5] = e * j - i * f;
-    dest.m[0][3] =-(b * t[0] - c * t[1] + d * t[2]);
-    dest.m[1][3] =  a * t[0] - c * t[3] + d * t[4];
-    dest.m[2][3] =-(a * t[1] - b * t[3] + d * t[5]);
-    dest.m[3][3] =  a * t[2] - b * t[4] + c * t[5];
-    det = 1.0 / (a * dest.m[0][0] + b * dest.m[1][0]
-               + c * dest.m[2][0] + d * dest.m[3][0]);
-    mat4_mul_scalar(dest, det);
-    return dest;
+/* Subtract a scalar from a vector. */
+cml_inline vec4
+cml_math_vec4_sub_scalar(const vec4 v, const f64 s) {
+    vec4 r;
+    r.v = simde_mm256_sub_pd(v.v, simde_mm256_set1_pd(s));
+    return r;
 }
 
-/* Perspective projection matrix. */
-cml_inline mat4
-cml_math_mat4_perspective(const f64 fov,  const f64 aspect, 
-                          const f64 near, const f64 far) {
-    mat4 r;
-    f64 f = 1.0 / tan(fov * 0.5);
-    r.m[0][0] = f / aspect;
-    r.m[0][1] = 0.0;
-    r.m[0][2] = 0.0;
-    r.m[0][3] = 0.0;
-    r.m[1][0] = 0.0;
-    r.m[1][1] = f;
-    r.m[1][2] = 0.0;
-    r.m[1][3] = 0.0;
-    r.m[2][0] = 0.0;
-    r.m[2][1] = 0.0;
-    r.m[2][2] = (far + near) / (near - far);
-    r.m[2][3] = -1.0;
-    r.m[3][0] = 0.0;
-    r.m[3][1] = 0.0;
-    r.m[3][2] = (2.0 * far * near) / (near - far);
-    r.m[3][3] = 0.0;
+/* Negate a vector. */
+cml_inline vec4
+cml_math_vec4_neg(const vec4 v) {
+    vec4 r;
+    r.v = simde_mm256_sub_pd(simde_mm256_setzero_pd(), v.v);
     return r;
 }
 
-/* Orthographic projection matrix. */
-cml_inline mat4
-cml_math_mat4_ortho(const f64 left,   const f64 right, 
-                    const f64 bottom, const f64 top, 
-                    const f64 near,   const f64 far) {
-    mat4 r;
-    r.m[0][0] = 2.0 / (right - left);
-    r.m[0][1] = 0.0;
-    r.m[0][2] = 0.0;
-    r.m[0][3] = 0.0;
-    r.m[1][0] = 0.0;
-    r.m[1][1] = 2.0 / (top - bottom);
-    r.m[1][2] = 0.0;
-    r.m[1][3] = 0.0;
-    r.m[2][0] = 0.0;
-    r.m[2][1] = 0.0;
-    r.m[2][2] = -2.0 / (far - near);
-    r.m[2][3] = 0.0;
-    r.m[3][0] = -(right + left) / (right - left);
-    r.m[3][1] = -(top + bottom) / (top - bottom);
-    r.m[3][2] = -(far + near) / (far - near);
-    r.m[3][3] = 1.0;
+/* Multiply two vectors. */
+cml_inline vec4
+cml_math_vec4_mul(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_mul_pd(a.v, b.v);
     return r;
 }
 
-/* Look at matrix. */
-cml_inline mat4
+/* Multiply a vector and a scalar. */
+cml_inline vec4
+cml_math_vec4_mul_scalar(const vec4 v, const f64 s) {
+    vec4 r;
+    r.v = simde_mm256_mul_pd(v.v, simde_mm256_set1_pd(s));
+    return r;
+}
+
+/* Divide two vectors. */
+cml_inline vec4
+cml_math_vec4_div(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_div_pd(a.v, b.v);
+    return r;
+}
+
+/* Divide a vector by a scalar. */
+cml_inline vec4
+cml_math_vec4_div_scalar(const vec4 v, const f64 s) {
+    vec4 r;
+    r.v = simde_mm256_div_pd(v.v, simde_mm256_set1_pd(s));
+    return r;
+}
+
+/* Compute the reciprocal of a vector. */
+cml_inline vec4
+cml_math_vec4_rcp(const vec4 v) {
+    vec4 r;
+    r.v = simde_mm256_div_pd(simde_mm256_set1_pd(1.0), v.v);
+    return r;
+}
+
+/* Compute the square root of a vector. */
+cml_inline vec4
+cml_math_vec4_sqrt(const vec4 v) {
+    vec4 r;
+    r.v = simde_mm256_sqrt_pd(v.v);
+    return r;
+}
+
+/* Compute the reciprocal square root of a vector. */
+cml_inline vec4
+cml_math_vec4_rsqrt(const vec4 v) {
+    vec4 r;
+    r.v = simde_mm256_div_pd(
+          simde_mm256_set1_pd(1.0), 
+          simde_mm256_sqrt_pd(v.v));
+    return r;
+}
+
+/* Compute the absolute value of a vector. */
+cml_inline vec4
+cml_math_vec4_abs(const vec4 v) {
+    vec4 r;
+    r.v = simde_mm256_andnot_pd(
+          simde_mm256_set1_pd(-0.0), 
+          v.v);
+    return r;
+}
+
+/* Compute the minimum of two vectors. */
+cml_inline vec4
+cml_math_vec4_min(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_min_pd(a.v, b.v);
+    return r;
+}
+
+/* Compute the maximum of two vectors. */
+cml_inline vec4
+cml_math_vec4_max(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_max_pd(a.v, b.v);
+    return r;
+}
+
+/*----------------------*/
+/* Comparison Functions */
+/*----------------------*/
+
+/* Compare two vectors for equality. */
+cml_inline vec4
+cml_math_vec4_is_equal(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_cmp_pd(a.v, b.v, SIMDE_CMP_EQ_OQ);
+    return r;
+}
+
+/* Compare two vectors for inequality. */
+cml_inline vec4
+cml_math_vec4_is_not_equal(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_cmp_pd(a.v, b.v, SIMDE_CMP_NEQ_UQ);
+    return r;
+}
+
+/* Compare two vectors for less than. */
+cml_inline vec4
+cml_math_vec4_is_less(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_cmp_pd(a.v, b.v, SIMDE_CMP_LT_OQ);
+    return r;
+}
+
+/* Compare two vectors for greater than. */
+cml_inline vec4
+cml_math_vec4_is_greater(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_cmp_pd(a.v, b.v, SIMDE_CMP_GT_OQ);
+    return r;
+}
+
+/*---------------------------*/
+/* Common Graphics Functions */
+/*---------------------------*/
+
+/* Compute the dot product of two vectors. */
+cml_inline f64
+cml_math_vec4_dot_product(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_mul_pd(a.v, b.v);
+    r.v = simde_mm256_hadd_pd(r.v, r.v);
+    r.v = simde_mm256_hadd_pd(r.v, r.v);
+    return r.v[0];
+}
+
+/* Returns the cross product of the xyz parts of two vectors, with w = 0. */
+cml_inline vec4 
+cml_math_vec4_cross_product(const vec4 a, const vec4 b) {
+    vec4 result, permute_b, permute_a, sub_result;
+    permute_b.v  = simde_mm256_permute4x64_pd(b.v, 
+                   SIMDE_MM_SHUFFLE(3, 0, 2, 1));
+    permute_a.v  = simde_mm256_permute4x64_pd(a.v, 
+                   SIMDE_MM_SHUFFLE(3, 0, 2, 1));
+    sub_result.v = simde_mm256_sub_pd(
+                   simde_mm256_mul_pd(a.v, permute_b.v), 
+                   simde_mm256_mul_pd(b.v, permute_a.v));
+    result.v     = simde_mm256_permute4x64_pd(sub_result.v, 
+                   SIMDE_MM_SHUFFLE(3, 0, 2, 1));
+    /* Lane 3 is a.w * b.w - b.w * a.w, which is only zero when the compiler
+     * does not contract it into an FMA. */
+    result.v     = simde_mm256_blend_pd(result.v, simde_mm256_setzero_pd(),
+                                        0x8);
+    return result;
+}
+
+/* Compute the length of a vector. */
+cml_inline f64
+cml_math_vec4_length(const vec4 v) {
+    vec4 r;
+    r.v = simde_mm256_mul_pd(v.v, v.v);
+    r.v = simde_mm256_hadd_pd(r.v, r.v);
+    r.v = simde_mm256_hadd_pd(r.v, r.v);
+    return sqrt(r.v[0]);
+}
+
+/* Compute the squared length of a vector. */
+cml_inline f64
+cml_math_vec4_length_squared(const vec4 v) {
+    vec4 r;
+    r.v = simde_mm256_mul_pd(v.v, v.v);
+    r.v = simde_mm256_hadd_pd(r.v, r.v);
+    r.v = simde_mm256_hadd_pd(r.v, r.v);
+    return r.v[0];
+}
+
+/* Normalize a vector. */
+cml_inline vec4
+cml_math_vec4_normalize(const vec4 v) {
+    vec4 r;
+    r.v = simde_mm256_div_pd(v.v, 
+          simde_mm256_sqrt_pd(
+          simde_mm256_mul_pd(v.v, v.v)));
+    return r;
+}
+
+/* Compute the distance between two vectors. */
+cml_inline f64
+cml_math_vec4_distance(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_sub_pd(a.v, b.v);
+    r.v = simde_mm256_mul_pd(r.v, r.v);
+    r.v = simde_mm256_hadd_pd(r.v, r.v);
+    r.v = simde_mm256_hadd_pd(r.v, r.v);
+    return sqrt(r.v[0]);
+}
+
+/* Compute the squared distance between two vectors. */
+cml_inline f64
+cml_math_vec4_distance_squared(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_sub_pd(a.v, b.v);
+    r.v = simde_mm256_mul_pd(r.v, r.v);
+    r.v = simde_mm256_hadd_pd(r.v, r.v);
+    r.v = simde_mm256_hadd_pd(r.v, r.v);
+    return r.v[0];
+}
+
+/* Compute the linear interpolation between two vectors. */
+cml_inline vec4
+cml_math_vec4_lerp(const vec4 a, const vec4 b, const f64 t) {
+    vec4 r;
+    r.v = simde_mm256_add_pd(a.v, 
+          simde_mm256_mul_pd(
+          simde_mm256_sub_pd(b.v, a.v), 
+          simde_mm256_set1_pd(t)));
+    return r;
+}
+
+/* Compute the reflection of a vector. */
+cml_inline vec4
+cml_math_vec4_reflect(const vec4 v, const vec4 n) {
+    vec4 r;
+    r.v = simde_mm256_sub_pd(v.v, 
+          simde_mm256_mul_pd(
+          simde_mm256_mul_pd(
+          simde_mm256_mul_pd(
+          simde_mm256_mul_pd(v.v, n.v), n.v), 
+          simde_mm256_set1_pd(2.0)), 
+          simde_mm256_set1_pd(1.0)));
+    return r;
+}
+
+/* Compute the refraction of a vector. */
+cml_inline vec4
+cml_math_vec4_refract(const vec4 v, const vec4 n, const f64 eta) {
+    vec4 r;
+    f64 k = 1.0 - eta * eta * (1.0 - cml_math_vec4_dot_product(v, n) * 
+                                     cml_math_vec4_dot_product(v, n));
+    if (k < 0.0) {
+        r.v = simde_mm256_set1_pd(0.0);
+    } else {
+        r.v = simde_mm256_add_pd(
+              simde_mm256_mul_pd(
+              simde_mm256_set1_pd(eta), v.v), 
+              simde_mm256_mul_pd(
+              simde_mm256_set1_pd(eta * 
+              cml_math_vec4_dot_product(v, n) - sqrt(k)), n.v));
+    }
+    return r;
+}
+
+/* Angle between two vectors. */
+cml_inline f64
+cml_math_vec4_angle(const vec4 a, const vec4 b) {
+    vec4 r;
+    r.v = simde_mm256_mul_pd(a.v, b.v);
+    r.v = simde_mm256_hadd_pd(r.v, r.v);
+    r.v = simde_mm256_hadd_pd(r.v, r.v);
+    return acos(r.v[0] / (cml_math_vec4_length(a) * 
+                          cml_math_vec4_length(b)));
+}
+
+/* Print a vector. */
+cml_inline void
+cml_math_vec4_print(const vec4 v) {
+    printf("%f %f %f %f ", v.v[0], v.v[1], v.v[2], v.v[3]);
+}
+
+/*============================================================================*/
+/* 4x4 Matrix                                                                 */
+/*============================================================================*/
+
+/* Four f64x4 rows, with m[i][j] the element in row i and column j. The rows
+ * are contiguous, so a mat4 is 16 packed f64 in row-major order. Points are
+ * row vectors (v * M, translation in row 3); read as column-major, the same
+ * bytes are the column-vector form M^T used by GLSL and HLSL, so row-major
+ * exports upload to either without a transpose. */
+typedef struct mat4 {
+    simde__m256d m[4];
+} mat4;
+
+_Static_assert(sizeof(mat4) == 16 * sizeof(f64), "mat4 must be 16 packed f64");
+
+/* Element order of packed matrix buffers. */
+typedef enum cml_matrix_order {
+    CML_ROW_MAJOR,
+    CML_COLUMN_MAJOR
+} cml_matrix_order;
+
+/*------------------*/
+/* Matrix Functions */
+/*------------------*/
+
+/* Create a 4x4 matrix from its elements, mij being row i and column j. */
+cml_inline mat4
+cml_math_mat4(const f64 m00, const f64 m01, const f64 m02, const f64 m03,
+              const f64 m10, const f64 m11, const f64 m12, const f64 m13,
+              const f64 m20, const f64 m21, const f64 m22, const f64 m23,
+              const f64 m30, const f64 m31, const f64 m32, const f64 m33) {
+    mat4 r;
+    r.m[0] = simde_mm256_setr_pd(m00, m01, m02, m03);
+    r.m[1] = simde_mm256_setr_pd(m10, m11, m12, m13);
+    r.m[2] = simde_mm256_setr_pd(m20, m21, m22, m23);
+    r.m[3] = simde_mm256_setr_pd(m30, m31, m32, m33);
+    return r;
+}
+
+/* Add two matrices. */
+cml_inline mat4
+cml_math_mat4_add(const mat4 a, const mat4 b) {
+    mat4 r;
+    r.m[0] = simde_mm256_add_pd(a.m[0], b.m[0]);
+    r.m[1] = simde_mm256_add_pd(a.m[1], b.m[1]);
+    r.m[2] = simde_mm256_add_pd(a.m[2], b.m[2]);
+    r.m[3] = simde_mm256_add_pd(a.m[3], b.m[3]);
+    return r;
+}
+
+/* Subtract two matrices. */
+cml_inline mat4
+cml_math_mat4_sub(const mat4 a, const mat4 b) {
+    mat4 r;
+    r.m[0] = simde_mm256_sub_pd(a.m[0], b.m[0]);
+    r.m[1] = simde_mm256_sub_pd(a.m[1], b.m[1]);
+    r.m[2] = simde_mm256_sub_pd(a.m[2], b.m[2]);
+    r.m[3] = simde_mm256_sub_pd(a.m[3], b.m[3]);
+    return r;
+}
+
+/* Multiply two matrices. Each row of a is broadcast lane by lane with
+ * permutes and accumulated with fused multiply-adds, so nothing leaves the
+ * registers. With native AVX-512 two rows share one zmm register, halving
+ * the multiply-add count. */
+cml_inline mat4
+cml_math_mat4_mul(const mat4 a, const mat4 b) {
+    mat4 r;
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+    const simde__m512d b0 = simde_mm512_broadcast_f64x4(b.m[0]);
+    const simde__m512d b1 = simde_mm512_broadcast_f64x4(b.m[1]);
+    const simde__m512d b2 = simde_mm512_broadcast_f64x4(b.m[2]);
+    const simde__m512d b3 = simde_mm512_broadcast_f64x4(b.m[3]);
+    const simde__m512i i0 = simde_mm512_set_epi64(4, 4, 4, 4, 0, 0, 0, 0);
+    const simde__m512i i1 = simde_mm512_set_epi64(5, 5, 5, 5, 1, 1, 1, 1);
+    const simde__m512i i2 = simde_mm512_set_epi64(6, 6, 6, 6, 2, 2, 2, 2);
+    const simde__m512i i3 = simde_mm512_set_epi64(7, 7, 7, 7, 3, 3, 3, 3);
+    for (int i = 0; i < 4; i += 2) {
+        const simde__m512d ai = simde_mm512_insertf64x4(
+                                simde_mm512_castpd256_pd512(a.m[i]),
+                                a.m[i + 1], 1);
+        simde__m512d ri;
+        ri = simde_mm512_mul_pd(simde_mm512_permutexvar_pd(i0, ai), b0);
+        ri = simde_mm512_fmadd_pd(simde_mm512_permutexvar_pd(i1, ai), b1, ri);
+        ri = simde_mm512_fmadd_pd(simde_mm512_permutexvar_pd(i2, ai), b2, ri);
+        ri = simde_mm512_fmadd_pd(simde_mm512_permutexvar_pd(i3, ai), b3, ri);
+        r.m[i]     = simde_mm512_castpd512_pd256(ri);
+        r.m[i + 1] = simde_mm512_extractf64x4_pd(ri, 1);
+    }
+#else
+    for (int i = 0; i < 4; i++) {
+        r.m[i] = simde_mm256_mul_pd(
+                 simde_mm256_permute4x64_pd(a.m[i], 0x00), b.m[0]);
+        r.m[i] = simde_mm256_fmadd_pd(
+                 simde_mm256_permute4x64_pd(a.m[i], 0x55), b.m[1], r.m[i]);
+        r.m[i] = simde_mm256_fmadd_pd(
+                 simde_mm256_permute4x64_pd(a.m[i], 0xAA), b.m[2], r.m[i]);
+        r.m[i] = simde_mm256_fmadd_pd(
+                 simde_mm256_permute4x64_pd(a.m[i], 0xFF), b.m[3], r.m[i]);
+    }
+#endif
+    return r;
+}
+
+/* Multiply a matrix by a scalar. */
+cml_inline mat4
+cml_math_mat4_mul_scalar(const mat4 a, const f64 s) {
+    mat4 r;
+    r.m[0] = simde_mm256_mul_pd(a.m[0], simde_mm256_set1_pd(s));
+    r.m[1] = simde_mm256_mul_pd(a.m[1], simde_mm256_set1_pd(s));
+    r.m[2] = simde_mm256_mul_pd(a.m[2], simde_mm256_set1_pd(s));
+    r.m[3] = simde_mm256_mul_pd(a.m[3], simde_mm256_set1_pd(s));
+    return r;
+}
+
+/* Create a 4x4 identity matrix. */
+cml_inline mat4
+cml_math_mat4_identity(void) {
+    mat4 r;
+    r.m[0] = simde_mm256_setr_pd(1.0, 0.0, 0.0, 0.0);
+    r.m[1] = simde_mm256_setr_pd(0.0, 1.0, 0.0, 0.0);
+    r.m[2] = simde_mm256_setr_pd(0.0, 0.0, 1.0, 0.0);
+    r.m[3] = simde_mm256_setr_pd(0.0, 0.0, 0.0, 1.0);
+    return r;
+}
+
+/* Create a 4x4 translation matrix. */
+cml_inline mat4
+cml_math_mat4_translation(const f64 x, const f64 y, const f64 z) {
+    mat4 r;
+    r.m[0] = simde_mm256_setr_pd(1.0, 0.0, 0.0, 0.0);
+    r.m[1] = simde_mm256_setr_pd(0.0, 1.0, 0.0, 0.0);
+    r.m[2] = simde_mm256_setr_pd(0.0, 0.0, 1.0, 0.0);
+    r.m[3] = simde_mm256_setr_pd(x, y, z, 1.0);
+    return r;
+}
+
+/* Create a 4x4 scaling matrix. */
+cml_inline mat4
+cml_math_mat4_scaling(const f64 x, const f64 y, const f64 z) {
+    mat4 r;
+    r.m[0] = simde_mm256_setr_pd(x, 0.0, 0.0, 0.0);
+    r.m[1] = simde_mm256_setr_pd(0.0, y, 0.0, 0.0);
+    r.m[2] = simde_mm256_setr_pd(0.0, 0.0, z, 0.0);
+    r.m[3] = simde_mm256_setr_pd(0.0, 0.0, 0.0, 1.0);
+    return r;
+}
+
+/* Transpose of a 4x4 matrix. */
+cml_inline mat4
+cml_math_mat4_transpose(const mat4 a) {
+    mat4 r = a;
+    cml_math_f64x4_transpose(r.m);
+    return r;
+}
+
+/* Create a 4x4 rotation matrix turning row vectors counterclockwise by
+ * angle about the unit axis (x, y, z), the same rotation as
+ * cml_math_quat_from_axis_angle. Row i holds the image of axis i. */
+cml_inline mat4
+cml_math_mat4_rotation(const f64 x, const f64 y, const f64 z, const f64 angle) {
+    mat4 r;
+    f64 s, c;
+    cml_math_sincos(angle, &s, &c);
+    f64 t = 1.0 - c;
+    r.m[0] = simde_mm256_setr_pd(c + x * x * t,
+                                     x * y * t + z * s,
+                                     x * z * t - y * s, 0.0);
+    r.m[1] = simde_mm256_setr_pd(x * y * t - z * s,
+                                 c + y * y * t,
+                                 y * z * t + x * s, 0.0);
+    r.m[2] = simde_mm256_setr_pd(x * z * t + y * s,
+                                 y * z * t - x * s,
+                                 c + z * z * t, 0.0);
+    r.m[3] = simde_mm256_setr_pd(0.0, 0.0, 0.0, 1.0);
+    return r;
+}
+
+/* Create n rotation matrices from the xyz parts of axis[i] and angle[i],
+ * four at a time with one vector sincos. Each turns row vectors
+ * counterclockwise by angle[i], the same rotation as
+ * cml_math_quat_from_axis_angle. */
+static inline void
+cml_math_mat4_rotation_array(const vec4* axis, const f64* angle, mat4* out,
+                             size_t n) {
+    const f64x4 one  = simde_mm256_set1_pd(1.0);
+    const f64x4 zero = simde_mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        f64x4 a[4], s, c;
+        a[0] = axis[i + 0].v;
+        a[1] = axis[i + 1].v;
+        a[2] = axis[i + 2].v;
+        a[3] = axis[i + 3].v;
+        cml_math_f64x4_transpose(a);
+        cml_math_sincos(simde_mm256_loadu_pd(angle + i), &s, &c);
+        const f64x4 t  = simde_mm256_sub_pd(one, c);
+        const f64x4 xs = simde_mm256_mul_pd(a[0], s);
+        const f64x4 ys = simde_mm256_mul_pd(a[1], s);
+        const f64x4 zs = simde_mm256_mul_pd(a[2], s);
+        const f64x4 xt = simde_mm256_mul_pd(a[0], t);
+        const f64x4 yt = simde_mm256_mul_pd(a[1], t);
+        const f64x4 xy = simde_mm256_mul_pd(xt, a[1]);
+        const f64x4 xz = simde_mm256_mul_pd(xt, a[2]);
+        const f64x4 yz = simde_mm256_mul_pd(yt, a[2]);
+        /* Element planes of one row for the four matrices, transposed
+         * into that row of each. */
+        f64x4 r[3][4];
+        r[0][0] = simde_mm256_fmadd_pd(xt, a[0], c);
+        r[0][1] = simde_mm256_add_pd(xy, zs);
+        r[0][2] = simde_mm256_sub_pd(xz, ys);
+        r[1][0] = simde_mm256_sub_pd(xy, zs);
+        r[1][1] = simde_mm256_fmadd_pd(yt, a[1], c);
+        r[1][2] = simde_mm256_add_pd(yz, xs);
+        r[2][0] = simde_mm256_add_pd(xz, ys);
+        r[2][1] = simde_mm256_sub_pd(yz, xs);
+        r[2][2] = simde_mm256_fmadd_pd(simde_mm256_mul_pd(t, a[2]), a[2], c);
+        for (i32 k = 0; k < 3; k++) {
+            r[k][3] = zero;
+            cml_math_f64x4_transpose(r[k]);
+            for (i32 j = 0; j < 4; j++) {
+                out[i + j].m[k] = r[k][j];
+            }
+        }
+        for (i32 j = 0; j < 4; j++) {
+            out[i + j].m[3] = simde_mm256_setr_pd(0.0, 0.0, 0.0, 1.0);
+        }
+    }
+    for (; i < n; i++) {
+        out[i] = cml_math_mat4_rotation(axis[i].v[0], axis[i].v[1],
+                                        axis[i].v[2], angle[i]);
+    }
+}
+
+/* Determinant of matrix. */
+cml_inline f64
+cml_math_mat4_determinant(const mat4 mat) {
+    f64 t[6];
+    f64 a = mat.m[0][0], b = mat.m[0][1], c = mat.m[0][2], d = mat.m[0][3],
+      e = mat.m[1][0], f = mat.m[1][1], g = mat.m[1][2], h = mat.m[1][3],
+      i = mat.m[2][0], j = mat.m[2][1], k = mat.m[2][2], l = mat.m[2][3],
+      m = mat.m[3][0], n = mat.m[3][1], o = mat.m[3][2], p = mat.m[3][3];
+    t[0] = k * p - o * l; 
+    t[1] = j * p - n * l; 
+    t[2] = j * o - n * k;
+    t[3] = i * p - m * l; 
+    t[4] = i * o - m * k; 
+    t[5] = i * n - m * j;
+    return a * (f * t[0] - g * t[1] + h * t[2]) -
+           b * (e * t[0] - g * t[3] + h * t[4]) +
+           c * (e * t[1] - f * t[3] + h * t[5]) -
+           d * (e * t[2] - f * t[4] + g * t[5]);
+}
+
+/* Matrix multiplication by scalar. */
+cml_inline mat4
+mat4_mul_scalar(const mat4 a, const f64 scalar) {
+    mat4 result;
+    result.m[0][0] = a.m[0][0] * scalar; result.m[0][1] = a.m[0][1] * scalar;
+    result.m[0][2] = a.m[0][2] * scalar; result.m[0][3] = a.m[0][3] * scalar;
+    result.m[1][0] = a.m[1][0] * scalar; result.m[1][1] = a.m[1][1] * scalar;
+    result.m[1][2] = a.m[1][2] * scalar; result.m[1][3] = a.m[1][3] * scalar;
+    result.m[2][0] = a.m[2][0] * scalar; result.m[2][1] = a.m[2][1] * scalar;
+    result.m[2][2] = a.m[2][2] * scalar; result.m[2][3] = a.m[2][3] * scalar;
+    result.m[3][0] = a.m[3][0] * scalar; result.m[3][1] = a.m[3][1] * scalar;
+    result.m[3][2] = a.m[3][2] * scalar; result.m[3][3] = a.m[3][3] * scalar;
+    return result;
+}   
+
+/* Inverse of matrix. */
+cml_inline mat4
+cml_math_mat4_inverse(const mat4 mat) {
+    mat4 dest;
+    f64 t[6];
+    f64 det;
+    f64 a = mat.m[0][0], b = mat.m[0][1], c = mat.m[0][2], d = mat.m[0][3],
+        e = mat.m[1][0], f = mat.m[1][1], g = mat.m[1][2], h = mat.m[1][3],
+        i = mat.m[2][0], j = mat.m[2][1], k = mat.m[2][2], l = mat.m[2][3],
+        m = mat.m[3][0], n = mat.m[3][1], o = mat.m[3][2], p = mat.m[3][3];
+    t[0] = k * p - o * l; 
+    t[1] = j * p - n * l; 
+    t[2] = j * o - n * k;
+    t[3] = i * p - m * l; 
+    t[4] = i * o - m * k; 
+    t[5] = i * n - m * j;
+    dest.m[0][0] =  f * t[0] - g * t[1] + h * t[2];
+    dest.m[1][0] =-(e * t[0] - g * t[3] + h * t[4]);
+    dest.m[2][0] =  e * t[1] - f * t[3] + h * t[5];
+    dest.m[3][0] =-(e * t[2] - f * t[4] + g * t[5]);
+    dest.m[0][1] =-(b * t[0] - c * t[1] + d * t[2]);
+    dest.m[1][1] =  a * t[0] - c * t[3] + d * t[4];
+    dest.m[2][1] =-(a * t[1] - b * t[3] + d * t[5]);
+    dest.m[3][1] =  a * t[2] - b * t[4] + c * t[5];
+    t[0] = g * p - o * h; 
+    t[1] = f * p - n * h; 
+    t[2] = f * o - n * g;
+    t[3] = e * p - m * h; 
+    t[4] = e * o - m * g; 
+    t[5] = e * n - m * f;
+    dest.m[0][2] =  b * t[0] - c * t[1] + d * t[2];
+    dest.m[1][2] =-(a * t[0] - c * t[3] + d * t[4]);
+    dest.m[2][2] =  a * t[1] - b * t[3] + d * t[5];
+    dest.m[3][2] =-(a * t[2] - b * t[4] + c * t[5]);
+    t[0] = g * l - k * h; 
+    t[1] = f * l - j * h; 
+    t[2] = f * k - j * g;
+    t[3] = e * l - i * h; 
+    t[4] = e * k - i * g; 
+    t[5] = e * j - i * f;
+    dest.m[0][3] =-(b * t[0] - c * t[1] + d * t[2]);
+    dest.m[1][3] =  a * t[0] - c * t[3] + d * t[4];
+    dest.m[2][3] =-(a * t[1] - b * t[3] + d * t[5]);
+    dest.m[3][3] =  a * t[2] - b * t[4] + c * t[5];
+    det = 1.0 / (a * dest.m[0][0] + b * dest.m[1][0]
+               + c * dest.m[2][0] + d * dest.m[3][0]);
+    dest = mat4_mul_scalar(dest, det);
+    return dest;
+}
+
+/* Perspective projection matrix. */
+cml_inline mat4
+cml_math_mat4_perspective(const f64 fov,  const f64 aspect, 
+                          const f64 near, const f64 far) {
+    mat4 r;
+    f64 f = 1.0 / tan(fov * 0.5);
+    r.m[0][0] = f / aspect;
+    r.m[0][1] = 0.0;
+    r.m[0][2] = 0.0;
+    r.m[0][3] = 0.0;
+    r.m[1][0] = 0.0;
+    r.m[1][1] = f;
+    r.m[1][2] = 0.0;
+    r.m[1][3] = 0.0;
+    r.m[2][0] = 0.0;
+    r.m[2][1] = 0.0;
+    r.m[2][2] = (far + near) / (near - far);
+    r.m[2][3] = -1.0;
+    r.m[3][0] = 0.0;
+    r.m[3][1] = 0.0;
+    r.m[3][2] = (2.0 * far * near) / (near - far);
+    r.m[3][3] = 0.0;
+    return r;
+}
+
+/* Orthographic projection matrix. */
+cml_inline mat4
+cml_math_mat4_ortho(const f64 left,   const f64 right, 
+                    const f64 bottom, const f64 top, 
+                    const f64 near,   const f64 far) {
+    mat4 r;
+    r.m[0][0] = 2.0 / (right - left);
+    r.m[0][1] = 0.0;
+    r.m[0][2] = 0.0;
+    r.m[0][3] = 0.0;
+    r.m[1][0] = 0.0;
+    r.m[1][1] = 2.0 / (top - bottom);
+    r.m[1][2] = 0.0;
+    r.m[1][3] = 0.0;
+    r.m[2][0] = 0.0;
+    r.m[2][1] = 0.0;
+    r.m[2][2] = -2.0 / (far - near);
+    r.m[2][3] = 0.0;
+    r.m[3][0] = -(right + left) / (right - left);
+    r.m[3][1] = -(top + bottom) / (top - bottom);
+    r.m[3][2] = -(far + near) / (far - near);
+    r.m[3][3] = 1.0;
+    return r;
+}
+
+/* Look at matrix. */
+cml_inline mat4
 cml_math_mat4_look_at(const vec4 eye, const vec4 center, const vec4 up) {
     vec4 f = cml_math_vec4_normalize(cml_math_vec4_sub(center, eye));
     vec4 s = cml_math_vec4_normalize(cml_math_vec4_cross_product(f, up));
     vec4 u = cml_math_vec4_cross_product(s, f);
     mat4 r;
-    r.m[0][0] =  s.v[0];
-    r.m[0][1] =  u.v[0];
-    r.m[0][2] = -f.v[0];
-    r.m[0][3] = 0.0;
-    r.m[1][0] =  s.v[1];
-    r.m[1][1] =  u.v[1];
-    r.m[1][2] = -f.v[1];
-    r.m[1][3] = 0.0;
-    r.m[2][0] =  s.v[2];
-    r.m[2][1] =  u.v[2];
-    r.m[2][2] = -f.v[2];
-    r.m[2][3] = 0.0;
-    r.m[3][0] = -cml_math_vec4_dot_product(s, eye);
-    r.m[3][1] = -cml_math_vec4_dot_product(u, eye);
-    r.m[3][2] =  cml_math_vec4_dot_product(f, eye);
-    r.m[3][3] = 1.0;
+    r.m[0][0] =  s.v[0];
+    r.m[0][1] =  u.v[0];
+    r.m[0][2] = -f.v[0];
+    r.m[0][3] = 0.0;
+    r.m[1][0] =  s.v[1];
+    r.m[1][1] =  u.v[1];
+    r.m[1][2] = -f.v[1];
+    r.m[1][3] = 0.0;
+    r.m[2][0] =  s.v[2];
+    r.m[2][1] =  u.v[2];
+    r.m[2][2] = -f.v[2];
+    r.m[2][3] = 0.0;
+    r.m[3][0] = -cml_math_vec4_dot_product(s, eye);
+    r.m[3][1] = -cml_math_vec4_dot_product(u, eye);
+    r.m[3][2] =  cml_math_vec4_dot_product(f, eye);
+    r.m[3][3] = 1.0;
+    return r;
+}
+
+/*------------------------------*/
+/* Matrix-Vector Transformation */
+/*------------------------------*/
+
+/* Transform a 4D vector by a matrix. Vectors are treated as rows, matching
+ * cml_math_mat4_mul, so the result is v * m. */
+cml_inline vec4
+cml_math_mat4_mul_vec4(const mat4 m, const vec4 v) {
+    vec4 r;
+    r.v = simde_mm256_mul_pd(
+          simde_mm256_permute4x64_pd(v.v, 0x00), m.m[0]);
+    r.v = simde_mm256_fmadd_pd(
+          simde_mm256_permute4x64_pd(v.v, 0x55), m.m[1], r.v);
+    r.v = simde_mm256_fmadd_pd(
+          simde_mm256_permute4x64_pd(v.v, 0xAA), m.m[2], r.v);
+    r.v = simde_mm256_fmadd_pd(
+          simde_mm256_permute4x64_pd(v.v, 0xFF), m.m[3], r.v);
+    return r;
+}
+
+/* Transform n points by a matrix, writing out[i] = in[i] * m. The matrix rows
+ * stay in registers for the whole call and each point is broadcast straight
+ * from memory, so no lane extraction or horizontal adds are needed. The main
+ * loop handles four points per iteration and the remainder is finished one
+ * point at a time. Arrays need not be 32-byte aligned, and in and out may
+ * point to the same array. */
+cml_inline void
+cml_math_mat4_transform_points(const mat4* m, const vec4* in, vec4* out,
+                               size_t n) {
+    const simde__m256d r0 = m->m[0];
+    const simde__m256d r1 = m->m[1];
+    const simde__m256d r2 = m->m[2];
+    const simde__m256d r3 = m->m[3];
+    const f64* src = (const f64*)in;
+    f64*       dst = (f64*)out;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4, src += 16, dst += 16) {
+        simde__m256d p0, p1, p2, p3;
+        p0 = simde_mm256_mul_pd(simde_mm256_broadcast_sd(src +  0), r0);
+        p1 = simde_mm256_mul_pd(simde_mm256_broadcast_sd(src +  4), r0);
+        p2 = simde_mm256_mul_pd(simde_mm256_broadcast_sd(src +  8), r0);
+        p3 = simde_mm256_mul_pd(simde_mm256_broadcast_sd(src + 12), r0);
+        p0 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  1), r1, p0);
+        p1 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  5), r1, p1);
+        p2 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  9), r1, p2);
+        p3 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 13), r1, p3);
+        p0 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  2), r2, p0);
+        p1 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  6), r2, p1);
+        p2 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 10), r2, p2);
+        p3 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 14), r2, p3);
+        p0 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  3), r3, p0);
+        p1 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  7), r3, p1);
+        p2 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 11), r3, p2);
+        p3 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 15), r3, p3);
+        simde_mm256_storeu_pd(dst +  0, p0);
+        simde_mm256_storeu_pd(dst +  4, p1);
+        simde_mm256_storeu_pd(dst +  8, p2);
+        simde_mm256_storeu_pd(dst + 12, p3);
+    }
+    for (; i < n; i++, src += 4, dst += 4) {
+        simde__m256d p;
+        p = simde_mm256_mul_pd(simde_mm256_broadcast_sd(src + 0), r0);
+        p = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 1), r1, p);
+        p = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 2), r2, p);
+        p = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 3), r3, p);
+        simde_mm256_storeu_pd(dst, p);
+    }
+}
+
+/*------------------------*/
+/* Affine Transformations */
+/*------------------------*/
+
+/* The functions below assume an affine matrix in the row-vector layout used
+ * by cml_math_mat4_translation: the upper 3x3 block holds the linear part,
+ * row 3 holds the translation and column 3 is (0, 0, 0, 1). Column 3 is
+ * never read, which is where the savings over the general functions come
+ * from. A rigid matrix is an affine matrix whose linear part is a rotation;
+ * the affine multiply and transforms apply to it unchanged. */
+
+/* Cross product of the xyz lanes of two rows; lane 3 of the result is 0. */
+cml_inline simde__m256d
+cml_math_mat4_cross_rows(const simde__m256d a, const simde__m256d b) {
+    const simde__m256d c = simde_mm256_fmsub_pd(a,
+                           simde_mm256_permute4x64_pd(b, 0xC9),
+                           simde_mm256_mul_pd(
+                           simde_mm256_permute4x64_pd(a, 0xC9), b));
+    /* The FMA leaves the rounding error of a.w * b.w in lane 3. */
+    return simde_mm256_blend_pd(simde_mm256_permute4x64_pd(c, 0xC9),
+                                simde_mm256_setzero_pd(), 0x8);
+}
+
+/* Row 3 of an affine inverse, (0, 0, 0, 1) - t * l, given the translation
+ * row t and the rows l of the inverted linear part. */
+cml_inline simde__m256d
+cml_math_mat4_affine_inverse_translation(const simde__m256d t,
+                                         const simde__m256d l[3]) {
+    simde__m256d r = simde_mm256_setr_pd(0.0, 0.0, 0.0, 1.0);
+    r = simde_mm256_fnmadd_pd(simde_mm256_permute4x64_pd(t, 0x00), l[0], r);
+    r = simde_mm256_fnmadd_pd(simde_mm256_permute4x64_pd(t, 0x55), l[1], r);
+    r = simde_mm256_fnmadd_pd(simde_mm256_permute4x64_pd(t, 0xAA), l[2], r);
+    return r;
+}
+
+/* Invert an affine matrix. The linear part is inverted through the cross
+ * products of its rows, so only one 3x3 determinant is computed. */
+cml_inline mat4
+cml_math_mat4_affine_inverse(const mat4 a) {
+    simde__m256d c[4];
+    c[0] = cml_math_mat4_cross_rows(a.m[1], a.m[2]);
+    c[1] = cml_math_mat4_cross_rows(a.m[2], a.m[0]);
+    c[2] = cml_math_mat4_cross_rows(a.m[0], a.m[1]);
+    c[3] = simde_mm256_setzero_pd();
+    const simde__m256d d = simde_mm256_mul_pd(a.m[0], c[0]);
+    const f64 det = d[0] + d[1] + d[2];
+    const simde__m256d s = simde_mm256_set1_pd(1.0 / det);
+    c[0] = simde_mm256_mul_pd(c[0], s);
+    c[1] = simde_mm256_mul_pd(c[1], s);
+    c[2] = simde_mm256_mul_pd(c[2], s);
+    cml_math_f64x4_transpose(c);
+    mat4 r;
+    r.m[0] = c[0];
+    r.m[1] = c[1];
+    r.m[2] = c[2];
+    r.m[3] = cml_math_mat4_affine_inverse_translation(a.m[3], c);
+    return r;
+}
+
+/* Invert a rigid matrix, one whose linear part is a pure rotation: the
+ * rotation is transposed and the translation rotated back and negated. */
+cml_inline mat4
+cml_math_mat4_rigid_inverse(const mat4 a) {
+    simde__m256d c[4];
+    c[0] = a.m[0];
+    c[1] = a.m[1];
+    c[2] = a.m[2];
+    c[3] = simde_mm256_setzero_pd();
+    cml_math_f64x4_transpose(c);
+    /* Lane 3 of the transposed rows picks up column 3, which is zero. */
+    const simde__m256d mask = simde_mm256_castsi256_pd(
+                              simde_mm256_setr_epi64x(-1, -1, -1, 0));
+    mat4 r;
+    r.m[0] = simde_mm256_and_pd(c[0], mask);
+    r.m[1] = simde_mm256_and_pd(c[1], mask);
+    r.m[2] = simde_mm256_and_pd(c[2], mask);
+    r.m[3] = cml_math_mat4_affine_inverse_translation(a.m[3], r.m);
+    return r;
+}
+
+/* Multiply two affine matrices, a * b. Twelve multiply-adds against the
+ * sixteen multiplies and adds of cml_math_mat4_mul. */
+cml_inline mat4
+cml_math_mat4_affine_mul(const mat4 a, const mat4 b) {
+    mat4 r;
+    for (int i = 0; i < 4; i++) {
+        r.m[i] = i == 3 ? b.m[3] : simde_mm256_setzero_pd();
+        r.m[i] = simde_mm256_fmadd_pd(
+                 simde_mm256_permute4x64_pd(a.m[i], 0x00), b.m[0], r.m[i]);
+        r.m[i] = simde_mm256_fmadd_pd(
+                 simde_mm256_permute4x64_pd(a.m[i], 0x55), b.m[1], r.m[i]);
+        r.m[i] = simde_mm256_fmadd_pd(
+                 simde_mm256_permute4x64_pd(a.m[i], 0xAA), b.m[2], r.m[i]);
+    }
+    return r;
+}
+
+/* Transform a point by an affine matrix. The w component of p is ignored
+ * and taken as 1; the result has w = 1. */
+cml_inline vec4
+cml_math_mat4_affine_transform_point(const mat4 m, const vec4 p) {
+    vec4 r;
+    r.v = simde_mm256_fmadd_pd(
+          simde_mm256_permute4x64_pd(p.v, 0x00), m.m[0], m.m[3]);
+    r.v = simde_mm256_fmadd_pd(
+          simde_mm256_permute4x64_pd(p.v, 0x55), m.m[1], r.v);
+    r.v = simde_mm256_fmadd_pd(
+          simde_mm256_permute4x64_pd(p.v, 0xAA), m.m[2], r.v);
+    return r;
+}
+
+/* Transform a direction by an affine matrix, ignoring the translation. The
+ * w component of v is ignored and taken as 0; the result has w = 0. */
+cml_inline vec4
+cml_math_mat4_affine_transform_vector(const mat4 m, const vec4 v) {
+    vec4 r;
+    r.v = simde_mm256_mul_pd(
+          simde_mm256_permute4x64_pd(v.v, 0x00), m.m[0]);
+    r.v = simde_mm256_fmadd_pd(
+          simde_mm256_permute4x64_pd(v.v, 0x55), m.m[1], r.v);
+    r.v = simde_mm256_fmadd_pd(
+          simde_mm256_permute4x64_pd(v.v, 0xAA), m.m[2], r.v);
+    return r;
+}
+
+/* Transform n points by an affine matrix, as
+ * cml_math_mat4_affine_transform_point. Three multiply-adds per point, and
+ * in and out may point to the same array. */
+cml_inline void
+cml_math_mat4_affine_transform_points(const mat4* m, const vec4* in,
+                                      vec4* out, size_t n) {
+    const simde__m256d r0 = m->m[0];
+    const simde__m256d r1 = m->m[1];
+    const simde__m256d r2 = m->m[2];
+    const simde__m256d r3 = m->m[3];
+    const f64* src = (const f64*)in;
+    f64*       dst = (f64*)out;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4, src += 16, dst += 16) {
+        simde__m256d p0, p1, p2, p3;
+        p0 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  0), r0, r3);
+        p1 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  4), r0, r3);
+        p2 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  8), r0, r3);
+        p3 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 12), r0, r3);
+        p0 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  1), r1, p0);
+        p1 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  5), r1, p1);
+        p2 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  9), r1, p2);
+        p3 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 13), r1, p3);
+        p0 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  2), r2, p0);
+        p1 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src +  6), r2, p1);
+        p2 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 10), r2, p2);
+        p3 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 14), r2, p3);
+        simde_mm256_storeu_pd(dst +  0, p0);
+        simde_mm256_storeu_pd(dst +  4, p1);
+        simde_mm256_storeu_pd(dst +  8, p2);
+        simde_mm256_storeu_pd(dst + 12, p3);
+    }
+    for (; i < n; i++, src += 4, dst += 4) {
+        simde__m256d p;
+        p = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 0), r0, r3);
+        p = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 1), r1, p);
+        p = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(src + 2), r2, p);
+        simde_mm256_storeu_pd(dst, p);
+    }
+}
+
+/*----------------------------------*/
+/* Batched Products and Hierarchies */
+/*----------------------------------*/
+
+/* Multiply through pointers, *r = *a * *b, broadcasting the elements of a
+ * straight from memory. All four result rows are kept in registers until
+ * the end, so r may alias a or b. */
+cml_inline void
+cml_math_mat4_mul_to(const mat4* a, const mat4* b, mat4* r) {
+    const f64* e = (const f64*)a->m;
+    const simde__m256d b0 = b->m[0];
+    const simde__m256d b1 = b->m[1];
+    const simde__m256d b2 = b->m[2];
+    const simde__m256d b3 = b->m[3];
+    simde__m256d r0, r1, r2, r3;
+    r0 = simde_mm256_mul_pd(simde_mm256_broadcast_sd(e +  0), b0);
+    r1 = simde_mm256_mul_pd(simde_mm256_broadcast_sd(e +  4), b0);
+    r2 = simde_mm256_mul_pd(simde_mm256_broadcast_sd(e +  8), b0);
+    r3 = simde_mm256_mul_pd(simde_mm256_broadcast_sd(e + 12), b0);
+    r0 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(e +  1), b1, r0);
+    r1 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(e +  5), b1, r1);
+    r2 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(e +  9), b1, r2);
+    r3 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(e + 13), b1, r3);
+    r0 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(e +  2), b2, r0);
+    r1 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(e +  6), b2, r1);
+    r2 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(e + 10), b2, r2);
+    r3 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(e + 14), b2, r3);
+    r0 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(e +  3), b3, r0);
+    r1 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(e +  7), b3, r1);
+    r2 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(e + 11), b3, r2);
+    r3 = simde_mm256_fmadd_pd(simde_mm256_broadcast_sd(e + 15), b3, r3);
+    r->m[0] = r0;
+    r->m[1] = r1;
+    r->m[2] = r2;
+    r->m[3] = r3;
+}
+
+/* Compute out[i] = a[i] * b[i] for n matrix pairs. out may be a or b. */
+cml_inline void
+cml_math_mat4_mul_array(const mat4* a, const mat4* b, mat4* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        cml_math_mat4_mul_to(a + i, b + i, out + i);
+    }
+}
+
+/* Sorts the nodes of a transform hierarchy by depth. parent[i] is the index
+ * of the parent of node i, or -1 for a root, and must describe a forest.
+ * On return depth[i] holds the depth of node i (roots are 0), order lists
+ * the nodes level by level, and level k occupies
+ * order[level_start[k] .. level_start[k + 1]). level_start needs room for
+ * one more entry than there are levels, at most n + 1. Returns the number
+ * of levels. The order only changes when the hierarchy does, so it can be
+ * computed once and reused every frame. */
+static inline size_t
+cml_math_hierarchy_depth_order(const i32* parent, size_t n, u32* depth,
+                               u32* order, size_t* level_start) {
+    for (size_t i = 0; i < n; i++) {
+        depth[i] = UINT32_MAX;
+    }
+    /* Walk up to the nearest node of known depth, then walk the same path
+     * again assigning depths; every node is assigned once. */
+    u32 levels = 0;
+    for (size_t i = 0; i < n; i++) {
+        u32 steps = 0;
+        i32 k = (i32)i;
+        while (depth[k] == UINT32_MAX && parent[k] >= 0) {
+            k = parent[k];
+            steps++;
+        }
+        u32 d = depth[k] == UINT32_MAX ? 0 : depth[k];
+        if (depth[k] == UINT32_MAX) {
+            depth[k] = 0;
+        }
+        d += steps;
+        for (k = (i32)i; depth[k] == UINT32_MAX; k = parent[k], d--) {
+            depth[k] = d;
+        }
+        if (depth[i] + 1 > levels) {
+            levels = depth[i] + 1;
+        }
+    }
+    /* Counting sort by depth, stable in node index. */
+    for (size_t l = 0; l <= levels; l++) {
+        level_start[l] = 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        level_start[depth[i] + 1]++;
+    }
+    for (size_t l = 0; l < levels; l++) {
+        level_start[l + 1] += level_start[l];
+    }
+    for (size_t i = 0; i < n; i++) {
+        order[level_start[depth[i]]++] = (u32)i;
+    }
+    for (size_t l = levels; l > 0; l--) {
+        level_start[l] = level_start[l - 1];
+    }
+    level_start[0] = 0;
+    return levels;
+}
+
+/* Relabels a hierarchy into the order from cml_math_hierarchy_depth_order.
+ * Node order[k] becomes node k: rank receives the new index of every old
+ * node and sorted_parent the parent array in new indices. Storing the local
+ * matrices in the same order lets cml_math_mat4_flatten_range run with a
+ * NULL order and stream through memory instead of gathering. */
+cml_inline void
+cml_math_hierarchy_relabel(const i32* parent, const u32* order, size_t n,
+                           u32* rank, i32* sorted_parent) {
+    for (size_t k = 0; k < n; k++) {
+        rank[order[k]] = (u32)k;
+    }
+    for (size_t k = 0; k < n; k++) {
+        const i32 p = parent[order[k]];
+        sorted_parent[k] = p < 0 ? -1 : (i32)rank[p];
+    }
+}
+
+/* Compute world[k] = local[k] * world[parent[k]] for the nodes
+ * k = order[begin .. end), or world[k] = local[k] for roots. Every parent
+ * must already be final, which holds for any range within one level of
+ * cml_math_hierarchy_depth_order. Ranges of the same level touch disjoint
+ * outputs, so the caller may hand them to different threads. A NULL order
+ * means the identity, for hierarchies already stored parents first. */
+cml_inline void
+cml_math_mat4_flatten_range(const i32* parent, const mat4* local,
+                            mat4* world, const u32* order, size_t begin,
+                            size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        const size_t k = order ? order[i] : i;
+        const i32    p = parent[k];
+        if (p < 0) {
+            world[k] = local[k];
+        } else {
+            cml_math_mat4_mul_to(local + k, world + p, world + k);
+        }
+    }
+}
+
+/* Smallest level split across OpenMP threads by
+ * cml_math_mat4_flatten_hierarchy. */
+#ifndef CML_FLATTEN_PARALLEL_MIN
+    #define CML_FLATTEN_PARALLEL_MIN 4096
+#endif
+
+/* Flatten a whole hierarchy, given the order and level_start from
+ * cml_math_hierarchy_depth_order. When compiled with OpenMP, one parallel
+ * region walks the levels in turn: levels of at least
+ * CML_FLATTEN_PARALLEL_MIN nodes are split across the threads and smaller
+ * ones run on one of them, with a barrier after each level so its parents
+ * are final before the next level reads them. Without OpenMP, callers with
+ * their own thread pool can do the same with cml_math_mat4_flatten_range. */
+cml_inline void
+cml_math_mat4_flatten_hierarchy(const i32* parent, const mat4* local,
+                                mat4* world, const u32* order,
+                                const size_t* level_start, size_t levels) {
+#if defined(_OPENMP)
+    if (level_start[levels] >= CML_FLATTEN_PARALLEL_MIN &&
+        omp_get_max_threads() > 1) {
+        #pragma omp parallel
+        {
+            const i64 parts = (i64)omp_get_num_threads();
+            for (size_t l = 0; l < levels; l++) {
+                const size_t first = level_start[l];
+                const size_t count = level_start[l + 1] - first;
+                if (count < CML_FLATTEN_PARALLEL_MIN) {
+                    #pragma omp single
+                    cml_math_mat4_flatten_range(parent, local, world, order,
+                                                first, first + count);
+                    continue;
+                }
+                #pragma omp for schedule(static)
+                for (i64 p = 0; p < parts; p++) {
+                    const size_t begin = count * (size_t)p / (size_t)parts;
+                    const size_t end = count * (size_t)(p + 1) / (size_t)parts;
+                    cml_math_mat4_flatten_range(parent, local, world, order,
+                                                first + begin, first + end);
+                }
+            }
+        }
+        return;
+    }
+#endif
+    cml_math_mat4_flatten_range(parent, local, world, order, 0,
+                                level_start[levels]);
+}
+
+/* Print matrix in a row-major format. */
+cml_inline void
+cml_math_mat4_print(const mat4 m) {
+    printf("%f %f %f %f\n", m.m[0][0], m.m[0][1], m.m[0][2], m.m[0][3]);
+    printf("%f %f %f %f\n", m.m[1][0], m.m[1][1], m.m[1][2], m.m[1][3]);
+    printf("%f %f %f %f\n", m.m[2][0], m.m[2][1], m.m[2][2], m.m[2][3]);
+    printf("%f %f %f %f\n", m.m[3][0], m.m[3][1], m.m[3][2], m.m[3][3]);
+}
+
+/*-------------------*/
+/* Storage Functions */
+/*-------------------*/
+
+/* Returns the elements of an array of matrices as packed row-major f64,
+ * without copying. */
+cml_inline const f64*
+cml_math_mat4_data(const mat4* m) {
+    return (const f64*)m;
+}
+
+/* With native AVX-512 a whole matrix fits in two f64x8 or one f32x16
+ * register, and a transpose is one or two cross-lane permutes instead of
+ * eight shuffles. */
+
+/* Write n matrices to dst as 16 packed f64 each, in the given order. */
+static inline void
+cml_math_mat4_to_f64_array(f64* dst, const mat4* src, const size_t n,
+                           const cml_matrix_order order) {
+    if (order == CML_ROW_MAJOR) {
+        memcpy(dst, src, n * sizeof(mat4));
+        return;
+    }
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+    const simde__m512i t0 = simde_mm512_set_epi64(13, 9, 5, 1, 12, 8, 4, 0);
+    const simde__m512i t1 = simde_mm512_set_epi64(15, 11, 7, 3, 14, 10, 6, 2);
+    for (size_t i = 0; i < n; i++, dst += 16) {
+        const f64x8 a = simde_mm512_loadu_pd((const f64*)(src + i));
+        const f64x8 b = simde_mm512_loadu_pd((const f64*)(src + i) + 8);
+        simde_mm512_storeu_pd(dst,     simde_mm512_permutex2var_pd(a, t0, b));
+        simde_mm512_storeu_pd(dst + 8, simde_mm512_permutex2var_pd(a, t1, b));
+    }
+#else
+    for (size_t i = 0; i < n; i++, dst += 16) {
+        f64x4 r[4] = {src[i].m[0], src[i].m[1], src[i].m[2], src[i].m[3]};
+        cml_math_f64x4_transpose(r);
+        simde_mm256_storeu_pd(dst +  0, r[0]);
+        simde_mm256_storeu_pd(dst +  4, r[1]);
+        simde_mm256_storeu_pd(dst +  8, r[2]);
+        simde_mm256_storeu_pd(dst + 12, r[3]);
+    }
+#endif
+}
+
+/* Read n matrices of 16 packed f64 each, in the given order, from src. */
+static inline void
+cml_math_mat4_from_f64_array(mat4* dst, const f64* src, const size_t n,
+                             const cml_matrix_order order) {
+    if (order == CML_ROW_MAJOR) {
+        memcpy(dst, src, n * sizeof(mat4));
+        return;
+    }
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+    const simde__m512i t0 = simde_mm512_set_epi64(13, 9, 5, 1, 12, 8, 4, 0);
+    const simde__m512i t1 = simde_mm512_set_epi64(15, 11, 7, 3, 14, 10, 6, 2);
+    for (size_t i = 0; i < n; i++, src += 16) {
+        const f64x8 a = simde_mm512_loadu_pd(src);
+        const f64x8 b = simde_mm512_loadu_pd(src + 8);
+        f64* out = (f64*)(dst + i);
+        simde_mm512_storeu_pd(out,     simde_mm512_permutex2var_pd(a, t0, b));
+        simde_mm512_storeu_pd(out + 8, simde_mm512_permutex2var_pd(a, t1, b));
+    }
+#else
+    for (size_t i = 0; i < n; i++, src += 16) {
+        dst[i].m[0] = simde_mm256_loadu_pd(src +  0);
+        dst[i].m[1] = simde_mm256_loadu_pd(src +  4);
+        dst[i].m[2] = simde_mm256_loadu_pd(src +  8);
+        dst[i].m[3] = simde_mm256_loadu_pd(src + 12);
+        cml_math_f64x4_transpose(dst[i].m);
+    }
+#endif
+}
+
+/* Write n matrices to dst as 16 packed f32 each, in the given order. Each
+ * element is rounded to nearest. */
+static inline void
+cml_math_mat4_to_f32_array(f32* dst, const mat4* src, const size_t n,
+                           const cml_matrix_order order) {
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+    /* Gathers both converted halves, rows 0-1 at 0-7 and rows 2-3 at
+     * 16-23, into the requested order. */
+    const simde__m512i t = order == CML_ROW_MAJOR ?
+        simde_mm512_set_epi32(23, 22, 21, 20, 19, 18, 17, 16,
+                              7, 6, 5, 4, 3, 2, 1, 0) :
+        simde_mm512_set_epi32(23, 19, 7, 3, 22, 18, 6, 2,
+                              21, 17, 5, 1, 20, 16, 4, 0);
+    for (size_t i = 0; i < n; i++, dst += 16) {
+        const f64* p = (const f64*)(src + i);
+        const f32x8 a = simde_mm512_cvtpd_ps(simde_mm512_loadu_pd(p));
+        const f32x8 b = simde_mm512_cvtpd_ps(simde_mm512_loadu_pd(p + 8));
+        simde_mm512_storeu_ps(dst, simde_mm512_permutex2var_ps(
+                                   simde_mm512_castps256_ps512(a), t,
+                                   simde_mm512_castps256_ps512(b)));
+    }
+#else
+    for (size_t i = 0; i < n; i++, dst += 16) {
+        f64x4 r[4] = {src[i].m[0], src[i].m[1], src[i].m[2], src[i].m[3]};
+        if (order == CML_COLUMN_MAJOR) {
+            cml_math_f64x4_transpose(r);
+        }
+        simde_mm_storeu_ps(dst +  0, simde_mm256_cvtpd_ps(r[0]));
+        simde_mm_storeu_ps(dst +  4, simde_mm256_cvtpd_ps(r[1]));
+        simde_mm_storeu_ps(dst +  8, simde_mm256_cvtpd_ps(r[2]));
+        simde_mm_storeu_ps(dst + 12, simde_mm256_cvtpd_ps(r[3]));
+    }
+#endif
+}
+
+/* Read n matrices of 16 packed f32 each, in the given order, from src. */
+static inline void
+cml_math_mat4_from_f32_array(mat4* dst, const f32* src, const size_t n,
+                             const cml_matrix_order order) {
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+    const simde__m512i t = simde_mm512_set_epi32(15, 11, 7, 3, 14, 10, 6, 2,
+                                                 13, 9, 5, 1, 12, 8, 4, 0);
+    for (size_t i = 0; i < n; i++, src += 16) {
+        f32x16 v = simde_mm512_loadu_ps(src);
+        if (order == CML_COLUMN_MAJOR) {
+            v = simde_mm512_permutexvar_ps(t, v);
+        }
+        const f32x8 hi = simde_mm256_castpd_ps(simde_mm512_extractf64x4_pd(
+                         simde_mm512_castps_pd(v), 1));
+        f64* out = (f64*)(dst + i);
+        simde_mm512_storeu_pd(out, simde_mm512_cvtps_pd(
+                                   simde_mm512_castps512_ps256(v)));
+        simde_mm512_storeu_pd(out + 8, simde_mm512_cvtps_pd(hi));
+    }
+#else
+    for (size_t i = 0; i < n; i++, src += 16) {
+        dst[i].m[0] = simde_mm256_cvtps_pd(simde_mm_loadu_ps(src +  0));
+        dst[i].m[1] = simde_mm256_cvtps_pd(simde_mm_loadu_ps(src +  4));
+        dst[i].m[2] = simde_mm256_cvtps_pd(simde_mm_loadu_ps(src +  8));
+        dst[i].m[3] = simde_mm256_cvtps_pd(simde_mm_loadu_ps(src + 12));
+        if (order == CML_COLUMN_MAJOR) {
+            cml_math_f64x4_transpose(dst[i].m);
+        }
+    }
+#endif
+}
+
+/*============================================================================*/
+/* Quaternion                                                                 */
+/*============================================================================*/
+
+/* Quaternion. */
+typedef struct quat {
+    simde__m256d q;
+} quat;
+
+/* Quaternion identity. */
+cml_inline quat
+cml_math_quat_identity(void) {
+    quat r;
+    r.q = simde_mm256_set_pd(0.0, 0.0, 0.0, 1.0);
+    return r;
+}
+
+/* Quaternion addition. */
+cml_inline quat
+cml_math_quat_add(const quat a, const quat b) {
+    quat r;
+    r.q = simde_mm256_add_pd(a.q, b.q);
+    return r;
+}
+
+/* Quaternion subtraction. */
+cml_inline quat
+cml_math_quat_sub(const quat a, const quat b) {
+    quat r;
+    r.q = simde_mm256_sub_pd(a.q, b.q);
+    return r;
+}
+
+/* Quaternion multiplication, the Hamilton product a * b: rotating by the
+ * result rotates by b first, then by a. Each term is one lane of a times b
+ * with its lanes permuted and signs flipped. */
+cml_inline quat
+cml_math_quat_mul(const quat a, const quat b) {
+    const simde__m256d sx = simde_mm256_setr_pd(-0.0, 0.0, -0.0, 0.0);
+    const simde__m256d sy = simde_mm256_setr_pd(-0.0, 0.0, 0.0, -0.0);
+    const simde__m256d sz = simde_mm256_setr_pd(-0.0, -0.0, 0.0, 0.0);
+    simde__m256d r;
+    r = simde_mm256_mul_pd(simde_mm256_permute4x64_pd(a.q, 0x00), b.q);
+    r = simde_mm256_fmadd_pd(simde_mm256_permute4x64_pd(a.q, 0x55),
+        simde_mm256_xor_pd(simde_mm256_permute4x64_pd(b.q, 0xB1), sx), r);
+    r = simde_mm256_fmadd_pd(simde_mm256_permute4x64_pd(a.q, 0xAA),
+        simde_mm256_xor_pd(simde_mm256_permute4x64_pd(b.q, 0x4E), sy), r);
+    r = simde_mm256_fmadd_pd(simde_mm256_permute4x64_pd(a.q, 0xFF),
+        simde_mm256_xor_pd(simde_mm256_permute4x64_pd(b.q, 0x1B), sz), r);
+    quat q;
+    q.q = r;
+    return q;
+}
+
+/* Quaternion negation. */
+cml_inline quat
+cml_math_quat_neg(const quat a) {
+    quat r;
+    r.q = simde_mm256_sub_pd(simde_mm256_setzero_pd(), a.q);
+    return r;
+}
+
+/* Quaternion conjugation. */
+cml_inline quat
+cml_math_quat_conjugate(const quat a) {
+    quat r;
+    r.q = simde_mm256_xor_pd(a.q, simde_mm256_set_pd(-0.0, -0.0, -0.0, 0.0));
+    return r;
+}
+
+/* Quaternion inverse. */
+cml_inline quat
+cml_math_quat_inverse(const quat a) {
+    quat r;
+    r.q = simde_mm256_div_pd(simde_mm256_set_pd(0.0, 0.0, 0.0, 1.0), a.q);
+    return r;
+}
+
+/* Quaternion length. */
+cml_inline f64
+cml_math_quat_length(const quat a) {
+    return sqrt(a.q[0] * a.q[0] + 
+                a.q[1] * a.q[1] + 
+                a.q[2] * a.q[2] + 
+                a.q[3] * a.q[3]);
+}
+
+/* Quaternion normalization. */
+cml_inline quat
+cml_math_quat_normalize(const quat a) {
+    quat r;
+    r.q = simde_mm256_div_pd(a.q, 
+          simde_mm256_set1_pd(cml_math_quat_length(a)));
+    return r;
+}
+
+/* Cosine above which slerp falls back to nlerp: the two rotations are then
+ * less than about 3.6 degrees apart and sin(theta) loses precision. */
+#define CML_QUAT_SLERP_THRESHOLD 0.9995
+
+/* Normalized linear interpolation between two unit quaternions, along the
+ * shorter arc. Cheaper than slerp but not constant angular velocity. */
+cml_inline quat
+cml_math_quat_nlerp(const quat a, const quat b, const f64 t) {
+    const f64 d = a.q[0] * b.q[0] + a.q[1] * b.q[1] +
+                  a.q[2] * b.q[2] + a.q[3] * b.q[3];
+    const f64x4 bq = d < 0.0 ? simde_mm256_sub_pd(simde_mm256_setzero_pd(),
+                                                  b.q) : b.q;
+    quat r;
+    r.q = simde_mm256_fmadd_pd(simde_mm256_sub_pd(bq, a.q),
+                               simde_mm256_set1_pd(t), a.q);
+    return cml_math_quat_normalize(r);
+}
+
+/* Spherical linear interpolation between two unit quaternions, along the
+ * shorter arc. */
+cml_inline quat
+cml_math_quat_slerp(const quat a, const quat b, const f64 t) {
+    f64 d = a.q[0] * b.q[0] + a.q[1] * b.q[1] +
+            a.q[2] * b.q[2] + a.q[3] * b.q[3];
+    f64x4 bq = b.q;
+    if (d < 0.0) {
+        d  = -d;
+        bq = simde_mm256_sub_pd(simde_mm256_setzero_pd(), bq);
+    }
+    if (d > CML_QUAT_SLERP_THRESHOLD) {
+        quat r;
+        r.q = simde_mm256_fmadd_pd(simde_mm256_sub_pd(bq, a.q),
+                                   simde_mm256_set1_pd(t), a.q);
+        return cml_math_quat_normalize(r);
+    }
+    const f64 theta = acos(d);
+    const f64 s     = 1.0 / sin(theta);
+    quat r;
+    r.q = simde_mm256_fmadd_pd(a.q,
+          simde_mm256_set1_pd(sin((1.0 - t) * theta) * s),
+          simde_mm256_mul_pd(bq, simde_mm256_set1_pd(sin(t * theta) * s)));
+    return r;
+}
+
+/* Normalizes four quaternions held as w, x, y and z planes. */
+cml_inline void
+cml_math_quat_normalize_f64x4(f64x4 q[4]) {
+    f64x4 l = simde_mm256_mul_pd(q[0], q[0]);
+    l = simde_mm256_fmadd_pd(q[1], q[1], l);
+    l = simde_mm256_fmadd_pd(q[2], q[2], l);
+    l = simde_mm256_fmadd_pd(q[3], q[3], l);
+    l = simde_mm256_div_pd(simde_mm256_set1_pd(1.0), simde_mm256_sqrt_pd(l));
+    for (int k = 0; k < 4; k++) {
+        q[k] = simde_mm256_mul_pd(q[k], l);
+    }
+}
+
+/* Nlerp of four quaternion pairs held as w, x, y and z planes. Branch-free:
+ * the shorter-arc flip is a sign mask applied to b. */
+cml_inline void
+cml_math_quat_nlerp_f64x4(const f64x4 a[4], const f64x4 b[4], const f64x4 t,
+                          f64x4 r[4]) {
+    f64x4 d = simde_mm256_mul_pd(a[0], b[0]);
+    d = simde_mm256_fmadd_pd(a[1], b[1], d);
+    d = simde_mm256_fmadd_pd(a[2], b[2], d);
+    d = simde_mm256_fmadd_pd(a[3], b[3], d);
+    const f64x4 sign = simde_mm256_and_pd(d, simde_mm256_set1_pd(-0.0));
+    for (int k = 0; k < 4; k++) {
+        const f64x4 bk = simde_mm256_xor_pd(b[k], sign);
+        r[k] = simde_mm256_fmadd_pd(simde_mm256_sub_pd(bk, a[k]), t, a[k]);
+    }
+    cml_math_quat_normalize_f64x4(r);
+}
+
+/* Slerp of four quaternion pairs held as w, x, y and z planes. Branch-free:
+ * acos and sin come from the polynomial kernels and the nlerp fallback for
+ * nearly equal rotations is a blend of the weights. t must lie in [0, 1].
+ * The result is within a few ulp of the libm-based cml_math_quat_slerp. */
+cml_inline void
+cml_math_quat_slerp_f64x4(const f64x4 a[4], const f64x4 b[4], const f64x4 t,
+                          f64x4 r[4]) {
+    const f64x4 one = simde_mm256_set1_pd(1.0);
+    f64x4 d = simde_mm256_mul_pd(a[0], b[0]);
+    d = simde_mm256_fmadd_pd(a[1], b[1], d);
+    d = simde_mm256_fmadd_pd(a[2], b[2], d);
+    d = simde_mm256_fmadd_pd(a[3], b[3], d);
+    const f64x4 sign = simde_mm256_and_pd(d, simde_mm256_set1_pd(-0.0));
+    d = simde_mm256_min_pd(simde_mm256_xor_pd(d, sign), one);
+
+    const f64x4 theta = cml_math_acos_f64x4(d);
+    const f64x4 s     = simde_mm256_sqrt_pd(
+                        simde_mm256_mul_pd(simde_mm256_sub_pd(one, d),
+                                           simde_mm256_add_pd(one, d)));
+    const f64x4 u     = simde_mm256_sub_pd(one, t);
+    const f64x4 sa    = cml_math_sin_half_pi_f64x4(
+                        simde_mm256_mul_pd(u, theta));
+    const f64x4 sb    = cml_math_sin_half_pi_f64x4(
+                        simde_mm256_mul_pd(t, theta));
+    const f64x4 near  = simde_mm256_cmp_pd(d,
+                        simde_mm256_set1_pd(CML_QUAT_SLERP_THRESHOLD),
+                        SIMDE_CMP_GT_OQ);
+    /* Keep the division finite in the lanes that take the nlerp weights. */
+    const f64x4 rs    = simde_mm256_div_pd(one,
+                        simde_mm256_blendv_pd(s, one, near));
+    const f64x4 wa    = simde_mm256_blendv_pd(
+                        simde_mm256_mul_pd(sa, rs), u, near);
+    const f64x4 wb    = simde_mm256_xor_pd(simde_mm256_blendv_pd(
+                        simde_mm256_mul_pd(sb, rs), t, near), sign);
+    for (int k = 0; k < 4; k++) {
+        r[k] = simde_mm256_fmadd_pd(a[k], wa, simde_mm256_mul_pd(b[k], wb));
+    }
+    /* Slerp weights already give a unit result; only the nlerp lanes need
+     * this, but normalizing all four is cheaper than a blend per plane. */
+    cml_math_quat_normalize_f64x4(r);
+}
+
+/* Loads m <= 4 quaternions from q as w, x, y and z planes. Missing lanes
+ * repeat q[0] so the kernels see valid input. */
+cml_inline void
+cml_math_quat_load_planes(const quat* q, size_t m, f64x4 r[4]) {
+    for (size_t k = 0; k < 4; k++) {
+        r[k] = q[k < m ? k : 0].q;
+    }
+    cml_math_f64x4_transpose(r);
+}
+
+/* Stores the first m <= 4 quaternions held as w, x, y and z planes. */
+cml_inline void
+cml_math_quat_store_planes(quat* q, size_t m, f64x4 r[4]) {
+    cml_math_f64x4_transpose(r);
+    for (size_t k = 0; k < m; k++) {
+        q[k].q = r[k];
+    }
+}
+
+/* Loads m <= 4 interpolation parameters, padding with zero. */
+cml_inline f64x4
+cml_math_quat_load_t(const f64* t, size_t m) {
+    f64 p[4] = {0.0, 0.0, 0.0, 0.0};
+    for (size_t k = 0; k < m; k++) {
+        p[k] = t[k];
+    }
+    return simde_mm256_loadu_pd(p);
+}
+
+/* Compute out[i] = slerp(a[i], b[i], t[i]) for n quaternion pairs. out may
+ * be a or b. */
+static inline void
+cml_math_quat_slerp_array(const quat* a, const quat* b, const f64* t,
+                          quat* out, size_t n) {
+    for (size_t i = 0; i < n; i += 4) {
+        const size_t m = n - i < 4 ? n - i : 4;
+        f64x4 qa[4], qb[4], qr[4];
+        cml_math_quat_load_planes(a + i, m, qa);
+        cml_math_quat_load_planes(b + i, m, qb);
+        cml_math_quat_slerp_f64x4(qa, qb, cml_math_quat_load_t(t + i, m), qr);
+        cml_math_quat_store_planes(out + i, m, qr);
+    }
+}
+
+/* Compute out[i] = nlerp(a[i], b[i], t[i]) for n quaternion pairs. out may
+ * be a or b. */
+static inline void
+cml_math_quat_nlerp_array(const quat* a, const quat* b, const f64* t,
+                          quat* out, size_t n) {
+    for (size_t i = 0; i < n; i += 4) {
+        const size_t m = n - i < 4 ? n - i : 4;
+        f64x4 qa[4], qb[4], qr[4];
+        cml_math_quat_load_planes(a + i, m, qa);
+        cml_math_quat_load_planes(b + i, m, qb);
+        cml_math_quat_nlerp_f64x4(qa, qb, cml_math_quat_load_t(t + i, m), qr);
+        cml_math_quat_store_planes(out + i, m, qr);
+    }
+}
+
+/* Quaternion rotation. Computes q * v * q^-1 for a unit quaternion through
+ * t = 2 * cross(q.xyz, v), v' = v + q.w * t + cross(q.xyz, t): seven
+ * permutes, a blend and seven arithmetic instructions. The w component of v is
+ * preserved. */
+cml_inline vec4
+cml_math_quat_rotate(const quat a, const vec4 b) {
+    /* u = (x, y, z, w) and u.yzx = (y, z, x, w) straight from (w, x, y, z). */
+    const simde__m256d u    = simde_mm256_permute4x64_pd(a.q, 0x39);
+    const simde__m256d uyzx = simde_mm256_permute4x64_pd(a.q, 0x1E);
+    const simde__m256d w    = simde_mm256_permute4x64_pd(a.q, 0x00);
+    const simde__m256d two  = simde_mm256_set1_pd(2.0);
+    /* cross(a, b) = (a * b.yzx - a.yzx * b).yzx. Lane 3 of t holds the
+     * rounding error of q.w * v.w that the FMA exposes; clearing it keeps
+     * lane 3 of the second cross product at zero and v.w exact. */
+    simde__m256d t = simde_mm256_fmsub_pd(u,
+                     simde_mm256_permute4x64_pd(b.v, 0xC9),
+                     simde_mm256_mul_pd(uyzx, b.v));
+    t = simde_mm256_mul_pd(two, simde_mm256_permute4x64_pd(t, 0xC9));
+    t = simde_mm256_blend_pd(t, simde_mm256_setzero_pd(), 0x8);
+    simde__m256d c = simde_mm256_fmsub_pd(u,
+                     simde_mm256_permute4x64_pd(t, 0xC9),
+                     simde_mm256_mul_pd(uyzx, t));
+    c = simde_mm256_permute4x64_pd(c, 0xC9);
+    vec4 r;
+    r.v = simde_mm256_add_pd(simde_mm256_fmadd_pd(w, t, b.v), c);
+    return r;
+}
+
+/* Rotation by a unit quaternion as a matrix in the layout expected by
+ * cml_math_mat4_transform_points: row i holds the image of axis i. */
+cml_inline mat4
+cml_math_quat_rotation_rows(const quat a) {
+    const f64 w = a.q[0], x = a.q[1], y = a.q[2], z = a.q[3];
+    mat4 r;
+    r.m[0] = simde_mm256_setr_pd(1.0 - 2.0 * (y * y + z * z),
+                                 2.0 * (x * y + w * z),
+                                 2.0 * (x * z - w * y), 0.0);
+    r.m[1] = simde_mm256_setr_pd(2.0 * (x * y - w * z),
+                                 1.0 - 2.0 * (x * x + z * z),
+                                 2.0 * (y * z + w * x), 0.0);
+    r.m[2] = simde_mm256_setr_pd(2.0 * (x * z + w * y),
+                                 2.0 * (y * z - w * x),
+                                 1.0 - 2.0 * (x * x + y * y), 0.0);
+    r.m[3] = simde_mm256_setr_pd(0.0, 0.0, 0.0, 1.0);
+    return r;
+}
+
+/* Rotate n vectors by one unit quaternion, out[i] = q * in[i] * q^-1. The
+ * quaternion is expanded to a matrix once, so each vector costs one
+ * four-term multiply-add chain. in and out may be the same array. */
+cml_inline void
+cml_math_quat_rotate_array(const quat a, const vec4* in, vec4* out,
+                           size_t n) {
+    const mat4 m = cml_math_quat_rotation_rows(a);
+    cml_math_mat4_transform_points(&m, in, out, n);
+}
+
+/* Quaternion to matrix. */
+cml_inline mat4
+cml_math_quat_to_mat4(const quat a) {
+    mat4 r;
+    r.m[0][0] = 1.0 - 2.0 * a.q[2] * a.q[2] - 2.0 * a.q[3] * a.q[3];
+    r.m[0][1] = 2.0       * a.q[1] * a.q[2] - 2.0 * a.q[3] * a.q[0];
+    r.m[0][2] = 2.0       * a.q[1] * a.q[3] + 2.0 * a.q[2] * a.q[0];
+    r.m[0][3] = 0.0;
+    r.m[1][0] = 2.0       * a.q[1] * a.q[2] + 2.0 * a.q[3] * a.q[0];
+    r.m[1][1] = 1.0 - 2.0 * a.q[1] * a.q[1] - 2.0 * a.q[3] * a.q[3];
+    r.m[1][2] = 2.0       * a.q[2] * a.q[3] - 2.0 * a.q[1] * a.q[0];
+    r.m[1][3] = 0.0;
+    r.m[2][0] = 2.0       * a.q[1] * a.q[3] - 2.0 * a.q[2] * a.q[0];
+    r.m[2][1] = 2.0       * a.q[2] * a.q[3] + 2.0 * a.q[1] * a.q[0];
+    r.m[2][2] = 1.0 - 2.0 * a.q[1] * a.q[1] - 2.0 * a.q[2] * a.q[2];
+    r.m[2][3] = 0.0;
+    r.m[3][0] = 0.0;
+    r.m[3][1] = 0.0;
+    r.m[3][2] = 0.0;
+    r.m[3][3] = 1.0;
+    return r;
+}
+
+/* Quaternion to vector. */
+cml_inline vec4
+cml_math_quat_to_vec4(const quat a) {
+    vec4 r;
+    r.v = a.q;
+    return r;
+}
+
+/* Pitch from quaternion. */
+cml_inline f64
+cml_math_quat_pitch(const quat a) {
+    return atan2(2.0       * (a.q[0] * a.q[1] + a.q[2] * a.q[3]), 
+                 1.0 - 2.0 * (a.q[1] * a.q[1] + a.q[2] * a.q[2]));
+}
+
+/* Yaw from quaternion. */
+cml_inline f64
+cml_math_quat_yaw(const quat a) {
+    return asin(2.0 * (a.q[0] * a.q[2] - a.q[3] * a.q[1]));
+}
+
+/* Roll from quaternion. */
+cml_inline f64
+cml_math_quat_roll(const quat a) {
+    return atan2(2.0       * (a.q[0] * a.q[3] + a.q[1] * a.q[2]), 
+                 1.0 - 2.0 * (a.q[2] * a.q[2] + a.q[3] * a.q[3]));
+}
+
+/* Quaternion from pitch, yaw and roll. */
+cml_inline quat
+cml_math_quat_from_pitch_yaw_roll(const f64 pitch, const f64 yaw, 
+                                  const f64 roll) {
+    quat r;
+    /* All three half-angles share one vector sincos. */
+    f64x4 s, c;
+    cml_math_sincos(simde_mm256_setr_pd(pitch * 0.5, yaw * 0.5,
+                                        roll * 0.5, 0.0), &s, &c);
+    f64 c1 = c[0];
+    f64 c2 = c[1];
+    f64 c3 = c[2];
+    f64 s1 = s[0];
+    f64 s2 = s[1];
+    f64 s3 = s[2];
+    r.q[0] = c1 * c2 * c3 + s1 * s2 * s3;
+    r.q[1] = s1 * c2 * c3 - c1 * s2 * s3;
+    r.q[2] = c1 * s2 * c3 + s1 * c2 * s3;
+    r.q[3] = c1 * c2 * s3 - s1 * s2 * c3;
+    return r;
+}
+
+/* Quaternion from axis and angle. */
+cml_inline quat
+cml_math_quat_from_axis_angle(const vec4 axis, const f64 angle) {
+    quat r;
+    f64 s, c;
+    cml_math_sincos(angle * 0.5, &s, &c);
+    r.q[0] = c;
+    r.q[1] = axis.v[0] * s;
+    r.q[2] = axis.v[1] * s;
+    r.q[3] = axis.v[2] * s;
+    return r;
+}
+
+/* Create n quaternions from the xyz parts of axis[i] and angle[i], four at
+ * a time with one vector sincos. */
+static inline void
+cml_math_quat_from_axis_angle_array(const vec4* axis, const f64* angle,
+                                    quat* out, size_t n) {
+    const f64x4 half = simde_mm256_set1_pd(0.5);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        f64x4 a[4], s, c;
+        a[0] = axis[i + 0].v;
+        a[1] = axis[i + 1].v;
+        a[2] = axis[i + 2].v;
+        a[3] = axis[i + 3].v;
+        cml_math_f64x4_transpose(a);
+        cml_math_sincos(simde_mm256_mul_pd(simde_mm256_loadu_pd(angle + i),
+                                           half), &s, &c);
+        /* Planes (x, y, z, w) become (w, x, y, z) = (c, x s, y s, z s). */
+        a[3] = simde_mm256_mul_pd(a[2], s);
+        a[2] = simde_mm256_mul_pd(a[1], s);
+        a[1] = simde_mm256_mul_pd(a[0], s);
+        a[0] = c;
+        cml_math_f64x4_transpose(a);
+        out[i + 0].q = a[0];
+        out[i + 1].q = a[1];
+        out[i + 2].q = a[2];
+        out[i + 3].q = a[3];
+    }
+    for (; i < n; i++) {
+        out[i] = cml_math_quat_from_axis_angle(axis[i], angle[i]);
+    }
+}
+
+/* Create n quaternions from pitch[i], yaw[i] and roll[i], four at a time
+ * with one vector sincos per angle. */
+static inline void
+cml_math_quat_from_pitch_yaw_roll_array(const f64* pitch, const f64* yaw,
+                                        const f64* roll, quat* out,
+                                        size_t n) {
+    const f64x4 half = simde_mm256_set1_pd(0.5);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        f64x4 s1, c1, s2, c2, s3, c3, q[4];
+        cml_math_sincos(simde_mm256_mul_pd(simde_mm256_loadu_pd(pitch + i),
+                                           half), &s1, &c1);
+        cml_math_sincos(simde_mm256_mul_pd(simde_mm256_loadu_pd(yaw + i),
+                                           half), &s2, &c2);
+        cml_math_sincos(simde_mm256_mul_pd(simde_mm256_loadu_pd(roll + i),
+                                           half), &s3, &c3);
+        const f64x4 cc = simde_mm256_mul_pd(c1, c2);
+        const f64x4 ss = simde_mm256_mul_pd(s1, s2);
+        const f64x4 sc = simde_mm256_mul_pd(s1, c2);
+        const f64x4 cs = simde_mm256_mul_pd(c1, s2);
+        q[0] = simde_mm256_fmadd_pd(cc, c3, simde_mm256_mul_pd(ss, s3));
+        q[1] = simde_mm256_fmsub_pd(sc, c3, simde_mm256_mul_pd(cs, s3));
+        q[2] = simde_mm256_fmadd_pd(cs, c3, simde_mm256_mul_pd(sc, s3));
+        q[3] = simde_mm256_fmsub_pd(cc, s3, simde_mm256_mul_pd(ss, c3));
+        cml_math_f64x4_transpose(q);
+        out[i + 0].q = q[0];
+        out[i + 1].q = q[1];
+        out[i + 2].q = q[2];
+        out[i + 3].q = q[3];
+    }
+    for (; i < n; i++) {
+        out[i] = cml_math_quat_from_pitch_yaw_roll(pitch[i], yaw[i],
+                                                   roll[i]);
+    }
+}
+
+/* Quaternion from matrix. */
+cml_inline quat
+cml_math_quat_from_mat4(const mat4 a) {
+    quat r;
+    f64 tr = a.m[0][0] + a.m[1][1] + a.m[2][2];
+    if (tr > 0.0) {
+        f64 s = sqrt(tr + 1.0);
+        r.q[0] = s * 0.5;
+        s = 0.5 / s;
+        r.q[1] = (a.m[2][1] - a.m[1][2]) * s;
+        r.q[2] = (a.m[0][2] - a.m[2][0]) * s;
+        r.q[3] = (a.m[1][0] - a.m[0][1]) * s;
+    } else {
+        i32 i  = a.m[0][0] < a.m[1][1] ? 
+                (a.m[1][1] < a.m[2][2] ? 2 : 1) : 
+                (a.m[0][0] < a.m[2][2] ? 2 : 0);
+        i32 j = (i + 1) % 3;
+        i32 k = (i + 2) % 3;
+        f64 s = sqrt((a.m[i][i] - (a.m[j][j] + a.m[k][k])) + 1.0);
+        r.q[i + 1] = s * 0.5;
+        s = 0.5 / s;
+        r.q[0]     = (a.m[k][j] - a.m[j][k]) * s;
+        r.q[j + 1] = (a.m[j][i] + a.m[i][j]) * s;
+        r.q[k + 1] = (a.m[k][i] + a.m[i][k]) * s;
+    }
+    return r;
+}
+
+/* Quaternion from vector. */
+cml_inline quat
+cml_math_quat_from_vec4(const vec4 a) {
+    quat r;
+    r.q[0] = a.v[0];
+    r.q[1] = a.v[1];
+    r.q[2] = a.v[2];
+    r.q[3] = a.v[3];
+    return r;
+}
+
+/* Print quaternion. */
+cml_inline void
+cml_math_quat_print(const quat a) {
+    printf("quat(%f, %f, %f, %f)\n", a.q[0], a.q[1], a.q[2], a.q[3]);
+}
+
+/*============================================================================*/
+/* Single-Precision Types                                                     */
+/*============================================================================*/
+
+/* vec2f, vec4f, mat4f and quatf mirror vec2, vec4, mat4 and quat in single
+ * precision, with the same element order and the same function names
+ * carrying an f suffix. Each 4-element value fits one f32x4, so they take
+ * half the memory bandwidth of the f64 types. The conversion functions at
+ * the end of each type section move values between the two families. */
+
+/* Sum of the four lanes of a single-precision vector. */
+cml_inline f32
+cml_math_f32x4_hsum(const f32x4 a) {
+    const f32x4 s = simde_mm_add_ps(a, simde_mm_movehl_ps(a, a));
+    return simde_mm_cvtss_f32(
+           simde_mm_add_ss(s, simde_mm_shuffle_ps(s, s, 0x55)));
+}
+
+/* Sum of the two low lanes of a single-precision vector. */
+cml_inline f32
+cml_math_f32x4_hsum2(const f32x4 a) {
+    return simde_mm_cvtss_f32(
+           simde_mm_add_ss(a, simde_mm_shuffle_ps(a, a, 0x55)));
+}
+
+/* Transposes four f32x4 rows in place. */
+cml_inline void
+cml_math_f32x4_transpose(f32x4 r[4]) {
+    const f32x4 t0 = simde_mm_unpacklo_ps(r[0], r[1]);
+    const f32x4 t1 = simde_mm_unpackhi_ps(r[0], r[1]);
+    const f32x4 t2 = simde_mm_unpacklo_ps(r[2], r[3]);
+    const f32x4 t3 = simde_mm_unpackhi_ps(r[2], r[3]);
+    r[0] = simde_mm_movelh_ps(t0, t2);
+    r[1] = simde_mm_movehl_ps(t2, t0);
+    r[2] = simde_mm_movelh_ps(t1, t3);
+    r[3] = simde_mm_movehl_ps(t3, t1);
+}
+
+/*============================================================================*/
+/* 2D Vector (Single Precision)                                               */
+/*============================================================================*/
+
+/* 2D vector. Only lanes 0 and 1 are meaningful; the set functions clear the
+ * other two and no function reads them. */
+typedef struct vec2f {
+    simde__m128 v;
+} vec2f;
+
+/*--------------------------*/
+/* Initialization Functions */
+/*--------------------------*/
+
+/* Set vector elements individually. */
+cml_inline vec2f
+cml_math_vec2f_set(const f32 x, const f32 y) {
+    vec2f v;
+    v.v = simde_mm_setr_ps(x, y, 0.0f, 0.0f);
+    return v;
+}
+
+/* Set vector elements from an array. */
+cml_inline vec2f
+cml_math_vec2f_set_from_array(const f32* a) {
+    vec2f v;
+    v.v = simde_mm_setr_ps(a[0], a[1], 0.0f, 0.0f);
+    return v;
+}
+
+/* Set vector elements from a scalar. */
+cml_inline vec2f
+cml_math_vec2f_set_from_scalar(const f32 s) {
+    vec2f v;
+    v.v = simde_mm_setr_ps(s, s, 0.0f, 0.0f);
+    return v;
+}
+
+/* Set vector elements from a 2D vector. */
+cml_inline vec2f
+cml_math_vec2f_set_from_vec2f(const vec2f v) {
+    vec2f r;
+    r.v = v.v;
+    return r;
+}
+
+/* Set vector elements to zero. */
+cml_inline vec2f
+cml_math_vec2f_zero(void) {
+    vec2f v;
+    v.v = simde_mm_setzero_ps();
+    return v;
+}
+
+/* Set vector elements to one. */
+cml_inline vec2f
+cml_math_vec2f_one(void) {
+    return cml_math_vec2f_set_from_scalar(1.0f);
+}
+
+/* Set vector elements to infinity. */
+cml_inline vec2f
+cml_math_vec2f_infinity(void) {
+    return cml_math_vec2f_set_from_scalar(HUGE_VALF);
+}
+
+/*----------------------*/
+/* Arithmetic Functions */
+/*----------------------*/
+
+/* Add two vectors. */
+cml_inline vec2f
+cml_math_vec2f_add(const vec2f a, const vec2f b) {
+    vec2f v;
+    v.v = simde_mm_add_ps(a.v, b.v);
+    return v;
+}
+
+/* Add a vector and a scalar. */
+cml_inline vec2f
+cml_math_vec2f_add_scalar(const vec2f a, const f32 b) {
+    vec2f v;
+    v.v = simde_mm_add_ps(a.v, simde_mm_set1_ps(b));
+    return v;
+}
+
+/* Subtract two vectors. */
+cml_inline vec2f
+cml_math_vec2f_sub(const vec2f a, const vec2f b) {
+    vec2f v;
+    v.v = simde_mm_sub_ps(a.v, b.v);
+    return v;
+}
+
+/* Negate a vector. */
+cml_inline vec2f
+cml_math_vec2f_neg(const vec2f a) {
+    vec2f v;
+    v.v = simde_mm_sub_ps(simde_mm_setzero_ps(), a.v);
+    return v;
+}
+
+/* Subtract a vector and a scalar. */
+cml_inline vec2f
+cml_math_vec2f_sub_scalar(const vec2f a, const f32 b) {
+    vec2f v;
+    v.v = simde_mm_sub_ps(a.v, simde_mm_set1_ps(b));
+    return v;
+}
+
+/* Multiply two vectors. */
+cml_inline vec2f
+cml_math_vec2f_mul(const vec2f a, const vec2f b) {
+    vec2f v;
+    v.v = simde_mm_mul_ps(a.v, b.v);
+    return v;
+}
+
+/* Multiply a vector and a scalar. */
+cml_inline vec2f
+cml_math_vec2f_mul_scalar(const vec2f a, const f32 b) {
+    vec2f v;
+    v.v = simde_mm_mul_ps(a.v, simde_mm_set1_ps(b));
+    return v;
+}
+
+/* Divide two vectors. */
+cml_inline vec2f
+cml_math_vec2f_div(const vec2f a, const vec2f b) {
+    vec2f v;
+    v.v = simde_mm_div_ps(a.v, b.v);
+    return v;
+}
+
+/* Divide a vector and a scalar. */
+cml_inline vec2f
+cml_math_vec2f_div_scalar(const vec2f a, const f32 b) {
+    vec2f v;
+    v.v = simde_mm_div_ps(a.v, simde_mm_set1_ps(b));
+    return v;
+}
+
+/* Compute the component-wise minimum of two vectors. */
+cml_inline vec2f
+cml_math_vec2f_min(const vec2f a, const vec2f b) {
+    vec2f r;
+    r.v = simde_mm_min_ps(a.v, b.v);
+    return r;
+}
+
+/* Compute the component-wise maximum of two vectors. */
+cml_inline vec2f
+cml_math_vec2f_max(const vec2f a, const vec2f b) {
+    vec2f r;
+    r.v = simde_mm_max_ps(a.v, b.v);
+    return r;
+}
+
+/* Compute the component-wise absolute value of a vector. */
+cml_inline vec2f
+cml_math_vec2f_abs(const vec2f a) {
+    vec2f r;
+    r.v = simde_mm_andnot_ps(simde_mm_set1_ps(-0.0f), a.v);
+    return r;
+}
+
+/* Compute the component-wise square root of a vector. */
+cml_inline vec2f
+cml_math_vec2f_sqrt(const vec2f a) {
+    vec2f r;
+    r.v = simde_mm_sqrt_ps(a.v);
+    return r;
+}
+
+/* Compute the component-wise reciprocal square root of a vector. */
+cml_inline vec2f
+cml_math_vec2f_rsqrt(const vec2f a) {
+    vec2f r;
+    r.v = simde_mm_div_ps(simde_mm_set1_ps(1.0f), simde_mm_sqrt_ps(a.v));
+    return r;
+}
+
+/* Compute the component-wise reciprocal of a vector. */
+cml_inline vec2f
+cml_math_vec2f_rcp(const vec2f a) {
+    vec2f r;
+    r.v = simde_mm_div_ps(simde_mm_set1_ps(1.0f), a.v);
+    return r;
+}
+
+/* Compute the component-wise square of a vector. */
+cml_inline vec2f
+cml_math_vec2f_square(const vec2f a) {
+    vec2f r;
+    r.v = simde_mm_mul_ps(a.v, a.v);
+    return r;
+}
+
+/* Compute the component-wise cube of a vector. */
+cml_inline vec2f
+cml_math_vec2f_cube(const vec2f a) {
+    vec2f r;
+    r.v = simde_mm_mul_ps(a.v, simde_mm_mul_ps(a.v, a.v));
+    return r;
+}
+
+/* Compute the component-wise exponent of a vector. */
+cml_inline vec2f
+cml_math_vec2f_exp(const vec2f a) {
+    vec2f r;
+    r.v = simde_mm_exp_ps(a.v);
+    return r;
+}
+
+/*----------------------*/
+/* Comparison Functions */
+/*----------------------*/
+
+/* Compare two vectors for equality. */
+cml_inline vec2f
+cml_math_vec2f_is_equal(const vec2f a, const vec2f b) {
+    vec2f v;
+    v.v = simde_mm_cmpeq_ps(a.v, b.v);
+    return v;
+}
+
+/* Compare two vectors for inequality. */
+cml_inline vec2f
+cml_math_vec2f_is_not_equal(const vec2f a, const vec2f b) {
+    vec2f v;
+    v.v = simde_mm_cmpneq_ps(a.v, b.v);
+    return v;
+}
+
+/* Compare two vectors for less than. */
+cml_inline vec2f
+cml_math_vec2f_is_less(const vec2f a, const vec2f b) {
+    vec2f v;
+    v.v = simde_mm_cmplt_ps(a.v, b.v);
+    return v;
+}
+
+/* Compare two vectors for greater than. */
+cml_inline vec2f
+cml_math_vec2f_is_greater(const vec2f a, const vec2f b) {
+    vec2f v;
+    v.v = simde_mm_cmpgt_ps(a.v, b.v);
+    return v;
+}
+
+/*---------------------------*/
+/* Common Graphics Functions */
+/*---------------------------*/
+
+/* Compute the dot product of two vectors. */
+cml_inline f32
+cml_math_vec2f_dot_product(const vec2f a, const vec2f b) {
+    return cml_math_f32x4_hsum2(simde_mm_mul_ps(a.v, b.v));
+}
+
+/* Compute the squared length of a vector. */
+cml_inline f32
+cml_math_vec2f_length_squared(const vec2f v) {
+    return cml_math_vec2f_dot_product(v, v);
+}
+
+/* Compute the length of a vector. */
+cml_inline f32
+cml_math_vec2f_length(const vec2f v) {
+    return sqrtf(cml_math_vec2f_dot_product(v, v));
+}
+
+/* Compute the squared distance between two vectors. */
+cml_inline f32
+cml_math_vec2f_distance_squared(const vec2f a, const vec2f b) {
+    const vec2f d = cml_math_vec2f_sub(a, b);
+    return cml_math_vec2f_dot_product(d, d);
+}
+
+/* Compute the distance between two vectors. */
+cml_inline f32
+cml_math_vec2f_distance(const vec2f a, const vec2f b) {
+    return sqrtf(cml_math_vec2f_distance_squared(a, b));
+}
+
+/* Normalize a vector. */
+cml_inline vec2f
+cml_math_vec2f_normalize(const vec2f v) {
+    return cml_math_vec2f_div_scalar(v, cml_math_vec2f_length(v));
+}
+
+/* Compute the cross product of two vectors, a.x * b.y - a.y * b.x. */
+cml_inline f32
+cml_math_vec2f_cross_product(const vec2f a, const vec2f b) {
+    const f32x4 p = simde_mm_mul_ps(a.v, simde_mm_shuffle_ps(b.v, b.v, 0x01));
+    return simde_mm_cvtss_f32(
+           simde_mm_sub_ss(p, simde_mm_shuffle_ps(p, p, 0x55)));
+}
+
+/* Compute the angle between two vectors. */
+cml_inline f32
+cml_math_vec2f_angle(const vec2f a, const vec2f b) {
+    return acosf(cml_math_vec2f_dot_product(a, b) /
+                 (cml_math_vec2f_length(a) * cml_math_vec2f_length(b)));
+}
+
+/* Reflect a vector about a normal, v - 2 * dot(v, n) * n. */
+cml_inline vec2f
+cml_math_vec2f_reflect(const vec2f v, const vec2f n) {
+    vec2f r;
+    r.v = simde_mm_fnmadd_ps(
+          simde_mm_set1_ps(2.0f * cml_math_vec2f_dot_product(v, n)),
+          n.v, v.v);
+    return r;
+}
+
+/* Compute the projection of a vector onto another vector. */
+cml_inline vec2f
+cml_math_vec2f_project(const vec2f v, const vec2f n) {
+    return cml_math_vec2f_mul_scalar(n, cml_math_vec2f_dot_product(v, n) /
+                                        cml_math_vec2f_dot_product(n, n));
+}
+
+/* Compute the component-wise lerp of two vectors. */
+cml_inline vec2f
+cml_math_vec2f_lerp(const vec2f a, const vec2f b, const f32 t) {
+    vec2f r;
+    r.v = simde_mm_fmadd_ps(simde_mm_sub_ps(b.v, a.v),
+                            simde_mm_set1_ps(t), a.v);
+    return r;
+}
+
+/* Interpolate between two vectors with the smoothstep weight
+ * t * t * (3 - 2 * t). */
+cml_inline vec2f
+cml_math_vec2f_smoothstep(const vec2f a, const vec2f b, const f32 t) {
+    return cml_math_vec2f_lerp(a, b, t * t * (3.0f - 2.0f * t));
+}
+
+/* Compute the component-wise clamp of a vector. */
+cml_inline vec2f
+cml_math_vec2f_clamp(const vec2f v, const vec2f min, const vec2f max) {
+    vec2f r;
+    r.v = simde_mm_min_ps(v.v, max.v);
+    r.v = simde_mm_max_ps(r.v, min.v);
+    return r;
+}
+
+/* Print a vector to stdout. */
+cml_inline void
+cml_math_vec2f_print(const vec2f v) {
+    printf("%f %f ", v.v[0], v.v[1]);
+}
+
+/*----------------------*/
+/* Conversion Functions */
+/*----------------------*/
+
+/* Convert a double-precision vector to single precision. */
+cml_inline vec2f
+cml_math_vec2f_from_vec2(const vec2 a) {
+    vec2f r;
+    r.v = simde_mm_cvtpd_ps(a.v);
+    return r;
+}
+
+/* Convert a single-precision vector to double precision. */
+cml_inline vec2
+cml_math_vec2_from_vec2f(const vec2f a) {
+    vec2 r;
+    r.v = simde_mm_cvtps_pd(a.v);
+    return r;
+}
+
+/*============================================================================*/
+/* 4D Vector (Single Precision)                                               */
+/*============================================================================*/
+
+typedef struct vec4f {
+    simde__m128 v;
+} vec4f;
+
+/* Set vector elements individually. */
+cml_inline vec4f
+cml_math_vec4f_set(const f32 x, const f32 y, const f32 z, const f32 w) {
+    vec4f r;
+    r.v = simde_mm_setr_ps(x, y, z, w);
+    return r;
+}
+
+/* Set vector elements from an array. */
+cml_inline vec4f
+cml_math_vec4f_set_array(const f32 *a) {
+    vec4f r;
+    r.v = simde_mm_loadu_ps(a);
+    return r;
+}
+
+/* Set vector elements from a scalar. */
+cml_inline vec4f
+cml_math_vec4f_set_scalar(const f32 s) {
+    vec4f r;
+    r.v = simde_mm_set1_ps(s);
+    return r;
+}
+
+/* Set vector elements from two 2D vectors. */
+cml_inline vec4f
+cml_math_vec4f_set_vec2f(const vec2f v1, const vec2f v2) {
+    vec4f r;
+    r.v = simde_mm_movelh_ps(v1.v, v2.v);
+    return r;
+}
+
+/* Set vector elements to zero. */
+cml_inline vec4f
+cml_math_vec4f_zero(void) {
+    vec4f r;
+    r.v = simde_mm_setzero_ps();
+    return r;
+}
+
+/* Set vector elements to one. */
+cml_inline vec4f
+cml_math_vec4f_one(void) {
+    vec4f r;
+    r.v = simde_mm_set1_ps(1.0f);
+    return r;
+}
+
+/* Set vector elements to infinity. */
+cml_inline vec4f
+cml_math_vec4f_inf(void) {
+    vec4f r;
+    r.v = simde_mm_set1_ps(HUGE_VALF);
+    return r;
+}
+
+/*----------------------*/
+/* Arithmetic Functions */
+/*----------------------*/
+
+/* Add two vectors. */
+cml_inline vec4f
+cml_math_vec4f_add(const vec4f a, const vec4f b) {
+    vec4f r;
+    r.v = simde_mm_add_ps(a.v, b.v);
+    return r;
+}
+
+/* Add a vector and a scalar. */
+cml_inline vec4f
+cml_math_vec4f_add_scalar(const vec4f v, const f32 s) {
+    vec4f r;
+    r.v = simde_mm_add_ps(v.v, simde_mm_set1_ps(s));
+    return r;
+}
+
+/* Subtract two vectors. */
+cml_inline vec4f
+cml_math_vec4f_sub(const vec4f a, const vec4f b) {
+    vec4f r;
+    r.v = simde_mm_sub_ps(a.v, b.v);
+    return r;
+}
+
+/* Subtract a scalar from a vector. */
+cml_inline vec4f
+cml_math_vec4f_sub_scalar(const vec4f v, const f32 s) {
+    vec4f r;
+    r.v = simde_mm_sub_ps(v.v, simde_mm_set1_ps(s));
+    return r;
+}
+
+/* Negate a vector. */
+cml_inline vec4f
+cml_math_vec4f_neg(const vec4f v) {
+    vec4f r;
+    r.v = simde_mm_sub_ps(simde_mm_setzero_ps(), v.v);
+    return r;
+}
+
+/* Multiply two vectors. */
+cml_inline vec4f
+cml_math_vec4f_mul(const vec4f a, const vec4f b) {
+    vec4f r;
+    r.v = simde_mm_mul_ps(a.v, b.v);
+    return r;
+}
+
+/* Multiply a vector and a scalar. */
+cml_inline vec4f
+cml_math_vec4f_mul_scalar(const vec4f v, const f32 s) {
+    vec4f r;
+    r.v = simde_mm_mul_ps(v.v, simde_mm_set1_ps(s));
+    return r;
+}
+
+/* Divide two vectors. */
+cml_inline vec4f
+cml_math_vec4f_div(const vec4f a, const vec4f b) {
+    vec4f r;
+    r.v = simde_mm_div_ps(a.v, b.v);
+    return r;
+}
+
+/* Divide a vector by a scalar. */
+cml_inline vec4f
+cml_math_vec4f_div_scalar(const vec4f v, const f32 s) {
+    vec4f r;
+    r.v = simde_mm_div_ps(v.v, simde_mm_set1_ps(s));
+    return r;
+}
+
+/* Compute the reciprocal of a vector. */
+cml_inline vec4f
+cml_math_vec4f_rcp(const vec4f v) {
+    vec4f r;
+    r.v = simde_mm_div_ps(simde_mm_set1_ps(1.0f), v.v);
+    return r;
+}
+
+/* Compute the square root of a vector. */
+cml_inline vec4f
+cml_math_vec4f_sqrt(const vec4f v) {
+    vec4f r;
+    r.v = simde_mm_sqrt_ps(v.v);
+    return r;
+}
+
+/* Compute the reciprocal square root of a vector. */
+cml_inline vec4f
+cml_math_vec4f_rsqrt(const vec4f v) {
+    vec4f r;
+    r.v = simde_mm_div_ps(simde_mm_set1_ps(1.0f), simde_mm_sqrt_ps(v.v));
+    return r;
+}
+
+/* Compute the absolute value of a vector. */
+cml_inline vec4f
+cml_math_vec4f_abs(const vec4f v) {
+    vec4f r;
+    r.v = simde_mm_andnot_ps(simde_mm_set1_ps(-0.0f), v.v);
+    return r;
+}
+
+/* Compute the minimum of two vectors. */
+cml_inline vec4f
+cml_math_vec4f_min(const vec4f a, const vec4f b) {
+    vec4f r;
+    r.v = simde_mm_min_ps(a.v, b.v);
+    return r;
+}
+
+/* Compute the maximum of two vectors. */
+cml_inline vec4f
+cml_math_vec4f_max(const vec4f a, const vec4f b) {
+    vec4f r;
+    r.v = simde_mm_max_ps(a.v, b.v);
+    return r;
+}
+
+/*----------------------*/
+/* Comparison Functions */
+/*----------------------*/
+
+/* Compare two vectors for equality. */
+cml_inline vec4f
+cml_math_vec4f_is_equal(const vec4f a, const vec4f b) {
+    vec4f r;
+    r.v = simde_mm_cmpeq_ps(a.v, b.v);
+    return r;
+}
+
+/* Compare two vectors for inequality. */
+cml_inline vec4f
+cml_math_vec4f_is_not_equal(const vec4f a, const vec4f b) {
+    vec4f r;
+    r.v = simde_mm_cmpneq_ps(a.v, b.v);
+    return r;
+}
+
+/* Compare two vectors for less than. */
+cml_inline vec4f
+cml_math_vec4f_is_less(const vec4f a, const vec4f b) {
+    vec4f r;
+    r.v = simde_mm_cmplt_ps(a.v, b.v);
+    return r;
+}
+
+/* Compare two vectors for greater than. */
+cml_inline vec4f
+cml_math_vec4f_is_greater(const vec4f a, const vec4f b) {
+    vec4f r;
+    r.v = simde_mm_cmpgt_ps(a.v, b.v);
+    return r;
+}
+
+/*---------------------------*/
+/* Common Graphics Functions */
+/*---------------------------*/
+
+/* Compute the dot product of two vectors. */
+cml_inline f32
+cml_math_vec4f_dot_product(const vec4f a, const vec4f b) {
+    return cml_math_f32x4_hsum(simde_mm_mul_ps(a.v, b.v));
+}
+
+/* Returns the cross product of the xyz parts of two vectors, with w = 0. */
+cml_inline vec4f
+cml_math_vec4f_cross_product(const vec4f a, const vec4f b) {
+    const f32x4 c = simde_mm_fmsub_ps(a.v,
+                    simde_mm_shuffle_ps(b.v, b.v, 0xC9),
+                    simde_mm_mul_ps(simde_mm_shuffle_ps(a.v, a.v, 0xC9),
+                                    b.v));
+    vec4f r;
+    /* The FMA leaves the rounding error of a.w * b.w in lane 3. */
+    r.v = simde_mm_blend_ps(simde_mm_shuffle_ps(c, c, 0xC9),
+                            simde_mm_setzero_ps(), 0x8);
+    return r;
+}
+
+/* Compute the length of a vector. */
+cml_inline f32
+cml_math_vec4f_length(const vec4f v) {
+    return sqrtf(cml_math_vec4f_dot_product(v, v));
+}
+
+/* Compute the squared length of a vector. */
+cml_inline f32
+cml_math_vec4f_length_squared(const vec4f v) {
+    return cml_math_vec4f_dot_product(v, v);
+}
+
+/* Normalize a vector. */
+cml_inline vec4f
+cml_math_vec4f_normalize(const vec4f v) {
+    return cml_math_vec4f_div_scalar(v, cml_math_vec4f_length(v));
+}
+
+/* Compute the distance between two vectors. */
+cml_inline f32
+cml_math_vec4f_distance(const vec4f a, const vec4f b) {
+    return cml_math_vec4f_length(cml_math_vec4f_sub(a, b));
+}
+
+/* Compute the squared distance between two vectors. */
+cml_inline f32
+cml_math_vec4f_distance_squared(const vec4f a, const vec4f b) {
+    return cml_math_vec4f_length_squared(cml_math_vec4f_sub(a, b));
+}
+
+/* Compute the linear interpolation between two vectors. */
+cml_inline vec4f
+cml_math_vec4f_lerp(const vec4f a, const vec4f b, const f32 t) {
+    vec4f r;
+    r.v = simde_mm_fmadd_ps(simde_mm_sub_ps(b.v, a.v),
+                            simde_mm_set1_ps(t), a.v);
+    return r;
+}
+
+/* Compute the reflection of a vector about a normal,
+ * v - 2 * dot(v, n) * n. */
+cml_inline vec4f
+cml_math_vec4f_reflect(const vec4f v, const vec4f n) {
+    vec4f r;
+    r.v = simde_mm_fnmadd_ps(
+          simde_mm_set1_ps(2.0f * cml_math_vec4f_dot_product(v, n)),
+          n.v, v.v);
+    return r;
+}
+
+/* Compute the refraction of a vector. */
+cml_inline vec4f
+cml_math_vec4f_refract(const vec4f v, const vec4f n, const f32 eta) {
+    const f32 d = cml_math_vec4f_dot_product(v, n);
+    const f32 k = 1.0f - eta * eta * (1.0f - d * d);
+    vec4f r;
+    if (k < 0.0f) {
+        r.v = simde_mm_setzero_ps();
+    } else {
+        r.v = simde_mm_fmadd_ps(simde_mm_set1_ps(eta), v.v,
+              simde_mm_mul_ps(simde_mm_set1_ps(eta * d - sqrtf(k)), n.v));
+    }
+    return r;
+}
+
+/* Angle between two vectors. */
+cml_inline f32
+cml_math_vec4f_angle(const vec4f a, const vec4f b) {
+    return acosf(cml_math_vec4f_dot_product(a, b) /
+                 (cml_math_vec4f_length(a) * cml_math_vec4f_length(b)));
+}
+
+/* Print a vector. */
+cml_inline void
+cml_math_vec4f_print(const vec4f v) {
+    printf("%f %f %f %f ", v.v[0], v.v[1], v.v[2], v.v[3]);
+}
+
+/*----------------------*/
+/* Conversion Functions */
+/*----------------------*/
+
+/* Convert a double-precision vector to single precision. */
+cml_inline vec4f
+cml_math_vec4f_from_vec4(const vec4 a) {
+    vec4f r;
+    r.v = simde_mm256_cvtpd_ps(a.v);
+    return r;
+}
+
+/* Convert a single-precision vector to double precision. */
+cml_inline vec4
+cml_math_vec4_from_vec4f(const vec4f a) {
+    vec4 r;
+    r.v = simde_mm256_cvtps_pd(a.v);
+    return r;
+}
+
+/* Convert n vectors to single precision. */
+cml_inline void
+cml_math_vec4f_from_vec4_array(vec4f* dst, const vec4* src, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        simde_mm_storeu_ps((f32*)(dst + i),
+                           simde_mm256_cvtpd_ps(
+                           simde_mm256_loadu_pd((const f64*)(src + i))));
+    }
+}
+
+/* Convert n vectors to double precision. */
+cml_inline void
+cml_math_vec4_from_vec4f_array(vec4* dst, const vec4f* src, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        simde_mm256_storeu_pd((f64*)(dst + i),
+                              simde_mm256_cvtps_pd(
+                              simde_mm_loadu_ps((const f32*)(src + i))));
+    }
+}
+
+/*============================================================================*/
+/* 4x4 Matrix (Single Precision)                                              */
+/*============================================================================*/
+
+/* Four f32x4 rows, with m[i][j] the element in row i and column j, in the
+ * same row-vector convention and row-major storage as mat4. */
+typedef struct mat4f {
+    simde__m128 m[4];
+} mat4f;
+
+_Static_assert(sizeof(mat4f) == 16 * sizeof(f32),
+               "mat4f must be 16 packed f32");
+
+/*----------------------*/
+/* Conversion Functions */
+/*----------------------*/
+
+/* Convert a double-precision matrix to single precision. */
+cml_inline mat4f
+cml_math_mat4f_from_mat4(const mat4 a) {
+    mat4f r;
+    r.m[0] = simde_mm256_cvtpd_ps(a.m[0]);
+    r.m[1] = simde_mm256_cvtpd_ps(a.m[1]);
+    r.m[2] = simde_mm256_cvtpd_ps(a.m[2]);
+    r.m[3] = simde_mm256_cvtpd_ps(a.m[3]);
+    return r;
+}
+
+/* Convert a single-precision matrix to double precision. */
+cml_inline mat4
+cml_math_mat4_from_mat4f(const mat4f a) {
+    mat4 r;
+    r.m[0] = simde_mm256_cvtps_pd(a.m[0]);
+    r.m[1] = simde_mm256_cvtps_pd(a.m[1]);
+    r.m[2] = simde_mm256_cvtps_pd(a.m[2]);
+    r.m[3] = simde_mm256_cvtps_pd(a.m[3]);
+    return r;
+}
+
+/*------------------*/
+/* Matrix Functions */
+/*------------------*/
+
+/* Create a 4x4 matrix. */
+cml_inline mat4f
+cml_math_mat4f(const f32 m00, const f32 m01, const f32 m02, const f32 m03,
+               const f32 m10, const f32 m11, const f32 m12, const f32 m13,
+               const f32 m20, const f32 m21, const f32 m22, const f32 m23,
+               const f32 m30, const f32 m31, const f32 m32, const f32 m33) {
+    mat4f r;
+    r.m[0] = simde_mm_setr_ps(m00, m01, m02, m03);
+    r.m[1] = simde_mm_setr_ps(m10, m11, m12, m13);
+    r.m[2] = simde_mm_setr_ps(m20, m21, m22, m23);
+    r.m[3] = simde_mm_setr_ps(m30, m31, m32, m33);
+    return r;
+}
+
+/* Add two matrices. */
+cml_inline mat4f
+cml_math_mat4f_add(const mat4f a, const mat4f b) {
+    mat4f r;
+    r.m[0] = simde_mm_add_ps(a.m[0], b.m[0]);
+    r.m[1] = simde_mm_add_ps(a.m[1], b.m[1]);
+    r.m[2] = simde_mm_add_ps(a.m[2], b.m[2]);
+    r.m[3] = simde_mm_add_ps(a.m[3], b.m[3]);
+    return r;
+}
+
+/* Subtract two matrices. */
+cml_inline mat4f
+cml_math_mat4f_sub(const mat4f a, const mat4f b) {
+    mat4f r;
+    r.m[0] = simde_mm_sub_ps(a.m[0], b.m[0]);
+    r.m[1] = simde_mm_sub_ps(a.m[1], b.m[1]);
+    r.m[2] = simde_mm_sub_ps(a.m[2], b.m[2]);
+    r.m[3] = simde_mm_sub_ps(a.m[3], b.m[3]);
+    return r;
+}
+
+/* Multiply two matrices, broadcasting each row of a with shuffles. */
+cml_inline mat4f
+cml_math_mat4f_mul(const mat4f a, const mat4f b) {
+    mat4f r;
+    for (int i = 0; i < 4; i++) {
+        r.m[i] = simde_mm_mul_ps(
+                 simde_mm_shuffle_ps(a.m[i], a.m[i], 0x00), b.m[0]);
+        r.m[i] = simde_mm_fmadd_ps(
+                 simde_mm_shuffle_ps(a.m[i], a.m[i], 0x55), b.m[1], r.m[i]);
+        r.m[i] = simde_mm_fmadd_ps(
+                 simde_mm_shuffle_ps(a.m[i], a.m[i], 0xAA), b.m[2], r.m[i]);
+        r.m[i] = simde_mm_fmadd_ps(
+                 simde_mm_shuffle_ps(a.m[i], a.m[i], 0xFF), b.m[3], r.m[i]);
+    }
+    return r;
+}
+
+/* Multiply a matrix by a scalar. */
+cml_inline mat4f
+cml_math_mat4f_mul_scalar(const mat4f a, const f32 s) {
+    const f32x4 v = simde_mm_set1_ps(s);
+    mat4f r;
+    r.m[0] = simde_mm_mul_ps(a.m[0], v);
+    r.m[1] = simde_mm_mul_ps(a.m[1], v);
+    r.m[2] = simde_mm_mul_ps(a.m[2], v);
+    r.m[3] = simde_mm_mul_ps(a.m[3], v);
+    return r;
+}
+
+/* Identity matrix. */
+cml_inline mat4f
+cml_math_mat4f_identity(void) {
+    mat4f r;
+    r.m[0] = simde_mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    r.m[1] = simde_mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+    r.m[2] = simde_mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+    r.m[3] = simde_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+    return r;
+}
+
+/* Translation matrix. */
+cml_inline mat4f
+cml_math_mat4f_translation(const f32 x, const f32 y, const f32 z) {
+    mat4f r = cml_math_mat4f_identity();
+    r.m[3] = simde_mm_setr_ps(x, y, z, 1.0f);
+    return r;
+}
+
+/* Scaling matrix. */
+cml_inline mat4f
+cml_math_mat4f_scaling(const f32 x, const f32 y, const f32 z) {
+    mat4f r;
+    r.m[0] = simde_mm_setr_ps(x, 0.0f, 0.0f, 0.0f);
+    r.m[1] = simde_mm_setr_ps(0.0f, y, 0.0f, 0.0f);
+    r.m[2] = simde_mm_setr_ps(0.0f, 0.0f, z, 0.0f);
+    r.m[3] = simde_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+    return r;
+}
+
+/* Transpose of matrix. */
+cml_inline mat4f
+cml_math_mat4f_transpose(const mat4f a) {
+    mat4f r = a;
+    cml_math_f32x4_transpose(r.m);
+    return r;
+}
+
+/* Rotation matrix turning row vectors counterclockwise by angle about the
+ * unit axis (x, y, z), the same rotation as cml_math_quatf_from_axis_angle. */
+cml_inline mat4f
+cml_math_mat4f_rotation(const f32 x, const f32 y, const f32 z,
+                        const f32 angle) {
+    const f32 c = cosf(angle);
+    const f32 s = sinf(angle);
+    const f32 t = 1.0f - c;
+    mat4f r;
+    r.m[0] = simde_mm_setr_ps(c + x * x * t,
+                                  x * y * t + z * s,
+                                  x * z * t - y * s, 0.0f);
+    r.m[1] = simde_mm_setr_ps(x * y * t - z * s,
+                              c + y * y * t,
+                              y * z * t + x * s, 0.0f);
+    r.m[2] = simde_mm_setr_ps(x * z * t + y * s,
+                              y * z * t - x * s,
+                              c + z * z * t, 0.0f);
+    r.m[3] = simde_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+    return r;
+}
+
+/* Determinant of matrix. Evaluated in double precision, where the
+ * cofactor expansion does not lose digits to cancellation. */
+cml_inline f32
+cml_math_mat4f_determinant(const mat4f a) {
+    return (f32)cml_math_mat4_determinant(cml_math_mat4_from_mat4f(a));
+}
+
+/* Inverse of matrix, evaluated in double precision like the determinant. */
+cml_inline mat4f
+cml_math_mat4f_inverse(const mat4f a) {
+    return cml_math_mat4f_from_mat4(
+           cml_math_mat4_inverse(cml_math_mat4_from_mat4f(a)));
+}
+
+/* Perspective projection matrix. */
+cml_inline mat4f
+cml_math_mat4f_perspective(const f32 fov,  const f32 aspect,
+                           const f32 near, const f32 far) {
+    return cml_math_mat4f_from_mat4(
+           cml_math_mat4_perspective(fov, aspect, near, far));
+}
+
+/* Orthographic projection matrix. */
+cml_inline mat4f
+cml_math_mat4f_ortho(const f32 left,   const f32 right,
+                     const f32 bottom, const f32 top,
+                     const f32 near,   const f32 far) {
+    return cml_math_mat4f_from_mat4(
+           cml_math_mat4_ortho(left, right, bottom, top, near, far));
+}
+
+/* Look at matrix. */
+cml_inline mat4f
+cml_math_mat4f_look_at(const vec4f eye, const vec4f center, const vec4f up) {
+    return cml_math_mat4f_from_mat4(
+           cml_math_mat4_look_at(cml_math_vec4_from_vec4f(eye),
+                                 cml_math_vec4_from_vec4f(center),
+                                 cml_math_vec4_from_vec4f(up)));
+}
+
+/*------------------------------*/
+/* Matrix-Vector Transformation */
+/*------------------------------*/
+
+/* Transform a 4D vector by a matrix, v * m. */
+cml_inline vec4f
+cml_math_mat4f_mul_vec4f(const mat4f m, const vec4f v) {
+    vec4f r;
+    r.v = simde_mm_mul_ps(simde_mm_shuffle_ps(v.v, v.v, 0x00), m.m[0]);
+    r.v = simde_mm_fmadd_ps(simde_mm_shuffle_ps(v.v, v.v, 0x55), m.m[1], r.v);
+    r.v = simde_mm_fmadd_ps(simde_mm_shuffle_ps(v.v, v.v, 0xAA), m.m[2], r.v);
+    r.v = simde_mm_fmadd_ps(simde_mm_shuffle_ps(v.v, v.v, 0xFF), m.m[3], r.v);
+    return r;
+}
+
+/* Transform n points by a matrix, writing out[i] = in[i] * m, with each
+ * element broadcast straight from memory. in and out may point to the same
+ * array. */
+cml_inline void
+cml_math_mat4f_transform_points(const mat4f* m, const vec4f* in, vec4f* out,
+                                size_t n) {
+    const simde__m128 r0 = m->m[0];
+    const simde__m128 r1 = m->m[1];
+    const simde__m128 r2 = m->m[2];
+    const simde__m128 r3 = m->m[3];
+    const f32* src = (const f32*)in;
+    f32*       dst = (f32*)out;
+    for (size_t i = 0; i < n; i++, src += 4, dst += 4) {
+        simde__m128 p;
+        p = simde_mm_mul_ps(simde_mm_set1_ps(src[0]), r0);
+        p = simde_mm_fmadd_ps(simde_mm_set1_ps(src[1]), r1, p);
+        p = simde_mm_fmadd_ps(simde_mm_set1_ps(src[2]), r2, p);
+        p = simde_mm_fmadd_ps(simde_mm_set1_ps(src[3]), r3, p);
+        simde_mm_storeu_ps(dst, p);
+    }
+}
+
+/* Print matrix in a row-major format. */
+cml_inline void
+cml_math_mat4f_print(const mat4f m) {
+    for (int i = 0; i < 4; i++) {
+        printf("%f %f %f %f\n", m.m[i][0], m.m[i][1], m.m[i][2], m.m[i][3]);
+    }
+}
+
+/*-------------------*/
+/* Storage Functions */
+/*-------------------*/
+
+/* Returns the elements of an array of matrices as packed row-major f32,
+ * without copying. */
+cml_inline const f32*
+cml_math_mat4f_data(const mat4f* m) {
+    return (const f32*)m;
+}
+
+/* Write n matrices to dst as 16 packed f32 each, in the given order. */
+static inline void
+cml_math_mat4f_to_f32_array(f32* dst, const mat4f* src, const size_t n,
+                            const cml_matrix_order order) {
+    if (order == CML_ROW_MAJOR) {
+        memcpy(dst, src, n * sizeof(mat4f));
+        return;
+    }
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+    const simde__m512i t = simde_mm512_set_epi32(15, 11, 7, 3, 14, 10, 6, 2,
+                                                 13, 9, 5, 1, 12, 8, 4, 0);
+    for (size_t i = 0; i < n; i++, dst += 16) {
+        const f32x16 v = simde_mm512_loadu_ps((const f32*)(src + i));
+        simde_mm512_storeu_ps(dst, simde_mm512_permutexvar_ps(t, v));
+    }
+#else
+    for (size_t i = 0; i < n; i++, dst += 16) {
+        f32x4 r[4] = {src[i].m[0], src[i].m[1], src[i].m[2], src[i].m[3]};
+        cml_math_f32x4_transpose(r);
+        simde_mm_storeu_ps(dst +  0, r[0]);
+        simde_mm_storeu_ps(dst +  4, r[1]);
+        simde_mm_storeu_ps(dst +  8, r[2]);
+        simde_mm_storeu_ps(dst + 12, r[3]);
+    }
+#endif
+}
+
+/* Read n matrices of 16 packed f32 each, in the given order, from src. */
+static inline void
+cml_math_mat4f_from_f32_array(mat4f* dst, const f32* src, const size_t n,
+                              const cml_matrix_order order) {
+    if (order == CML_ROW_MAJOR) {
+        memcpy(dst, src, n * sizeof(mat4f));
+        return;
+    }
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+    const simde__m512i t = simde_mm512_set_epi32(15, 11, 7, 3, 14, 10, 6, 2,
+                                                 13, 9, 5, 1, 12, 8, 4, 0);
+    for (size_t i = 0; i < n; i++, src += 16) {
+        const f32x16 v = simde_mm512_loadu_ps(src);
+        simde_mm512_storeu_ps((f32*)(dst + i),
+                              simde_mm512_permutexvar_ps(t, v));
+    }
+#else
+    for (size_t i = 0; i < n; i++, src += 16) {
+        dst[i].m[0] = simde_mm_loadu_ps(src +  0);
+        dst[i].m[1] = simde_mm_loadu_ps(src +  4);
+        dst[i].m[2] = simde_mm_loadu_ps(src +  8);
+        dst[i].m[3] = simde_mm_loadu_ps(src + 12);
+        cml_math_f32x4_transpose(dst[i].m);
+    }
+#endif
+}
+
+/*============================================================================*/
+/* Quaternion (Single Precision)                                              */
+/*============================================================================*/
+
+/* Quaternion, lanes (w, x, y, z) as in quat. */
+typedef struct quatf {
+    simde__m128 q;
+} quatf;
+
+/* Convert a double-precision quaternion to single precision. */
+cml_inline quatf
+cml_math_quatf_from_quat(const quat a) {
+    quatf r;
+    r.q = simde_mm256_cvtpd_ps(a.q);
+    return r;
+}
+
+/* Convert a single-precision quaternion to double precision. */
+cml_inline quat
+cml_math_quat_from_quatf(const quatf a) {
+    quat r;
+    r.q = simde_mm256_cvtps_pd(a.q);
+    return r;
+}
+
+/* Quaternion identity. */
+cml_inline quatf
+cml_math_quatf_identity(void) {
+    quatf r;
+    r.q = simde_mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    return r;
+}
+
+/* Quaternion addition. */
+cml_inline quatf
+cml_math_quatf_add(const quatf a, const quatf b) {
+    quatf r;
+    r.q = simde_mm_add_ps(a.q, b.q);
+    return r;
+}
+
+/* Quaternion subtraction. */
+cml_inline quatf
+cml_math_quatf_sub(const quatf a, const quatf b) {
+    quatf r;
+    r.q = simde_mm_sub_ps(a.q, b.q);
+    return r;
+}
+
+/* Quaternion multiplication, the Hamilton product a * b. Each component
+ * of a scales a shuffled, sign-flipped copy of b. */
+cml_inline quatf
+cml_math_quatf_mul(const quatf a, const quatf b) {
+    const f32x4 bx = simde_mm_xor_ps(simde_mm_shuffle_ps(b.q, b.q, 0xB1),
+                     simde_mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f));
+    const f32x4 by = simde_mm_xor_ps(simde_mm_shuffle_ps(b.q, b.q, 0x4E),
+                     simde_mm_setr_ps(-0.0f, 0.0f, 0.0f, -0.0f));
+    const f32x4 bz = simde_mm_xor_ps(simde_mm_shuffle_ps(b.q, b.q, 0x1B),
+                     simde_mm_setr_ps(-0.0f, -0.0f, 0.0f, 0.0f));
+    quatf r;
+    r.q = simde_mm_mul_ps(simde_mm_shuffle_ps(a.q, a.q, 0x00), b.q);
+    r.q = simde_mm_fmadd_ps(simde_mm_shuffle_ps(a.q, a.q, 0x55), bx, r.q);
+    r.q = simde_mm_fmadd_ps(simde_mm_shuffle_ps(a.q, a.q, 0xAA), by, r.q);
+    r.q = simde_mm_fmadd_ps(simde_mm_shuffle_ps(a.q, a.q, 0xFF), bz, r.q);
+    return r;
+}
+
+/* Quaternion negation. */
+cml_inline quatf
+cml_math_quatf_neg(const quatf a) {
+    quatf r;
+    r.q = simde_mm_sub_ps(simde_mm_setzero_ps(), a.q);
+    return r;
+}
+
+/* Quaternion conjugation. */
+cml_inline quatf
+cml_math_quatf_conjugate(const quatf a) {
+    quatf r;
+    r.q = simde_mm_xor_ps(a.q, simde_mm_setr_ps(0.0f, -0.0f, -0.0f, -0.0f));
+    return r;
+}
+
+/* Quaternion length. */
+cml_inline f32
+cml_math_quatf_length(const quatf a) {
+    return sqrtf(cml_math_f32x4_hsum(simde_mm_mul_ps(a.q, a.q)));
+}
+
+/* Quaternion inverse, the conjugate divided by the squared length. */
+cml_inline quatf
+cml_math_quatf_inverse(const quatf a) {
+    quatf r = cml_math_quatf_conjugate(a);
+    r.q = simde_mm_div_ps(r.q, simde_mm_set1_ps(
+          cml_math_f32x4_hsum(simde_mm_mul_ps(a.q, a.q))));
+    return r;
+}
+
+/* Quaternion normalization. */
+cml_inline quatf
+cml_math_quatf_normalize(const quatf a) {
+    quatf r;
+    r.q = simde_mm_div_ps(a.q, simde_mm_set1_ps(cml_math_quatf_length(a)));
+    return r;
+}
+
+/* Quaternion rotation of a vector by a unit quaternion, as
+ * cml_math_quat_rotate. */
+cml_inline vec4f
+cml_math_quatf_rotate(const quatf a, const vec4f b) {
+    const f32x4 u    = simde_mm_shuffle_ps(a.q, a.q, 0x39);
+    const f32x4 uyzx = simde_mm_shuffle_ps(a.q, a.q, 0x1E);
+    const f32x4 w    = simde_mm_shuffle_ps(a.q, a.q, 0x00);
+    f32x4 t = simde_mm_fmsub_ps(u, simde_mm_shuffle_ps(b.v, b.v, 0xC9),
+                                simde_mm_mul_ps(uyzx, b.v));
+    t = simde_mm_mul_ps(simde_mm_set1_ps(2.0f),
+                        simde_mm_shuffle_ps(t, t, 0xC9));
+    t = simde_mm_blend_ps(t, simde_mm_setzero_ps(), 0x8);
+    f32x4 c = simde_mm_fmsub_ps(u, simde_mm_shuffle_ps(t, t, 0xC9),
+                                simde_mm_mul_ps(uyzx, t));
+    c = simde_mm_shuffle_ps(c, c, 0xC9);
+    vec4f r;
+    r.v = simde_mm_add_ps(simde_mm_fmadd_ps(w, t, b.v), c);
+    return r;
+}
+
+/* Normalized linear interpolation along the shorter arc. */
+cml_inline quatf
+cml_math_quatf_nlerp(const quatf a, const quatf b, const f32 t) {
+    const f32 d = cml_math_f32x4_hsum(simde_mm_mul_ps(a.q, b.q));
+    const f32x4 bq = d < 0.0f ? simde_mm_sub_ps(simde_mm_setzero_ps(), b.q)
+                              : b.q;
+    quatf r;
+    r.q = simde_mm_fmadd_ps(simde_mm_sub_ps(bq, a.q), simde_mm_set1_ps(t),
+                            a.q);
+    return cml_math_quatf_normalize(r);
+}
+
+/* Spherical linear interpolation along the shorter arc. */
+cml_inline quatf
+cml_math_quatf_slerp(const quatf a, const quatf b, const f32 t) {
+    f32 d = cml_math_f32x4_hsum(simde_mm_mul_ps(a.q, b.q));
+    f32x4 bq = b.q;
+    if (d < 0.0f) {
+        d  = -d;
+        bq = simde_mm_sub_ps(simde_mm_setzero_ps(), bq);
+    }
+    if (d > (f32)CML_QUAT_SLERP_THRESHOLD) {
+        quatf r;
+        r.q = simde_mm_fmadd_ps(simde_mm_sub_ps(bq, a.q),
+                                simde_mm_set1_ps(t), a.q);
+        return cml_math_quatf_normalize(r);
+    }
+    const f32 theta = acosf(d);
+    const f32 s     = 1.0f / sinf(theta);
+    quatf r;
+    r.q = simde_mm_fmadd_ps(a.q,
+          simde_mm_set1_ps(sinf((1.0f - t) * theta) * s),
+          simde_mm_mul_ps(bq, simde_mm_set1_ps(sinf(t * theta) * s)));
+    return r;
+}
+
+/* Quaternion to matrix. */
+cml_inline mat4f
+cml_math_quatf_to_mat4f(const quatf a) {
+    return cml_math_mat4f_from_mat4(
+           cml_math_quat_to_mat4(cml_math_quat_from_quatf(a)));
+}
+
+/* Quaternion to vector. */
+cml_inline vec4f
+cml_math_quatf_to_vec4f(const quatf a) {
+    vec4f r;
+    r.v = a.q;
+    return r;
+}
+
+/* Pitch from quaternion. */
+cml_inline f32
+cml_math_quatf_pitch(const quatf a) {
+    return (f32)cml_math_quat_pitch(cml_math_quat_from_quatf(a));
+}
+
+/* Yaw from quaternion. */
+cml_inline f32
+cml_math_quatf_yaw(const quatf a) {
+    return (f32)cml_math_quat_yaw(cml_math_quat_from_quatf(a));
+}
+
+/* Roll from quaternion. */
+cml_inline f32
+cml_math_quatf_roll(const quatf a) {
+    return (f32)cml_math_quat_roll(cml_math_quat_from_quatf(a));
+}
+
+/* Quaternion from pitch, yaw and roll. */
+cml_inline quatf
+cml_math_quatf_from_pitch_yaw_roll(const f32 pitch, const f32 yaw,
+                                   const f32 roll) {
+    return cml_math_quatf_from_quat(
+           cml_math_quat_from_pitch_yaw_roll(pitch, yaw, roll));
+}
+
+/* Quaternion from axis and angle. */
+cml_inline quatf
+cml_math_quatf_from_axis_angle(const vec4f axis, const f32 angle) {
+    const f32 s = sinf(angle * 0.5f);
+    quatf r;
+    r.q = simde_mm_mul_ps(simde_mm_shuffle_ps(axis.v, axis.v, 0x90),
+                          simde_mm_set1_ps(s));
+    r.q = simde_mm_move_ss(r.q, simde_mm_set_ss(cosf(angle * 0.5f)));
+    return r;
+}
+
+/* Quaternion from matrix. */
+cml_inline quatf
+cml_math_quatf_from_mat4f(const mat4f a) {
+    return cml_math_quatf_from_quat(
+           cml_math_quat_from_mat4(cml_math_mat4_from_mat4f(a)));
+}
+
+/* Quaternion from vector. */
+cml_inline quatf
+cml_math_quatf_from_vec4f(const vec4f a) {
+    quatf r;
+    r.q = a.v;
+    return r;
+}
+
+/* Print quaternion. */
+cml_inline void
+cml_math_quatf_print(const quatf a) {
+    printf("quatf(%f, %f, %f, %f)\n", a.q[0], a.q[1], a.q[2], a.q[3]);
+}
+
+/*============================================================================*/
+/* Structure-of-Arrays Streams                                                */
+/*============================================================================*/
+
+/* Alignment, in bytes, of every plane allocated by the SoA stream types. */
+#define CML_SOA_ALIGNMENT 64
+
+/* Stream of 4D vectors stored as separate x, y, z and w planes. Kernels work
+ * on one component of several vectors per instruction, so reductions such as
+ * the dot product need no horizontal adds. */
+typedef struct vec4_soa {
+    f64*   x;
+    f64*   y;
+    f64*   z;
+    f64*   w;
+    size_t n;
+} vec4_soa;
+
+/* Stream of quaternions stored as separate w, x, y and z planes, in the same
+ * component order as the lanes of quat. */
+typedef struct quat_soa {
+    f64*   w;
+    f64*   x;
+    f64*   y;
+    f64*   z;
+    size_t n;
+} quat_soa;
+
+/* Stream of 4x4 matrices stored as sixteen planes, one per element: element
+ * (r, c) of matrix i is m[4 * r + c][i]. Each instruction then works on the
+ * same element of several matrices, so batch kernels are straight-line code
+ * with no shuffles or lane extraction. */
+typedef struct mat4_soa {
+    f64*   m[16];
+    size_t n;
+} mat4_soa;
+
+/* Stream of 4D vectors in single precision, laid out like vec4_soa. It halves
+ * the memory traffic of bounds that do not need f64, such as culling
+ * inputs. */
+typedef struct vec4f_soa {
+    f32*   x;
+    f32*   y;
+    f32*   z;
+    f32*   w;
+    size_t n;
+} vec4f_soa;
+
+/*-------------------------*/
+/* Shared Layout Functions */
+/*-------------------------*/
+
+/* Allocates count 64-byte aligned planes of n elements in one block. The
+ * planes are padded to an odd number of cache lines so each one starts
+ * aligned and no two start in the same L1 set, which a power-of-two n would
+ * otherwise cause for every plane at once. Returns NULL for every plane if
+ * the allocation failed. */
+cml_inline void
+cml_math_soa_alloc_plane_set(f64** p, const size_t count, const size_t n) {
+    const size_t per_line = CML_SOA_ALIGNMENT / sizeof(f64);
+    const size_t lines    = (n + per_line - 1) / per_line;
+    const size_t stride   = (lines > 0 ? lines | 1 : 0) * per_line;
+    f64* base = stride > 0 ? (f64*)cml_aligned_alloc(CML_SOA_ALIGNMENT,
+                              count * stride * sizeof(f64)) : NULL;
+    for (size_t k = 0; k < count; k++) {
+        p[k] = base ? base + stride * k : NULL;
+    }
+}
+
+/* Allocates four planes as cml_math_soa_alloc_plane_set. */
+cml_inline void
+cml_math_soa_alloc_planes(f64* p[4], const size_t n) {
+    cml_math_soa_alloc_plane_set(p, 4, n);
+}
+
+/* Scatters n interleaved 4-element records into four planes, transposing
+ * four records at a time in registers. */
+cml_inline void
+cml_math_soa_from_aos(f64* const p[4], const f64* src, const size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4, src += 16) {
+        f64x4 r[4];
+        r[0] = simde_mm256_loadu_pd(src +  0);
+        r[1] = simde_mm256_loadu_pd(src +  4);
+        r[2] = simde_mm256_loadu_pd(src +  8);
+        r[3] = simde_mm256_loadu_pd(src + 12);
+        cml_math_f64x4_transpose(r);
+        simde_mm256_storeu_pd(p[0] + i, r[0]);
+        simde_mm256_storeu_pd(p[1] + i, r[1]);
+        simde_mm256_storeu_pd(p[2] + i, r[2]);
+        simde_mm256_storeu_pd(p[3] + i, r[3]);
+    }
+    for (; i < n; i++, src += 4) {
+        p[0][i] = src[0];
+        p[1][i] = src[1];
+        p[2][i] = src[2];
+        p[3][i] = src[3];
+    }
+}
+
+/* Gathers four planes back into n interleaved 4-element records. */
+cml_inline void
+cml_math_soa_to_aos(f64* dst, const f64* const p[4], const size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4, dst += 16) {
+        f64x4 r[4];
+        r[0] = simde_mm256_loadu_pd(p[0] + i);
+        r[1] = simde_mm256_loadu_pd(p[1] + i);
+        r[2] = simde_mm256_loadu_pd(p[2] + i);
+        r[3] = simde_mm256_loadu_pd(p[3] + i);
+        cml_math_f64x4_transpose(r);
+        simde_mm256_storeu_pd(dst +  0, r[0]);
+        simde_mm256_storeu_pd(dst +  4, r[1]);
+        simde_mm256_storeu_pd(dst +  8, r[2]);
+        simde_mm256_storeu_pd(dst + 12, r[3]);
+    }
+    for (; i < n; i++, dst += 4) {
+        dst[0] = p[0][i];
+        dst[1] = p[1][i];
+        dst[2] = p[2][i];
+        dst[3] = p[3][i];
+    }
+}
+
+/*----------------------------*/
+/* 4D Vector Stream Functions */
+/*----------------------------*/
+
+/* Allocate a stream of n vectors. The contents are uninitialized. On failure
+ * every plane is NULL and n is zero. */
+cml_inline vec4_soa
+cml_math_vec4_soa_alloc(const size_t n) {
+    vec4_soa s;
+    f64* p[4];
+    cml_math_soa_alloc_planes(p, n);
+    s.x = p[0];
+    s.y = p[1];
+    s.z = p[2];
+    s.w = p[3];
+    s.n = p[0] ? n : 0;
+    return s;
+}
+
+/* Free a stream returned by cml_math_vec4_soa_alloc. Views must not be
+ * freed with this function. */
+cml_inline void
+cml_math_vec4_soa_free(vec4_soa* s) {
+    cml_aligned_free(s->x);
+    s->x = s->y = s->z = s->w = NULL;
+    s->n = 0;
+}
+
+/* Wrap caller-owned planes as a stream without copying. */
+cml_inline vec4_soa
+cml_math_vec4_soa_view(f64* x, f64* y, f64* z, f64* w, const size_t n) {
+    vec4_soa s;
+    s.x = x;
+    s.y = y;
+    s.z = z;
+    s.w = w;
+    s.n = n;
+    return s;
+}
+
+/* Read the vector at index i. */
+cml_inline vec4
+cml_math_vec4_soa_get(const vec4_soa* s, const size_t i) {
+    vec4 r;
+    r.v = simde_mm256_set_pd(s->w[i], s->z[i], s->y[i], s->x[i]);
+    return r;
+}
+
+/* Write the vector at index i. */
+cml_inline void
+cml_math_vec4_soa_set(vec4_soa* s, const size_t i, const vec4 v) {
+    f64 a[4];
+    simde_mm256_storeu_pd(a, v.v);
+    s->x[i] = a[0];
+    s->y[i] = a[1];
+    s->z[i] = a[2];
+    s->w[i] = a[3];
+}
+
+/* Copy dst->n vectors from an array into a stream. */
+cml_inline void
+cml_math_vec4_soa_from_vec4_array(vec4_soa* dst, const vec4* src) {
+    f64* const p[4] = {dst->x, dst->y, dst->z, dst->w};
+    cml_math_soa_from_aos(p, (const f64*)src, dst->n);
+}
+
+/* Copy src->n vectors from a stream into an array. */
+cml_inline void
+cml_math_vec4_soa_to_vec4_array(vec4* dst, const vec4_soa* src) {
+    const f64* const p[4] = {src->x, src->y, src->z, src->w};
+    cml_math_soa_to_aos((f64*)dst, p, src->n);
+}
+
+/* Compute out[i] = dot(a[i], b[i]) for the a->n vectors of the streams. */
+cml_inline void
+cml_math_vec4_soa_dot_product(const vec4_soa* a, const vec4_soa* b, f64* out) {
+    const size_t n = a->n;
+    size_t i = 0;
+    for (; i + CML_F64XN_LANES <= n; i += CML_F64XN_LANES) {
+        f64xn r;
+        r = cml_f64xn_mul(cml_f64xn_loadu(a->x + i), cml_f64xn_loadu(b->x + i));
+        r = cml_f64xn_fmadd(cml_f64xn_loadu(a->y + i),
+                            cml_f64xn_loadu(b->y + i), r);
+        r = cml_f64xn_fmadd(cml_f64xn_loadu(a->z + i),
+                            cml_f64xn_loadu(b->z + i), r);
+        r = cml_f64xn_fmadd(cml_f64xn_loadu(a->w + i),
+                            cml_f64xn_loadu(b->w + i), r);
+        cml_f64xn_storeu(out + i, r);
+    }
+    for (; i < n; i++) {
+        out[i] = a->x[i] * b->x[i] + a->y[i] * b->y[i] +
+                 a->z[i] * b->z[i] + a->w[i] * b->w[i];
+    }
+}
+
+/* Compute out[i] = length(a[i]) for the a->n vectors of the stream. */
+cml_inline void
+cml_math_vec4_soa_length(const vec4_soa* a, f64* out) {
+    const size_t n = a->n;
+    size_t i = 0;
+    for (; i + CML_F64XN_LANES <= n; i += CML_F64XN_LANES) {
+        const f64xn x = cml_f64xn_loadu(a->x + i);
+        const f64xn y = cml_f64xn_loadu(a->y + i);
+        const f64xn z = cml_f64xn_loadu(a->z + i);
+        const f64xn w = cml_f64xn_loadu(a->w + i);
+        f64xn r;
+        r = cml_f64xn_mul(x, x);
+        r = cml_f64xn_fmadd(y, y, r);
+        r = cml_f64xn_fmadd(z, z, r);
+        r = cml_f64xn_fmadd(w, w, r);
+        cml_f64xn_storeu(out + i, cml_f64xn_sqrt(r));
+    }
+    for (; i < n; i++) {
+        out[i] = sqrt(a->x[i] * a->x[i] + a->y[i] * a->y[i] +
+                      a->z[i] * a->z[i] + a->w[i] * a->w[i]);
+    }
+}
+
+/* Compute out[i] = distance(a[i], b[i]) for the a->n vectors of the
+ * streams. */
+cml_inline void
+cml_math_vec4_soa_distance(const vec4_soa* a, const vec4_soa* b, f64* out) {
+    const size_t n = a->n;
+    size_t i = 0;
+    for (; i + CML_F64XN_LANES <= n; i += CML_F64XN_LANES) {
+        const f64xn x = cml_f64xn_sub(cml_f64xn_loadu(a->x + i),
+                                      cml_f64xn_loadu(b->x + i));
+        const f64xn y = cml_f64xn_sub(cml_f64xn_loadu(a->y + i),
+                                      cml_f64xn_loadu(b->y + i));
+        const f64xn z = cml_f64xn_sub(cml_f64xn_loadu(a->z + i),
+                                      cml_f64xn_loadu(b->z + i));
+        const f64xn w = cml_f64xn_sub(cml_f64xn_loadu(a->w + i),
+                                      cml_f64xn_loadu(b->w + i));
+        f64xn r;
+        r = cml_f64xn_mul(x, x);
+        r = cml_f64xn_fmadd(y, y, r);
+        r = cml_f64xn_fmadd(z, z, r);
+        r = cml_f64xn_fmadd(w, w, r);
+        cml_f64xn_storeu(out + i, cml_f64xn_sqrt(r));
+    }
+    for (; i < n; i++) {
+        const f64 x = a->x[i] - b->x[i];
+        const f64 y = a->y[i] - b->y[i];
+        const f64 z = a->z[i] - b->z[i];
+        const f64 w = a->w[i] - b->w[i];
+        out[i] = sqrt(x * x + y * y + z * z + w * w);
+    }
+}
+
+/* Normalize the a->n vectors of a stream into out, which may be a. */
+cml_inline void
+cml_math_vec4_soa_normalize(const vec4_soa* a, vec4_soa* out) {
+    const size_t n = a->n;
+    const f64xn one = cml_f64xn_set1(1.0);
+    size_t i = 0;
+    for (; i + CML_F64XN_LANES <= n; i += CML_F64XN_LANES) {
+        const f64xn x = cml_f64xn_loadu(a->x + i);
+        const f64xn y = cml_f64xn_loadu(a->y + i);
+        const f64xn z = cml_f64xn_loadu(a->z + i);
+        const f64xn w = cml_f64xn_loadu(a->w + i);
+        f64xn r;
+        r = cml_f64xn_mul(x, x);
+        r = cml_f64xn_fmadd(y, y, r);
+        r = cml_f64xn_fmadd(z, z, r);
+        r = cml_f64xn_fmadd(w, w, r);
+        r = cml_f64xn_div(one, cml_f64xn_sqrt(r));
+        cml_f64xn_storeu(out->x + i, cml_f64xn_mul(x, r));
+        cml_f64xn_storeu(out->y + i, cml_f64xn_mul(y, r));
+        cml_f64xn_storeu(out->z + i, cml_f64xn_mul(z, r));
+        cml_f64xn_storeu(out->w + i, cml_f64xn_mul(w, r));
+    }
+    for (; i < n; i++) {
+        const f64 r = 1.0 / sqrt(a->x[i] * a->x[i] + a->y[i] * a->y[i] +
+                                 a->z[i] * a->z[i] + a->w[i] * a->w[i]);
+        out->x[i] = a->x[i] * r;
+        out->y[i] = a->y[i] * r;
+        out->z[i] = a->z[i] * r;
+        out->w[i] = a->w[i] * r;
+    }
+}
+
+/* Compute out[i] = cross(a[i], b[i]) for the a->n vectors of the streams.
+ * As with cml_math_vec4_cross_product, the w component of the result is
+ * zero. out may be a or b. */
+cml_inline void
+cml_math_vec4_soa_cross_product(const vec4_soa* a, const vec4_soa* b,
+                                vec4_soa* out) {
+    const size_t n = a->n;
+    const f64xn zero = cml_f64xn_set1(0.0);
+    size_t i = 0;
+    for (; i + CML_F64XN_LANES <= n; i += CML_F64XN_LANES) {
+        const f64xn ax = cml_f64xn_loadu(a->x + i);
+        const f64xn ay = cml_f64xn_loadu(a->y + i);
+        const f64xn az = cml_f64xn_loadu(a->z + i);
+        const f64xn bx = cml_f64xn_loadu(b->x + i);
+        const f64xn by = cml_f64xn_loadu(b->y + i);
+        const f64xn bz = cml_f64xn_loadu(b->z + i);
+        cml_f64xn_storeu(out->x + i,
+                         cml_f64xn_fmsub(ay, bz, cml_f64xn_mul(az, by)));
+        cml_f64xn_storeu(out->y + i,
+                         cml_f64xn_fmsub(az, bx, cml_f64xn_mul(ax, bz)));
+        cml_f64xn_storeu(out->z + i,
+                         cml_f64xn_fmsub(ax, by, cml_f64xn_mul(ay, bx)));
+        cml_f64xn_storeu(out->w + i, zero);
+    }
+    for (; i < n; i++) {
+        const f64 ax = a->x[i], ay = a->y[i], az = a->z[i];
+        const f64 bx = b->x[i], by = b->y[i], bz = b->z[i];
+        out->x[i] = ay * bz - az * by;
+        out->y[i] = az * bx - ax * bz;
+        out->z[i] = ax * by - ay * bx;
+        out->w[i] = 0.0;
+    }
+}
+
+/* Compute out[i] = lerp(a[i], b[i], t) for the a->n vectors of the streams.
+ * out may be a or b. */
+cml_inline void
+cml_math_vec4_soa_lerp(const vec4_soa* a, const vec4_soa* b, const f64 t,
+                       vec4_soa* out) {
+    const size_t n = a->n;
+    const f64xn tv = cml_f64xn_set1(t);
+    f64* const       po[4] = {out->x, out->y, out->z, out->w};
+    const f64* const pa[4] = {a->x, a->y, a->z, a->w};
+    const f64* const pb[4] = {b->x, b->y, b->z, b->w};
+    for (size_t c = 0; c < 4; c++) {
+        size_t i = 0;
+        for (; i + CML_F64XN_LANES <= n; i += CML_F64XN_LANES) {
+            const f64xn va = cml_f64xn_loadu(pa[c] + i);
+            const f64xn vb = cml_f64xn_loadu(pb[c] + i);
+            cml_f64xn_storeu(po[c] + i,
+                             cml_f64xn_fmadd(cml_f64xn_sub(vb, va), tv, va));
+        }
+        for (; i < n; i++) {
+            po[c][i] = pa[c][i] + (pb[c][i] - pa[c][i]) * t;
+        }
+    }
+}
+
+/*---------------------------------------------*/
+/* Single-Precision 4D Vector Stream Functions */
+/*---------------------------------------------*/
+
+/* Allocate a stream of n single-precision vectors, with the plane layout of
+ * cml_math_vec4_soa_alloc. The contents are uninitialized. On failure every
+ * plane is NULL and n is zero. */
+cml_inline vec4f_soa
+cml_math_vec4f_soa_alloc(const size_t n) {
+    vec4f_soa s;
+    f64* p[4];
+    cml_math_soa_alloc_planes(p, (n + 1) / 2);
+    s.x = (f32*)p[0];
+    s.y = (f32*)p[1];
+    s.z = (f32*)p[2];
+    s.w = (f32*)p[3];
+    s.n = p[0] ? n : 0;
+    return s;
+}
+
+/* Free a stream returned by cml_math_vec4f_soa_alloc. */
+cml_inline void
+cml_math_vec4f_soa_free(vec4f_soa* s) {
+    cml_aligned_free(s->x);
+    s->x = s->y = s->z = s->w = NULL;
+    s->n = 0;
+}
+
+/* Wrap caller-owned planes as a stream without copying. */
+cml_inline vec4f_soa
+cml_math_vec4f_soa_view(f32* x, f32* y, f32* z, f32* w, const size_t n) {
+    vec4f_soa s;
+    s.x = x;
+    s.y = y;
+    s.z = z;
+    s.w = w;
+    s.n = n;
+    return s;
+}
+
+/*-----------------------------*/
+/* Quaternion Stream Functions */
+/*-----------------------------*/
+
+/* Allocate a stream of n quaternions. The contents are uninitialized. On
+ * failure every plane is NULL and n is zero. */
+cml_inline quat_soa
+cml_math_quat_soa_alloc(const size_t n) {
+    quat_soa s;
+    f64* p[4];
+    cml_math_soa_alloc_planes(p, n);
+    s.w = p[0];
+    s.x = p[1];
+    s.y = p[2];
+    s.z = p[3];
+    s.n = p[0] ? n : 0;
+    return s;
+}
+
+/* Free a stream returned by cml_math_quat_soa_alloc. Views must not be
+ * freed with this function. */
+cml_inline void
+cml_math_quat_soa_free(quat_soa* s) {
+    cml_aligned_free(s->w);
+    s->w = s->x = s->y = s->z = NULL;
+    s->n = 0;
+}
+
+/* Wrap caller-owned planes as a stream without copying. */
+cml_inline quat_soa
+cml_math_quat_soa_view(f64* w, f64* x, f64* y, f64* z, const size_t n) {
+    quat_soa s;
+    s.w = w;
+    s.x = x;
+    s.y = y;
+    s.z = z;
+    s.n = n;
+    return s;
+}
+
+/* Read the quaternion at index i. */
+cml_inline quat
+cml_math_quat_soa_get(const quat_soa* s, const size_t i) {
+    quat r;
+    r.q = simde_mm256_set_pd(s->z[i], s->y[i], s->x[i], s->w[i]);
+    return r;
+}
+
+/* Write the quaternion at index i. */
+cml_inline void
+cml_math_quat_soa_set(quat_soa* s, const size_t i, const quat q) {
+    f64 a[4];
+    simde_mm256_storeu_pd(a, q.q);
+    s->w[i] = a[0];
+    s->x[i] = a[1];
+    s->y[i] = a[2];
+    s->z[i] = a[3];
+}
+
+/* Copy dst->n quaternions from an array into a stream. */
+cml_inline void
+cml_math_quat_soa_from_quat_array(quat_soa* dst, const quat* src) {
+    f64* const p[4] = {dst->w, dst->x, dst->y, dst->z};
+    cml_math_soa_from_aos(p, (const f64*)src, dst->n);
+}
+
+/* Copy src->n quaternions from a stream into an array. */
+cml_inline void
+cml_math_quat_soa_to_quat_array(quat* dst, const quat_soa* src) {
+    const f64* const p[4] = {src->w, src->x, src->y, src->z};
+    cml_math_soa_to_aos((f64*)dst, p, src->n);
+}
+
+/* Compute out[i] = dot(a[i], b[i]) for the a->n quaternions of the
+ * streams. */
+cml_inline void
+cml_math_quat_soa_dot_product(const quat_soa* a, const quat_soa* b, f64* out) {
+    const vec4_soa va = cml_math_vec4_soa_view(a->w, a->x, a->y, a->z, a->n);
+    const vec4_soa vb = cml_math_vec4_soa_view(b->w, b->x, b->y, b->z, b->n);
+    cml_math_vec4_soa_dot_product(&va, &vb, out);
+}
+
+/* Compute out[i] = length(a[i]) for the a->n quaternions of the stream. */
+cml_inline void
+cml_math_quat_soa_length(const quat_soa* a, f64* out) {
+    const vec4_soa va = cml_math_vec4_soa_view(a->w, a->x, a->y, a->z, a->n);
+    cml_math_vec4_soa_length(&va, out);
+}
+
+/* Normalize the a->n quaternions of a stream into out, which may be a. */
+cml_inline void
+cml_math_quat_soa_normalize(const quat_soa* a, quat_soa* out) {
+    const vec4_soa va = cml_math_vec4_soa_view(a->w, a->x, a->y, a->z, a->n);
+    vec4_soa vo = cml_math_vec4_soa_view(out->w, out->x, out->y, out->z,
+                                         out->n);
+    cml_math_vec4_soa_normalize(&va, &vo);
+}
+
+/* Compute the Hamilton product out[i] = a[i] * b[i] for the a->n quaternions
+ * of the streams. out may be a or b. */
+cml_inline void
+cml_math_quat_soa_mul(const quat_soa* a, const quat_soa* b, quat_soa* out) {
+    const size_t n = a->n;
+    size_t i = 0;
+    for (; i + CML_F64XN_LANES <= n; i += CML_F64XN_LANES) {
+        const f64xn aw = cml_f64xn_loadu(a->w + i);
+        const f64xn ax = cml_f64xn_loadu(a->x + i);
+        const f64xn ay = cml_f64xn_loadu(a->y + i);
+        const f64xn az = cml_f64xn_loadu(a->z + i);
+        const f64xn bw = cml_f64xn_loadu(b->w + i);
+        const f64xn bx = cml_f64xn_loadu(b->x + i);
+        const f64xn by = cml_f64xn_loadu(b->y + i);
+        const f64xn bz = cml_f64xn_loadu(b->z + i);
+        f64xn w, x, y, z;
+        w = cml_f64xn_mul(aw, bw);
+        w = cml_f64xn_fnmadd(ax, bx, w);
+        w = cml_f64xn_fnmadd(ay, by, w);
+        w = cml_f64xn_fnmadd(az, bz, w);
+        x = cml_f64xn_mul(aw, bx);
+        x = cml_f64xn_fmadd(ax, bw, x);
+        x = cml_f64xn_fmadd(ay, bz, x);
+        x = cml_f64xn_fnmadd(az, by, x);
+        y = cml_f64xn_mul(aw, by);
+        y = cml_f64xn_fnmadd(ax, bz, y);
+        y = cml_f64xn_fmadd(ay, bw, y);
+        y = cml_f64xn_fmadd(az, bx, y);
+        z = cml_f64xn_mul(aw, bz);
+        z = cml_f64xn_fmadd(ax, by, z);
+        z = cml_f64xn_fnmadd(ay, bx, z);
+        z = cml_f64xn_fmadd(az, bw, z);
+        cml_f64xn_storeu(out->w + i, w);
+        cml_f64xn_storeu(out->x + i, x);
+        cml_f64xn_storeu(out->y + i, y);
+        cml_f64xn_storeu(out->z + i, z);
+    }
+    for (; i < n; i++) {
+        const f64 aw = a->w[i], ax = a->x[i], ay = a->y[i], az = a->z[i];
+        const f64 bw = b->w[i], bx = b->x[i], by = b->y[i], bz = b->z[i];
+        out->w[i] = aw * bw - ax * bx - ay * by - az * bz;
+        out->x[i] = aw * bx + ax * bw + ay * bz - az * by;
+        out->y[i] = aw * by - ax * bz + ay * bw + az * bx;
+        out->z[i] = aw * bz + ax * by - ay * bx + az * bw;
+    }
+}
+
+/* Loads lanes [i, i + m) of the four planes of a stream, m <= 4, padding
+ * missing lanes with the identity so the kernels see valid input. */
+cml_inline void
+cml_math_quat_soa_load_f64x4(const quat_soa* a, size_t i, size_t m,
+                             f64x4 r[4]) {
+    if (m == 4) {
+        r[0] = simde_mm256_loadu_pd(a->w + i);
+        r[1] = simde_mm256_loadu_pd(a->x + i);
+        r[2] = simde_mm256_loadu_pd(a->y + i);
+        r[3] = simde_mm256_loadu_pd(a->z + i);
+        return;
+    }
+    f64 p[4][4] = {{1.0, 1.0, 1.0, 1.0}};
+    for (size_t k = 0; k < m; k++) {
+        p[0][k] = a->w[i + k];
+        p[1][k] = a->x[i + k];
+        p[2][k] = a->y[i + k];
+        p[3][k] = a->z[i + k];
+    }
+    for (size_t k = 0; k < 4; k++) {
+        r[k] = simde_mm256_loadu_pd(p[k]);
+    }
+}
+
+/* Stores lanes [i, i + m) of the four planes of a stream, m <= 4. */
+cml_inline void
+cml_math_quat_soa_store_f64x4(quat_soa* a, size_t i, size_t m,
+                              const f64x4 r[4]) {
+    if (m == 4) {
+        simde_mm256_storeu_pd(a->w + i, r[0]);
+        simde_mm256_storeu_pd(a->x + i, r[1]);
+        simde_mm256_storeu_pd(a->y + i, r[2]);
+        simde_mm256_storeu_pd(a->z + i, r[3]);
+        return;
+    }
+    f64 p[4][4];
+    for (size_t k = 0; k < 4; k++) {
+        simde_mm256_storeu_pd(p[k], r[k]);
+    }
+    for (size_t k = 0; k < m; k++) {
+        a->w[i + k] = p[0][k];
+        a->x[i + k] = p[1][k];
+        a->y[i + k] = p[2][k];
+        a->z[i + k] = p[3][k];
+    }
+}
+
+/* Compute out[i] = slerp(a[i], b[i], t[i]) for the a->n quaternions of the
+ * streams. out may be a or b. */
+static inline void
+cml_math_quat_soa_slerp(const quat_soa* a, const quat_soa* b, const f64* t,
+                        quat_soa* out) {
+    const size_t n = a->n;
+    for (size_t i = 0; i < n; i += 4) {
+        const size_t m = n - i < 4 ? n - i : 4;
+        f64x4 qa[4], qb[4], qr[4];
+        cml_math_quat_soa_load_f64x4(a, i, m, qa);
+        cml_math_quat_soa_load_f64x4(b, i, m, qb);
+        cml_math_quat_slerp_f64x4(qa, qb, cml_math_quat_load_t(t + i, m), qr);
+        cml_math_quat_soa_store_f64x4(out, i, m, qr);
+    }
+}
+
+/* Compute out[i] = nlerp(a[i], b[i], t[i]) for the a->n quaternions of the
+ * streams. out may be a or b. */
+static inline void
+cml_math_quat_soa_nlerp(const quat_soa* a, const quat_soa* b, const f64* t,
+                        quat_soa* out) {
+    const size_t n = a->n;
+    for (size_t i = 0; i < n; i += 4) {
+        const size_t m = n - i < 4 ? n - i : 4;
+        f64x4 qa[4], qb[4], qr[4];
+        cml_math_quat_soa_load_f64x4(a, i, m, qa);
+        cml_math_quat_soa_load_f64x4(b, i, m, qb);
+        cml_math_quat_nlerp_f64x4(qa, qb, cml_math_quat_load_t(t + i, m), qr);
+        cml_math_quat_soa_store_f64x4(out, i, m, qr);
+    }
+}
+
+/* Rotate the a->n vectors of a stream by one unit quaternion into out, which
+ * may be a. Nine multiply-adds per vector; w is copied through. */
+cml_inline void
+cml_math_vec4_soa_rotate(const quat q, const vec4_soa* a, vec4_soa* out) {
+    const mat4 m = cml_math_quat_rotation_rows(q);
+    const size_t n = a->n;
+    const f64xn r00 = cml_f64xn_set1(m.m[0][0]);
+    const f64xn r01 = cml_f64xn_set1(m.m[0][1]);
+    const f64xn r02 = cml_f64xn_set1(m.m[0][2]);
+    const f64xn r10 = cml_f64xn_set1(m.m[1][0]);
+    const f64xn r11 = cml_f64xn_set1(m.m[1][1]);
+    const f64xn r12 = cml_f64xn_set1(m.m[1][2]);
+    const f64xn r20 = cml_f64xn_set1(m.m[2][0]);
+    const f64xn r21 = cml_f64xn_set1(m.m[2][1]);
+    const f64xn r22 = cml_f64xn_set1(m.m[2][2]);
+    size_t i = 0;
+    for (; i + CML_F64XN_LANES <= n; i += CML_F64XN_LANES) {
+        const f64xn x = cml_f64xn_loadu(a->x + i);
+        const f64xn y = cml_f64xn_loadu(a->y + i);
+        const f64xn z = cml_f64xn_loadu(a->z + i);
+        const f64xn w = cml_f64xn_loadu(a->w + i);
+        f64xn rx, ry, rz;
+        rx = cml_f64xn_mul(x, r00);
+        ry = cml_f64xn_mul(x, r01);
+        rz = cml_f64xn_mul(x, r02);
+        rx = cml_f64xn_fmadd(y, r10, rx);
+        ry = cml_f64xn_fmadd(y, r11, ry);
+        rz = cml_f64xn_fmadd(y, r12, rz);
+        rx = cml_f64xn_fmadd(z, r20, rx);
+        ry = cml_f64xn_fmadd(z, r21, ry);
+        rz = cml_f64xn_fmadd(z, r22, rz);
+        cml_f64xn_storeu(out->x + i, rx);
+        cml_f64xn_storeu(out->y + i, ry);
+        cml_f64xn_storeu(out->z + i, rz);
+        cml_f64xn_storeu(out->w + i, w);
+    }
+    for (; i < n; i++) {
+        const f64 x = a->x[i], y = a->y[i], z = a->z[i];
+        out->x[i] = x * m.m[0][0] + y * m.m[1][0] + z * m.m[2][0];
+        out->y[i] = x * m.m[0][1] + y * m.m[1][1] + z * m.m[2][1];
+        out->z[i] = x * m.m[0][2] + y * m.m[1][2] + z * m.m[2][2];
+        out->w[i] = a->w[i];
+    }
+}
+
+/* Rotate each vector of a stream by its own unit quaternion, out[i] =
+ * q[i] * a[i] * q[i]^-1, for the a->n elements. out may be a. Uses
+ * t = 2 * cross(q.xyz, v), v' = v + q.w * t + cross(q.xyz, t): eighteen
+ * multiplies and multiply-adds per vector; w is copied through. */
+cml_inline void
+cml_math_quat_soa_rotate(const quat_soa* q, const vec4_soa* a,
+                         vec4_soa* out) {
+    const size_t n = a->n;
+    const f64xn two = cml_f64xn_set1(2.0);
+    size_t i = 0;
+    for (; i + CML_F64XN_LANES <= n; i += CML_F64XN_LANES) {
+        const f64xn qw = cml_f64xn_loadu(q->w + i);
+        const f64xn qx = cml_f64xn_loadu(q->x + i);
+        const f64xn qy = cml_f64xn_loadu(q->y + i);
+        const f64xn qz = cml_f64xn_loadu(q->z + i);
+        const f64xn x  = cml_f64xn_loadu(a->x + i);
+        const f64xn y  = cml_f64xn_loadu(a->y + i);
+        const f64xn z  = cml_f64xn_loadu(a->z + i);
+        const f64xn w  = cml_f64xn_loadu(a->w + i);
+        /* Half of t; the factor two is folded into the final step. */
+        const f64xn tx = cml_f64xn_fmsub(qy, z, cml_f64xn_mul(qz, y));
+        const f64xn ty = cml_f64xn_fmsub(qz, x, cml_f64xn_mul(qx, z));
+        const f64xn tz = cml_f64xn_fmsub(qx, y, cml_f64xn_mul(qy, x));
+        f64xn rx, ry, rz;
+        rx = cml_f64xn_fmadd(qw, tx, cml_f64xn_mul(qy, tz));
+        ry = cml_f64xn_fmadd(qw, ty, cml_f64xn_mul(qz, tx));
+        rz = cml_f64xn_fmadd(qw, tz, cml_f64xn_mul(qx, ty));
+        rx = cml_f64xn_fnmadd(qz, ty, rx);
+        ry = cml_f64xn_fnmadd(qx, tz, ry);
+        rz = cml_f64xn_fnmadd(qy, tx, rz);
+        cml_f64xn_storeu(out->x + i, cml_f64xn_fmadd(two, rx, x));
+        cml_f64xn_storeu(out->y + i, cml_f64xn_fmadd(two, ry, y));
+        cml_f64xn_storeu(out->z + i, cml_f64xn_fmadd(two, rz, z));
+        cml_f64xn_storeu(out->w + i, w);
+    }
+    for (; i < n; i++) {
+        const f64 qw = q->w[i], qx = q->x[i], qy = q->y[i], qz = q->z[i];
+        const f64 x = a->x[i], y = a->y[i], z = a->z[i];
+        const f64 tx = qy * z - qz * y;
+        const f64 ty = qz * x - qx * z;
+        const f64 tz = qx * y - qy * x;
+        out->x[i] = x + 2.0 * (qw * tx + qy * tz - qz * ty);
+        out->y[i] = y + 2.0 * (qw * ty + qz * tx - qx * tz);
+        out->z[i] = z + 2.0 * (qw * tz + qx * ty - qy * tx);
+        out->w[i] = a->w[i];
+    }
+}
+
+/*-----------------------------*/
+/* 4x4 Matrix Stream Functions */
+/*-----------------------------*/
+
+/* Allocate a stream of n matrices. The contents are uninitialized. On
+ * failure every plane is NULL and n is zero. */
+cml_inline mat4_soa
+cml_math_mat4_soa_alloc(const size_t n) {
+    mat4_soa s;
+    cml_math_soa_alloc_plane_set(s.m, 16, n);
+    s.n = s.m[0] ? n : 0;
+    return s;
+}
+
+/* Free a stream returned by cml_math_mat4_soa_alloc. */
+cml_inline void
+cml_math_mat4_soa_free(mat4_soa* s) {
+    cml_aligned_free(s->m[0]);
+    for (size_t k = 0; k < 16; k++) {
+        s->m[k] = NULL;
+    }
+    s->n = 0;
+}
+
+/* Read the matrix at index i. */
+cml_inline mat4
+cml_math_mat4_soa_get(const mat4_soa* s, const size_t i) {
+    mat4 r;
+    f64* e = (f64*)r.m;
+    for (size_t k = 0; k < 16; k++) {
+        e[k] = s->m[k][i];
+    }
     return r;
 }
 
-/* Print matrix in a row-major format. */
+/* Write the matrix at index i. */
 cml_inline void
-cml_math_mat4_print(const mat4 m) {
-    printf("%f %f %f %f\n", m.m[0][0], m.m[0][1], m.m[0][2], m.m[0][3]);
-    printf("%f %f %f %f\n", m.m[1][0], m.m[1][1], m.m[1][2], m.m[1][3]);
-    printf("%f %f %f %f\n", m.m[2][0], m.m[2][1], m.m[2][2], m.m[2][3]);
-    printf("%f %f %f %f\n", m.m[3][0], m.m[3][1], m.m[3][2], m.m[3][3]);
+cml_math_mat4_soa_set(mat4_soa* s, const size_t i, const mat4 a) {
+    const f64* e = (const f64*)a.m;
+    for (size_t k = 0; k < 16; k++) {
+        s->m[k][i] = e[k];
+    }
+}
+
+/* Scatters n matrices into sixteen planes, transposing each row of four
+ * matrices at a time in registers. */
+cml_inline void
+cml_math_mat4_soa_from_aos(f64* const p[16], const mat4* src,
+                           const size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (size_t r = 0; r < 4; r++) {
+            f64x4 t[4] = {src[i].m[r], src[i + 1].m[r], src[i + 2].m[r],
+                          src[i + 3].m[r]};
+            cml_math_f64x4_transpose(t);
+            simde_mm256_storeu_pd(p[4 * r + 0] + i, t[0]);
+            simde_mm256_storeu_pd(p[4 * r + 1] + i, t[1]);
+            simde_mm256_storeu_pd(p[4 * r + 2] + i, t[2]);
+            simde_mm256_storeu_pd(p[4 * r + 3] + i, t[3]);
+        }
+    }
+    for (; i < n; i++) {
+        const f64* e = (const f64*)src[i].m;
+        for (size_t k = 0; k < 16; k++) {
+            p[k][i] = e[k];
+        }
+    }
+}
+
+/* Gathers sixteen planes back into n matrices. */
+cml_inline void
+cml_math_mat4_soa_to_aos(mat4* dst, const f64* const p[16], const size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        for (size_t r = 0; r < 4; r++) {
+            f64x4 t[4];
+            t[0] = simde_mm256_loadu_pd(p[4 * r + 0] + i);
+            t[1] = simde_mm256_loadu_pd(p[4 * r + 1] + i);
+            t[2] = simde_mm256_loadu_pd(p[4 * r + 2] + i);
+            t[3] = simde_mm256_loadu_pd(p[4 * r + 3] + i);
+            cml_math_f64x4_transpose(t);
+            dst[i].m[r]     = t[0];
+            dst[i + 1].m[r] = t[1];
+            dst[i + 2].m[r] = t[2];
+            dst[i + 3].m[r] = t[3];
+        }
+    }
+    for (; i < n; i++) {
+        f64* e = (f64*)dst[i].m;
+        for (size_t k = 0; k < 16; k++) {
+            e[k] = p[k][i];
+        }
+    }
+}
+
+/* Copy dst->n matrices from an array into a stream. */
+cml_inline void
+cml_math_mat4_soa_from_mat4_array(mat4_soa* dst, const mat4* src) {
+    cml_math_mat4_soa_from_aos(dst->m, src, dst->n);
+}
+
+/* Copy src->n matrices from a stream into an array. */
+cml_inline void
+cml_math_mat4_soa_to_mat4_array(mat4* dst, const mat4_soa* src) {
+    cml_math_mat4_soa_to_aos(dst, (const f64* const*)src->m, src->n);
+}
+
+/* Loads the CML_F64XN_LANES matrices starting at src into a, one matrix per
+ * lane, transposing in registers. */
+cml_inline void
+cml_math_mat4_load_f64xn(const mat4* src, f64xn a[16]) {
+    for (size_t r = 0; r < 4; r++) {
+        f64x4 t[4] = {src[0].m[r], src[1].m[r], src[2].m[r], src[3].m[r]};
+        cml_math_f64x4_transpose(t);
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+        f64x4 u[4] = {src[4].m[r], src[5].m[r], src[6].m[r], src[7].m[r]};
+        cml_math_f64x4_transpose(u);
+        for (size_t c = 0; c < 4; c++) {
+            a[4 * r + c] = cml_math_f64x8_join(t[c], u[c]);
+        }
+#else
+        for (size_t c = 0; c < 4; c++) {
+            a[4 * r + c] = t[c];
+        }
+#endif
+    }
+}
+
+/* Stores the matrices held one per lane in a to CML_F64XN_LANES
+ * consecutive matrices at dst. */
+cml_inline void
+cml_math_mat4_store_f64xn(mat4* dst, const f64xn a[16]) {
+    for (size_t r = 0; r < 4; r++) {
+#if defined(SIMDE_X86_AVX512F_NATIVE)
+        f64x4 t[4], u[4];
+        for (size_t c = 0; c < 4; c++) {
+            t[c] = cml_math_f64x8_lo(a[4 * r + c]);
+            u[c] = cml_math_f64x8_hi(a[4 * r + c]);
+        }
+        cml_math_f64x4_transpose(u);
+        dst[4].m[r] = u[0];
+        dst[5].m[r] = u[1];
+        dst[6].m[r] = u[2];
+        dst[7].m[r] = u[3];
+#else
+        f64x4 t[4] = {a[4 * r], a[4 * r + 1], a[4 * r + 2], a[4 * r + 3]};
+#endif
+        cml_math_f64x4_transpose(t);
+        dst[0].m[r] = t[0];
+        dst[1].m[r] = t[1];
+        dst[2].m[r] = t[2];
+        dst[3].m[r] = t[3];
+    }
+}
+
+/* The batch inverse and determinant expand along the first two rows: the
+ * six 2x2 minors s of rows 0-1 and c of rows 2-3 give
+ * det = s0 c5 - s1 c4 + s2 c3 + s3 c2 - s4 c1 + s5 c0, and every cofactor is
+ * three multiply-adds of one of them. */
+
+/* Computes the minors s[6] of rows 0-1 and c[6] of rows 2-3 of the matrices
+ * held in a, and returns their determinants. */
+cml_inline f64xn
+cml_math_mat4_soa_minors(const f64xn a[16], f64xn s[6], f64xn c[6]) {
+    s[0] = cml_f64xn_fmsub(a[0], a[5], cml_f64xn_mul(a[4], a[1]));
+    s[1] = cml_f64xn_fmsub(a[0], a[6], cml_f64xn_mul(a[4], a[2]));
+    s[2] = cml_f64xn_fmsub(a[0], a[7], cml_f64xn_mul(a[4], a[3]));
+    s[3] = cml_f64xn_fmsub(a[1], a[6], cml_f64xn_mul(a[5], a[2]));
+    s[4] = cml_f64xn_fmsub(a[1], a[7], cml_f64xn_mul(a[5], a[3]));
+    s[5] = cml_f64xn_fmsub(a[2], a[7], cml_f64xn_mul(a[6], a[3]));
+    c[0] = cml_f64xn_fmsub(a[8], a[13], cml_f64xn_mul(a[12], a[9]));
+    c[1] = cml_f64xn_fmsub(a[8], a[14], cml_f64xn_mul(a[12], a[10]));
+    c[2] = cml_f64xn_fmsub(a[8], a[15], cml_f64xn_mul(a[12], a[11]));
+    c[3] = cml_f64xn_fmsub(a[9], a[14], cml_f64xn_mul(a[13], a[10]));
+    c[4] = cml_f64xn_fmsub(a[9], a[15], cml_f64xn_mul(a[13], a[11]));
+    c[5] = cml_f64xn_fmsub(a[10], a[15], cml_f64xn_mul(a[14], a[11]));
+    f64xn det;
+    det = cml_f64xn_mul(s[0], c[5]);
+    det = cml_f64xn_fnmadd(s[1], c[4], det);
+    det = cml_f64xn_fmadd(s[2], c[3], det);
+    det = cml_f64xn_fmadd(s[3], c[2], det);
+    det = cml_f64xn_fnmadd(s[4], c[1], det);
+    det = cml_f64xn_fmadd(s[5], c[0], det);
+    return det;
+}
+
+/* Returns x * p - y * q + z * r. */
+cml_inline f64xn
+cml_math_mat4_soa_cof(const f64xn x, const f64xn p, const f64xn y,
+                      const f64xn q, const f64xn z, const f64xn r) {
+    return cml_f64xn_fmadd(z, r, cml_f64xn_fmsub(x, p, cml_f64xn_mul(y, q)));
+}
+
+/* Returns -(x * p - y * q + z * r). */
+cml_inline f64xn
+cml_math_mat4_soa_ncof(const f64xn x, const f64xn p, const f64xn y,
+                       const f64xn q, const f64xn z, const f64xn r) {
+    return cml_f64xn_fnmadd(z, r, cml_f64xn_fmsub(y, q, cml_f64xn_mul(x, p)));
+}
+
+/* Inverts the matrices held one per lane in a into b. Returns the bits of
+ * the lanes that are singular to within tol, as described for
+ * cml_math_mat4_soa_inverse; b holds no useful value in those lanes. */
+static inline u32
+cml_math_mat4_inverse_f64xn(const f64xn a[16], f64xn b[16], const f64 tol) {
+    f64xn s[6], c[6];
+    const f64xn det = cml_math_mat4_soa_minors(a, s, c);
+    /* Hadamard's bound: |det| never exceeds the product of the row
+     * lengths, and the ratio of the two falls to zero as the rows lose
+     * rank, whatever the scale of the matrix. */
+    f64xn r0, r1, r2, r3;
+    r0 = cml_f64xn_mul(a[0], a[0]);
+    r1 = cml_f64xn_mul(a[4], a[4]);
+    r2 = cml_f64xn_mul(a[8], a[8]);
+    r3 = cml_f64xn_mul(a[12], a[12]);
+    for (size_t k = 1; k < 4; k++) {
+        r0 = cml_f64xn_fmadd(a[k], a[k], r0);
+        r1 = cml_f64xn_fmadd(a[4 + k], a[4 + k], r1);
+        r2 = cml_f64xn_fmadd(a[8 + k], a[8 + k], r2);
+        r3 = cml_f64xn_fmadd(a[12 + k], a[12 + k], r3);
+    }
+    const f64xn bound = cml_f64xn_mul(cml_f64xn_set1(tol),
+                        cml_f64xn_mul(cml_f64xn_sqrt(cml_f64xn_mul(r0, r1)),
+                                      cml_f64xn_sqrt(cml_f64xn_mul(r2, r3))));
+    const u32 ok = cml_f64xn_cmpgt_mask(cml_f64xn_abs(det), bound);
+    const f64xn inv = cml_f64xn_div(cml_f64xn_set1(1.0), det);
+    b[0]  = cml_math_mat4_soa_cof(a[5], c[5], a[6], c[4], a[7], c[3]);
+    b[1]  = cml_math_mat4_soa_ncof(a[1], c[5], a[2], c[4], a[3], c[3]);
+    b[2]  = cml_math_mat4_soa_cof(a[13], s[5], a[14], s[4], a[15], s[3]);
+    b[3]  = cml_math_mat4_soa_ncof(a[9], s[5], a[10], s[4], a[11], s[3]);
+    b[4]  = cml_math_mat4_soa_ncof(a[4], c[5], a[6], c[2], a[7], c[1]);
+    b[5]  = cml_math_mat4_soa_cof(a[0], c[5], a[2], c[2], a[3], c[1]);
+    b[6]  = cml_math_mat4_soa_ncof(a[12], s[5], a[14], s[2], a[15], s[1]);
+    b[7]  = cml_math_mat4_soa_cof(a[8], s[5], a[10], s[2], a[11], s[1]);
+    b[8]  = cml_math_mat4_soa_cof(a[4], c[4], a[5], c[2], a[7], c[0]);
+    b[9]  = cml_math_mat4_soa_ncof(a[0], c[4], a[1], c[2], a[3], c[0]);
+    b[10] = cml_math_mat4_soa_cof(a[12], s[4], a[13], s[2], a[15], s[0]);
+    b[11] = cml_math_mat4_soa_ncof(a[8], s[4], a[9], s[2], a[11], s[0]);
+    b[12] = cml_math_mat4_soa_ncof(a[4], c[3], a[5], c[1], a[6], c[0]);
+    b[13] = cml_math_mat4_soa_cof(a[0], c[3], a[1], c[1], a[2], c[0]);
+    b[14] = cml_math_mat4_soa_ncof(a[12], s[3], a[13], s[1], a[14], s[0]);
+    b[15] = cml_math_mat4_soa_cof(a[8], s[3], a[9], s[1], a[10], s[0]);
+    for (size_t k = 0; k < 16; k++) {
+        b[k] = cml_f64xn_mul(b[k], inv);
+    }
+    return ~ok & ((1u << CML_F64XN_LANES) - 1);
+}
+
+/* Inverts the CML_F64XN_LANES matrices starting at lane i of the planes in
+ * into the same lanes of out, which may be in, zeroing singular ones.
+ * Returns the singular bits. */
+cml_inline u32
+cml_math_mat4_soa_inverse_lanes(const f64* const in[16], f64* const out[16],
+                                const size_t i, const f64 tol) {
+    f64xn a[16], b[16];
+    for (size_t k = 0; k < 16; k++) {
+        a[k] = cml_f64xn_loadu(in[k] + i);
+    }
+    const u32 bad = cml_math_mat4_inverse_f64xn(a, b, tol);
+    for (size_t k = 0; k < 16; k++) {
+        cml_f64xn_storeu(out[k] + i, b[k]);
+    }
+    for (u32 w = bad; w; w &= w - 1) {
+        const u32 l = cml_ctz64(w);
+        for (size_t k = 0; k < 16; k++) {
+            out[k][i + l] = 0.0;
+        }
+    }
+    return bad;
+}
+
+/* Compute out[i] = det(a[i]) for the a->n matrices of a stream. */
+cml_inline void
+cml_math_mat4_soa_determinant(const mat4_soa* a, f64* out) {
+    const size_t n = a->n;
+    size_t i = 0;
+    for (; i + CML_F64XN_LANES <= n; i += CML_F64XN_LANES) {
+        f64xn e[16], s[6], c[6];
+        for (size_t k = 0; k < 16; k++) {
+            e[k] = cml_f64xn_loadu(a->m[k] + i);
+        }
+        cml_f64xn_storeu(out + i, cml_math_mat4_soa_minors(e, s, c));
+    }
+    for (; i < n; i++) {
+        out[i] = cml_math_mat4_determinant(cml_math_mat4_soa_get(a, i));
+    }
+}
+
+/* Invert the a->n matrices of a stream into out, which may be a. A matrix
+ * is singular when |det| <= tol times the product of its row lengths, a
+ * ratio that is 1 for a rotation and falls to 0 as the rows become linearly
+ * dependent, at any scale. tol = 0 flags only a zero, underflowed or NaN
+ * determinant; around 1e-12 also flags matrices whose inverse would have
+ * lost most of its digits. Singular matrices get a zero inverse, and if
+ * singular is not NULL it receives their bits: bit i % 64 of word i / 64
+ * for matrix i, in (n + 63) / 64 words. Returns the number of singular
+ * matrices. */
+static inline size_t
+cml_math_mat4_soa_inverse(const mat4_soa* a, mat4_soa* out, const f64 tol,
+                          u64* singular) {
+    const size_t n = a->n;
+    const f64* const* in = (const f64* const*)a->m;
+    size_t count = 0;
+    for (size_t i = 0; i < n; i += 64) {
+        const size_t m = n - i < 64 ? n - i : 64;
+        u64 bits = 0;
+        size_t j = 0;
+        for (; j + CML_F64XN_LANES <= m; j += CML_F64XN_LANES) {
+            bits |= (u64)cml_math_mat4_soa_inverse_lanes(in, out->m, i + j,
+                                                         tol) << j;
+        }
+        if (j < m) {
+            /* Run the tail through a block padded with identities. */
+            f64 block[16][CML_F64XN_LANES];
+            f64* p[16];
+            for (size_t k = 0; k < 16; k++) {
+                p[k] = block[k];
+                for (size_t l = 0; l < CML_F64XN_LANES; l++) {
+                    block[k][l] = j + l < m ? in[k][i + j + l]
+                                            : (k % 5 == 0 ? 1.0 : 0.0);
+                }
+            }
+            bits |= (u64)cml_math_mat4_soa_inverse_lanes(
+                    (const f64* const*)p, p, 0, tol) << j;
+            for (size_t k = 0; k < 16; k++) {
+                for (size_t l = 0; j + l < m; l++) {
+                    out->m[k][i + j + l] = block[k][l];
+                }
+            }
+        }
+        if (singular) {
+            singular[i / 64] = bits;
+        }
+        count += cml_popcount64(bits);
+    }
+    return count;
+}
+
+/* Invert n matrices stored as an array, out[i] = a[i]^-1, transposing
+ * CML_F64XN_LANES of them at a time into registers for the stream kernel.
+ * out may be a. tol, singular and the return value are as for
+ * cml_math_mat4_soa_inverse. */
+static inline size_t
+cml_math_mat4_inverse_array(const mat4* a, mat4* out, const size_t n,
+                            const f64 tol, u64* singular) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i += 64) {
+        const size_t m = n - i < 64 ? n - i : 64;
+        u64 bits = 0;
+        for (size_t j = 0; j < m; j += CML_F64XN_LANES) {
+            const size_t l = m - j < CML_F64XN_LANES ? m - j
+                                                      : CML_F64XN_LANES;
+            f64xn e[16], r[16];
+            u32 bad;
+            if (l == CML_F64XN_LANES) {
+                cml_math_mat4_load_f64xn(a + i + j, e);
+                bad = cml_math_mat4_inverse_f64xn(e, r, tol);
+                cml_math_mat4_store_f64xn(out + i + j, r);
+            } else {
+                /* Pad the tail with identities. */
+                mat4 t[CML_F64XN_LANES];
+                for (size_t k = 0; k < CML_F64XN_LANES; k++) {
+                    t[k] = k < l ? a[i + j + k] : cml_math_mat4_identity();
+                }
+                cml_math_mat4_load_f64xn(t, e);
+                bad = cml_math_mat4_inverse_f64xn(e, r, tol);
+                cml_math_mat4_store_f64xn(t, r);
+                for (size_t k = 0; k < l; k++) {
+                    out[i + j + k] = t[k];
+                }
+                bad &= (1u << l) - 1;
+            }
+            for (u32 w = bad; w; w &= w - 1) {
+                memset(out + i + j + cml_ctz64(w), 0, sizeof(mat4));
+            }
+            bits |= (u64)bad << j;
+        }
+        if (singular) {
+            singular[i / 64] = bits;
+        }
+        count += cml_popcount64(bits);
+    }
+    return count;
 }
 
 /*============================================================================*/
-/* Quaternion                                                                 */
+/* Dual Quaternion                                                            */
 /*============================================================================*/
 
-/* Quaternion. */
-typedef struct quat {
-    simde__m256d q;
-} quat;
+/* Unit dual quaternion real + e * dual for a rigid transform: real is the
+ * rotation and dual = 0.5 * t * real, with t the translation as a pure
+ * quaternion (0, x, y, z). Eight f64 instead of the sixteen of a mat4, and
+ * blending them keeps the result rigid, so skinned joints neither shrink
+ * nor collapse the way blended matrices do. */
+typedef struct dquat {
+    quat real;
+    quat dual;
+} dquat;
+
+/* Dual quaternion identity. */
+cml_inline dquat
+cml_math_dquat_identity(void) {
+    dquat r;
+    r.real = cml_math_quat_identity();
+    r.dual.q = simde_mm256_setzero_pd();
+    return r;
+}
+
+/* Dual quaternion rotating by the unit quaternion q, then translating by the
+ * xyz part of t. */
+cml_inline dquat
+cml_math_dquat_from_quat_translation(const quat q, const vec4 t) {
+    /* (0, x, y, z) from (x, y, z, w). */
+    quat tq;
+    tq.q = simde_mm256_blend_pd(simde_mm256_permute4x64_pd(t.v, 0x90),
+                                simde_mm256_setzero_pd(), 0x1);
+    dquat r;
+    r.real = q;
+    r.dual = cml_math_quat_mul(tq, q);
+    r.dual.q = simde_mm256_mul_pd(r.dual.q, simde_mm256_set1_pd(0.5));
+    return r;
+}
+
+/* Dual quaternion from a rigid matrix, rotation and translation only, in the
+ * row-vector layout of cml_math_mat4_translation. */
+cml_inline dquat
+cml_math_dquat_from_mat4(const mat4 m) {
+    /* cml_math_quat_from_mat4 reads the column-vector layout. */
+    const quat q = cml_math_quat_from_mat4(cml_math_mat4_transpose(m));
+    vec4 t;
+    t.v = m.m[3];
+    return cml_math_dquat_from_quat_translation(q, t);
+}
+
+/* Translation of a unit dual quaternion, 2 * dual * conjugate(real), with
+ * w = 0. */
+cml_inline vec4
+cml_math_dquat_translation(const dquat a) {
+    const quat t = cml_math_quat_mul(a.dual, cml_math_quat_conjugate(a.real));
+    vec4 r;
+    r.v = simde_mm256_blend_pd(
+          simde_mm256_mul_pd(simde_mm256_permute4x64_pd(t.q, 0x39),
+                             simde_mm256_set1_pd(2.0)),
+          simde_mm256_setzero_pd(), 0x8);
+    return r;
+}
+
+/* Matrix of a unit dual quaternion in the row-vector layout, so that
+ * cml_math_dquat_to_mat4(cml_math_dquat_from_mat4(m)) returns m for a rigid
+ * m. */
+cml_inline mat4
+cml_math_dquat_to_mat4(const dquat a) {
+    mat4 r = cml_math_quat_rotation_rows(a.real);
+    r.m[3] = simde_mm256_blend_pd(cml_math_dquat_translation(a).v,
+                                  simde_mm256_set1_pd(1.0), 0x8);
+    return r;
+}
+
+/* Dual quaternion multiplication: transforming by a * b transforms by b
+ * first, then by a, which matches the matrix product
+ * to_mat4(b) * to_mat4(a). */
+cml_inline dquat
+cml_math_dquat_mul(const dquat a, const dquat b) {
+    dquat r;
+    r.real = cml_math_quat_mul(a.real, b.real);
+    r.dual = cml_math_quat_add(cml_math_quat_mul(a.real, b.dual),
+                               cml_math_quat_mul(a.dual, b.real));
+    return r;
+}
+
+/* Dual quaternion conjugate, which is the inverse of a unit dual
+ * quaternion. */
+cml_inline dquat
+cml_math_dquat_conjugate(const dquat a) {
+    dquat r;
+    r.real = cml_math_quat_conjugate(a.real);
+    r.dual = cml_math_quat_conjugate(a.dual);
+    return r;
+}
+
+/* Dual quaternion normalization. Scales both parts by 1 / |real| and then
+ * removes the part of dual along real, so the result is a unit dual
+ * quaternion even after blending or accumulated rounding. */
+cml_inline dquat
+cml_math_dquat_normalize(const dquat a) {
+    const simde__m256d s = simde_mm256_set1_pd(1.0 /
+                           cml_math_quat_length(a.real));
+    const simde__m256d r = simde_mm256_mul_pd(a.real.q, s);
+    const simde__m256d d = simde_mm256_mul_pd(a.dual.q, s);
+    const f64 k = r[0] * d[0] + r[1] * d[1] + r[2] * d[2] + r[3] * d[3];
+    dquat o;
+    o.real.q = r;
+    o.dual.q = simde_mm256_fnmadd_pd(simde_mm256_set1_pd(k), r, d);
+    return o;
+}
+
+/* Transform a point by a unit dual quaternion: rotate, then translate. The
+ * w component is preserved. */
+cml_inline vec4
+cml_math_dquat_transform_point(const dquat a, const vec4 p) {
+    return cml_math_vec4_add(cml_math_quat_rotate(a.real, p),
+                             cml_math_dquat_translation(a));
+}
+
+/* Transform a direction or normal by a unit dual quaternion, which only
+ * rotates it. */
+cml_inline vec4
+cml_math_dquat_transform_vector(const dquat a, const vec4 v) {
+    return cml_math_quat_rotate(a.real, v);
+}
+
+/* Blend the k bones index[0 .. k) with weights weight[0 .. k) into one unit
+ * dual quaternion. Bones whose rotation lies in the opposite hemisphere from
+ * the first one are negated, so the blend follows the shorter arc. The
+ * weights need not sum to one but must not cancel out. */
+cml_inline dquat
+cml_math_dquat_blend(const dquat* bones, const u32* index, const f64* weight,
+                     const size_t k) {
+    const simde__m256d pivot = bones[index[0]].real.q;
+    simde__m256d r = simde_mm256_setzero_pd();
+    simde__m256d d = simde_mm256_setzero_pd();
+    for (size_t j = 0; j < k; j++) {
+        const dquat* b = bones + index[j];
+        const f64 dot = b->real.q[0] * pivot[0] + b->real.q[1] * pivot[1] +
+                        b->real.q[2] * pivot[2] + b->real.q[3] * pivot[3];
+        const simde__m256d w = simde_mm256_set1_pd(dot < 0.0 ? -weight[j]
+                                                             : weight[j]);
+        r = simde_mm256_fmadd_pd(w, b->real.q, r);
+        d = simde_mm256_fmadd_pd(w, b->dual.q, d);
+    }
+    dquat o;
+    o.real.q = r;
+    o.dual.q = d;
+    return cml_math_dquat_normalize(o);
+}
+
+/* Print dual quaternion. */
+cml_inline void
+cml_math_dquat_print(const dquat a) {
+    printf("dquat(%f, %f, %f, %f; %f, %f, %f, %f)\n",
+           a.real.q[0], a.real.q[1], a.real.q[2], a.real.q[3],
+           a.dual.q[0], a.dual.q[1], a.dual.q[2], a.dual.q[3]);
+}
+
+/*----------------------------------*/
+/* Dual Quaternion Skinning Kernels */
+/*----------------------------------*/
+
+/* Loads m <= 4 values, padding with zero. */
+cml_inline f64x4
+cml_math_f64x4_load_partial(const f64* p, const size_t m) {
+    if (m == 4) {
+        return simde_mm256_loadu_pd(p);
+    }
+    f64 t[4] = {0.0, 0.0, 0.0, 0.0};
+    for (size_t l = 0; l < m; l++) {
+        t[l] = p[l];
+    }
+    return simde_mm256_loadu_pd(t);
+}
+
+/* Stores the first m <= 4 lanes of v. */
+cml_inline void
+cml_math_f64x4_store_partial(f64* p, const size_t m, const f64x4 v) {
+    if (m == 4) {
+        simde_mm256_storeu_pd(p, v);
+        return;
+    }
+    f64 t[4];
+    simde_mm256_storeu_pd(t, v);
+    for (size_t l = 0; l < m; l++) {
+        p[l] = t[l];
+    }
+}
+
+/* Blends the bones of the m <= 4 vertices starting at i into real and dual
+ * parts held as w, x, y and z planes, normalized. Missing lanes repeat
+ * vertex i so the kernel sees valid input. */
+cml_inline void
+cml_math_dquat_blend_f64x4(const dquat* bones, const u32* index,
+                           const f64* weight, const size_t k, const size_t i,
+                           const size_t m, f64x4 r[4], f64x4 d[4]) {
+    const f64x4 sign = simde_mm256_set1_pd(-0.0);
+    f64x4 pivot[4];
+    for (size_t c = 0; c < 4; c++) {
+        r[c] = simde_mm256_setzero_pd();
+        d[c] = simde_mm256_setzero_pd();
+    }
+    for (size_t j = 0; j < k; j++) {
+        f64x4 br[4], bd[4];
+        f64 w[4];
+        for (size_t l = 0; l < 4; l++) {
+            const size_t v = (i + (l < m ? l : 0)) * k + j;
+            br[l] = bones[index[v]].real.q;
+            bd[l] = bones[index[v]].dual.q;
+            w[l]  = weight[v];
+        }
+        cml_math_f64x4_transpose(br);
+        cml_math_f64x4_transpose(bd);
+        if (j == 0) {
+            for (size_t c = 0; c < 4; c++) {
+                pivot[c] = br[c];
+            }
+        }
+        /* Negate the weight of bones in the other hemisphere. */
+        f64x4 dot;
+        dot = simde_mm256_mul_pd(br[0], pivot[0]);
+        dot = simde_mm256_fmadd_pd(br[1], pivot[1], dot);
+        dot = simde_mm256_fmadd_pd(br[2], pivot[2], dot);
+        dot = simde_mm256_fmadd_pd(br[3], pivot[3], dot);
+        const f64x4 ws = simde_mm256_xor_pd(simde_mm256_loadu_pd(w),
+                                            simde_mm256_and_pd(dot, sign));
+        for (size_t c = 0; c < 4; c++) {
+            r[c] = simde_mm256_fmadd_pd(ws, br[c], r[c]);
+            d[c] = simde_mm256_fmadd_pd(ws, bd[c], d[c]);
+        }
+    }
+    /* Scale by 1 / |r|. The part of d along r is left in: it only reaches
+     * the scalar part of d * conjugate(r), which the translation drops. */
+    f64x4 len;
+    len = simde_mm256_mul_pd(r[0], r[0]);
+    len = simde_mm256_fmadd_pd(r[1], r[1], len);
+    len = simde_mm256_fmadd_pd(r[2], r[2], len);
+    len = simde_mm256_fmadd_pd(r[3], r[3], len);
+    const f64x4 inv = simde_mm256_div_pd(simde_mm256_set1_pd(1.0),
+                                         simde_mm256_sqrt_pd(len));
+    for (size_t c = 0; c < 4; c++) {
+        r[c] = simde_mm256_mul_pd(r[c], inv);
+        d[c] = simde_mm256_mul_pd(d[c], inv);
+    }
+}
+
+/* Rotates the vectors (x, y, z) by the unit quaternions r held as planes,
+ * v' = v + 2 * cross(r.xyz, cross(r.xyz, v) + r.w * v). */
+cml_inline void
+cml_math_dquat_rotate_f64x4(const f64x4 r[4], f64x4* x, f64x4* y,
+                            f64x4* z) {
+    const f64x4 ax = simde_mm256_fmadd_pd(r[0], *x, simde_mm256_fmsub_pd(
+                     r[2], *z, simde_mm256_mul_pd(r[3], *y)));
+    const f64x4 ay = simde_mm256_fmadd_pd(r[0], *y, simde_mm256_fmsub_pd(
+                     r[3], *x, simde_mm256_mul_pd(r[1], *z)));
+    const f64x4 az = simde_mm256_fmadd_pd(r[0], *z, simde_mm256_fmsub_pd(
+                     r[1], *y, simde_mm256_mul_pd(r[2], *x)));
+    const f64x4 two = simde_mm256_set1_pd(2.0);
+    *x = simde_mm256_fmadd_pd(two, simde_mm256_fmsub_pd(r[2], az,
+                              simde_mm256_mul_pd(r[3], ay)), *x);
+    *y = simde_mm256_fmadd_pd(two, simde_mm256_fmsub_pd(r[3], ax,
+                              simde_mm256_mul_pd(r[1], az)), *y);
+    *z = simde_mm256_fmadd_pd(two, simde_mm256_fmsub_pd(r[1], ay,
+                              simde_mm256_mul_pd(r[2], ax)), *z);
+}
+
+/* Dual-quaternion skinning of the pos->n vertices of a stream. Vertex i is
+ * influenced by the k bones index[i * k .. i * k + k) with weights
+ * weight[i * k .. i * k + k), blended as cml_math_dquat_blend does. Skinned
+ * positions go to out_pos and, if nrm is not NULL, rotated normals to
+ * out_nrm; both may alias their input, and w is copied through. Four
+ * vertices are blended at a time, with each bone read as eight f64. */
+static inline void
+cml_math_dquat_skin(const dquat* bones, const u32* index, const f64* weight,
+                    const size_t k, const vec4_soa* pos, const vec4_soa* nrm,
+                    vec4_soa* out_pos, vec4_soa* out_nrm) {
+    const size_t n = pos->n;
+    const f64x4 two = simde_mm256_set1_pd(2.0);
+    for (size_t i = 0; i < n; i += 4) {
+        const size_t m = n - i < 4 ? n - i : 4;
+        f64x4 r[4], d[4];
+        cml_math_dquat_blend_f64x4(bones, index, weight, k, i, m, r, d);
+        /* t = 2 * (r.w * d.xyz - d.w * r.xyz + cross(r.xyz, d.xyz)). */
+        f64x4 tx, ty, tz;
+        tx = simde_mm256_fmsub_pd(r[2], d[3], simde_mm256_mul_pd(r[3], d[2]));
+        ty = simde_mm256_fmsub_pd(r[3], d[1], simde_mm256_mul_pd(r[1], d[3]));
+        tz = simde_mm256_fmsub_pd(r[1], d[2], simde_mm256_mul_pd(r[2], d[1]));
+        tx = simde_mm256_fnmadd_pd(d[0], r[1], simde_mm256_fmadd_pd(r[0],
+                                   d[1], tx));
+        ty = simde_mm256_fnmadd_pd(d[0], r[2], simde_mm256_fmadd_pd(r[0],
+                                   d[2], ty));
+        tz = simde_mm256_fnmadd_pd(d[0], r[3], simde_mm256_fmadd_pd(r[0],
+                                   d[3], tz));
+        f64x4 x = cml_math_f64x4_load_partial(pos->x + i, m);
+        f64x4 y = cml_math_f64x4_load_partial(pos->y + i, m);
+        f64x4 z = cml_math_f64x4_load_partial(pos->z + i, m);
+        cml_math_dquat_rotate_f64x4(r, &x, &y, &z);
+        cml_math_f64x4_store_partial(out_pos->x + i, m,
+                                     simde_mm256_fmadd_pd(two, tx, x));
+        cml_math_f64x4_store_partial(out_pos->y + i, m,
+                                     simde_mm256_fmadd_pd(two, ty, y));
+        cml_math_f64x4_store_partial(out_pos->z + i, m,
+                                     simde_mm256_fmadd_pd(two, tz, z));
+        for (size_t l = 0; l < m; l++) {
+            out_pos->w[i + l] = pos->w[i + l];
+        }
+        if (nrm) {
+            x = cml_math_f64x4_load_partial(nrm->x + i, m);
+            y = cml_math_f64x4_load_partial(nrm->y + i, m);
+            z = cml_math_f64x4_load_partial(nrm->z + i, m);
+            cml_math_dquat_rotate_f64x4(r, &x, &y, &z);
+            cml_math_f64x4_store_partial(out_nrm->x + i, m, x);
+            cml_math_f64x4_store_partial(out_nrm->y + i, m, y);
+            cml_math_f64x4_store_partial(out_nrm->z + i, m, z);
+            for (size_t l = 0; l < m; l++) {
+                out_nrm->w[i + l] = nrm->w[i + l];
+            }
+        }
+    }
+}
+
+/*============================================================================*/
+/* Factorials, Binomials and Bernstein Polynomials                            */
+/*============================================================================*/
+
+/* n! for n <= CML_FACTORIAL_MAX is read from a table of correctly rounded
+ * f64 values. The entries up to 22! are exact, so factorials up to 20! also
+ * convert exactly to u64. Binomial coefficients divide table entries and
+ * round to the nearest integer, which is exact for n <= 54 and within three
+ * ulp up to CML_FACTORIAL_MAX. Larger arguments go through lgamma. */
+
+/* Largest n with a finite f64 factorial. */
+#define CML_FACTORIAL_MAX 170
+
+/* n! for n = 0 .. CML_FACTORIAL_MAX. */
+static const f64 cml_factorial_table[CML_FACTORIAL_MAX + 1] = {
+    1.0, 1.0, 2.0, 6.0, 24.0, 120.0, 720.0, 5040.0, 40320.0, 362880.0,
+    3628800.0, 39916800.0, 479001600.0, 6227020800.0, 87178291200.0,
+    1307674368000.0, 20922789888000.0, 355687428096000.0, 6402373705728000.0,
+    1.21645100408832e+17, 2.43290200817664e+18, 5.109094217170944e+19,
+    1.1240007277776077e+21, 2.585201673888498e+22, 6.204484017332394e+23,
+    1.5511210043330986e+25, 4.0329146112660565e+26, 1.0888869450418352e+28,
+    3.0488834461171387e+29, 8.841761993739702e+30, 2.6525285981219107e+32,
+    8.222838654177922e+33, 2.631308369336935e+35, 8.683317618811886e+36,
+    2.9523279903960416e+38, 1.0333147966386145e+40, 3.7199332678990125e+41,
+    1.3763753091226346e+43, 5.230226174666011e+44, 2.0397882081197444e+46,
+    8.159152832478977e+47, 3.345252661316381e+49, 1.40500611775288e+51,
+    6.041526306337383e+52, 2.658271574788449e+54, 1.1962222086548019e+56,
+    5.502622159812089e+57, 2.5862324151116818e+59, 1.2413915592536073e+61,
+    6.082818640342675e+62, 3.0414093201713376e+64, 1.5511187532873822e+66,
+    8.065817517094388e+67, 4.2748832840600255e+69, 2.308436973392414e+71,
+    1.2696403353658276e+73, 7.109985878048635e+74, 4.0526919504877214e+76,
+    2.3505613312828785e+78, 1.3868311854568984e+80, 8.32098711274139e+81,
+    5.075802138772248e+83, 3.146997326038794e+85, 1.98260831540444e+87,
+    1.2688693218588417e+89, 8.247650592082472e+90, 5.443449390774431e+92,
+    3.647111091818868e+94, 2.4800355424368305e+96, 1.711224524281413e+98,
+    1.1978571669969892e+100, 8.504785885678623e+101, 6.1234458376886085e+103,
+    4.4701154615126844e+105, 3.307885441519386e+107, 2.48091408113954e+109,
+    1.8854947016660504e+111, 1.4518309202828587e+113, 1.1324281178206297e+115,
+    8.946182130782976e+116, 7.156945704626381e+118, 5.797126020747368e+120,
+    4.753643337012842e+122, 3.945523969720659e+124, 3.314240134565353e+126,
+    2.81710411438055e+128, 2.4227095383672734e+130, 2.107757298379528e+132,
+    1.8548264225739844e+134, 1.650795516090846e+136, 1.4857159644817615e+138,
+    1.352001527678403e+140, 1.2438414054641308e+142, 1.1567725070816416e+144,
+    1.087366156656743e+146, 1.032997848823906e+148, 9.916779348709496e+149,
+    9.619275968248212e+151, 9.426890448883248e+153, 9.332621544394415e+155,
+    9.332621544394415e+157, 9.42594775983836e+159, 9.614466715035127e+161,
+    9.90290071648618e+163, 1.0299016745145628e+166, 1.081396758240291e+168,
+    1.1462805637347084e+170, 1.226520203196138e+172, 1.324641819451829e+174,
+    1.4438595832024937e+176, 1.588245541522743e+178, 1.7629525510902446e+180,
+    1.974506857221074e+182, 2.2311927486598138e+184, 2.5435597334721877e+186,
+    2.925093693493016e+188, 3.393108684451898e+190, 3.969937160808721e+192,
+    4.684525849754291e+194, 5.574585761207606e+196, 6.689502913449127e+198,
+    8.094298525273444e+200, 9.875044200833601e+202, 1.214630436702533e+205,
+    1.506141741511141e+207, 1.882677176888926e+209, 2.372173242880047e+211,
+    3.0126600184576594e+213, 3.856204823625804e+215, 4.974504222477287e+217,
+    6.466855489220474e+219, 8.47158069087882e+221, 1.1182486511960043e+224,
+    1.4872707060906857e+226, 1.9929427461615188e+228, 2.6904727073180504e+230,
+    3.659042881952549e+232, 5.012888748274992e+234, 6.917786472619489e+236,
+    9.615723196941089e+238, 1.3462012475717526e+241, 1.898143759076171e+243,
+    2.695364137888163e+245, 3.854370717180073e+247, 5.5502938327393044e+249,
+    8.047926057471992e+251, 1.1749972043909107e+254, 1.727245890454639e+256,
+    2.5563239178728654e+258, 3.80892263763057e+260, 5.713383956445855e+262,
+    8.62720977423324e+264, 1.3113358856834524e+267, 2.0063439050956823e+269,
+    3.0897696138473508e+271, 4.789142901463394e+273, 7.471062926282894e+275,
+    1.1729568794264145e+278, 1.853271869493735e+280, 2.9467022724950384e+282,
+    4.7147236359920616e+284, 7.590705053947219e+286, 1.2296942187394494e+289,
+    2.0044015765453026e+291, 3.287218585534296e+293, 5.423910666131589e+295,
+    9.003691705778438e+297, 1.503616514864999e+300, 2.5260757449731984e+302,
+    4.269068009004705e+304, 7.257415615307999e+306
+};
+
+/* Returns n!, or +inf when n > CML_FACTORIAL_MAX. */
+cml_inline f64
+cml_math_factorial_f64(const u32 n) {
+    return n <= CML_FACTORIAL_MAX ? cml_factorial_table[n] : HUGE_VAL;
+}
+
+/* Returns n! exactly, or 0 when n > 20 and n! does not fit in a u64. */
+cml_inline u64
+cml_math_factorial_u64(const u32 n) {
+    return n <= 20 ? (u64)cml_factorial_table[n] : 0;
+}
+
+/* Returns log(n!). */
+cml_inline f64
+cml_math_log_factorial(const u32 n) {
+    return n <= CML_FACTORIAL_MAX ? log(cml_factorial_table[n])
+                                  : lgamma((f64)n + 1.0);
+}
+
+/* Returns the binomial coefficient C(n, k), 0 when k > n. Above
+ * CML_FACTORIAL_MAX the relative error grows with log(n!) * DBL_EPSILON,
+ * and results beyond the f64 range are +inf. */
+cml_inline f64
+cml_math_binomial_f64(const u32 n, const u32 k) {
+    if (k > n) {
+        return 0.0;
+    }
+    if (n <= CML_FACTORIAL_MAX) {
+        return round(cml_factorial_table[n] /
+                     (cml_factorial_table[k] * cml_factorial_table[n - k]));
+    }
+    return round(exp(cml_math_log_factorial(n) - cml_math_log_factorial(k) -
+                     cml_math_log_factorial(n - k)));
+}
+
+/* Returns the Bernstein basis polynomial C(n, i) t^i (1 - t)^(n - i). */
+cml_inline f64
+cml_math_bernstein(const u32 n, const u32 i, const f64 t) {
+    if (i > n) {
+        return 0.0;
+    }
+    return cml_math_binomial_f64(n, i) * pow(t, (f64)i) *
+           pow(1.0 - t, (f64)(n - i));
+}
+
+/* Writes the n + 1 Bernstein basis polynomials of degree n at t to out. */
+static inline void
+cml_math_bernstein_basis(const u32 n, const f64 t, f64* out) {
+    const f64 u = 1.0 - t;
+    f64 p = 1.0;
+    for (u32 i = 0; i <= n; i++) {
+        out[i] = cml_math_binomial_f64(n, i) * p;
+        p *= t;
+    }
+    p = 1.0;
+    for (u32 i = n + 1; i-- > 0;) {
+        out[i] *= p;
+        p *= u;
+    }
+}
+
+/* Evaluates sum_i w[i] t^i (1 - t)^(n - i) at a vector of t with the
+ * Horner-like scheme for the Bernstein form, where w[i] = c[i] C(n, i).
+ * For t in [0, 1] the basis polynomials are non-negative, so with
+ * non-negative coefficients no term cancels; mixed signs in c can still
+ * cancel as in any polynomial sum. */
+cml_inline f64xn
+cml_math_bernstein_f64xn(const f64* w, const u32 n, const f64xn t) {
+    if (n == 0) {
+        return cml_f64xn_set1(w[0]);
+    }
+    const f64xn u = cml_f64xn_sub(cml_f64xn_set1(1.0), t);
+    f64xn tn = cml_f64xn_set1(1.0);
+    f64xn r  = cml_f64xn_mul(cml_f64xn_set1(w[0]), u);
+    for (u32 i = 1; i < n; i++) {
+        tn = cml_f64xn_mul(tn, t);
+        r  = cml_f64xn_mul(cml_f64xn_fmadd(tn, cml_f64xn_set1(w[i]), r), u);
+    }
+    return cml_f64xn_fmadd(cml_f64xn_mul(tn, t), cml_f64xn_set1(w[n]), r);
+}
+
+/* Evaluates the degree n Bernstein polynomial with coefficients c[0 .. n]
+ * at m parameters, out[j] = sum_i c[i] B(n, i, t[j]). The binomials are
+ * folded into the coefficients once, then every vector of parameters costs
+ * n multiply-adds and 2n multiplies. Degrees above CML_FACTORIAL_MAX write
+ * NaN. */
+static inline void
+cml_math_bernstein_eval_array(const f64* c, const u32 n, const f64* t,
+                              f64* out, const size_t m) {
+    if (n > CML_FACTORIAL_MAX) {
+        for (size_t j = 0; j < m; j++) {
+            out[j] = NAN;
+        }
+        return;
+    }
+    f64 w[CML_FACTORIAL_MAX + 1];
+    for (u32 i = 0; i <= n; i++) {
+        w[i] = c[i] * cml_math_binomial_f64(n, i);
+    }
+    size_t j = 0;
+    for (; j + CML_F64XN_LANES <= m; j += CML_F64XN_LANES) {
+        cml_f64xn_storeu(out + j,
+                         cml_math_bernstein_f64xn(w, n,
+                                                  cml_f64xn_loadu(t + j)));
+    }
+    if (j < m) {
+        f64 x[CML_F64XN_LANES];
+        for (size_t k = 0; k < CML_F64XN_LANES; k++) {
+            x[k] = j + k < m ? t[j + k] : 0.5;
+        }
+        cml_f64xn_storeu(x, cml_math_bernstein_f64xn(w, n,
+                                                     cml_f64xn_loadu(x)));
+        for (size_t k = 0; j + k < m; k++) {
+            out[j + k] = x[k];
+        }
+    }
+}
+
+/*============================================================================*/
+/* Spline Evaluation                                                          */
+/*============================================================================*/
+
+/* A cubic segment is p(t) = [1 t t^2 t^3] * B * G for t in [0, 1], where G
+ * holds four control points as rows and B is the basis matrix of the curve
+ * kind. The product C = B * G is computed once per segment; every sample
+ * after that is three multiply-adds on whole vec4s. A track is an array of
+ * control points, and segment s reads the four consecutive points starting
+ * at s * step:
+ *   Catmull-Rom  step 1, p[s .. s + 3], passes through p[s + 1], p[s + 2]
+ *   Bezier       step 3, p[3s .. 3s + 3], endpoints shared between segments
+ *   Hermite      step 2, point, tangent, point, tangent, ...
+ *   B-spline     step 1, uniform cubic, C2 but not interpolating */
+
+typedef enum cml_spline_kind {
+    CML_SPLINE_CATMULL_ROM,
+    CML_SPLINE_BEZIER,
+    CML_SPLINE_HERMITE,
+    CML_SPLINE_BSPLINE
+} cml_spline_kind;
+
+/* Basis matrix of a curve kind; row k holds the weights of t^k. */
+cml_inline mat4
+cml_math_spline_basis(const cml_spline_kind kind) {
+    switch (kind) {
+    case CML_SPLINE_CATMULL_ROM:
+        return cml_math_mat4( 0.0,  1.0,  0.0,  0.0,
+                             -0.5,  0.0,  0.5,  0.0,
+                              1.0, -2.5,  2.0, -0.5,
+                             -0.5,  1.5, -1.5,  0.5);
+    case CML_SPLINE_BEZIER:
+        return cml_math_mat4( 1.0,  0.0,  0.0,  0.0,
+                             -3.0,  3.0,  0.0,  0.0,
+                              3.0, -6.0,  3.0,  0.0,
+                             -1.0,  3.0, -3.0,  1.0);
+    case CML_SPLINE_HERMITE:
+        return cml_math_mat4( 1.0,  0.0,  0.0,  0.0,
+                              0.0,  1.0,  0.0,  0.0,
+                             -3.0, -2.0,  3.0, -1.0,
+                              2.0,  1.0, -2.0,  1.0);
+    case CML_SPLINE_BSPLINE:
+    default:
+        return cml_math_mat4( 1.0 / 6.0,  4.0 / 6.0,  1.0 / 6.0, 0.0,
+                             -3.0 / 6.0,  0.0,        3.0 / 6.0, 0.0,
+                              3.0 / 6.0, -6.0 / 6.0,  3.0 / 6.0, 0.0,
+                             -1.0 / 6.0,  3.0 / 6.0, -3.0 / 6.0, 1.0 / 6.0);
+    }
+}
+
+/* Distance, in control points, between the starts of two segments. */
+cml_inline size_t
+cml_math_spline_step(const cml_spline_kind kind) {
+    return kind == CML_SPLINE_BEZIER ? 3 : kind == CML_SPLINE_HERMITE ? 2 : 1;
+}
+
+/* Number of whole segments in a track of n control points. */
+cml_inline size_t
+cml_math_spline_segment_count(const cml_spline_kind kind, const size_t n) {
+    return n < 4 ? 0 : (n - 4) / cml_math_spline_step(kind) + 1;
+}
+
+/* Coefficient matrix C = B * G of segment s; row k is the coefficient of
+ * t^k. */
+cml_inline mat4
+cml_math_spline_segment(const cml_spline_kind kind, const vec4* p,
+                        const size_t s) {
+    const vec4* g = p + s * cml_math_spline_step(kind);
+    mat4 m;
+    m.m[0] = g[0].v;
+    m.m[1] = g[1].v;
+    m.m[2] = g[2].v;
+    m.m[3] = g[3].v;
+    return cml_math_mat4_mul(cml_math_spline_basis(kind), m);
+}
+
+/* Point of a segment at t, by Horner's rule on the coefficient rows. */
+cml_inline vec4
+cml_math_spline_eval(const mat4* c, const f64 t) {
+    const simde__m256d tt = simde_mm256_set1_pd(t);
+    vec4 r;
+    r.v = simde_mm256_fmadd_pd(simde_mm256_fmadd_pd(
+          simde_mm256_fmadd_pd(c->m[3], tt, c->m[2]), tt, c->m[1]), tt,
+          c->m[0]);
+    return r;
+}
+
+/* Derivative of a segment with respect to t, the tangent of the curve. */
+cml_inline vec4
+cml_math_spline_eval_derivative(const mat4* c, const f64 t) {
+    const simde__m256d tt = simde_mm256_set1_pd(t);
+    vec4 r;
+    r.v = simde_mm256_fmadd_pd(simde_mm256_fmadd_pd(
+          simde_mm256_mul_pd(c->m[3], simde_mm256_set1_pd(3.0)), tt,
+          simde_mm256_mul_pd(c->m[2], simde_mm256_set1_pd(2.0))), tt,
+          c->m[1]);
+    return r;
+}
+
+/* Evaluate a track of n control points at the m parameters u, writing
+ * out[i]. Segment s covers u in [s, s + 1], so u runs over
+ * [0, cml_math_spline_segment_count]; values outside extrapolate the first
+ * or last segment. The coefficients are only rebuilt when the segment
+ * changes, so sorted or clustered u cost three multiply-adds per sample.
+ * The track must hold at least one segment. */
+static inline void
+cml_math_spline_eval_array(const cml_spline_kind kind, const vec4* p,
+                           const size_t n, const f64* u, vec4* out,
+                           const size_t m) {
+    const size_t segs = cml_math_spline_segment_count(kind, n);
+    const f64    last = (f64)(segs - 1);
+    size_t cur = 0;
+    mat4   c   = cml_math_spline_segment(kind, p, 0);
+    for (size_t i = 0; i < m; i++) {
+        /* NaN falls into the first segment. */
+        const f64 f = floor(u[i]);
+        const f64 k = !(f > 0.0) ? 0.0 : f < last ? f : last;
+        const size_t s = (size_t)k;
+        if (s != cur) {
+            cur = s;
+            c   = cml_math_spline_segment(kind, p, s);
+        }
+        out[i] = cml_math_spline_eval(&c, u[i] - k);
+    }
+}
+
+/* Sample every segment of a track of n control points at per_segment
+ * evenly spaced t = j / per_segment, then the end of the last segment,
+ * writing segments * per_segment + 1 points to out. Returns that count.
+ * Within a segment the samples come from forward differences, three vector
+ * adds per point. The differences restart exactly at every segment; their
+ * rounding error grows with the square of per_segment and is about 1e-13
+ * of the coordinate scale at 1000 samples per segment. */
+static inline size_t
+cml_math_spline_sample_uniform(const cml_spline_kind kind, const vec4* p,
+                               const size_t n, const size_t per_segment,
+                               vec4* out) {
+    const size_t segs = cml_math_spline_segment_count(kind, n);
+    if (segs == 0 || per_segment == 0) {
+        return 0;
+    }
+    const f64 h = 1.0 / (f64)per_segment;
+    const simde__m256d h1 = simde_mm256_set1_pd(h);
+    const simde__m256d h2 = simde_mm256_set1_pd(h * h);
+    const simde__m256d h3 = simde_mm256_set1_pd(h * h * h);
+    mat4 c;
+    for (size_t s = 0; s < segs; s++) {
+        c = cml_math_spline_segment(kind, p, s);
+        /* First, second and third differences of the cubic at step h. */
+        const simde__m256d c2 = simde_mm256_mul_pd(c.m[2], h2);
+        const simde__m256d c3 = simde_mm256_mul_pd(c.m[3], h3);
+        const simde__m256d d3 = simde_mm256_mul_pd(c3,
+                                simde_mm256_set1_pd(6.0));
+        simde__m256d f  = c.m[0];
+        simde__m256d d1 = simde_mm256_add_pd(simde_mm256_fmadd_pd(c.m[1], h1,
+                                             c2), c3);
+        simde__m256d d2 = simde_mm256_fmadd_pd(c2, simde_mm256_set1_pd(2.0),
+                                               d3);
+        vec4* o = out + s * per_segment;
+        for (size_t j = 0; j < per_segment; j++) {
+            o[j].v = f;
+            f  = simde_mm256_add_pd(f, d1);
+            d1 = simde_mm256_add_pd(d1, d2);
+            d2 = simde_mm256_add_pd(d2, d3);
+        }
+    }
+    out[segs * per_segment] = cml_math_spline_eval(&c, 1.0);
+    return segs * per_segment + 1;
+}
+
+/*============================================================================*/
+/* Frustum Culling                                                            */
+/*============================================================================*/
+
+/* Plane indices of a frustum. */
+typedef enum cml_frustum_plane {
+    CML_FRUSTUM_LEFT,
+    CML_FRUSTUM_RIGHT,
+    CML_FRUSTUM_BOTTOM,
+    CML_FRUSTUM_TOP,
+    CML_FRUSTUM_NEAR,
+    CML_FRUSTUM_FAR,
+    CML_FRUSTUM_PLANES
+} cml_frustum_plane;
+
+/* The six planes bounding the volume a view-projection matrix maps into the
+ * clip cube. Each plane (a, b, c, d) has a unit normal (a, b, c) pointing
+ * inward, so a * x + b * y + c * z + d is the signed distance of a point. */
+typedef struct frustum {
+    vec4 p[CML_FRUSTUM_PLANES];
+} frustum;
+
+/*-------------------------*/
+/* Frustum Setup Functions */
+/*-------------------------*/
+
+/* Extract the planes of a view-projection matrix, such as the product of
+ * cml_math_mat4_look_at and cml_math_mat4_perspective. Points are row vectors
+ * (clip = v * m), so column j of m yields clip component j, and each plane
+ * is the w column plus or minus one of the others. */
+cml_inline frustum
+cml_math_frustum_from_mat4(const mat4 m) {
+    f64x4 c[4] = {m.m[0], m.m[1], m.m[2], m.m[3]};
+    cml_math_f64x4_transpose(c);
+    frustum f;
+    f.p[CML_FRUSTUM_LEFT].v   = simde_mm256_add_pd(c[3], c[0]);
+    f.p[CML_FRUSTUM_RIGHT].v  = simde_mm256_sub_pd(c[3], c[0]);
+    f.p[CML_FRUSTUM_BOTTOM].v = simde_mm256_add_pd(c[3], c[1]);
+    f.p[CML_FRUSTUM_TOP].v    = simde_mm256_sub_pd(c[3], c[1]);
+    f.p[CML_FRUSTUM_NEAR].v   = simde_mm256_add_pd(c[3], c[2]);
+    f.p[CML_FRUSTUM_FAR].v    = simde_mm256_sub_pd(c[3], c[2]);
+    for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+        const f64* p = (const f64*)&f.p[k].v;
+        const f64  s = 1.0 / sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        f.p[k].v = simde_mm256_mul_pd(f.p[k].v, simde_mm256_set1_pd(s));
+    }
+    return f;
+}
+
+/*-------------------------*/
+/* Single Object Functions */
+/*-------------------------*/
+
+/* Returns true if the sphere with center (s.x, s.y, s.z) and radius s.w is
+ * at least partly inside the frustum. */
+cml_inline bool
+cml_math_frustum_test_sphere(const frustum* f, const vec4 s) {
+    const f64* c = (const f64*)&s.v;
+    for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+        const f64* p = (const f64*)&f->p[k].v;
+        if (p[0] * c[0] + p[1] * c[1] + p[2] * c[2] + p[3] < -c[3]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Returns true if the box spanning lo to hi (w ignored) is at least partly
+ * inside the frustum. Tests, for each plane, the corner furthest along its
+ * normal; boxes near a frustum corner may be kept although outside. */
+cml_inline bool
+cml_math_frustum_test_aabb(const frustum* f, const vec4 lo, const vec4 hi) {
+    const f64* a = (const f64*)&lo.v;
+    const f64* b = (const f64*)&hi.v;
+    for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+        const f64* p = (const f64*)&f->p[k].v;
+        const f64  x = p[0] >= 0.0 ? b[0] : a[0];
+        const f64  y = p[1] >= 0.0 ? b[1] : a[1];
+        const f64  z = p[2] >= 0.0 ? b[2] : a[2];
+        if (p[0] * x + p[1] * y + p[2] * z + p[3] < 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*-------------------------*/
+/* Batch Culling Functions */
+/*-------------------------*/
+
+/* Batch results are bitmasks with bit i % 64 of word i / 64 set for each
+ * visible object, so a mask for n objects holds (n + 63) / 64 words and the
+ * bits past n in the last word are clear. The vector loops agree with the
+ * single object tests their tails use: an object is culled only when some
+ * plane distance compares below the bound, so a NaN distance never culls.
+ * The running minimum starts at +inf and takes each new distance as the
+ * first operand of min, which drops it when it is NaN. */
+
+/* Returns the visibility bits of the m <= 64 spheres starting at i. */
+cml_inline u64
+cml_math_frustum_spheres_word(const frustum* f, const vec4_soa* s,
+                              const size_t i, const size_t m) {
+    f64xn pa[CML_FRUSTUM_PLANES], pb[CML_FRUSTUM_PLANES];
+    f64xn pc[CML_FRUSTUM_PLANES], pd[CML_FRUSTUM_PLANES];
+    for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+        const f64* p = (const f64*)&f->p[k].v;
+        pa[k] = cml_f64xn_set1(p[0]);
+        pb[k] = cml_f64xn_set1(p[1]);
+        pc[k] = cml_f64xn_set1(p[2]);
+        pd[k] = cml_f64xn_set1(p[3]);
+    }
+    const f64xn zero = cml_f64xn_set1(0.0);
+    const f64xn inf  = cml_f64xn_set1(HUGE_VAL);
+    u64 bits = 0;
+    size_t j = 0;
+    for (; j + CML_F64XN_LANES <= m; j += CML_F64XN_LANES) {
+        const f64xn x = cml_f64xn_loadu(s->x + i + j);
+        const f64xn y = cml_f64xn_loadu(s->y + i + j);
+        const f64xn z = cml_f64xn_loadu(s->z + i + j);
+        const f64xn r = cml_f64xn_loadu(s->w + i + j);
+        /* Nearest plane distance; visible unless it is below -r. */
+        f64xn d = inf;
+        for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+            d = cml_f64xn_min(cml_f64xn_fmadd(pa[k], x,
+                cml_f64xn_fmadd(pb[k], y, cml_f64xn_fmadd(pc[k], z, pd[k]))),
+                d);
+        }
+        bits |= (u64)cml_f64xn_cmpnlt_mask(cml_f64xn_add(d, r), zero) << j;
+    }
+    for (; j < m; j++) {
+        const vec4 c = cml_math_vec4_set(s->x[i + j], s->y[i + j],
+                                         s->z[i + j], s->w[i + j]);
+        bits |= (u64)cml_math_frustum_test_sphere(f, c) << j;
+    }
+    return bits;
+}
+
+/* Returns the visibility bits of the m <= 64 boxes starting at i. Each plane
+ * tests the box corner furthest along its normal, which is picked once per
+ * plane by reading x, y and z from either the lo or the hi stream. */
+cml_inline u64
+cml_math_frustum_aabbs_word(const frustum* f, const vec4_soa* lo,
+                            const vec4_soa* hi, const size_t i,
+                            const size_t m) {
+    f64xn pa[CML_FRUSTUM_PLANES], pb[CML_FRUSTUM_PLANES];
+    f64xn pc[CML_FRUSTUM_PLANES], pd[CML_FRUSTUM_PLANES];
+    const f64* vx[CML_FRUSTUM_PLANES];
+    const f64* vy[CML_FRUSTUM_PLANES];
+    const f64* vz[CML_FRUSTUM_PLANES];
+    for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+        const f64* p = (const f64*)&f->p[k].v;
+        pa[k] = cml_f64xn_set1(p[0]);
+        pb[k] = cml_f64xn_set1(p[1]);
+        pc[k] = cml_f64xn_set1(p[2]);
+        pd[k] = cml_f64xn_set1(p[3]);
+        vx[k] = (p[0] >= 0.0 ? hi->x : lo->x) + i;
+        vy[k] = (p[1] >= 0.0 ? hi->y : lo->y) + i;
+        vz[k] = (p[2] >= 0.0 ? hi->z : lo->z) + i;
+    }
+    const f64xn zero = cml_f64xn_set1(0.0);
+    const f64xn inf  = cml_f64xn_set1(HUGE_VAL);
+    u64 bits = 0;
+    size_t j = 0;
+    for (; j + CML_F64XN_LANES <= m; j += CML_F64XN_LANES) {
+        f64xn d = inf;
+        for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+            d = cml_f64xn_min(
+                cml_f64xn_fmadd(pa[k], cml_f64xn_loadu(vx[k] + j),
+                cml_f64xn_fmadd(pb[k], cml_f64xn_loadu(vy[k] + j),
+                cml_f64xn_fmadd(pc[k], cml_f64xn_loadu(vz[k] + j), pd[k]))),
+                d);
+        }
+        bits |= (u64)cml_f64xn_cmpnlt_mask(d, zero) << j;
+    }
+    for (; j < m; j++) {
+        const vec4 a = cml_math_vec4_set(lo->x[i + j], lo->y[i + j],
+                                         lo->z[i + j], 0.0);
+        const vec4 b = cml_math_vec4_set(hi->x[i + j], hi->y[i + j],
+                                         hi->z[i + j], 0.0);
+        bits |= (u64)cml_math_frustum_test_aabb(f, a, b) << j;
+    }
+    return bits;
+}
+
+/* Rounds the planes of a frustum to f32 for the single-precision kernels. */
+cml_inline void
+cml_math_frustum_planes_f32(const frustum* f,
+                            f32 q[CML_FRUSTUM_PLANES][4]) {
+    for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+        const f64* p = (const f64*)&f->p[k].v;
+        for (size_t c = 0; c < 4; c++) {
+            q[k][c] = (f32)p[c];
+        }
+    }
+}
+
+/* Returns the visibility bits of the m <= 64 spheres of a single-precision
+ * stream starting at i, as cml_math_frustum_spheres_word does in f32. */
+cml_inline u64
+cml_math_frustum_spheres_word_f32(const f32 q[CML_FRUSTUM_PLANES][4],
+                                  const vec4f_soa* s, const size_t i,
+                                  const size_t m) {
+    f32xn pa[CML_FRUSTUM_PLANES], pb[CML_FRUSTUM_PLANES];
+    f32xn pc[CML_FRUSTUM_PLANES], pd[CML_FRUSTUM_PLANES];
+    for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+        pa[k] = cml_f32xn_set1(q[k][0]);
+        pb[k] = cml_f32xn_set1(q[k][1]);
+        pc[k] = cml_f32xn_set1(q[k][2]);
+        pd[k] = cml_f32xn_set1(q[k][3]);
+    }
+    const f32xn zero = cml_f32xn_set1(0.0f);
+    const f32xn inf  = cml_f32xn_set1(HUGE_VALF);
+    u64 bits = 0;
+    size_t j = 0;
+    for (; j + CML_F32XN_LANES <= m; j += CML_F32XN_LANES) {
+        const f32xn x = cml_f32xn_loadu(s->x + i + j);
+        const f32xn y = cml_f32xn_loadu(s->y + i + j);
+        const f32xn z = cml_f32xn_loadu(s->z + i + j);
+        const f32xn r = cml_f32xn_loadu(s->w + i + j);
+        f32xn d = inf;
+        for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+            d = cml_f32xn_min(cml_f32xn_fmadd(pa[k], x,
+                cml_f32xn_fmadd(pb[k], y, cml_f32xn_fmadd(pc[k], z, pd[k]))),
+                d);
+        }
+        bits |= (u64)cml_f32xn_cmpnlt_mask(cml_f32xn_add(d, r), zero) << j;
+    }
+    /* The tail repeats the lane arithmetic, min operand order included. */
+    for (; j < m; j++) {
+        f32 d = HUGE_VALF;
+        for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+            const f32 e = fmaf(q[k][0], s->x[i + j], fmaf(q[k][1], s->y[i + j],
+                          fmaf(q[k][2], s->z[i + j], q[k][3])));
+            d = e < d ? e : d;
+        }
+        bits |= (u64)!(d + s->w[i + j] < 0.0f) << j;
+    }
+    return bits;
+}
+
+/* Returns the visibility bits of the m <= 64 boxes of single-precision
+ * streams starting at i, as cml_math_frustum_aabbs_word does in f32. */
+cml_inline u64
+cml_math_frustum_aabbs_word_f32(const f32 q[CML_FRUSTUM_PLANES][4],
+                                const vec4f_soa* lo, const vec4f_soa* hi,
+                                const size_t i, const size_t m) {
+    f32xn pa[CML_FRUSTUM_PLANES], pb[CML_FRUSTUM_PLANES];
+    f32xn pc[CML_FRUSTUM_PLANES], pd[CML_FRUSTUM_PLANES];
+    const f32* vx[CML_FRUSTUM_PLANES];
+    const f32* vy[CML_FRUSTUM_PLANES];
+    const f32* vz[CML_FRUSTUM_PLANES];
+    for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+        pa[k] = cml_f32xn_set1(q[k][0]);
+        pb[k] = cml_f32xn_set1(q[k][1]);
+        pc[k] = cml_f32xn_set1(q[k][2]);
+        pd[k] = cml_f32xn_set1(q[k][3]);
+        vx[k] = (q[k][0] >= 0.0f ? hi->x : lo->x) + i;
+        vy[k] = (q[k][1] >= 0.0f ? hi->y : lo->y) + i;
+        vz[k] = (q[k][2] >= 0.0f ? hi->z : lo->z) + i;
+    }
+    const f32xn zero = cml_f32xn_set1(0.0f);
+    const f32xn inf  = cml_f32xn_set1(HUGE_VALF);
+    u64 bits = 0;
+    size_t j = 0;
+    for (; j + CML_F32XN_LANES <= m; j += CML_F32XN_LANES) {
+        f32xn d = inf;
+        for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+            d = cml_f32xn_min(
+                cml_f32xn_fmadd(pa[k], cml_f32xn_loadu(vx[k] + j),
+                cml_f32xn_fmadd(pb[k], cml_f32xn_loadu(vy[k] + j),
+                cml_f32xn_fmadd(pc[k], cml_f32xn_loadu(vz[k] + j), pd[k]))),
+                d);
+        }
+        bits |= (u64)cml_f32xn_cmpnlt_mask(d, zero) << j;
+    }
+    for (; j < m; j++) {
+        f32 d = HUGE_VALF;
+        for (size_t k = 0; k < CML_FRUSTUM_PLANES; k++) {
+            const f32 e = fmaf(q[k][0], vx[k][j], fmaf(q[k][1], vy[k][j],
+                          fmaf(q[k][2], vz[k][j], q[k][3])));
+            d = e < d ? e : d;
+        }
+        bits |= (u64)!(d < 0.0f) << j;
+    }
+    return bits;
+}
+
+/* Appends base plus the position of each set bit of w to idx, in increasing
+ * order, and returns the number appended. */
+cml_inline size_t
+cml_math_cull_bits_to_indices(u64 w, const u32 base, u32* idx) {
+    size_t c = 0;
+    while (w != 0) {
+        idx[c++] = base + cml_ctz64(w);
+        w &= w - 1;
+    }
+    return c;
+}
+
+/* Test the s->n spheres of a stream, with centers in x, y, z and radii in w,
+ * against a frustum. Writes the visibility bitmask to mask and returns the
+ * number of visible spheres. */
+static inline size_t
+cml_math_frustum_cull_spheres(const frustum* f, const vec4_soa* s, u64* mask) {
+    size_t c = 0;
+    for (size_t i = 0; i < s->n; i += 64) {
+        const size_t m = s->n - i < 64 ? s->n - i : 64;
+        const u64    w = cml_math_frustum_spheres_word(f, s, i, m);
+        mask[i / 64] = w;
+        c += cml_popcount64(w);
+    }
+    return c;
+}
+
+/* Test the spheres of a stream against a frustum, writing the indices of the
+ * visible ones to idx in increasing order. idx must hold s->n entries, and
+ * s->n must fit in a u32. Returns the number of indices written. */
+static inline size_t
+cml_math_frustum_cull_spheres_indices(const frustum* f, const vec4_soa* s,
+                                      u32* idx) {
+    size_t c = 0;
+    for (size_t i = 0; i < s->n; i += 64) {
+        const size_t m = s->n - i < 64 ? s->n - i : 64;
+        c += cml_math_cull_bits_to_indices(
+             cml_math_frustum_spheres_word(f, s, i, m), (u32)i, idx + c);
+    }
+    return c;
+}
+
+/* Test the lo->n boxes spanning lo to hi (w ignored) against a frustum.
+ * Writes the visibility bitmask to mask and returns the number of visible
+ * boxes. */
+static inline size_t
+cml_math_frustum_cull_aabbs(const frustum* f, const vec4_soa* lo,
+                            const vec4_soa* hi, u64* mask) {
+    size_t c = 0;
+    for (size_t i = 0; i < lo->n; i += 64) {
+        const size_t m = lo->n - i < 64 ? lo->n - i : 64;
+        const u64    w = cml_math_frustum_aabbs_word(f, lo, hi, i, m);
+        mask[i / 64] = w;
+        c += cml_popcount64(w);
+    }
+    return c;
+}
+
+/* Test boxes against a frustum, writing the indices of the visible ones to
+ * idx in increasing order. idx must hold lo->n entries, and lo->n must fit
+ * in a u32. Returns the number of indices written. */
+static inline size_t
+cml_math_frustum_cull_aabbs_indices(const frustum* f, const vec4_soa* lo,
+                                    const vec4_soa* hi, u32* idx) {
+    size_t c = 0;
+    for (size_t i = 0; i < lo->n; i += 64) {
+        const size_t m = lo->n - i < 64 ? lo->n - i : 64;
+        c += cml_math_cull_bits_to_indices(
+             cml_math_frustum_aabbs_word(f, lo, hi, i, m), (u32)i, idx + c);
+    }
+    return c;
+}
+
+/* Single-precision version of cml_math_frustum_cull_spheres. The planes are
+ * rounded to f32 and the distances computed in f32, so objects within f32
+ * rounding of a plane may be classified differently than in f64. With half
+ * the bytes per object, large streams take about half the time of the f64
+ * version, which is bound by memory bandwidth. */
+static inline size_t
+cml_math_frustum_cull_spheres_f32(const frustum* f, const vec4f_soa* s,
+                                  u64* mask) {
+    f32 q[CML_FRUSTUM_PLANES][4];
+    cml_math_frustum_planes_f32(f, q);
+    size_t c = 0;
+    for (size_t i = 0; i < s->n; i += 64) {
+        const size_t m = s->n - i < 64 ? s->n - i : 64;
+        const u64    w = cml_math_frustum_spheres_word_f32(q, s, i, m);
+        mask[i / 64] = w;
+        c += cml_popcount64(w);
+    }
+    return c;
+}
+
+/* Single-precision version of cml_math_frustum_cull_spheres_indices. */
+static inline size_t
+cml_math_frustum_cull_spheres_indices_f32(const frustum* f,
+                                          const vec4f_soa* s, u32* idx) {
+    f32 q[CML_FRUSTUM_PLANES][4];
+    cml_math_frustum_planes_f32(f, q);
+    size_t c = 0;
+    for (size_t i = 0; i < s->n; i += 64) {
+        const size_t m = s->n - i < 64 ? s->n - i : 64;
+        c += cml_math_cull_bits_to_indices(
+             cml_math_frustum_spheres_word_f32(q, s, i, m), (u32)i, idx + c);
+    }
+    return c;
+}
+
+/* Single-precision version of cml_math_frustum_cull_aabbs, with the caveats
+ * of cml_math_frustum_cull_spheres_f32. */
+static inline size_t
+cml_math_frustum_cull_aabbs_f32(const frustum* f, const vec4f_soa* lo,
+                                const vec4f_soa* hi, u64* mask) {
+    f32 q[CML_FRUSTUM_PLANES][4];
+    cml_math_frustum_planes_f32(f, q);
+    size_t c = 0;
+    for (size_t i = 0; i < lo->n; i += 64) {
+        const size_t m = lo->n - i < 64 ? lo->n - i : 64;
+        const u64    w = cml_math_frustum_aabbs_word_f32(q, lo, hi, i, m);
+        mask[i / 64] = w;
+        c += cml_popcount64(w);
+    }
+    return c;
+}
+
+/* Single-precision version of cml_math_frustum_cull_aabbs_indices. */
+static inline size_t
+cml_math_frustum_cull_aabbs_indices_f32(const frustum* f,
+                                        const vec4f_soa* lo,
+                                        const vec4f_soa* hi, u32* idx) {
+    f32 q[CML_FRUSTUM_PLANES][4];
+    cml_math_frustum_planes_f32(f, q);
+    size_t c = 0;
+    for (size_t i = 0; i < lo->n; i += 64) {
+        const size_t m = lo->n - i < 64 ? lo->n - i : 64;
+        c += cml_math_cull_bits_to_indices(
+             cml_math_frustum_aabbs_word_f32(q, lo, hi, i, m), (u32)i,
+             idx + c);
+    }
+    return c;
+}
+
+/* Convert the first n bits of a visibility bitmask to an index list in
+ * increasing order. Returns the number of indices written. */
+static inline size_t
+cml_math_cull_mask_to_indices(const u64* mask, const size_t n, u32* idx) {
+    size_t c = 0;
+    for (size_t i = 0; i < n; i += 64) {
+        c += cml_math_cull_bits_to_indices(mask[i / 64], (u32)i, idx + c);
+    }
+    return c;
+}
 
-/* Quaternion identity. */
-cml_inline quat
-cml_math_quat_identity(void) {
-    quat r;
-    r.q = simde_mm256_set_pd(0.0, 0.0, 0.0, 1.0);
+/*============================================================================*/
+/* Ray Intersection                                                           */
+/*============================================================================*/
+
+/* Packets of four and eight rays stored by component, so each instruction
+ * advances one component of every ray in the packet. The reciprocal
+ * directions used by the slab test are computed once when the packet is
+ * built. The tests are branch-free and return a bitmask with bit i set if
+ * ray i hits; the distances they write are only meaningful for those rays. */
+typedef struct ray4 {
+    f64x4 ox, oy, oz;
+    f64x4 dx, dy, dz;
+    f64x4 ix, iy, iz;
+} ray4;
+
+typedef struct ray8 {
+    f64x8 ox, oy, oz;
+    f64x8 dx, dy, dz;
+    f64x8 ix, iy, iz;
+} ray8;
+
+/*------------------------*/
+/* 4-Ray Packet Functions */
+/*------------------------*/
+
+/* Build a packet from four origins and four directions (w ignored). */
+cml_inline ray4
+cml_math_ray4_set(const vec4 o[4], const vec4 d[4]) {
+    f64x4 a[4] = {o[0].v, o[1].v, o[2].v, o[3].v};
+    f64x4 b[4] = {d[0].v, d[1].v, d[2].v, d[3].v};
+    cml_math_f64x4_transpose(a);
+    cml_math_f64x4_transpose(b);
+    const f64x4 one = simde_mm256_set1_pd(1.0);
+    ray4 r;
+    r.ox = a[0];
+    r.oy = a[1];
+    r.oz = a[2];
+    r.dx = b[0];
+    r.dy = b[1];
+    r.dz = b[2];
+    r.ix = simde_mm256_div_pd(one, b[0]);
+    r.iy = simde_mm256_div_pd(one, b[1]);
+    r.iz = simde_mm256_div_pd(one, b[2]);
     return r;
 }
 
-/* Quaternion addition. */
-cml_inline quat
-cml_math_quat_add(const quat a, const quat b) {
-    quat r;
-    r.q = simde_mm256_add_pd(a.q, b.q);
+/* Slab test of the packet against the box spanning lo to hi (w ignored) over
+ * [tmin, tmax]. Writes the entry distance, clamped to tmin, to t. Each ray
+ * takes its entry plane from the sign of its reciprocal direction, so no
+ * min or max pairs the two planes of a slab. A zero direction component
+ * gives infinite slab distances, and a ray lying in a slab plane gives a
+ * NaN distance to that plane, which the max and min against the running
+ * interval drop. Rays on the lo and hi faces, with +0 or -0 directions,
+ * therefore all hit. */
+cml_inline u32
+cml_math_ray4_intersect_aabb(const ray4* r, const vec4 lo, const vec4 hi,
+                             const f64x4 tmin, const f64x4 tmax, f64x4* t) {
+    const f64*  a  = (const f64*)&lo.v;
+    const f64*  b  = (const f64*)&hi.v;
+    const f64x4 ax = simde_mm256_set1_pd(a[0]);
+    const f64x4 ay = simde_mm256_set1_pd(a[1]);
+    const f64x4 az = simde_mm256_set1_pd(a[2]);
+    const f64x4 bx = simde_mm256_set1_pd(b[0]);
+    const f64x4 by = simde_mm256_set1_pd(b[1]);
+    const f64x4 bz = simde_mm256_set1_pd(b[2]);
+    /* blendv picks hi where the reciprocal's sign bit is set, -0 included. */
+    const f64x4 x0 = simde_mm256_mul_pd(simde_mm256_sub_pd(
+                     simde_mm256_blendv_pd(ax, bx, r->ix), r->ox), r->ix);
+    const f64x4 x1 = simde_mm256_mul_pd(simde_mm256_sub_pd(
+                     simde_mm256_blendv_pd(bx, ax, r->ix), r->ox), r->ix);
+    const f64x4 y0 = simde_mm256_mul_pd(simde_mm256_sub_pd(
+                     simde_mm256_blendv_pd(ay, by, r->iy), r->oy), r->iy);
+    const f64x4 y1 = simde_mm256_mul_pd(simde_mm256_sub_pd(
+                     simde_mm256_blendv_pd(by, ay, r->iy), r->oy), r->iy);
+    const f64x4 z0 = simde_mm256_mul_pd(simde_mm256_sub_pd(
+                     simde_mm256_blendv_pd(az, bz, r->iz), r->oz), r->iz);
+    const f64x4 z1 = simde_mm256_mul_pd(simde_mm256_sub_pd(
+                     simde_mm256_blendv_pd(bz, az, r->iz), r->oz), r->iz);
+    f64x4 tn, tf;
+    tn = simde_mm256_max_pd(x0, tmin);
+    tn = simde_mm256_max_pd(y0, tn);
+    tn = simde_mm256_max_pd(z0, tn);
+    tf = simde_mm256_min_pd(x1, tmax);
+    tf = simde_mm256_min_pd(y1, tf);
+    tf = simde_mm256_min_pd(z1, tf);
+    *t = tn;
+    return (u32)simde_mm256_movemask_pd(
+           simde_mm256_cmp_pd(tn, tf, SIMDE_CMP_LE_OQ));
+}
+
+/* Intersect the packet with the sphere of center (s.x, s.y, s.z) and radius
+ * s.w. Writes the nearest distance in [tmin, tmax] to t. The discriminant is
+ * taken from the distance between the center and the ray's line rather than
+ * b * b - a * c, which cancels badly for small or distant spheres. */
+cml_inline u32
+cml_math_ray4_intersect_sphere(const ray4* r, const vec4 s, const f64x4 tmin,
+                               const f64x4 tmax, f64x4* t) {
+    const f64*  c    = (const f64*)&s.v;
+    const f64x4 rr   = simde_mm256_set1_pd(c[3] * c[3]);
+    const f64x4 sign = simde_mm256_set1_pd(-0.0);
+    const f64x4 fx   = simde_mm256_sub_pd(r->ox, simde_mm256_set1_pd(c[0]));
+    const f64x4 fy   = simde_mm256_sub_pd(r->oy, simde_mm256_set1_pd(c[1]));
+    const f64x4 fz   = simde_mm256_sub_pd(r->oz, simde_mm256_set1_pd(c[2]));
+    f64x4 a, b, cc;
+    a  = simde_mm256_mul_pd(r->dx, r->dx);
+    a  = simde_mm256_fmadd_pd(r->dy, r->dy, a);
+    a  = simde_mm256_fmadd_pd(r->dz, r->dz, a);
+    b  = simde_mm256_mul_pd(fx, r->dx);
+    b  = simde_mm256_fmadd_pd(fy, r->dy, b);
+    b  = simde_mm256_fmadd_pd(fz, r->dz, b);
+    cc = simde_mm256_fmsub_pd(fx, fx, rr);
+    cc = simde_mm256_fmadd_pd(fy, fy, cc);
+    cc = simde_mm256_fmadd_pd(fz, fz, cc);
+    /* l is the offset from the center to the closest point of the line, and
+     * r^2 - l.l the discriminant divided by a. */
+    const f64x4 ia = simde_mm256_div_pd(simde_mm256_set1_pd(1.0), a);
+    const f64x4 k  = simde_mm256_mul_pd(b, ia);
+    const f64x4 lx = simde_mm256_fnmadd_pd(k, r->dx, fx);
+    const f64x4 ly = simde_mm256_fnmadd_pd(k, r->dy, fy);
+    const f64x4 lz = simde_mm256_fnmadd_pd(k, r->dz, fz);
+    f64x4 disc;
+    disc = simde_mm256_fnmadd_pd(lx, lx, rr);
+    disc = simde_mm256_fnmadd_pd(ly, ly, disc);
+    disc = simde_mm256_fnmadd_pd(lz, lz, disc);
+    /* Roots c / q and q / a with q = -(b + sign(b) sqrt(a * disc)). */
+    const f64x4 sq = simde_mm256_sqrt_pd(simde_mm256_mul_pd(a, disc));
+    const f64x4 q  = simde_mm256_xor_pd(sign, simde_mm256_add_pd(b,
+                     simde_mm256_or_pd(sq, simde_mm256_and_pd(b, sign))));
+    const f64x4 t0 = simde_mm256_div_pd(cc, q);
+    const f64x4 t1 = simde_mm256_mul_pd(q, ia);
+    const f64x4 tn = simde_mm256_min_pd(t0, t1);
+    const f64x4 tf = simde_mm256_max_pd(t0, t1);
+    const f64x4 th = simde_mm256_blendv_pd(tf, tn,
+                     simde_mm256_cmp_pd(tn, tmin, SIMDE_CMP_GE_OQ));
+    f64x4 hit;
+    hit = simde_mm256_cmp_pd(disc, simde_mm256_setzero_pd(),
+                             SIMDE_CMP_GE_OQ);
+    hit = simde_mm256_and_pd(hit,
+          simde_mm256_cmp_pd(th, tmin, SIMDE_CMP_GE_OQ));
+    hit = simde_mm256_and_pd(hit,
+          simde_mm256_cmp_pd(th, tmax, SIMDE_CMP_LE_OQ));
+    *t = th;
+    return (u32)simde_mm256_movemask_pd(hit);
+}
+
+/* Moller-Trumbore test of the packet against the triangle v0, v1, v2
+ * (w ignored) over [tmin, tmax]. Writes the distance to t and the
+ * barycentric coordinates of v1 and v2 at the hit to u and v. Rays parallel
+ * to the plane of the triangle miss. */
+cml_inline u32
+cml_math_ray4_intersect_triangle(const ray4* r, const vec4 v0, const vec4 v1,
+                                 const vec4 v2, const f64x4 tmin,
+                                 const f64x4 tmax, f64x4* t, f64x4* u,
+                                 f64x4* v) {
+    const vec4  e1v = cml_math_vec4_sub(v1, v0);
+    const vec4  e2v = cml_math_vec4_sub(v2, v0);
+    const f64*  a   = (const f64*)&e1v.v;
+    const f64*  b   = (const f64*)&e2v.v;
+    const f64*  o   = (const f64*)&v0.v;
+    const f64x4 e1x = simde_mm256_set1_pd(a[0]);
+    const f64x4 e1y = simde_mm256_set1_pd(a[1]);
+    const f64x4 e1z = simde_mm256_set1_pd(a[2]);
+    const f64x4 e2x = simde_mm256_set1_pd(b[0]);
+    const f64x4 e2y = simde_mm256_set1_pd(b[1]);
+    const f64x4 e2z = simde_mm256_set1_pd(b[2]);
+    /* p = d x e2, s = o - v0, q = s x e1. */
+    const f64x4 px  = simde_mm256_fmsub_pd(r->dy, e2z,
+                      simde_mm256_mul_pd(r->dz, e2y));
+    const f64x4 py  = simde_mm256_fmsub_pd(r->dz, e2x,
+                      simde_mm256_mul_pd(r->dx, e2z));
+    const f64x4 pz  = simde_mm256_fmsub_pd(r->dx, e2y,
+                      simde_mm256_mul_pd(r->dy, e2x));
+    const f64x4 sx  = simde_mm256_sub_pd(r->ox, simde_mm256_set1_pd(o[0]));
+    const f64x4 sy  = simde_mm256_sub_pd(r->oy, simde_mm256_set1_pd(o[1]));
+    const f64x4 sz  = simde_mm256_sub_pd(r->oz, simde_mm256_set1_pd(o[2]));
+    const f64x4 qx  = simde_mm256_fmsub_pd(sy, e1z,
+                      simde_mm256_mul_pd(sz, e1y));
+    const f64x4 qy  = simde_mm256_fmsub_pd(sz, e1x,
+                      simde_mm256_mul_pd(sx, e1z));
+    const f64x4 qz  = simde_mm256_fmsub_pd(sx, e1y,
+                      simde_mm256_mul_pd(sy, e1x));
+    f64x4 det, uu, vv, tt;
+    det = simde_mm256_mul_pd(e1x, px);
+    det = simde_mm256_fmadd_pd(e1y, py, det);
+    det = simde_mm256_fmadd_pd(e1z, pz, det);
+    uu  = simde_mm256_mul_pd(sx, px);
+    uu  = simde_mm256_fmadd_pd(sy, py, uu);
+    uu  = simde_mm256_fmadd_pd(sz, pz, uu);
+    vv  = simde_mm256_mul_pd(r->dx, qx);
+    vv  = simde_mm256_fmadd_pd(r->dy, qy, vv);
+    vv  = simde_mm256_fmadd_pd(r->dz, qz, vv);
+    tt  = simde_mm256_mul_pd(e2x, qx);
+    tt  = simde_mm256_fmadd_pd(e2y, qy, tt);
+    tt  = simde_mm256_fmadd_pd(e2z, qz, tt);
+    const f64x4 inv  = simde_mm256_div_pd(simde_mm256_set1_pd(1.0), det);
+    const f64x4 zero = simde_mm256_setzero_pd();
+    uu = simde_mm256_mul_pd(uu, inv);
+    vv = simde_mm256_mul_pd(vv, inv);
+    tt = simde_mm256_mul_pd(tt, inv);
+    f64x4 hit;
+    hit = simde_mm256_cmp_pd(det, zero, SIMDE_CMP_NEQ_OQ);
+    hit = simde_mm256_and_pd(hit,
+          simde_mm256_cmp_pd(uu, zero, SIMDE_CMP_GE_OQ));
+    hit = simde_mm256_and_pd(hit,
+          simde_mm256_cmp_pd(vv, zero, SIMDE_CMP_GE_OQ));
+    hit = simde_mm256_and_pd(hit, simde_mm256_cmp_pd(
+          simde_mm256_add_pd(uu, vv), simde_mm256_set1_pd(1.0),
+          SIMDE_CMP_LE_OQ));
+    hit = simde_mm256_and_pd(hit,
+          simde_mm256_cmp_pd(tt, tmin, SIMDE_CMP_GE_OQ));
+    hit = simde_mm256_and_pd(hit,
+          simde_mm256_cmp_pd(tt, tmax, SIMDE_CMP_LE_OQ));
+    *t = tt;
+    *u = uu;
+    *v = vv;
+    return (u32)simde_mm256_movemask_pd(hit);
+}
+
+/*------------------------*/
+/* 8-Ray Packet Functions */
+/*------------------------*/
+
+/* Build a packet from eight origins and eight directions (w ignored). */
+cml_inline ray8
+cml_math_ray8_set(const vec4 o[8], const vec4 d[8]) {
+    const ray4 a = cml_math_ray4_set(o, d);
+    const ray4 b = cml_math_ray4_set(o + 4, d + 4);
+    ray8 r;
+    r.ox = cml_math_f64x8_join(a.ox, b.ox);
+    r.oy = cml_math_f64x8_join(a.oy, b.oy);
+    r.oz = cml_math_f64x8_join(a.oz, b.oz);
+    r.dx = cml_math_f64x8_join(a.dx, b.dx);
+    r.dy = cml_math_f64x8_join(a.dy, b.dy);
+    r.dz = cml_math_f64x8_join(a.dz, b.dz);
+    r.ix = cml_math_f64x8_join(a.ix, b.ix);
+    r.iy = cml_math_f64x8_join(a.iy, b.iy);
+    r.iz = cml_math_f64x8_join(a.iz, b.iz);
     return r;
 }
 
-/* Quaternion subtraction. */
-cml_inline quat
-cml_math_quat_sub(const quat a, const quat b) {
-    quat r;
-    r.q = simde_mm256_sub_pd(a.q, b.q);
-    return r;
+/* Eight-ray version of cml_math_ray4_intersect_aabb. */
+cml_inline u32
+cml_math_ray8_intersect_aabb(const ray8* r, const vec4 lo, const vec4 hi,
+                             const f64x8 tmin, const f64x8 tmax, f64x8* t) {
+    const f64*  a  = (const f64*)&lo.v;
+    const f64*  b  = (const f64*)&hi.v;
+    const f64x8 ax = simde_mm512_set1_pd(a[0]);
+    const f64x8 ay = simde_mm512_set1_pd(a[1]);
+    const f64x8 az = simde_mm512_set1_pd(a[2]);
+    const f64x8 bx = simde_mm512_set1_pd(b[0]);
+    const f64x8 by = simde_mm512_set1_pd(b[1]);
+    const f64x8 bz = simde_mm512_set1_pd(b[2]);
+    const simde__mmask8 sx = simde_mm512_movepi64_mask(
+                             simde_mm512_castpd_si512(r->ix));
+    const simde__mmask8 sy = simde_mm512_movepi64_mask(
+                             simde_mm512_castpd_si512(r->iy));
+    const simde__mmask8 sz = simde_mm512_movepi64_mask(
+                             simde_mm512_castpd_si512(r->iz));
+    const f64x8 x0 = simde_mm512_mul_pd(simde_mm512_sub_pd(
+                     simde_mm512_mask_blend_pd(sx, ax, bx), r->ox), r->ix);
+    const f64x8 x1 = simde_mm512_mul_pd(simde_mm512_sub_pd(
+                     simde_mm512_mask_blend_pd(sx, bx, ax), r->ox), r->ix);
+    const f64x8 y0 = simde_mm512_mul_pd(simde_mm512_sub_pd(
+                     simde_mm512_mask_blend_pd(sy, ay, by), r->oy), r->iy);
+    const f64x8 y1 = simde_mm512_mul_pd(simde_mm512_sub_pd(
+                     simde_mm512_mask_blend_pd(sy, by, ay), r->oy), r->iy);
+    const f64x8 z0 = simde_mm512_mul_pd(simde_mm512_sub_pd(
+                     simde_mm512_mask_blend_pd(sz, az, bz), r->oz), r->iz);
+    const f64x8 z1 = simde_mm512_mul_pd(simde_mm512_sub_pd(
+                     simde_mm512_mask_blend_pd(sz, bz, az), r->oz), r->iz);
+    f64x8 tn, tf;
+    tn = simde_mm512_max_pd(x0, tmin);
+    tn = simde_mm512_max_pd(y0, tn);
+    tn = simde_mm512_max_pd(z0, tn);
+    tf = simde_mm512_min_pd(x1, tmax);
+    tf = simde_mm512_min_pd(y1, tf);
+    tf = simde_mm512_min_pd(z1, tf);
+    *t = tn;
+    return (u32)simde_mm512_cmp_pd_mask(tn, tf, SIMDE_CMP_LE_OQ);
+}
+
+/* Eight-ray version of cml_math_ray4_intersect_sphere. */
+cml_inline u32
+cml_math_ray8_intersect_sphere(const ray8* r, const vec4 s, const f64x8 tmin,
+                               const f64x8 tmax, f64x8* t) {
+    const f64*  c    = (const f64*)&s.v;
+    const f64x8 rr   = simde_mm512_set1_pd(c[3] * c[3]);
+    const f64x8 sign = simde_mm512_set1_pd(-0.0);
+    const f64x8 fx   = simde_mm512_sub_pd(r->ox, simde_mm512_set1_pd(c[0]));
+    const f64x8 fy   = simde_mm512_sub_pd(r->oy, simde_mm512_set1_pd(c[1]));
+    const f64x8 fz   = simde_mm512_sub_pd(r->oz, simde_mm512_set1_pd(c[2]));
+    f64x8 a, b, cc;
+    a  = simde_mm512_mul_pd(r->dx, r->dx);
+    a  = simde_mm512_fmadd_pd(r->dy, r->dy, a);
+    a  = simde_mm512_fmadd_pd(r->dz, r->dz, a);
+    b  = simde_mm512_mul_pd(fx, r->dx);
+    b  = simde_mm512_fmadd_pd(fy, r->dy, b);
+    b  = simde_mm512_fmadd_pd(fz, r->dz, b);
+    cc = simde_mm512_fmsub_pd(fx, fx, rr);
+    cc = simde_mm512_fmadd_pd(fy, fy, cc);
+    cc = simde_mm512_fmadd_pd(fz, fz, cc);
+    /* l is the offset from the center to the closest point of the line, and
+     * r^2 - l.l the discriminant divided by a. */
+    const f64x8 ia = simde_mm512_div_pd(simde_mm512_set1_pd(1.0), a);
+    const f64x8 k  = simde_mm512_mul_pd(b, ia);
+    const f64x8 lx = simde_mm512_fnmadd_pd(k, r->dx, fx);
+    const f64x8 ly = simde_mm512_fnmadd_pd(k, r->dy, fy);
+    const f64x8 lz = simde_mm512_fnmadd_pd(k, r->dz, fz);
+    f64x8 disc;
+    disc = simde_mm512_fnmadd_pd(lx, lx, rr);
+    disc = simde_mm512_fnmadd_pd(ly, ly, disc);
+    disc = simde_mm512_fnmadd_pd(lz, lz, disc);
+    /* Roots c / q and q / a with q = -(b + sign(b) sqrt(a * disc)). */
+    const f64x8 sq = simde_mm512_sqrt_pd(simde_mm512_mul_pd(a, disc));
+    const f64x8 q  = simde_mm512_xor_pd(sign, simde_mm512_add_pd(b,
+                     simde_mm512_or_pd(sq, simde_mm512_and_pd(b, sign))));
+    const f64x8 t0 = simde_mm512_div_pd(cc, q);
+    const f64x8 t1 = simde_mm512_mul_pd(q, ia);
+    const f64x8 tn = simde_mm512_min_pd(t0, t1);
+    const f64x8 tf = simde_mm512_max_pd(t0, t1);
+    const simde__mmask8 ahead =
+                     simde_mm512_cmp_pd_mask(tn, tmin, SIMDE_CMP_GE_OQ);
+    const f64x8 th = simde_mm512_mask_blend_pd(ahead, tf, tn);
+    simde__mmask8 hit;
+    hit = simde_mm512_cmp_pd_mask(disc, simde_mm512_setzero_pd(),
+                                  SIMDE_CMP_GE_OQ);
+    hit &= simde_mm512_cmp_pd_mask(th, tmin, SIMDE_CMP_GE_OQ);
+    hit &= simde_mm512_cmp_pd_mask(th, tmax, SIMDE_CMP_LE_OQ);
+    *t = th;
+    return (u32)hit;
+}
+
+/* Eight-ray version of cml_math_ray4_intersect_triangle. */
+cml_inline u32
+cml_math_ray8_intersect_triangle(const ray8* r, const vec4 v0, const vec4 v1,
+                                 const vec4 v2, const f64x8 tmin,
+                                 const f64x8 tmax, f64x8* t, f64x8* u,
+                                 f64x8* v) {
+    const vec4  e1v = cml_math_vec4_sub(v1, v0);
+    const vec4  e2v = cml_math_vec4_sub(v2, v0);
+    const f64*  a   = (const f64*)&e1v.v;
+    const f64*  b   = (const f64*)&e2v.v;
+    const f64*  o   = (const f64*)&v0.v;
+    const f64x8 e1x = simde_mm512_set1_pd(a[0]);
+    const f64x8 e1y = simde_mm512_set1_pd(a[1]);
+    const f64x8 e1z = simde_mm512_set1_pd(a[2]);
+    const f64x8 e2x = simde_mm512_set1_pd(b[0]);
+    const f64x8 e2y = simde_mm512_set1_pd(b[1]);
+    const f64x8 e2z = simde_mm512_set1_pd(b[2]);
+    /* p = d x e2, s = o - v0, q = s x e1. */
+    const f64x8 px  = simde_mm512_fmsub_pd(r->dy, e2z,
+                      simde_mm512_mul_pd(r->dz, e2y));
+    const f64x8 py  = simde_mm512_fmsub_pd(r->dz, e2x,
+                      simde_mm512_mul_pd(r->dx, e2z));
+    const f64x8 pz  = simde_mm512_fmsub_pd(r->dx, e2y,
+                      simde_mm512_mul_pd(r->dy, e2x));
+    const f64x8 sx  = simde_mm512_sub_pd(r->ox, simde_mm512_set1_pd(o[0]));
+    const f64x8 sy  = simde_mm512_sub_pd(r->oy, simde_mm512_set1_pd(o[1]));
+    const f64x8 sz  = simde_mm512_sub_pd(r->oz, simde_mm512_set1_pd(o[2]));
+    const f64x8 qx  = simde_mm512_fmsub_pd(sy, e1z,
+                      simde_mm512_mul_pd(sz, e1y));
+    const f64x8 qy  = simde_mm512_fmsub_pd(sz, e1x,
+                      simde_mm512_mul_pd(sx, e1z));
+    const f64x8 qz  = simde_mm512_fmsub_pd(sx, e1y,
+                      simde_mm512_mul_pd(sy, e1x));
+    f64x8 det, uu, vv, tt;
+    det = simde_mm512_mul_pd(e1x, px);
+    det = simde_mm512_fmadd_pd(e1y, py, det);
+    det = simde_mm512_fmadd_pd(e1z, pz, det);
+    uu  = simde_mm512_mul_pd(sx, px);
+    uu  = simde_mm512_fmadd_pd(sy, py, uu);
+    uu  = simde_mm512_fmadd_pd(sz, pz, uu);
+    vv  = simde_mm512_mul_pd(r->dx, qx);
+    vv  = simde_mm512_fmadd_pd(r->dy, qy, vv);
+    vv  = simde_mm512_fmadd_pd(r->dz, qz, vv);
+    tt  = simde_mm512_mul_pd(e2x, qx);
+    tt  = simde_mm512_fmadd_pd(e2y, qy, tt);
+    tt  = simde_mm512_fmadd_pd(e2z, qz, tt);
+    const f64x8 inv  = simde_mm512_div_pd(simde_mm512_set1_pd(1.0), det);
+    const f64x8 zero = simde_mm512_setzero_pd();
+    uu = simde_mm512_mul_pd(uu, inv);
+    vv = simde_mm512_mul_pd(vv, inv);
+    tt = simde_mm512_mul_pd(tt, inv);
+    simde__mmask8 hit;
+    hit = simde_mm512_cmp_pd_mask(det, zero, SIMDE_CMP_NEQ_OQ);
+    hit &= simde_mm512_cmp_pd_mask(uu, zero, SIMDE_CMP_GE_OQ);
+    hit &= simde_mm512_cmp_pd_mask(vv, zero, SIMDE_CMP_GE_OQ);
+    hit &= simde_mm512_cmp_pd_mask(simde_mm512_add_pd(uu, vv),
+                                  simde_mm512_set1_pd(1.0), SIMDE_CMP_LE_OQ);
+    hit &= simde_mm512_cmp_pd_mask(tt, tmin, SIMDE_CMP_GE_OQ);
+    hit &= simde_mm512_cmp_pd_mask(tt, tmax, SIMDE_CMP_LE_OQ);
+    *t = tt;
+    *u = uu;
+    *v = vv;
+    return (u32)hit;
 }
 
-/* Quaternion multiplication. */
-cml_inline quat
-cml_math_quat_mul(const quat a, const quat b) {
-    quat r;
-    r.q = simde_mm256_add_pd(
-          simde_mm256_add_pd(
-          simde_mm256_add_pd(
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0x00), 
-          simde_mm256_permute4x64_pd(b.q, 0x00)),
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0x55), 
-          simde_mm256_permute4x64_pd(b.q, 0x55))),
-          simde_mm256_add_pd(
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0xAA), 
-          simde_mm256_permute4x64_pd(b.q, 0xAA)),
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0xFF), 
-          simde_mm256_permute4x64_pd(b.q, 0xFF)))),
-          simde_mm256_add_pd(
-          simde_mm256_add_pd(
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0x00), 
-          simde_mm256_permute4x64_pd(b.q, 0x55)),
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0x55), 
-          simde_mm256_permute4x64_pd(b.q, 0xAA))),
-          simde_mm256_add_pd(
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0xAA), 
-          simde_mm256_permute4x64_pd(b.q, 0xFF)),
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0xFF), 
-          simde_mm256_permute4x64_pd(b.q, 0x00)))));
-    return r;
+/*============================================================================*/
+/* Bounding Volume Hierarchy                                                  */
+/*============================================================================*/
+
+/* Most primitives a leaf holds, and the SAH bins per axis. */
+#define CML_BVH4_LEAF_MAX 4
+#define CML_BVH4_BINS     16
+
+/* Ranges at least this large are built as separate OpenMP tasks. */
+#define CML_BVH4_TASK_MIN 4096
+
+/* Depth from which ranges are halved instead of SAH-split. This bounds the
+ * depth of degenerate inputs, and so the traversal stack. */
+#define CML_BVH4_SAH_DEPTH 48
+#define CML_BVH4_STACK     256
+
+/* Flag marking a child reference as a leaf. The other bits are the index of
+ * the leaf's first primitive in bvh4.prims. */
+#define CML_BVH4_LEAF 0x80000000u
+
+/* Four-wide BVH node filling two cache lines. The children's bounds are
+ * stored by component in f32, rounded outward so they never shrink a box.
+ * An inner child has a zero count and references a node. Bit k of mask is
+ * set when slot k holds a child; unused slots hold a box at +inf, which a
+ * ray with an unbounded tmax can still pass, so traversal masks them out. */
+typedef struct cml_align(64) bvh4_node {
+    f32 lo_x[4];
+    f32 lo_y[4];
+    f32 lo_z[4];
+    f32 hi_x[4];
+    f32 hi_y[4];
+    f32 hi_z[4];
+    u32 child[4];
+    u16 count[4];
+    u32 mask;
+} bvh4_node;
+
+_Static_assert(sizeof(bvh4_node) == 128,
+               "bvh4_node must fill two cache lines");
+
+/* Four-wide BVH over n primitives. Node 0 is the root, and leaves reference
+ * ranges of prims, a permutation of the primitive indices. */
+typedef struct bvh4 {
+    bvh4_node* nodes;
+    u32*       prims;
+    size_t     node_count;
+    size_t     prim_count;
+} bvh4;
+
+/* Closest hit found by a traversal. u and v are the barycentric coordinates
+ * of the second and third vertex for triangles, and zero for boxes. */
+typedef struct bvh4_hit {
+    f64 t;
+    f64 u;
+    f64 v;
+    u32 prim;
+} bvh4_hit;
+
+/* Primitive kinds a BVH can be traversed over. */
+typedef enum cml_bvh4_kind {
+    CML_BVH4_TRIANGLES,
+    CML_BVH4_AABBS
+} cml_bvh4_kind;
+
+/* State shared by the build tasks. */
+typedef struct cml_bvh4_builder {
+    const vec4* lo;
+    const vec4* hi;
+    const vec4* c;
+    bvh4*       bvh;
+    u64         next;
+} cml_bvh4_builder;
+
+/*-------------------*/
+/* Builder Functions */
+/*-------------------*/
+
+/* Returns the largest f32 not above x. */
+cml_inline f32
+cml_math_f32_round_down(const f64 x) {
+    const f32 r = (f32)x;
+    return (f64)r > x ? nextafterf(r, -HUGE_VALF) : r;
+}
+
+/* Returns the smallest f32 not below x. */
+cml_inline f32
+cml_math_f32_round_up(const f64 x) {
+    const f32 r = (f32)x;
+    return (f64)r < x ? nextafterf(r, HUGE_VALF) : r;
+}
+
+/* Half the surface area of the box spanning lo to hi. */
+cml_inline f64
+cml_math_bvh4_area(const f64x4 lo, const f64x4 hi) {
+    f64 e[4];
+    simde_mm256_storeu_pd(e, simde_mm256_sub_pd(hi, lo));
+    return e[0] * e[1] + e[1] * e[2] + e[2] * e[0];
 }
 
-/* Quaternion negation. */
-cml_inline quat
-cml_math_quat_neg(const quat a) {
-    quat r;
-    r.q = simde_mm256_sub_pd(simde_mm256_setzero_pd(), a.q);
-    return r;
+/* Computes the bin of a centroid along each axis. */
+cml_inline void
+cml_math_bvh4_bin(const f64x4 c, const f64x4 cmin, const f64x4 scale,
+                  size_t bin[3]) {
+    f64 t[4];
+    simde_mm256_storeu_pd(t, simde_mm256_mul_pd(simde_mm256_sub_pd(c, cmin),
+                                                scale));
+    for (size_t a = 0; a < 3; a++) {
+        const size_t j = t[a] > 0.0 ? (size_t)t[a] : 0;
+        bin[a] = j < CML_BVH4_BINS ? j : CML_BVH4_BINS - 1;
+    }
 }
 
-/* Quaternion conjugation. */
-cml_inline quat
-cml_math_quat_conjugate(const quat a) {
-    quat r;
-    r.q = simde_mm256_xor_pd(a.q, simde_mm256_set_pd(-0.0, -0.0, -0.0, 0.0));
-    return r;
+/* Computes the bounds, and the bounds of the centroids, of the count
+ * primitives at idx. */
+cml_inline void
+cml_math_bvh4_bounds(const cml_bvh4_builder* b, const u32* idx,
+                     const size_t count, f64x4* lo, f64x4* hi, f64x4* clo,
+                     f64x4* chi) {
+    f64x4 l  = simde_mm256_set1_pd(HUGE_VAL);
+    f64x4 h  = simde_mm256_set1_pd(-HUGE_VAL);
+    f64x4 cl = l;
+    f64x4 ch = h;
+    for (size_t i = 0; i < count; i++) {
+        l  = simde_mm256_min_pd(l, b->lo[idx[i]].v);
+        h  = simde_mm256_max_pd(h, b->hi[idx[i]].v);
+        cl = simde_mm256_min_pd(cl, b->c[idx[i]].v);
+        ch = simde_mm256_max_pd(ch, b->c[idx[i]].v);
+    }
+    *lo  = l;
+    *hi  = h;
+    *clo = cl;
+    *chi = ch;
+}
+
+/* Splits the count > 1 primitives at idx, whose centroids span cmin to
+ * cmax, into two non-empty groups, reordering idx, and returns the size of
+ * the first. The split minimizing the surface area heuristic is chosen among
+ * CML_BVH4_BINS bins of the centroid bounds on each axis; the range is halved
+ * instead if all centroids coincide or depth reached CML_BVH4_SAH_DEPTH.
+ * Writes the bounds of both groups to lo and hi, and the bounds of their
+ * centroids to clo and chi. */
+static inline size_t
+cml_math_bvh4_split(const cml_bvh4_builder* b, u32* idx, const size_t count,
+                    const size_t depth, const f64x4 cmin, const f64x4 cmax,
+                    f64x4 lo[2], f64x4 hi[2], f64x4 clo[2], f64x4 chi[2]) {
+    f64 e[4];
+    simde_mm256_storeu_pd(e, simde_mm256_sub_pd(cmax, cmin));
+    f64    best      = HUGE_VAL;
+    size_t best_axis = 0;
+    size_t best_bin  = 0;
+    size_t best_n    = 0;
+    f64x4  blo[3][CML_BVH4_BINS], bhi[3][CML_BVH4_BINS];
+    size_t bn[3][CML_BVH4_BINS];
+    f64x4  scale = simde_mm256_setzero_pd();
+    if (depth < CML_BVH4_SAH_DEPTH && (e[0] > 0.0 || e[1] > 0.0 ||
+                                       e[2] > 0.0)) {
+        scale = simde_mm256_setr_pd(
+                e[0] > 0.0 ? CML_BVH4_BINS / e[0] : 0.0,
+                e[1] > 0.0 ? CML_BVH4_BINS / e[1] : 0.0,
+                e[2] > 0.0 ? CML_BVH4_BINS / e[2] : 0.0, 0.0);
+        for (size_t a = 0; a < 3; a++) {
+            for (size_t j = 0; j < CML_BVH4_BINS; j++) {
+                blo[a][j] = simde_mm256_set1_pd(HUGE_VAL);
+                bhi[a][j] = simde_mm256_set1_pd(-HUGE_VAL);
+                bn[a][j]  = 0;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            const u32 p = idx[i];
+            size_t    bin[3];
+            cml_math_bvh4_bin(b->c[p].v, cmin, scale, bin);
+            for (size_t a = 0; a < 3; a++) {
+                blo[a][bin[a]] = simde_mm256_min_pd(blo[a][bin[a]],
+                                                    b->lo[p].v);
+                bhi[a][bin[a]] = simde_mm256_max_pd(bhi[a][bin[a]],
+                                                    b->hi[p].v);
+                bn[a][bin[a]]++;
+            }
+        }
+        /* Sweep right to left for the right-hand areas, then left to right
+         * scoring each split as area * count on both sides. */
+        for (size_t a = 0; a < 3; a++) {
+            if (!(e[a] > 0.0)) {
+                continue;
+            }
+            f64    rarea[CML_BVH4_BINS];
+            size_t rn[CML_BVH4_BINS];
+            f64x4  l = simde_mm256_set1_pd(HUGE_VAL);
+            f64x4  h = simde_mm256_set1_pd(-HUGE_VAL);
+            size_t n = 0;
+            for (size_t j = CML_BVH4_BINS - 1; j > 0; j--) {
+                l = simde_mm256_min_pd(l, blo[a][j]);
+                h = simde_mm256_max_pd(h, bhi[a][j]);
+                n += bn[a][j];
+                rarea[j] = n > 0 ? cml_math_bvh4_area(l, h) : 0.0;
+                rn[j]    = n;
+            }
+            l = simde_mm256_set1_pd(HUGE_VAL);
+            h = simde_mm256_set1_pd(-HUGE_VAL);
+            n = 0;
+            for (size_t j = 0; j + 1 < CML_BVH4_BINS; j++) {
+                l = simde_mm256_min_pd(l, blo[a][j]);
+                h = simde_mm256_max_pd(h, bhi[a][j]);
+                n += bn[a][j];
+                if (n == 0 || rn[j + 1] == 0) {
+                    continue;
+                }
+                const f64 cost = cml_math_bvh4_area(l, h) * (f64)n +
+                                 rarea[j + 1] * (f64)rn[j + 1];
+                if (cost < best) {
+                    best      = cost;
+                    best_axis = a;
+                    best_bin  = j;
+                    best_n    = n;
+                }
+            }
+        }
+    }
+    if (best_n == 0) {
+        const size_t k = count / 2;
+        cml_math_bvh4_bounds(b, idx, k, &lo[0], &hi[0], &clo[0], &chi[0]);
+        cml_math_bvh4_bounds(b, idx + k, count - k, &lo[1], &hi[1], &clo[1],
+                             &chi[1]);
+        return k;
+    }
+    /* Partition, gathering the centroid bounds of each side on the way. */
+    clo[0] = clo[1] = simde_mm256_set1_pd(HUGE_VAL);
+    chi[0] = chi[1] = simde_mm256_set1_pd(-HUGE_VAL);
+    size_t i = 0;
+    size_t j = count;
+    while (i < j) {
+        const f64x4 c = b->c[idx[i]].v;
+        size_t bin[3];
+        cml_math_bvh4_bin(c, cmin, scale, bin);
+        if (bin[best_axis] <= best_bin) {
+            clo[0] = simde_mm256_min_pd(clo[0], c);
+            chi[0] = simde_mm256_max_pd(chi[0], c);
+            i++;
+        } else {
+            const u32 t = idx[i];
+            clo[1] = simde_mm256_min_pd(clo[1], c);
+            chi[1] = simde_mm256_max_pd(chi[1], c);
+            idx[i] = idx[--j];
+            idx[j] = t;
+        }
+    }
+    lo[0] = lo[1] = simde_mm256_set1_pd(HUGE_VAL);
+    hi[0] = hi[1] = simde_mm256_set1_pd(-HUGE_VAL);
+    for (size_t k = 0; k < CML_BVH4_BINS; k++) {
+        const size_t s = k <= best_bin ? 0 : 1;
+        lo[s] = simde_mm256_min_pd(lo[s], blo[best_axis][k]);
+        hi[s] = simde_mm256_max_pd(hi[s], bhi[best_axis][k]);
+    }
+    return best_n;
+}
+
+/* Builds node from the count primitives at b->bvh->prims + first, with
+ * bounds lo to hi and centroid bounds clo to chi. Children are split off the
+ * largest-area range until there are four or every range fits in a leaf. */
+static inline void
+cml_math_bvh4_build_node(cml_bvh4_builder* b, const size_t node,
+                         const size_t first, const size_t count,
+                         const f64x4 lo, const f64x4 hi, const f64x4 clo,
+                         const f64x4 chi, const size_t depth) {
+    size_t cf[4] = {first};
+    size_t cc[4] = {count};
+    f64x4  cl[4] = {lo};
+    f64x4  ch[4] = {hi};
+    f64x4  xl[4] = {clo};
+    f64x4  xh[4] = {chi};
+    size_t m     = 1;
+    while (m < 4) {
+        size_t s    = 4;
+        f64    area = -1.0;
+        for (size_t k = 0; k < m; k++) {
+            const f64 ak = cml_math_bvh4_area(cl[k], ch[k]);
+            if (cc[k] > CML_BVH4_LEAF_MAX && ak > area) {
+                s    = k;
+                area = ak;
+            }
+        }
+        if (s == 4) {
+            break;
+        }
+        f64x4 sl[2], sh[2], sxl[2], sxh[2];
+        const size_t n = cml_math_bvh4_split(b, b->bvh->prims + cf[s], cc[s],
+                                             depth, xl[s], xh[s], sl, sh, sxl,
+                                             sxh);
+        cf[m] = cf[s] + n;
+        cc[m] = cc[s] - n;
+        cl[m] = sl[1];
+        ch[m] = sh[1];
+        xl[m] = sxl[1];
+        xh[m] = sxh[1];
+        cc[s] = n;
+        cl[s] = sl[0];
+        ch[s] = sh[0];
+        xl[s] = sxl[0];
+        xh[s] = sxh[0];
+        m++;
+    }
+    bvh4_node* out = b->bvh->nodes + node;
+    out->mask = 0;
+    for (size_t k = 0; k < 4; k++) {
+        f64 l[4], h[4];
+        if (k < m && cc[k] > 0) {
+            simde_mm256_storeu_pd(l, cl[k]);
+            simde_mm256_storeu_pd(h, ch[k]);
+        } else {
+            l[0] = l[1] = l[2] = h[0] = h[1] = h[2] = HUGE_VAL;
+            cc[k] = 0;
+        }
+        out->lo_x[k] = cml_math_f32_round_down(l[0]);
+        out->lo_y[k] = cml_math_f32_round_down(l[1]);
+        out->lo_z[k] = cml_math_f32_round_down(l[2]);
+        out->hi_x[k] = cml_math_f32_round_up(h[0]);
+        out->hi_y[k] = cml_math_f32_round_up(h[1]);
+        out->hi_z[k] = cml_math_f32_round_up(h[2]);
+        out->child[k] = 0;
+        out->count[k] = 0;
+        if (cc[k] == 0) {
+            continue;
+        }
+        out->mask |= 1u << k;
+        if (cc[k] <= CML_BVH4_LEAF_MAX) {
+            out->child[k] = CML_BVH4_LEAF | (u32)cf[k];
+            out->count[k] = (u16)cc[k];
+            continue;
+        }
+        const size_t id  = (size_t)cml_atomic_fetch_add(&b->next, 1);
+        const size_t cfk = cf[k];
+        const size_t cck = cc[k];
+        const f64x4  clk = cl[k];
+        const f64x4  chk = ch[k];
+        const f64x4  xlk = xl[k];
+        const f64x4  xhk = xh[k];
+        out->child[k] = (u32)id;
+#if defined(_OPENMP)
+        #pragma omp task if (cck >= CML_BVH4_TASK_MIN)
+#endif
+        cml_math_bvh4_build_node(b, id, cfk, cck, clk, chk, xlk, xhk,
+                                 depth + 1);
+    }
 }
 
-/* Quaternion inverse. */
-cml_inline quat
-cml_math_quat_inverse(const quat a) {
-    quat r;
-    r.q = simde_mm256_div_pd(simde_mm256_set_pd(0.0, 0.0, 0.0, 1.0), a.q);
+/* Build a BVH over the n boxes spanning lo[i] to hi[i] (w ignored). Subtrees
+ * are built in parallel when compiled with OpenMP. On allocation failure
+ * every pointer is NULL and the counts are zero. */
+static inline bvh4
+cml_math_bvh4_build(const vec4* lo, const vec4* hi, const size_t n) {
+    bvh4 r = {NULL, NULL, 0, 0};
+    /* Every inner node but the root has at least two children. */
+    const size_t cap   = n + 1;
+    const size_t cbyte = (n * sizeof(vec4) + CML_SOA_ALIGNMENT - 1) /
+                         CML_SOA_ALIGNMENT * CML_SOA_ALIGNMENT;
+    bvh4_node* nodes = (bvh4_node*)cml_aligned_alloc(CML_SOA_ALIGNMENT,
+                                                     cap * sizeof(bvh4_node));
+    u32*  prims = (u32*)malloc((n > 0 ? n : 1) * sizeof(u32));
+    vec4* c     = cbyte > 0 ? (vec4*)cml_aligned_alloc(CML_SOA_ALIGNMENT,
+                                                       cbyte) : NULL;
+    if (!nodes || !prims || (n > 0 && !c)) {
+        cml_aligned_free(nodes);
+        free(prims);
+        cml_aligned_free(c);
+        return r;
+    }
+    const f64x4 half = simde_mm256_set1_pd(0.5);
+    for (size_t i = 0; i < n; i++) {
+        c[i].v   = simde_mm256_mul_pd(simde_mm256_add_pd(lo[i].v, hi[i].v),
+                                      half);
+        prims[i] = (u32)i;
+    }
+    r.nodes      = nodes;
+    r.prims      = prims;
+    r.prim_count = n;
+    cml_bvh4_builder b = {lo, hi, c, &r, 1};
+    f64x4 l, h, cl, ch;
+    cml_math_bvh4_bounds(&b, prims, n, &l, &h, &cl, &ch);
+#if defined(_OPENMP)
+    #pragma omp parallel if (n >= CML_BVH4_TASK_MIN)
+    #pragma omp single
+#endif
+    cml_math_bvh4_build_node(&b, 0, 0, n, l, h, cl, ch, 0);
+    r.node_count = (size_t)b.next;
+    cml_aligned_free(c);
     return r;
 }
 
-/* Quaternion length. */
-cml_inline f64
-cml_math_quat_length(const quat a) {
-    return sqrt(a.q[0] * a.q[0] + 
-                a.q[1] * a.q[1] + 
-                a.q[2] * a.q[2] + 
-                a.q[3] * a.q[3]);
+/* Build a BVH over n triangles, triangle i being v[3 * i] to v[3 * i + 2]. */
+static inline bvh4
+cml_math_bvh4_build_triangles(const vec4* v, const size_t n) {
+    const size_t bytes = (n * sizeof(vec4) + CML_SOA_ALIGNMENT - 1) /
+                         CML_SOA_ALIGNMENT * CML_SOA_ALIGNMENT;
+    vec4* lo = bytes > 0 ? (vec4*)cml_aligned_alloc(CML_SOA_ALIGNMENT,
+                                                    bytes) : NULL;
+    vec4* hi = bytes > 0 ? (vec4*)cml_aligned_alloc(CML_SOA_ALIGNMENT,
+                                                    bytes) : NULL;
+    bvh4 r = {NULL, NULL, 0, 0};
+    if (n == 0 || (lo && hi)) {
+        for (size_t i = 0; i < n; i++) {
+            lo[i].v = simde_mm256_min_pd(v[3 * i].v, simde_mm256_min_pd(
+                      v[3 * i + 1].v, v[3 * i + 2].v));
+            hi[i].v = simde_mm256_max_pd(v[3 * i].v, simde_mm256_max_pd(
+                      v[3 * i + 1].v, v[3 * i + 2].v));
+        }
+        r = cml_math_bvh4_build(lo, hi, n);
+    }
+    cml_aligned_free(lo);
+    cml_aligned_free(hi);
+    return r;
 }
 
-/* Quaternion normalization. */
-cml_inline quat
-cml_math_quat_normalize(const quat a) {
-    quat r;
-    r.q = simde_mm256_div_pd(a.q, 
-          simde_mm256_set1_pd(cml_math_quat_length(a)));
-    return r;
+/* Free a BVH returned by one of the build functions. */
+cml_inline void
+cml_math_bvh4_free(bvh4* b) {
+    cml_aligned_free(b->nodes);
+    free(b->prims);
+    b->nodes      = NULL;
+    b->prims      = NULL;
+    b->node_count = 0;
+    b->prim_count = 0;
+}
+
+/*---------------------*/
+/* Traversal Functions */
+/*---------------------*/
+
+/* Moller-Trumbore test of one ray against the triangle v[0], v[1], v[2] over
+ * [tmin, tmax]. */
+cml_inline bool
+cml_math_bvh4_hit_triangle(const f64 o[3], const f64 d[3], const vec4* v,
+                           const f64 tmin, const f64 tmax, f64* t, f64* u,
+                           f64* w) {
+    const f64* a  = (const f64*)&v[0].v;
+    const f64* b  = (const f64*)&v[1].v;
+    const f64* c  = (const f64*)&v[2].v;
+    const f64  e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    const f64  e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    const f64  s[3]  = {o[0] - a[0], o[1] - a[1], o[2] - a[2]};
+    const f64  p[3]  = {d[1] * e2[2] - d[2] * e2[1],
+                        d[2] * e2[0] - d[0] * e2[2],
+                        d[0] * e2[1] - d[1] * e2[0]};
+    const f64  q[3]  = {s[1] * e1[2] - s[2] * e1[1],
+                        s[2] * e1[0] - s[0] * e1[2],
+                        s[0] * e1[1] - s[1] * e1[0]};
+    const f64  det = e1[0] * p[0] + e1[1] * p[1] + e1[2] * p[2];
+    /* Reject on the undivided coordinates, scaled by |det|, so only
+     * candidate hits pay for the division. */
+    const f64  sg  = det < 0.0 ? -1.0 : 1.0;
+    const f64  ad  = det * sg;
+    const f64  uu  = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * sg;
+    const f64  vv  = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * sg;
+    if (!(ad > 0.0 && uu >= 0.0 && vv >= 0.0 && uu + vv <= ad)) {
+        return false;
+    }
+    const f64  inv = 1.0 / ad;
+    const f64  tt  = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * sg * inv;
+    *t = tt;
+    *u = uu * inv;
+    *w = vv * inv;
+    return tt >= tmin && tt <= tmax;
+}
+
+/* Slab test of one ray, with reciprocal direction i, against the box lo to
+ * hi over [tmin, tmax], with the NaN handling of the packet slab tests. */
+cml_inline bool
+cml_math_bvh4_hit_aabb(const f64 o[3], const f64 i[3], const vec4 lo,
+                       const vec4 hi, const f64 tmin, const f64 tmax,
+                       f64* t) {
+    const f64* a  = (const f64*)&lo.v;
+    const f64* b  = (const f64*)&hi.v;
+    f64        tn = tmin;
+    f64        tf = tmax;
+    for (size_t k = 0; k < 3; k++) {
+        const bool neg = signbit(i[k]) != 0;
+        const f64  n   = ((neg ? b[k] : a[k]) - o[k]) * i[k];
+        const f64  f   = ((neg ? a[k] : b[k]) - o[k]) * i[k];
+        tn = n > tn ? n : tn;
+        tf = f < tf ? f : tf;
+    }
+    *t = tn;
+    return tn <= tf;
+}
+
+/* Traverses the BVH for the hit of the ray o + t * d with t in [tmin, tmax]
+ * closest to the origin, or for any hit if any is set. Each node tests one
+ * ray against its four children at once and queues the children hit, the
+ * nearest on top. p0 holds the triangle vertices, or p0 and p1 the boxes. */
+static inline bool
+cml_math_bvh4_traverse(const bvh4* b, const cml_bvh4_kind kind,
+                       const vec4* p0, const vec4* p1, const vec4 o,
+                       const vec4 d, const f64 tmin, const f64 tmax,
+                       const bool any, bvh4_hit* hit) {
+    struct {
+        u32 ref;
+        u32 count;
+        f64 t;
+    } stack[CML_BVH4_STACK];
+    const f64*  op   = (const f64*)&o.v;
+    const f64*  dp   = (const f64*)&d.v;
+    const f64   ro[3] = {op[0], op[1], op[2]};
+    const f64   rd[3] = {dp[0], dp[1], dp[2]};
+    const f64   ri[3] = {1.0 / dp[0], 1.0 / dp[1], 1.0 / dp[2]};
+    const f64x4 ox = simde_mm256_set1_pd(ro[0]);
+    const f64x4 oy = simde_mm256_set1_pd(ro[1]);
+    const f64x4 oz = simde_mm256_set1_pd(ro[2]);
+    const f64x4 ix = simde_mm256_set1_pd(ri[0]);
+    const f64x4 iy = simde_mm256_set1_pd(ri[1]);
+    const f64x4 iz = simde_mm256_set1_pd(ri[2]);
+    const f64x4 t0 = simde_mm256_set1_pd(tmin);
+    const bool  sx = signbit(ri[0]) != 0;
+    const bool  sy = signbit(ri[1]) != 0;
+    const bool  sz = signbit(ri[2]) != 0;
+    f64    tc    = tmax;
+    bool   found = false;
+    size_t sp    = 1;
+    stack[0].ref   = 0;
+    stack[0].count = 0;
+    stack[0].t     = tmin;
+    if (b->nodes == NULL) {
+        return false;
+    }
+    while (sp > 0) {
+        sp--;
+        if (stack[sp].t > tc) {
+            continue;
+        }
+        if (stack[sp].count > 0) {
+            const u32 first = stack[sp].ref & ~CML_BVH4_LEAF;
+            const u32 last  = first + stack[sp].count;
+            for (u32 j = first; j < last; j++) {
+                const u32 p = b->prims[j];
+                f64  t, u = 0.0, v = 0.0;
+                bool h;
+                if (kind == CML_BVH4_TRIANGLES) {
+                    h = cml_math_bvh4_hit_triangle(ro, rd, p0 + 3 * (size_t)p,
+                                                   tmin, tc, &t, &u, &v);
+                } else {
+                    h = cml_math_bvh4_hit_aabb(ro, ri, p0[p], p1[p], tmin, tc,
+                                               &t);
+                }
+                if (h) {
+                    tc    = t;
+                    found = true;
+                    if (hit) {
+                        hit->t    = t;
+                        hit->u    = u;
+                        hit->v    = v;
+                        hit->prim = p;
+                    }
+                    if (any) {
+                        return true;
+                    }
+                }
+            }
+            continue;
+        }
+        /* Entry and exit planes come from the direction's signs, as in
+         * cml_math_bvh4_hit_aabb. */
+        const bvh4_node* n = b->nodes + stack[sp].ref;
+        const f64x4 x0 = simde_mm256_mul_pd(simde_mm256_sub_pd(
+                         simde_mm256_cvtps_pd(simde_mm_load_ps(
+                         sx ? n->hi_x : n->lo_x)), ox), ix);
+        const f64x4 x1 = simde_mm256_mul_pd(simde_mm256_sub_pd(
+                         simde_mm256_cvtps_pd(simde_mm_load_ps(
+                         sx ? n->lo_x : n->hi_x)), ox), ix);
+        const f64x4 y0 = simde_mm256_mul_pd(simde_mm256_sub_pd(
+                         simde_mm256_cvtps_pd(simde_mm_load_ps(
+                         sy ? n->hi_y : n->lo_y)), oy), iy);
+        const f64x4 y1 = simde_mm256_mul_pd(simde_mm256_sub_pd(
+                         simde_mm256_cvtps_pd(simde_mm_load_ps(
+                         sy ? n->lo_y : n->hi_y)), oy), iy);
+        const f64x4 z0 = simde_mm256_mul_pd(simde_mm256_sub_pd(
+                         simde_mm256_cvtps_pd(simde_mm_load_ps(
+                         sz ? n->hi_z : n->lo_z)), oz), iz);
+        const f64x4 z1 = simde_mm256_mul_pd(simde_mm256_sub_pd(
+                         simde_mm256_cvtps_pd(simde_mm_load_ps(
+                         sz ? n->lo_z : n->hi_z)), oz), iz);
+        f64x4 tn, tf;
+        tn = simde_mm256_max_pd(x0, t0);
+        tn = simde_mm256_max_pd(y0, tn);
+        tn = simde_mm256_max_pd(z0, tn);
+        tf = simde_mm256_min_pd(x1, simde_mm256_set1_pd(tc));
+        tf = simde_mm256_min_pd(y1, tf);
+        tf = simde_mm256_min_pd(z1, tf);
+        u32 mask = (u32)simde_mm256_movemask_pd(
+                   simde_mm256_cmp_pd(tn, tf, SIMDE_CMP_LE_OQ)) & n->mask;
+        f64 tk[4];
+        simde_mm256_storeu_pd(tk, tn);
+        /* Insert the hit children so distances decrease up the stack. The
+         * builder's depth bound keeps a valid tree within CML_BVH4_STACK;
+         * the check only stops a corrupt one from overrunning it. */
+        const size_t base = sp;
+        while (mask != 0 && sp < CML_BVH4_STACK) {
+            const u32 k = cml_ctz64(mask);
+            size_t    j = sp++;
+            mask &= mask - 1;
+            while (j > base && stack[j - 1].t < tk[k]) {
+                stack[j] = stack[j - 1];
+                j--;
+            }
+            stack[j].ref   = n->child[k];
+            stack[j].count = n->count[k];
+            stack[j].t     = tk[k];
+        }
+    }
+    return found;
+}
+
+/* Find the triangle of v, as passed to cml_math_bvh4_build_triangles, that
+ * the ray o + t * d hits first with t in [tmin, tmax]. Returns false on a
+ * miss, otherwise true with the hit written to hit. */
+static inline bool
+cml_math_bvh4_intersect_triangles(const bvh4* b, const vec4* v, const vec4 o,
+                                  const vec4 d, const f64 tmin,
+                                  const f64 tmax, bvh4_hit* hit) {
+    return cml_math_bvh4_traverse(b, CML_BVH4_TRIANGLES, v, NULL, o, d, tmin,
+                                  tmax, false, hit);
+}
+
+/* Returns true if the ray o + t * d hits any triangle of v with t in
+ * [tmin, tmax], stopping at the first hit found. */
+static inline bool
+cml_math_bvh4_occluded_triangles(const bvh4* b, const vec4* v, const vec4 o,
+                                 const vec4 d, const f64 tmin,
+                                 const f64 tmax) {
+    return cml_math_bvh4_traverse(b, CML_BVH4_TRIANGLES, v, NULL, o, d, tmin,
+                                  tmax, true, NULL);
+}
+
+/* Find the box lo[i] to hi[i], as passed to cml_math_bvh4_build, that the
+ * ray o + t * d enters first with t in [tmin, tmax]. Returns false on a miss,
+ * otherwise true with the entry distance and box written to hit. */
+static inline bool
+cml_math_bvh4_intersect_aabbs(const bvh4* b, const vec4* lo, const vec4* hi,
+                              const vec4 o, const vec4 d, const f64 tmin,
+                              const f64 tmax, bvh4_hit* hit) {
+    return cml_math_bvh4_traverse(b, CML_BVH4_AABBS, lo, hi, o, d, tmin, tmax,
+                                  false, hit);
+}
+
+/* Returns true if the ray o + t * d hits any box with t in [tmin, tmax],
+ * stopping at the first hit found. */
+static inline bool
+cml_math_bvh4_occluded_aabbs(const bvh4* b, const vec4* lo, const vec4* hi,
+                             const vec4 o, const vec4 d, const f64 tmin,
+                             const f64 tmax) {
+    return cml_math_bvh4_traverse(b, CML_BVH4_AABBS, lo, hi, o, d, tmin, tmax,
+                                  true, NULL);
 }
 
-/* Quaternion rotation. */
+/*============================================================================*/
+/* Random Sampling                                                            */
+/*============================================================================*/
+
+/* Samplers for common distributions, built on the xoshiro generators and the
+ * vector log and sincos kernels, so no sample calls into scalar libm. The
+ * single-value samplers draw from a rngx4. The fill functions draw from a
+ * rngx8, like cml_math_rand_fill_f64, and process a full generator step per
+ * iteration. */
+
+/* Returns four independent standard normal samples. One draw of four
+ * uniforms feeds two Box-Muller pairs. */
 cml_inline vec4
-cml_math_quat_rotate(const quat a, const vec4 b) {
-    quat r;
-    r.q = simde_mm256_add_pd(
-          simde_mm256_add_pd(
-          simde_mm256_add_pd(
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0x00), 
-          simde_mm256_permute4x64_pd(b.v, 0x00)),
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0x55), 
-          simde_mm256_permute4x64_pd(b.v, 0x55))),
-          simde_mm256_add_pd(
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0xAA), 
-          simde_mm256_permute4x64_pd(b.v, 0xAA)),
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0xFF), 
-          simde_mm256_permute4x64_pd(b.v, 0xFF)))),
-          simde_mm256_add_pd(
-          simde_mm256_add_pd(
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0x00), 
-          simde_mm256_permute4x64_pd(b.v, 0x55)),
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0x55), 
-          simde_mm256_permute4x64_pd(b.v, 0xAA))),
-          simde_mm256_add_pd(
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0xAA), 
-          simde_mm256_permute4x64_pd(b.v, 0xFF)),
-          simde_mm256_mul_pd(
-          simde_mm256_permute4x64_pd(a.q, 0xFF), 
-          simde_mm256_permute4x64_pd(b.v, 0x00)))));
+cml_math_rngx4_normal(rngx4* r) {
+    const f64x4 u  = cml_math_rngx4_next_f64(r);
+    /* (u0, u1, u0, u1) for the radii and (u2, u3, u2, u3) for the angles. */
+    const f64x4 ur = simde_mm256_permute4x64_pd(u, 0x44);
+    const f64x4 ua = simde_mm256_permute4x64_pd(u, 0xEE);
+    const f64x4 radius = simde_mm256_sqrt_pd(
+                         simde_mm256_mul_pd(simde_mm256_set1_pd(-2.0),
+                         cml_math_log_f64x4(
+                         simde_mm256_sub_pd(simde_mm256_set1_pd(1.0), ur))));
+    f64x4 s, c;
+    cml_math_sincos_turns_f64x4(ua, &s, &c);
     vec4 v;
-    v.v = r.q;
+    v.v = simde_mm256_mul_pd(radius, simde_mm256_blend_pd(c, s, 0xC));
     return v;
 }
 
-/* Quaternion to matrix. */
-cml_inline mat4
-cml_math_quat_to_mat4(const quat a) {
-    mat4 r;
-    r.m[0][0] = 1.0 - 2.0 * a.q[2] * a.q[2] - 2.0 * a.q[3] * a.q[3];
-    r.m[0][1] = 2.0       * a.q[1] * a.q[2] - 2.0 * a.q[3] * a.q[0];
-    r.m[0][2] = 2.0       * a.q[1] * a.q[3] + 2.0 * a.q[2] * a.q[0];
-    r.m[0][3] = 0.0;
-    r.m[1][0] = 2.0       * a.q[1] * a.q[2] + 2.0 * a.q[3] * a.q[0];
-    r.m[1][1] = 1.0 - 2.0 * a.q[1] * a.q[1] - 2.0 * a.q[3] * a.q[3];
-    r.m[1][2] = 2.0       * a.q[2] * a.q[3] - 2.0 * a.q[1] * a.q[0];
-    r.m[1][3] = 0.0;
-    r.m[2][0] = 2.0       * a.q[1] * a.q[3] - 2.0 * a.q[2] * a.q[0];
-    r.m[2][1] = 2.0       * a.q[2] * a.q[3] + 2.0 * a.q[1] * a.q[0];
-    r.m[2][2] = 1.0 - 2.0 * a.q[1] * a.q[1] - 2.0 * a.q[2] * a.q[2];
-    r.m[2][3] = 0.0;
-    r.m[3][0] = 0.0;
-    r.m[3][1] = 0.0;
-    r.m[3][2] = 0.0;
-    r.m[3][3] = 1.0;
-    return r;
-}
-
-/* Quaternion to vector. */
+/* Returns four independent samples of the exponential distribution with
+ * rate 1. Scale by 1 / lambda for other rates. */
 cml_inline vec4
-cml_math_quat_to_vec4(const quat a) {
-    vec4 r;
-    r.v = a.q;
-    return r;
+cml_math_rngx4_exponential(rngx4* r) {
+    const f64x4 u = cml_math_rngx4_next_f64(r);
+    vec4 v;
+    v.v = simde_mm256_sub_pd(simde_mm256_setzero_pd(),
+          cml_math_log_f64x4(simde_mm256_sub_pd(simde_mm256_set1_pd(1.0), u)));
+    return v;
 }
 
-/* Pitch from quaternion. */
-cml_inline f64
-cml_math_quat_pitch(const quat a) {
-    return atan2(2.0       * (a.q[0] * a.q[1] + a.q[2] * a.q[3]), 
-                 1.0 - 2.0 * (a.q[1] * a.q[1] + a.q[2] * a.q[2]));
+/* Returns a point distributed uniformly on the unit sphere, with w = 0. The
+ * height is uniform in [-1, 1) and the azimuth uniform in [0, 2 * pi). */
+cml_inline vec4
+cml_math_rngx4_unit_sphere(rngx4* r) {
+    const f64x4 u = cml_math_rngx4_next_f64(r);
+    f64 a[4];
+    f64x4 s, c;
+    cml_math_sincos_turns_f64x4(simde_mm256_permute4x64_pd(u, 0x55), &s, &c);
+    simde_mm256_storeu_pd(a, u);
+    const f64 z      = 2.0 * a[0] - 1.0;
+    const f64 radius = sqrt(fmax(0.0, 1.0 - z * z));
+    vec4 v;
+    v.v = simde_mm256_mul_pd(simde_mm256_set_pd(0.0, 0.0, radius, radius),
+                             simde_mm256_unpacklo_pd(c, s));
+    v.v = simde_mm256_blend_pd(v.v, simde_mm256_set1_pd(z), 0x4);
+    return v;
 }
 
-/* Yaw from quaternion. */
-cml_inline f64
-cml_math_quat_yaw(const quat a) {
-    return asin(2.0 * (a.q[0] * a.q[2] - a.q[3] * a.q[1]));
+/* Returns a point distributed uniformly in the unit disk. */
+cml_inline vec2
+cml_math_rngx4_unit_disk(rngx4* r) {
+    const f64x4 u = cml_math_rngx4_next_f64(r);
+    f64x4 s, c;
+    cml_math_sincos_turns_f64x4(simde_mm256_permute4x64_pd(u, 0x55), &s, &c);
+    const f64x4 p = simde_mm256_mul_pd(simde_mm256_unpacklo_pd(c, s),
+                    simde_mm256_sqrt_pd(simde_mm256_permute4x64_pd(u, 0x00)));
+    vec2 v;
+    v.v = simde_mm256_castpd256_pd128(p);
+    return v;
 }
 
-/* Roll from quaternion. */
-cml_inline f64
-cml_math_quat_roll(const quat a) {
-    return atan2(2.0       * (a.q[0] * a.q[3] + a.q[1] * a.q[2]), 
-                 1.0 - 2.0 * (a.q[2] * a.q[2] + a.q[3] * a.q[3]));
+/* Splits one step of an eight-lane generator into two four-lane halves of
+ * uniforms in [0, 1). */
+cml_inline void
+cml_math_rngx8_next_f64_halves(rngx8* r, f64x4* lo, f64x4* hi) {
+    const simde__m512d u = cml_math_rngx8_next_f64(r);
+    *lo = simde_mm512_castpd512_pd256(u);
+    *hi = simde_mm512_extractf64x4_pd(u, 1);
+}
+
+/* Fill out with n standard normal samples, eight per step, by the
+ * Box-Muller transform. */
+static inline void
+cml_math_rand_fill_normal(rngx8* r, f64* out, const size_t n) {
+    rngx8 g = *r;
+    size_t i = 0;
+    while (i < n) {
+        f64x4 ur, ua, s, c;
+        cml_math_rngx8_next_f64_halves(&g, &ur, &ua);
+        const f64x4 radius = simde_mm256_sqrt_pd(
+                             simde_mm256_mul_pd(simde_mm256_set1_pd(-2.0),
+                             cml_math_log_f64x4(simde_mm256_sub_pd(
+                             simde_mm256_set1_pd(1.0), ur))));
+        cml_math_sincos_turns_f64x4(ua, &s, &c);
+        f64 tmp[8];
+        f64* dst = i + 8 <= n ? out + i : tmp;
+        simde_mm256_storeu_pd(dst,     simde_mm256_mul_pd(radius, c));
+        simde_mm256_storeu_pd(dst + 4, simde_mm256_mul_pd(radius, s));
+        if (dst == tmp) {
+            memcpy(out + i, tmp, (n - i) * sizeof(f64));
+        }
+        i += 8;
+    }
+    *r = g;
+}
+
+/* Fill out with n samples of the exponential distribution with rate 1,
+ * eight per step. */
+static inline void
+cml_math_rand_fill_exponential(rngx8* r, f64* out, const size_t n) {
+    const f64x4 one = simde_mm256_set1_pd(1.0);
+    rngx8 g = *r;
+    size_t i = 0;
+    while (i < n) {
+        f64x4 lo, hi;
+        cml_math_rngx8_next_f64_halves(&g, &lo, &hi);
+        lo = cml_math_log_f64x4(simde_mm256_sub_pd(one, lo));
+        hi = cml_math_log_f64x4(simde_mm256_sub_pd(one, hi));
+        f64 tmp[8];
+        f64* dst = i + 8 <= n ? out + i : tmp;
+        simde_mm256_storeu_pd(dst,     simde_mm256_sub_pd(
+                                       simde_mm256_setzero_pd(), lo));
+        simde_mm256_storeu_pd(dst + 4, simde_mm256_sub_pd(
+                                       simde_mm256_setzero_pd(), hi));
+        if (dst == tmp) {
+            memcpy(out + i, tmp, (n - i) * sizeof(f64));
+        }
+        i += 8;
+    }
+    *r = g;
+}
+
+/* Fill out with n points distributed uniformly on the unit sphere, with
+ * w = 0. Each step makes four points in planar form and transposes them
+ * into vec4s. */
+static inline void
+cml_math_rand_fill_unit_sphere(rngx8* r, vec4* out, const size_t n) {
+    rngx8 g = *r;
+    size_t i = 0;
+    while (i < n) {
+        f64x4 uz, ua, p[4];
+        cml_math_rngx8_next_f64_halves(&g, &uz, &ua);
+        p[2] = simde_mm256_fmsub_pd(uz, simde_mm256_set1_pd(2.0),
+                                    simde_mm256_set1_pd(1.0));
+        const f64x4 radius = simde_mm256_sqrt_pd(simde_mm256_max_pd(
+                             simde_mm256_setzero_pd(),
+                             simde_mm256_fnmadd_pd(p[2], p[2],
+                             simde_mm256_set1_pd(1.0))));
+        cml_math_sincos_turns_f64x4(ua, &p[1], &p[0]);
+        p[0] = simde_mm256_mul_pd(p[0], radius);
+        p[1] = simde_mm256_mul_pd(p[1], radius);
+        p[3] = simde_mm256_setzero_pd();
+        cml_math_f64x4_transpose(p);
+        const size_t m = n - i < 4 ? n - i : 4;
+        for (size_t j = 0; j < m; j++) {
+            out[i + j].v = p[j];
+        }
+        i += 4;
+    }
+    *r = g;
+}
+
+/* Fill out with n points distributed uniformly in the unit disk. */
+static inline void
+cml_math_rand_fill_unit_disk(rngx8* r, vec2* out, const size_t n) {
+    rngx8 g = *r;
+    size_t i = 0;
+    while (i < n) {
+        f64x4 ur, ua, s, c;
+        cml_math_rngx8_next_f64_halves(&g, &ur, &ua);
+        cml_math_sincos_turns_f64x4(ua, &s, &c);
+        const f64x4 radius = simde_mm256_sqrt_pd(ur);
+        const f64x4 x  = simde_mm256_mul_pd(c, radius);
+        const f64x4 y  = simde_mm256_mul_pd(s, radius);
+        /* (x0, y0, x2, y2) and (x1, y1, x3, y3) back into point order. */
+        const f64x4 lo = simde_mm256_unpacklo_pd(x, y);
+        const f64x4 hi = simde_mm256_unpackhi_pd(x, y);
+        f64 tmp[8];
+        f64* dst = i + 4 <= n ? (f64*)(out + i) : tmp;
+        simde_mm256_storeu_pd(dst,     
+                              simde_mm256_permute2f128_pd(lo, hi, 0x20));
+        simde_mm256_storeu_pd(dst + 4, 
+                              simde_mm256_permute2f128_pd(lo, hi, 0x31));
+        if (dst == tmp) {
+            memcpy(out + i, tmp, (n - i) * sizeof(vec2));
+        }
+        i += 4;
+    }
+    *r = g;
 }
 
-/* Quaternion from pitch, yaw and roll. */
-cml_inline quat
-cml_math_quat_from_pitch_yaw_roll(const f64 pitch, const f64 yaw, 
-                                  const f64 roll) {
-    quat r;
-    f64 c1 = cos(pitch * 0.5);
-    f64 c2 = cos(yaw   * 0.5);
-    f64 c3 = cos(roll  * 0.5);
-    f64 s1 = sin(pitch * 0.5);
-    f64 s2 = sin(yaw   * 0.5);
-    f64 s3 = sin(roll  * 0.5);
-    r.q[0] = c1 * c2 * c3 + s1 * s2 * s3;
-    r.q[1] = s1 * c2 * c3 - c1 * s2 * s3;
-    r.q[2] = c1 * s2 * c3 + s1 * c2 * s3;
-    r.q[3] = c1 * c2 * s3 - s1 * s2 * c3;
-    return r;
-}
+/*============================================================================*/
+/* Runtime Dispatch                                                           */
+/*============================================================================*/
 
-/* Quaternion from axis and angle. */
-cml_inline quat
-cml_math_quat_from_axis_angle(const vec4 axis, const f64 angle) {
-    quat r;
-    f64 s  = sin(angle * 0.5);
-    r.q[0] = cos(angle * 0.5);
-    r.q[1] = axis.v[0] * s;
-    r.q[2] = axis.v[1] * s;
-    r.q[3] = axis.v[2] * s;
-    return r;
+/* The batch and array kernels are picked at runtime through a table of
+ * function pointers, so one binary can be built for a baseline target and
+ * still use AVX2 or AVX-512 where present. SIMDE chooses its intrinsics from
+ * the compiler flags, so a variant for a wider instruction set has to be a
+ * whole translation unit compiled with those flags: a source file that
+ * defines CML_DISPATCH_EMIT_AVX2 or CML_DISPATCH_EMIT_AVX512 before
+ * including this header (dispatch/ holds both) defines
+ * cml_dispatch_fill_avx2 or cml_dispatch_fill_avx512, which point a table
+ * at that file's copies of the kernels. Programs linking them define
+ * CML_DISPATCH_AVX2 and CML_DISPATCH_AVX512 everywhere; the CMake
+ * cml_dispatch target does both. The baseline variants are those of the
+ * translation unit that first fills the table, compiled with its own flags.
+ * Vector arguments are passed by pointer because the ABI for passing
+ * 256-bit values differs between the variants. */
+
+typedef enum cml_cpu_level {
+    CML_CPU_BASELINE = 0,
+    CML_CPU_AVX2     = 1,
+    CML_CPU_AVX512   = 2
+} cml_cpu_level;
+
+typedef struct cml_dispatch_table {
+    cml_cpu_level level;
+    void (*mat4_transform_points)(const mat4* m, const vec4* in, vec4* out,
+                                  size_t n);
+    void (*mat4_affine_transform_points)(const mat4* m, const vec4* in,
+                                         vec4* out, size_t n);
+    void (*mat4_mul_array)(const mat4* a, const mat4* b, mat4* out,
+                           size_t n);
+    void (*mat4_flatten_range)(const i32* parent, const mat4* local,
+                               mat4* world, const u32* order, size_t begin,
+                               size_t end);
+    void (*mat4_rotation_array)(const vec4* axis, const f64* angle,
+                                mat4* out, size_t n);
+    size_t (*mat4_inverse_array)(const mat4* a, mat4* out, size_t n,
+                                 f64 tol, u64* singular);
+    void (*mat4f_transform_points)(const mat4f* m, const vec4f* in,
+                                   vec4f* out, size_t n);
+    void (*quat_slerp_array)(const quat* a, const quat* b, const f64* t,
+                             quat* out, size_t n);
+    void (*quat_nlerp_array)(const quat* a, const quat* b, const f64* t,
+                             quat* out, size_t n);
+    void (*quat_rotate_array)(const quat* q, const vec4* in, vec4* out,
+                              size_t n);
+    void (*quat_from_axis_angle_array)(const vec4* axis, const f64* angle,
+                                       quat* out, size_t n);
+    void (*vec4_soa_normalize)(const vec4_soa* a, vec4_soa* out);
+    void (*vec4_soa_rotate)(const quat* q, const vec4_soa* a, vec4_soa* out);
+    void (*quat_soa_mul)(const quat_soa* a, const quat_soa* b,
+                         quat_soa* out);
+    void (*quat_soa_slerp)(const quat_soa* a, const quat_soa* b,
+                           const f64* t, quat_soa* out);
+    void (*quat_soa_rotate)(const quat_soa* q, const vec4_soa* a,
+                            vec4_soa* out);
+    void (*mat4_soa_determinant)(const mat4_soa* a, f64* out);
+    size_t (*mat4_soa_inverse)(const mat4_soa* a, mat4_soa* out, f64 tol,
+                               u64* singular);
+    void (*dquat_skin)(const dquat* bones, const u32* index,
+                       const f64* weight, size_t k, const vec4_soa* pos,
+                       const vec4_soa* nrm, vec4_soa* out_pos,
+                       vec4_soa* out_nrm);
+    void (*spline_eval_array)(cml_spline_kind kind, const vec4* p, size_t n,
+                              const f64* u, vec4* out, size_t m);
+    void (*bernstein_eval_array)(const f64* c, u32 n, const f64* t, f64* out,
+                                 size_t m);
+    void (*sin_array)(const f64* in, f64* out, size_t n);
+    void (*cos_array)(const f64* in, f64* out, size_t n);
+    void (*sincos_array)(const f64* in, f64* s, f64* c, size_t n);
+    void (*exp_array)(const f64* in, f64* out, size_t n);
+    void (*log_array)(const f64* in, f64* out, size_t n);
+    f64 (*array_sum)(const f64* a, size_t n, cml_reduce_mode mode);
+    f64 (*array_dot)(const f64* a, const f64* b, size_t n,
+                     cml_reduce_mode mode);
+    size_t (*frustum_cull_spheres)(const frustum* f, const vec4_soa* s,
+                                   u64* mask);
+    size_t (*frustum_cull_aabbs)(const frustum* f, const vec4_soa* lo,
+                                 const vec4_soa* hi, u64* mask);
+    size_t (*frustum_cull_spheres_f32)(const frustum* f, const vec4f_soa* s,
+                                       u64* mask);
+    size_t (*frustum_cull_aabbs_f32)(const frustum* f, const vec4f_soa* lo,
+                                     const vec4f_soa* hi, u64* mask);
+    void (*rand_fill_u64)(rngx8* r, u64* out, size_t n);
+    void (*rand_fill_f64)(rngx8* r, f64* out, size_t n);
+    void (*rand_fill_normal)(rngx8* r, f64* out, size_t n);
+} cml_dispatch_table;
+
+/* Highest instruction set the CPU and operating system both support, read
+ * with cpuid (and xgetbv for the register state) through the compiler's
+ * CPU model. */
+static inline cml_cpu_level
+cml_cpu_detect(void) {
+#if defined(CML_DISPATCH_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512vl")) {
+        return CML_CPU_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return CML_CPU_AVX2;
+    }
+#endif
+    return CML_CPU_BASELINE;
 }
 
-/* Quaternion from matrix. */
-cml_inline quat
-cml_math_quat_from_mat4(const mat4 a) {
-    quat r;
-    f64 tr = a.m[0][0] + a.m[1][1] + a.m[2][2];
-    if (tr > 0.0) {
-        f64 s = sqrt(tr + 1.0);
-        r.q[0] = s * 0.5;
-        s = 0.5 / s;
-        r.q[1] = (a.m[2][1] - a.m[1][2]) * s;
-        r.q[2] = (a.m[0][2] - a.m[2][0]) * s;
-        r.q[3] = (a.m[1][0] - a.m[0][1]) * s;
-    } else {
-        i32 i  = a.m[0][0] < a.m[1][1] ? 
-                (a.m[1][1] < a.m[2][2] ? 2 : 1) : 
-                (a.m[0][0] < a.m[2][2] ? 2 : 0);
-        i32 j = (i + 1) % 3;
-        i32 k = (i + 2) % 3;
-        f64 s = sqrt((a.m[i][i] - (a.m[j][j] + a.m[k][k])) + 1.0);
-        r.q[i + 1] = s * 0.5;
-        s = 0.5 / s;
-        r.q[0]     = (a.m[k][j] - a.m[j][k]) * s;
-        r.q[j + 1] = (a.m[j][i] + a.m[i][j]) * s;
-        r.q[k + 1] = (a.m[k][i] + a.m[i][k]) * s;
+/* Defines cml_dispatch_<name>, a wrapper of cml_math_<name> compiled with
+ * the flags of the current translation unit. The wrapper takes params and
+ * forwards args; the _RET form returns the kernel's result. */
+#define CML_DISPATCH_KERNEL(name, params, args)                                \
+    static void                                                                \
+    cml_dispatch_##name params {                                               \
+        cml_math_##name args;                                                  \
     }
-    return r;
+#define CML_DISPATCH_KERNEL_RET(type, name, params, args)                      \
+    static type                                                                \
+    cml_dispatch_##name params {                                               \
+        return cml_math_##name args;                                           \
+    }
+
+CML_DISPATCH_KERNEL(mat4_transform_points,
+    (const mat4* m, const vec4* in, vec4* out, size_t n), (m, in, out, n))
+CML_DISPATCH_KERNEL(mat4_affine_transform_points,
+    (const mat4* m, const vec4* in, vec4* out, size_t n), (m, in, out, n))
+CML_DISPATCH_KERNEL(mat4_mul_array,
+    (const mat4* a, const mat4* b, mat4* out, size_t n), (a, b, out, n))
+CML_DISPATCH_KERNEL(mat4_flatten_range,
+    (const i32* parent, const mat4* local, mat4* world, const u32* order,
+     size_t begin, size_t end),
+    (parent, local, world, order, begin, end))
+CML_DISPATCH_KERNEL(mat4_rotation_array,
+    (const vec4* axis, const f64* angle, mat4* out, size_t n),
+    (axis, angle, out, n))
+CML_DISPATCH_KERNEL_RET(size_t, mat4_inverse_array,
+    (const mat4* a, mat4* out, size_t n, f64 tol, u64* singular),
+    (a, out, n, tol, singular))
+CML_DISPATCH_KERNEL(mat4f_transform_points,
+    (const mat4f* m, const vec4f* in, vec4f* out, size_t n), (m, in, out, n))
+CML_DISPATCH_KERNEL(quat_slerp_array,
+    (const quat* a, const quat* b, const f64* t, quat* out, size_t n),
+    (a, b, t, out, n))
+CML_DISPATCH_KERNEL(quat_nlerp_array,
+    (const quat* a, const quat* b, const f64* t, quat* out, size_t n),
+    (a, b, t, out, n))
+CML_DISPATCH_KERNEL(quat_rotate_array,
+    (const quat* q, const vec4* in, vec4* out, size_t n), (*q, in, out, n))
+CML_DISPATCH_KERNEL(quat_from_axis_angle_array,
+    (const vec4* axis, const f64* angle, quat* out, size_t n),
+    (axis, angle, out, n))
+CML_DISPATCH_KERNEL(vec4_soa_normalize,
+    (const vec4_soa* a, vec4_soa* out), (a, out))
+CML_DISPATCH_KERNEL(vec4_soa_rotate,
+    (const quat* q, const vec4_soa* a, vec4_soa* out), (*q, a, out))
+CML_DISPATCH_KERNEL(quat_soa_mul,
+    (const quat_soa* a, const quat_soa* b, quat_soa* out), (a, b, out))
+CML_DISPATCH_KERNEL(quat_soa_slerp,
+    (const quat_soa* a, const quat_soa* b, const f64* t, quat_soa* out),
+    (a, b, t, out))
+CML_DISPATCH_KERNEL(quat_soa_rotate,
+    (const quat_soa* q, const vec4_soa* a, vec4_soa* out), (q, a, out))
+CML_DISPATCH_KERNEL(mat4_soa_determinant,
+    (const mat4_soa* a, f64* out), (a, out))
+CML_DISPATCH_KERNEL_RET(size_t, mat4_soa_inverse,
+    (const mat4_soa* a, mat4_soa* out, f64 tol, u64* singular),
+    (a, out, tol, singular))
+CML_DISPATCH_KERNEL(dquat_skin,
+    (const dquat* bones, const u32* index, const f64* weight, size_t k,
+     const vec4_soa* pos, const vec4_soa* nrm, vec4_soa* out_pos,
+     vec4_soa* out_nrm),
+    (bones, index, weight, k, pos, nrm, out_pos, out_nrm))
+CML_DISPATCH_KERNEL(spline_eval_array,
+    (cml_spline_kind kind, const vec4* p, size_t n, const f64* u, vec4* out,
+     size_t m),
+    (kind, p, n, u, out, m))
+CML_DISPATCH_KERNEL(bernstein_eval_array,
+    (const f64* c, u32 n, const f64* t, f64* out, size_t m),
+    (c, n, t, out, m))
+CML_DISPATCH_KERNEL(sin_array,
+    (const f64* in, f64* out, size_t n), (in, out, n))
+CML_DISPATCH_KERNEL(cos_array,
+    (const f64* in, f64* out, size_t n), (in, out, n))
+CML_DISPATCH_KERNEL(sincos_array,
+    (const f64* in, f64* s, f64* c, size_t n), (in, s, c, n))
+CML_DISPATCH_KERNEL(exp_array,
+    (const f64* in, f64* out, size_t n), (in, out, n))
+CML_DISPATCH_KERNEL(log_array,
+    (const f64* in, f64* out, size_t n), (in, out, n))
+CML_DISPATCH_KERNEL_RET(f64, array_sum,
+    (const f64* a, size_t n, cml_reduce_mode mode), (a, n, mode))
+CML_DISPATCH_KERNEL_RET(f64, array_dot,
+    (const f64* a, const f64* b, size_t n, cml_reduce_mode mode),
+    (a, b, n, mode))
+CML_DISPATCH_KERNEL_RET(size_t, frustum_cull_spheres,
+    (const frustum* f, const vec4_soa* s, u64* mask), (f, s, mask))
+CML_DISPATCH_KERNEL_RET(size_t, frustum_cull_aabbs,
+    (const frustum* f, const vec4_soa* lo, const vec4_soa* hi, u64* mask),
+    (f, lo, hi, mask))
+CML_DISPATCH_KERNEL_RET(size_t, frustum_cull_spheres_f32,
+    (const frustum* f, const vec4f_soa* s, u64* mask), (f, s, mask))
+CML_DISPATCH_KERNEL_RET(size_t, frustum_cull_aabbs_f32,
+    (const frustum* f, const vec4f_soa* lo, const vec4f_soa* hi, u64* mask),
+    (f, lo, hi, mask))
+CML_DISPATCH_KERNEL(rand_fill_u64,
+    (rngx8* r, u64* out, size_t n), (r, out, n))
+CML_DISPATCH_KERNEL(rand_fill_f64,
+    (rngx8* r, f64* out, size_t n), (r, out, n))
+CML_DISPATCH_KERNEL(rand_fill_normal,
+    (rngx8* r, f64* out, size_t n), (r, out, n))
+
+/* Points every entry of a table at the wrappers of this translation unit,
+ * recording the instruction set they were compiled for. */
+static inline void
+cml_dispatch_fill_local(cml_dispatch_table* t, const cml_cpu_level level) {
+    t->level                        = level;
+    t->mat4_transform_points        = cml_dispatch_mat4_transform_points;
+    t->mat4_affine_transform_points = cml_dispatch_mat4_affine_transform_points;
+    t->mat4_mul_array               = cml_dispatch_mat4_mul_array;
+    t->mat4_flatten_range           = cml_dispatch_mat4_flatten_range;
+    t->mat4_rotation_array          = cml_dispatch_mat4_rotation_array;
+    t->mat4_inverse_array           = cml_dispatch_mat4_inverse_array;
+    t->mat4f_transform_points       = cml_dispatch_mat4f_transform_points;
+    t->quat_slerp_array             = cml_dispatch_quat_slerp_array;
+    t->quat_nlerp_array             = cml_dispatch_quat_nlerp_array;
+    t->quat_rotate_array            = cml_dispatch_quat_rotate_array;
+    t->quat_from_axis_angle_array   = cml_dispatch_quat_from_axis_angle_array;
+    t->vec4_soa_normalize           = cml_dispatch_vec4_soa_normalize;
+    t->vec4_soa_rotate              = cml_dispatch_vec4_soa_rotate;
+    t->quat_soa_mul                 = cml_dispatch_quat_soa_mul;
+    t->quat_soa_slerp               = cml_dispatch_quat_soa_slerp;
+    t->quat_soa_rotate              = cml_dispatch_quat_soa_rotate;
+    t->mat4_soa_determinant         = cml_dispatch_mat4_soa_determinant;
+    t->mat4_soa_inverse             = cml_dispatch_mat4_soa_inverse;
+    t->dquat_skin                   = cml_dispatch_dquat_skin;
+    t->spline_eval_array            = cml_dispatch_spline_eval_array;
+    t->bernstein_eval_array         = cml_dispatch_bernstein_eval_array;
+    t->sin_array                    = cml_dispatch_sin_array;
+    t->cos_array                    = cml_dispatch_cos_array;
+    t->sincos_array                 = cml_dispatch_sincos_array;
+    t->exp_array                    = cml_dispatch_exp_array;
+    t->log_array                    = cml_dispatch_log_array;
+    t->array_sum                    = cml_dispatch_array_sum;
+    t->array_dot                    = cml_dispatch_array_dot;
+    t->frustum_cull_spheres         = cml_dispatch_frustum_cull_spheres;
+    t->frustum_cull_aabbs           = cml_dispatch_frustum_cull_aabbs;
+    t->frustum_cull_spheres_f32     = cml_dispatch_frustum_cull_spheres_f32;
+    t->frustum_cull_aabbs_f32       = cml_dispatch_frustum_cull_aabbs_f32;
+    t->rand_fill_u64                = cml_dispatch_rand_fill_u64;
+    t->rand_fill_f64                = cml_dispatch_rand_fill_f64;
+    t->rand_fill_normal             = cml_dispatch_rand_fill_normal;
+}
+
+/* Fill functions of the variant translation units. */
+#if defined(CML_DISPATCH_AVX2) || defined(CML_DISPATCH_EMIT_AVX2)
+void cml_dispatch_fill_avx2(cml_dispatch_table* t);
+#endif
+#if defined(CML_DISPATCH_AVX512) || defined(CML_DISPATCH_EMIT_AVX512)
+void cml_dispatch_fill_avx512(cml_dispatch_table* t);
+#endif
+
+#if defined(CML_DISPATCH_EMIT_AVX2)
+    #if !defined(__AVX2__) || !defined(__FMA__)
+        #error "CML_DISPATCH_EMIT_AVX2 needs AVX2 and FMA enabled"
+    #endif
+void
+cml_dispatch_fill_avx2(cml_dispatch_table* t) {
+    cml_dispatch_fill_local(t, CML_CPU_AVX2);
 }
+#endif
 
-/* Quaternion from vector. */
-cml_inline quat
-cml_math_quat_from_vec4(const vec4 a) {
-    quat r;
-    r.q[0] = a.v[0];
-    r.q[1] = a.v[1];
-    r.q[2] = a.v[2];
-    r.q[3] = a.v[3];
-    return r;
+#if defined(CML_DISPATCH_EMIT_AVX512)
+    #if !defined(__AVX512F__) || !defined(__AVX512DQ__) || \
+        !defined(__AVX512VL__)
+        #error "CML_DISPATCH_EMIT_AVX512 needs AVX-512 F, DQ and VL enabled"
+    #endif
+void
+cml_dispatch_fill_avx512(cml_dispatch_table* t) {
+    cml_dispatch_fill_local(t, CML_CPU_AVX512);
 }
+#endif
 
-/* Print quaternion. */
-cml_inline void
-cml_math_quat_print(const quat a) {
-    printf("quat(%f, %f, %f, %f)\n", a.q[0], a.q[1], a.q[2], a.q[3]);
+/* One table per level, shared by every translation unit. Each is filled
+ * once: its state goes from 0 (empty) to 1 (being filled) to 2 (ready).
+ * cml_dispatch_level is the level cml_dispatch returns, or -1 before the
+ * first cml_dispatch_init. */
+cml_shared cml_dispatch_table cml_dispatch_tables[3] = {{CML_CPU_BASELINE}};
+cml_shared i32                cml_dispatch_filled[3] = {0, 0, 0};
+cml_shared i32                cml_dispatch_level     = -1;
+
+/* The highest level at most level whose variants are linked in. */
+cml_inline cml_cpu_level
+cml_dispatch_linked(const cml_cpu_level level) {
+#if defined(CML_DISPATCH_AVX512)
+    if (level >= CML_CPU_AVX512) {
+        return CML_CPU_AVX512;
+    }
+#endif
+#if defined(CML_DISPATCH_AVX2)
+    if (level >= CML_CPU_AVX2) {
+        return CML_CPU_AVX2;
+    }
+#endif
+    (void)level;
+    return CML_CPU_BASELINE;
+}
+
+/* The table for a linked level, filled by the first caller while any
+ * others wait for it. */
+static inline const cml_dispatch_table*
+cml_dispatch_table_for(const cml_cpu_level level) {
+    cml_dispatch_table* t = &cml_dispatch_tables[level];
+    i32* state = &cml_dispatch_filled[level];
+    if (cml_atomic_load_acquire(state) == 2) {
+        return t;
+    }
+    if (cml_atomic_cas(state, 0, 1)) {
+        switch (level) {
+#if defined(CML_DISPATCH_AVX512)
+        case CML_CPU_AVX512: cml_dispatch_fill_avx512(t); break;
+#endif
+#if defined(CML_DISPATCH_AVX2)
+        case CML_CPU_AVX2:   cml_dispatch_fill_avx2(t);   break;
+#endif
+        default: cml_dispatch_fill_local(t, CML_CPU_BASELINE); break;
+        }
+        cml_atomic_store_release(state, 2);
+    } else {
+        while (cml_atomic_load_acquire(state) != 2) {
+        }
+    }
+    return t;
+}
+
+/* Select the table for the given level, clamped to what the CPU supports
+ * and to the variants linked in. Passing CML_CPU_AVX512 selects the best
+ * available variants; lower levels are useful to compare variants. Safe to
+ * call from any thread; callers already holding a table keep using it. */
+static inline void
+cml_dispatch_init(const cml_cpu_level level) {
+    const cml_cpu_level cpu = cml_cpu_detect();
+    const cml_cpu_level l   = cml_dispatch_linked(level < cpu ? level : cpu);
+    cml_dispatch_table_for(l);
+    cml_atomic_store_release(&cml_dispatch_level, (i32)l);
+}
+
+/* The selected dispatch table, choosing the best variants on first use if
+ * cml_dispatch_init has not been called. */
+cml_inline const cml_dispatch_table*
+cml_dispatch(void) {
+    i32 l = cml_atomic_load_acquire(&cml_dispatch_level);
+    if (l < 0) {
+        cml_dispatch_init(CML_CPU_AVX512);
+        l = cml_atomic_load_acquire(&cml_dispatch_level);
+    }
+    return &cml_dispatch_tables[l];
 }
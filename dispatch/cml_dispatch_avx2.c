@@ -0,0 +1,5 @@
+/* AVX2 variants of the dispatched kernels. Compile with AVX2 and FMA
+ * enabled, and define CML_DISPATCH_AVX2 in the rest of the program. */
+
+#define CML_DISPATCH_EMIT_AVX2
+#include "cml.h"
@@ -0,0 +1,6 @@
+/* AVX-512 variants of the dispatched kernels. Compile with AVX-512 F, DQ
+ * and VL enabled, and define CML_DISPATCH_AVX512 in the rest of the
+ * program. */
+
+#define CML_DISPATCH_EMIT_AVX512
+#include "cml.h"
@@ -0,0 +1,34 @@
+/* Check macros shared by the regression tests. Each test is one executable
+ * that returns nonzero when any check failed. */
+
+#pragma once
+
+#include "cml.h"
+
+#include <stdio.h>
+
+static i32 cml_test_failures = 0;
+
+/* Records a failure when cond is false. */
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,  \
+                    #cond);                                                    \
+            cml_test_failures++;                                               \
+        }                                                                      \
+    } while (0)
+
+/* Records a failure when |a - b| > tol. */
+#define CHECK_NEAR(a, b, tol)                                                  \
+    do {                                                                       \
+        const f64 cml_test_a = (a), cml_test_b = (b);                          \
+        if (!(fabs(cml_test_a - cml_test_b) <= (tol))) {                       \
+            fprintf(stderr, "%s:%d: %s = %.17g, expected %s = %.17g\n",        \
+                    __FILE__, __LINE__, #a, cml_test_a, #b, cml_test_b);       \
+            cml_test_failures++;                                               \
+        }                                                                      \
+    } while (0)
+
+/* Exit status of a test executable. */
+#define CML_TEST_RESULT() (cml_test_failures == 0 ? 0 : 1)
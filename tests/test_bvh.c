@@ -0,0 +1,67 @@
+/* BVH traversal with an unbounded tmax: rays that miss everything return
+ * false instead of revisiting empty child slots, and closest hits match a
+ * brute-force search. */
+
+#include "cml_test.h"
+
+#define TRIS 300
+
+static vec4 g_v[3 * TRIS];
+
+int
+main(void) {
+    /* One box: the root has three empty slots. */
+    const vec4 lo = cml_math_vec4_set(0.0, 0.0, 0.0, 0.0);
+    const vec4 hi = cml_math_vec4_set(1.0, 1.0, 1.0, 0.0);
+    bvh4 b = cml_math_bvh4_build(&lo, &hi, 1);
+    const vec4 away = cml_math_vec4_set(5.0, 5.0, 5.0, 0.0);
+    const vec4 up   = cml_math_vec4_set(1.0, 2.0, 3.0, 0.0);
+    CHECK(!cml_math_bvh4_intersect_aabbs(&b, &lo, &hi, away, up, 0.0,
+                                         INFINITY, NULL));
+    CHECK(!cml_math_bvh4_occluded_aabbs(&b, &lo, &hi, away, up, 0.0,
+                                        INFINITY));
+    cml_math_bvh4_free(&b);
+
+    rng r;
+    cml_math_rng_seed(&r, 7);
+    for (i32 i = 0; i < TRIS; i++) {
+        const f64 cx = cml_math_rng_next_f64(&r);
+        const f64 cy = cml_math_rng_next_f64(&r);
+        const f64 cz = cml_math_rng_next_f64(&r);
+        for (i32 k = 0; k < 3; k++) {
+            g_v[3 * i + k] = cml_math_vec4_set(
+                             cx + 0.05 * cml_math_rng_next_f64(&r),
+                             cy + 0.05 * cml_math_rng_next_f64(&r),
+                             cz + 0.05 * cml_math_rng_next_f64(&r), 0.0);
+        }
+    }
+    b = cml_math_bvh4_build_triangles(g_v, TRIS);
+    CHECK(!cml_math_bvh4_intersect_triangles(&b, g_v, away, up, 0.0,
+                                             INFINITY, NULL));
+    for (i32 j = 0; j < 500; j++) {
+        const f64 o[3] = {-1.0, cml_math_rng_next_f64(&r),
+                          cml_math_rng_next_f64(&r)};
+        const f64 d[3] = {1.0, cml_math_rng_next_f64(&r) - 0.5,
+                          cml_math_rng_next_f64(&r) - 0.5};
+        f64  best  = INFINITY;
+        bool found = false;
+        for (i32 i = 0; i < TRIS; i++) {
+            f64 t, u, v;
+            if (cml_math_bvh4_hit_triangle(o, d, g_v + 3 * i, 0.0, best, &t,
+                                           &u, &v)) {
+                best  = t;
+                found = true;
+            }
+        }
+        bvh4_hit h = {-1.0, 0.0, 0.0, 0};
+        const vec4 ov = cml_math_vec4_set(o[0], o[1], o[2], 0.0);
+        const vec4 dv = cml_math_vec4_set(d[0], d[1], d[2], 0.0);
+        CHECK(cml_math_bvh4_intersect_triangles(&b, g_v, ov, dv, 0.0,
+                                                INFINITY, &h) == found);
+        if (found) {
+            CHECK(h.t == best);
+        }
+    }
+    cml_math_bvh4_free(&b);
+    return CML_TEST_RESULT();
+}
@@ -0,0 +1,82 @@
+/* The vector loops of the batch culling kernels classify every object as
+ * the scalar tail would, NaN bounds included, in f64 and in f32. */
+
+#include "cml_test.h"
+
+#define N 1003
+
+static f64 g_d[8][N];
+static f32 g_f[8][N];
+
+/* Visibility bit i of mask. */
+static bool
+bit(const u64* mask, const size_t i) {
+    return (mask[i / 64] >> (i % 64) & 1) != 0;
+}
+
+int
+main(void) {
+    const frustum fr = cml_math_frustum_from_mat4(
+                       cml_math_mat4_perspective(1.0, 1.5, 0.1, 100.0));
+    rng r;
+    cml_math_rng_seed(&r, 11);
+    for (size_t i = 0; i < N; i++) {
+        for (size_t c = 0; c < 3; c++) {
+            const f64 a = (cml_math_rng_next_f64(&r) - 0.5) * 100.0;
+            const f64 b = a + cml_math_rng_next_f64(&r) * 5.0;
+            g_d[c][i]     = c == 2 ? -a : a;
+            g_d[4 + c][i] = c == 2 ? -a + b - a : b;
+        }
+        g_d[3][i] = cml_math_rng_next_f64(&r) * 5.0;
+        g_d[7][i] = 0.0;
+        /* Every 17th object has a NaN somewhere in its bounds. */
+        if (i % 17 == 0) {
+            g_d[(i / 17) % 8][i] = NAN;
+        }
+        for (size_t c = 0; c < 8; c++) {
+            g_f[c][i] = (f32)g_d[c][i];
+        }
+    }
+    vec4_soa  s  = cml_math_vec4_soa_view(g_d[0], g_d[1], g_d[2], g_d[3], N);
+    vec4_soa  lo = cml_math_vec4_soa_view(g_d[0], g_d[1], g_d[2], g_d[3], N);
+    vec4_soa  hi = cml_math_vec4_soa_view(g_d[4], g_d[5], g_d[6], g_d[7], N);
+    vec4f_soa sf = cml_math_vec4f_soa_view(g_f[0], g_f[1], g_f[2], g_f[3], N);
+    vec4f_soa lf = cml_math_vec4f_soa_view(g_f[0], g_f[1], g_f[2], g_f[3], N);
+    vec4f_soa hf = cml_math_vec4f_soa_view(g_f[4], g_f[5], g_f[6], g_f[7], N);
+
+    u64 ms[(N + 63) / 64], ma[(N + 63) / 64];
+    u64 mfs[(N + 63) / 64], mfa[(N + 63) / 64];
+    const size_t vs = cml_math_frustum_cull_spheres(&fr, &s, ms);
+    const size_t va = cml_math_frustum_cull_aabbs(&fr, &lo, &hi, ma);
+    cml_math_frustum_cull_spheres_f32(&fr, &sf, mfs);
+    cml_math_frustum_cull_aabbs_f32(&fr, &lf, &hf, mfa);
+    CHECK(vs > 0 && vs < N);
+    CHECK(va > 0 && va < N);
+
+    f32 q[CML_FRUSTUM_PLANES][4];
+    cml_math_frustum_planes_f32(&fr, q);
+    size_t mismatch = 0;
+    for (size_t i = 0; i < N; i++) {
+        const vec4 c = cml_math_vec4_soa_get(&s, i);
+        const vec4 h = cml_math_vec4_soa_get(&hi, i);
+        CHECK(bit(ms, i) == cml_math_frustum_test_sphere(&fr, c));
+        CHECK(bit(ma, i) == cml_math_frustum_test_aabb(&fr, c, h));
+        /* A one-object word runs only the scalar tail. */
+        CHECK(bit(mfs, i) ==
+              (cml_math_frustum_spheres_word_f32(q, &sf, i, 1) != 0));
+        CHECK(bit(mfa, i) ==
+              (cml_math_frustum_aabbs_word_f32(q, &lf, &hf, i, 1) != 0));
+        mismatch += bit(ms, i) != bit(mfs, i);
+        mismatch += bit(ma, i) != bit(mfa, i);
+        if (i % 17 == 0) {
+            CHECK(bit(ms, i) || (i / 17) % 8 >= 4);
+        }
+    }
+    /* f32 rounding only matters right at a plane. */
+    CHECK(mismatch <= 2);
+
+    u32 idx[N];
+    CHECK(cml_math_frustum_cull_spheres_indices_f32(&fr, &sf, idx) ==
+          cml_math_cull_mask_to_indices(mfs, N, idx));
+    return CML_TEST_RESULT();
+}
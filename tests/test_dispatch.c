@@ -0,0 +1,139 @@
+/* Runtime dispatch: threads racing through the first cml_dispatch agree on
+ * one table, and the table of every level the CPU supports matches scalar
+ * reference results. */
+
+#include "cml_test.h"
+
+#include <pthread.h>
+
+#define THREADS 4
+#define N       1001
+
+static void*
+first_use(void* out) {
+    *(const cml_dispatch_table**)out = cml_dispatch();
+    return NULL;
+}
+
+/* Scalar slerp of quaternions given as (w, x, y, z), on the shorter arc. */
+static void
+slerp_ref(const f64* a, const f64* b, const f64 t, f64* out) {
+    f64 d = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+    const f64 sign = d < 0.0 ? -1.0 : 1.0;
+    d *= sign;
+    f64 wa = 1.0 - t, wb = t;
+    if (d <= 0.9995) {
+        const f64 theta = acos(d);
+        wa = sin((1.0 - t) * theta) / sin(theta);
+        wb = sin(t * theta) / sin(theta);
+    }
+    f64 len = 0.0;
+    for (i32 k = 0; k < 4; k++) {
+        out[k] = wa * a[k] + sign * wb * b[k];
+        len += out[k] * out[k];
+    }
+    for (i32 k = 0; k < 4; k++) {
+        out[k] /= sqrt(len);
+    }
+}
+
+int
+main(void) {
+    const cml_dispatch_table* seen[THREADS];
+    pthread_t threads[THREADS];
+    for (i32 i = 0; i < THREADS; i++) {
+        CHECK(pthread_create(threads + i, NULL, first_use, seen + i) == 0);
+    }
+    for (i32 i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        CHECK(seen[i] == seen[0]);
+    }
+    const cml_cpu_level cpu = cml_cpu_detect();
+    CHECK(seen[0]->level == cml_dispatch_linked(cpu));
+
+    mat4* m     = (mat4*)cml_aligned_alloc(64, sizeof(mat4));
+    vec4* in    = (vec4*)cml_aligned_alloc(64, 1024 * sizeof(vec4));
+    vec4* out   = (vec4*)cml_aligned_alloc(64, 1024 * sizeof(vec4));
+    quat* qa    = (quat*)cml_aligned_alloc(64, 1024 * sizeof(quat));
+    quat* qb    = (quat*)cml_aligned_alloc(64, 1024 * sizeof(quat));
+    quat* qo    = (quat*)cml_aligned_alloc(64, 1024 * sizeof(quat));
+    f64*  t     = (f64*)malloc(N * sizeof(f64));
+    f64*  fo    = (f64*)malloc(N * sizeof(f64));
+    vec4_soa s  = cml_math_vec4_soa_alloc(N);
+    vec4_soa so = cml_math_vec4_soa_alloc(N);
+    if (!m || !in || !out || !qa || !qb || !qo || !t || !fo || !s.x || !so.x) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    rng r;
+    cml_math_rng_seed(&r, 13);
+    *m = cml_math_mat4_mul(cml_math_mat4_rotation(0.0, 1.0, 0.0, 0.7),
+                           cml_math_mat4_translation(1.0, -2.0, 0.5));
+    for (i32 i = 0; i < N; i++) {
+        f64 x[8];
+        for (i32 k = 0; k < 8; k++) {
+            x[k] = 2.0 * cml_math_rng_next_f64(&r) - 1.0;
+        }
+        in[i]   = cml_math_vec4_set(x[0], x[1], x[2], 1.0);
+        qa[i].q = simde_mm256_setr_pd(x[0], x[1], x[2], x[3]);
+        qb[i].q = simde_mm256_setr_pd(x[4], x[5], x[6], x[7]);
+        qa[i]   = cml_math_quat_normalize(qa[i]);
+        qb[i]   = cml_math_quat_normalize(qb[i]);
+        t[i]    = 0.5 * x[0] + 0.5;
+        s.x[i]  = x[4];
+        s.y[i]  = x[5];
+        s.z[i]  = x[6];
+        s.w[i]  = x[7];
+    }
+
+    for (i32 level = CML_CPU_BASELINE; level <= CML_CPU_AVX512; level++) {
+        if (level > (i32)cpu) {
+            break;
+        }
+        cml_dispatch_init((cml_cpu_level)level);
+        const cml_dispatch_table* d = cml_dispatch();
+        CHECK(d->level == cml_dispatch_linked((cml_cpu_level)level));
+
+        d->mat4_transform_points(m, in, out, N);
+        d->quat_slerp_array(qa, qb, t, qo, N);
+        d->vec4_soa_normalize(&s, &so);
+        d->sin_array(s.x, fo, N);
+        f64 sum = 0.0;
+        for (i32 i = 0; i < N; i++) {
+            for (i32 c = 0; c < 4; c++) {
+                f64 e = 0.0;
+                for (i32 k = 0; k < 4; k++) {
+                    e += in[i].v[k] * m->m[k][c];
+                }
+                CHECK_NEAR(out[i].v[c], e, 1e-14);
+            }
+            f64 a[4], b[4], q[4];
+            for (i32 k = 0; k < 4; k++) {
+                a[k] = qa[i].q[k];
+                b[k] = qb[i].q[k];
+            }
+            slerp_ref(a, b, t[i], q);
+            for (i32 k = 0; k < 4; k++) {
+                CHECK_NEAR(qo[i].q[k], q[k], 1e-14);
+            }
+            const f64 len = sqrt(s.x[i] * s.x[i] + s.y[i] * s.y[i] +
+                                 s.z[i] * s.z[i] + s.w[i] * s.w[i]);
+            CHECK_NEAR(so.x[i], s.x[i] / len, 1e-15);
+            CHECK_NEAR(so.w[i], s.w[i] / len, 1e-15);
+            CHECK_NEAR(fo[i], sin(s.x[i]), 1e-15);
+            sum += s.y[i];
+        }
+        CHECK_NEAR(d->array_sum(s.y, N, CML_REDUCE_PAIRWISE), sum, 1e-12);
+    }
+    cml_aligned_free(m);
+    cml_aligned_free(in);
+    cml_aligned_free(out);
+    cml_aligned_free(qa);
+    cml_aligned_free(qb);
+    cml_aligned_free(qo);
+    free(t);
+    free(fo);
+    cml_math_vec4_soa_free(&s);
+    cml_math_vec4_soa_free(&so);
+    return CML_TEST_RESULT();
+}
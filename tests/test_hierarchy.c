@@ -0,0 +1,71 @@
+/* Hierarchy flattening, serial or split across threads level by level,
+ * matches multiplying each node by its parent's world matrix in index
+ * order. */
+
+#include "cml_test.h"
+
+#define NODES 20000
+
+int
+main(void) {
+    i32*    parent = (i32*)malloc(NODES * sizeof(i32));
+    u32*    depth  = (u32*)malloc(NODES * sizeof(u32));
+    u32*    order  = (u32*)malloc(NODES * sizeof(u32));
+    size_t* start  = (size_t*)malloc((NODES + 1) * sizeof(size_t));
+    mat4*   local  = (mat4*)cml_aligned_alloc(64, NODES * sizeof(mat4));
+    mat4*   world  = (mat4*)cml_aligned_alloc(64, NODES * sizeof(mat4));
+    mat4*   expect = (mat4*)cml_aligned_alloc(64, NODES * sizeof(mat4));
+    if (!parent || !depth || !order || !start || !local || !world ||
+        !expect) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    /* Four roots, 64 children, one level wide enough to split across
+     * threads and a last one narrow enough to run on a single thread. */
+    rng r;
+    cml_math_rng_seed(&r, 5);
+    for (i32 i = 0; i < NODES; i++) {
+        parent[i] = i < 4       ? -1
+                  : i < 68      ? i % 4
+                  : i < 16000   ? 4 + i % 64
+                                : 68 + i % 1000;
+        local[i]  = cml_math_mat4_mul(
+                    cml_math_mat4_rotation(0.0, 0.0, 1.0,
+                                           cml_math_rng_next_f64(&r)),
+                    cml_math_mat4_translation(cml_math_rng_next_f64(&r),
+                                              0.5, -0.25));
+    }
+    for (i32 i = 0; i < NODES; i++) {
+        if (parent[i] < 0) {
+            expect[i] = local[i];
+        } else {
+            cml_math_mat4_mul_to(local + i, expect + parent[i], expect + i);
+        }
+    }
+    const size_t levels = cml_math_hierarchy_depth_order(parent, NODES, depth,
+                                                         order, start);
+    CHECK(levels > 2);
+    size_t widest = 0;
+    for (size_t l = 0; l < levels; l++) {
+        const size_t w = start[l + 1] - start[l];
+        widest = w > widest ? w : widest;
+    }
+    CHECK(widest >= CML_FLATTEN_PARALLEL_MIN);
+    cml_math_mat4_flatten_hierarchy(parent, local, world, order, start,
+                                    levels);
+    for (i32 i = 0; i < NODES; i++) {
+        for (i32 j = 0; j < 4; j++) {
+            for (i32 k = 0; k < 4; k++) {
+                CHECK(world[i].m[j][k] == expect[i].m[j][k]);
+            }
+        }
+    }
+    free(parent);
+    free(depth);
+    free(order);
+    free(start);
+    cml_aligned_free(local);
+    cml_aligned_free(world);
+    cml_aligned_free(expect);
+    return CML_TEST_RESULT();
+}
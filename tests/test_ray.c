@@ -0,0 +1,59 @@
+/* Slab tests accept rays lying in a face plane of the box, on the lo and the
+ * hi face alike, whatever the sign of the zero direction component. */
+
+#include "cml_test.h"
+
+int
+main(void) {
+    const vec4 lo = cml_math_vec4_set(0.0, 0.0, 0.0, 0.0);
+    const vec4 hi = cml_math_vec4_set(1.0, 1.0, 1.0, 0.0);
+    cml_align(32) vec4 o[8];
+    cml_align(32) vec4 d[8];
+    for (i32 i = 0; i < 8; i++) {
+        const f64 face = (i & 1) ? 1.0 : 0.0;
+        const f64 zero = (i & 2) ? -0.0 : 0.0;
+        if (i < 4) {
+            o[i] = cml_math_vec4_set(face, 0.5, -1.0, 0.0);
+            d[i] = cml_math_vec4_set(zero, 0.0, 1.0, 0.0);
+        } else {
+            o[i] = cml_math_vec4_set(0.5, face, -1.0, 0.0);
+            d[i] = cml_math_vec4_set(0.0, zero, 1.0, 0.0);
+        }
+    }
+
+    /* Packets. */
+    const ray4 r4 = cml_math_ray4_set(o, d);
+    f64x4 t4;
+    CHECK(cml_math_ray4_intersect_aabb(&r4, lo, hi, simde_mm256_set1_pd(0.0),
+                                       simde_mm256_set1_pd(10.0),
+                                       &t4) == 0xF);
+    CHECK(t4[0] == 1.0 && t4[1] == 1.0 && t4[2] == 1.0 && t4[3] == 1.0);
+    const ray8 r8 = cml_math_ray8_set(o, d);
+    f64x8 t8;
+    CHECK(cml_math_ray8_intersect_aabb(&r8, lo, hi, simde_mm512_set1_pd(0.0),
+                                       simde_mm512_set1_pd(10.0),
+                                       &t8) == 0xFF);
+    for (i32 i = 0; i < 8; i++) {
+        CHECK(t8[i] == 1.0);
+    }
+
+    /* Just outside each face still misses. */
+    const vec4 out[2] = {cml_math_vec4_set(-0x1.0p-40, 0.5, -1.0, 0.0),
+                         cml_math_vec4_set(1.0 + 0x1.0p-40, 0.5, -1.0, 0.0)};
+    cml_align(32) vec4 oo[4] = {out[0], out[1], out[0], out[1]};
+    const ray4 m4 = cml_math_ray4_set(oo, d);
+    CHECK(cml_math_ray4_intersect_aabb(&m4, lo, hi, simde_mm256_set1_pd(0.0),
+                                       simde_mm256_set1_pd(10.0),
+                                       &t4) == 0);
+
+    /* The BVH node and leaf tests, one ray at a time. */
+    bvh4 b = cml_math_bvh4_build(&lo, &hi, 1);
+    for (i32 i = 0; i < 8; i++) {
+        bvh4_hit h = {-1.0, 0.0, 0.0, 0};
+        CHECK(cml_math_bvh4_intersect_aabbs(&b, &lo, &hi, o[i], d[i], 0.0,
+                                            10.0, &h));
+        CHECK(h.t == 1.0);
+    }
+    cml_math_bvh4_free(&b);
+    return CML_TEST_RESULT();
+}
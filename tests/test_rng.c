@@ -0,0 +1,69 @@
+/* Vector uniform doubles match the scalar (x >> 11) * 0x1.0p-53 mapping on
+ * the same raw bits, so every one of the 53 bits reaches the result, and the
+ * bulk u64 fill gives the scalar xoshiro256** output of each lane. */
+
+#include "cml_test.h"
+
+static f64
+expected(const u64 x) {
+    return (f64)(x >> 11) * 0x1.0p-53;
+}
+
+int
+main(void) {
+    rngx2 r2;
+    rngx4 r4;
+    rngx8 r8;
+    cml_math_rngx2_seed(&r2, 1);
+    cml_math_rngx4_seed(&r4, 2);
+    cml_math_rngx8_seed(&r8, 3);
+    bool odd = false;
+    for (i32 k = 0; k < 256; k++) {
+        u64 b[8];
+        f64 u[8];
+        rngx2 c2 = r2;
+        simde_mm_storeu_si128((simde__m128i*)b, cml_math_rngx2_next(&c2));
+        simde_mm_storeu_pd(u, cml_math_rngx2_next_f64(&r2));
+        for (i32 i = 0; i < 2; i++) {
+            CHECK(u[i] == expected(b[i]));
+        }
+        rngx4 c4 = r4;
+        simde_mm256_storeu_si256((simde__m256i*)b, cml_math_rngx4_next(&c4));
+        simde_mm256_storeu_pd(u, cml_math_rngx4_next_f64(&r4));
+        for (i32 i = 0; i < 4; i++) {
+            CHECK(u[i] == expected(b[i]));
+        }
+        rngx8 c8 = r8;
+        simde_mm512_storeu_si512(b, cml_math_rngx8_next(&c8));
+        simde_mm512_storeu_pd(u, cml_math_rngx8_next_f64(&r8));
+        for (i32 i = 0; i < 8; i++) {
+            CHECK(u[i] == expected(b[i]));
+            CHECK(u[i] >= 0.0 && u[i] < 1.0);
+            odd |= (b[i] >> 11 & 1) != 0;
+        }
+    }
+    CHECK(odd);
+
+    /* The extremes of the mapping. */
+    f64 u[8];
+    simde_mm512_storeu_pd(u, cml_math_rng_bits_to_f64x8(
+                             simde_mm512_set1_epi64(-1)));
+    CHECK(u[0] == 1.0 - 0x1.0p-53);
+    simde_mm512_storeu_pd(u, cml_math_rng_bits_to_f64x8(
+                             simde_mm512_set1_epi64(0x800)));
+    CHECK(u[0] == 0x1.0p-53);
+
+    /* rand_fill_u64 interleaves the lanes; 3 values of the last step are
+     * discarded. */
+    rng lane[8];
+    cml_math_rngx8_seed(&r8, 4);
+    for (i32 j = 0; j < 8; j++) {
+        cml_math_rngx8_lane(&r8, j, lane + j, false);
+    }
+    u64 fill[101];
+    cml_math_rand_fill_u64(&r8, fill, 101);
+    for (i32 i = 0; i < 101; i++) {
+        CHECK(fill[i] == cml_math_rng_next(lane + i % 8));
+    }
+    return CML_TEST_RESULT();
+}
@@ -0,0 +1,47 @@
+/* The default generators are shared by every translation unit: a thread that
+ * draws here and in test_rng_streams_tu.c walks one stream, each vector
+ * default is one object, and the next default is seeded from the shared
+ * count. */
+
+#include "cml_test.h"
+
+#include <pthread.h>
+
+u64 cml_test_rand_other_tu(void);
+rng* cml_test_thread_rng_other_tu(void);
+rngx2* cml_test_thread_rngx2_other_tu(void);
+rngx4* cml_test_thread_rngx4_other_tu(void);
+rngx8* cml_test_thread_rngx8_other_tu(void);
+
+static void*
+second_thread(void* out) {
+    *(u64*)out = cml_test_rand_other_tu();
+    return NULL;
+}
+
+int
+main(void) {
+    CHECK(cml_math_rng_thread() == cml_test_thread_rng_other_tu());
+
+    rng expect = {{1, 2, 3, 4}};
+    const u64 a = cml_math_rand();
+    const u64 b = cml_test_rand_other_tu();
+    CHECK(a == cml_math_rng_next(&expect));
+    CHECK(b == cml_math_rng_next(&expect));
+
+    u64 c = 0;
+    pthread_t t;
+    CHECK(pthread_create(&t, NULL, second_thread, &c) == 0);
+    pthread_join(t, NULL);
+    u64 n = 1;
+    rng next;
+    cml_math_rng_seed(&next, cml_math_splitmix64(&n));
+    CHECK(c == cml_math_rng_next(&next));
+
+    /* The vector defaults take the next counts, once each. */
+    CHECK(cml_math_rngx2_thread() == cml_test_thread_rngx2_other_tu());
+    CHECK(cml_math_rngx4_thread() == cml_test_thread_rngx4_other_tu());
+    CHECK(cml_math_rngx8_thread() == cml_test_thread_rngx8_other_tu());
+    CHECK(cml_rng_default_count == 5);
+    return CML_TEST_RESULT();
+}
@@ -0,0 +1,34 @@
+/* Second translation unit of test_rng_streams. */
+
+#include "cml.h"
+
+u64 cml_test_rand_other_tu(void);
+rng* cml_test_thread_rng_other_tu(void);
+rngx2* cml_test_thread_rngx2_other_tu(void);
+rngx4* cml_test_thread_rngx4_other_tu(void);
+rngx8* cml_test_thread_rngx8_other_tu(void);
+
+u64
+cml_test_rand_other_tu(void) {
+    return cml_math_rand();
+}
+
+rng*
+cml_test_thread_rng_other_tu(void) {
+    return cml_math_rng_thread();
+}
+
+rngx2*
+cml_test_thread_rngx2_other_tu(void) {
+    return cml_math_rngx2_thread();
+}
+
+rngx4*
+cml_test_thread_rngx4_other_tu(void) {
+    return cml_math_rngx4_thread();
+}
+
+rngx8*
+cml_test_thread_rngx8_other_tu(void) {
+    return cml_math_rngx8_thread();
+}
@@ -0,0 +1,77 @@
+/* Every rotation constructor turns row vectors the same way: +90 degrees
+ * about z takes x to y. */
+
+#include "cml_test.h"
+
+static void
+check_vec4(const vec4 v, const f64 x, const f64 y, const f64 z) {
+    CHECK_NEAR(v.v[0], x, 1e-15);
+    CHECK_NEAR(v.v[1], y, 1e-15);
+    CHECK_NEAR(v.v[2], z, 1e-15);
+}
+
+int
+main(void) {
+    const vec4 x = cml_math_vec4_set(1.0, 0.0, 0.0, 1.0);
+    const vec4 y = cml_math_vec4_set(0.0, 1.0, 0.0, 1.0);
+    const vec4 z_axis = cml_math_vec4_set(0.0, 0.0, 1.0, 0.0);
+
+    /* mat4 path. */
+    const mat4 m = cml_math_mat4_rotation(0.0, 0.0, 1.0, CML_PI_DIV_2);
+    check_vec4(cml_math_mat4_mul_vec4(m, x), 0.0, 1.0, 0.0);
+    check_vec4(cml_math_mat4_mul_vec4(m, y), -1.0, 0.0, 0.0);
+
+    /* Batched mat4 path, four through the vector loop and one scalar. */
+    cml_align(32) vec4 axis[5];
+    cml_align(32) mat4 ms[5];
+    f64 angle[5];
+    for (i32 i = 0; i < 5; i++) {
+        axis[i]  = z_axis;
+        angle[i] = CML_PI_DIV_2;
+    }
+    cml_math_mat4_rotation_array(axis, angle, ms, 5);
+    for (i32 i = 0; i < 5; i++) {
+        check_vec4(cml_math_mat4_mul_vec4(ms[i], x), 0.0, 1.0, 0.0);
+    }
+
+    /* mat4f path. */
+    const mat4f mf = cml_math_mat4f_rotation(0.0f, 0.0f, 1.0f,
+                                             (f32)CML_PI_DIV_2);
+    CHECK_NEAR(mf.m[0][0], 0.0, 1e-7);
+    CHECK_NEAR(mf.m[0][1], 1.0, 1e-7);
+
+    /* quat paths. */
+    const quat q = cml_math_quat_from_axis_angle(z_axis, CML_PI_DIV_2);
+    check_vec4(cml_math_quat_rotate(q, x), 0.0, 1.0, 0.0);
+    vec4 out;
+    cml_math_quat_rotate_array(q, &x, &out, 1);
+    check_vec4(out, 0.0, 1.0, 0.0);
+
+    /* The matrix and quaternion of any axis and angle agree. */
+    const f64  l = sqrt(0.3 * 0.3 + 0.5 * 0.5 + 0.8 * 0.8);
+    const vec4 a = cml_math_vec4_set(0.3 / l, -0.5 / l, 0.8 / l, 0.0);
+    const mat4 ma = cml_math_mat4_rotation(a.v[0], a.v[1], a.v[2], 1.1);
+    const mat4 qa = cml_math_quat_rotation_rows(
+                    cml_math_quat_from_axis_angle(a, 1.1));
+    for (i32 r = 0; r < 4; r++) {
+        for (i32 c = 0; c < 4; c++) {
+            CHECK_NEAR(ma.m[r][c], qa.m[r][c], 1e-15);
+        }
+    }
+
+    /* Lane 3 of cross products is exactly zero and rotation keeps w exact,
+     * even when w * w rounds. */
+    const vec4 p = cml_math_vec4_set(0.1, 0.7, -0.3, 0.1);
+    const vec4 s = cml_math_vec4_set(-0.6, 0.2, 0.9, 0.3);
+    CHECK(cml_math_vec4_cross_product(p, s).v[3] == 0.0);
+    CHECK(cml_math_quat_rotate(cml_math_quat_from_axis_angle(a, 1.1),
+                               s).v[3] == 0.3);
+    const vec4f pf = cml_math_vec4f_set(0.1f, 0.7f, -0.3f, 0.1f);
+    const vec4f sf = cml_math_vec4f_set(-0.6f, 0.2f, 0.9f, 0.3f);
+    CHECK(cml_math_vec4f_cross_product(pf, sf).v[3] == 0.0f);
+    const quatf qf = cml_math_quatf_from_axis_angle(
+                     cml_math_vec4f_set(0.3f / (f32)l, -0.5f / (f32)l,
+                                        0.8f / (f32)l, 0.0f), 1.1f);
+    CHECK(cml_math_quatf_rotate(qf, sf).v[3] == 0.3f);
+    return CML_TEST_RESULT();
+}